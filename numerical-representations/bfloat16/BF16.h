@@ -1,47 +1,90 @@
 #ifndef BFLOAT16_H
 #define BFLOAT16_H
 
+#include "FloatFormat.h"
+#include "Chars.h"
 #include <cstdint>
+#include <cstddef>
+#include <cstring>
 #include <string>
 #include <iosfwd>
 #include <iostream>
 
 class BFloat16 {
 public:
+    // masks, bias and the arithmetic kernels
+    using Format = FloatFormat<8, 7>;
+    // the kernels per subnormal mode. the arithmetic runs the calling
+    // thread's subnormalMode(), see Rounding.h
+    template <SubnormalMode S>
+    using FormatFor = FloatFormat<8, 7, S>;
+    
     // constructors 
 
-    BFloat16();                          // default
-    explicit BFloat16(uint16_t bits);    // raw bits
+    constexpr BFloat16() : bits_(0) {}                            // default
+    constexpr explicit BFloat16(uint16_t bits) : bits_(bits) {}   // raw bits
     BFloat16(float value);               // native float
     BFloat16(double value);              // native double
     BFloat16(int value);                 // integer
+    BFloat16(float value, RoundingMode mode); // native float, any rounding mode
     
     // named constructors
 
-    static BFloat16 fromBits(uint16_t bits);
-    static BFloat16 zero(bool negative = false);
-    static BFloat16 infinity(bool negative = false);
-    static BFloat16 nan();
-    static BFloat16 epsilon();
+    static constexpr BFloat16 fromBits(uint16_t bits) { return BFloat16(bits); }
+    static constexpr BFloat16 zero(bool negative = false) {
+        return BFloat16(static_cast<uint16_t>(negative ? SIGN_MASK : 0));
+    }
+    static constexpr BFloat16 infinity(bool negative = false) {
+        return BFloat16(static_cast<uint16_t>((negative ? SIGN_MASK : 0) | EXPONENT_MASK));
+    }
+    static constexpr BFloat16 nan() {
+        // quiet nan exponent all 1s, mantissa non-zero with MSB set
+        return BFloat16(static_cast<uint16_t>(EXPONENT_MASK | 0x0040u));
+    }
+    static constexpr BFloat16 epsilon() {
+        // machine epsilon for BFloat16: 2^-7 (7 bit mantissa)
+        // smallest value such that 1.0 + epsilon != 1.0
+        return BFloat16(static_cast<uint16_t>(0x3C00u)); // exponent = 120 (127-7), mantissa = 0
+    }
     
     // accessors
 
-    uint16_t bits() const { return bits_; }
-    bool sign() const;
-    uint8_t exponent() const;
-    uint8_t mantissa() const;
-    int biasedExponent() const;
-    int unbiasedExponent() const;
+    constexpr uint16_t bits() const { return bits_; }
+    constexpr bool sign() const { return (bits_ & SIGN_MASK) != 0; }
+    constexpr uint8_t exponent() const {
+        return static_cast<uint8_t>((bits_ & EXPONENT_MASK) >> MANTISSA_BITS);
+    }
+    constexpr uint8_t mantissa() const { return static_cast<uint8_t>(bits_ & MANTISSA_MASK); }
+    constexpr int biasedExponent() const { return exponent(); }
+    constexpr int unbiasedExponent() const {
+        // subnormal numbers and zero share the minimum exponent
+        return exponent() == 0 ? 1 - EXPONENT_BIAS : exponent() - EXPONENT_BIAS;
+    }
     
     // classification
 
-    bool isZero() const;
-    bool isInfinity() const;
-    bool isNaN() const;
-    bool isNormal() const;
-    bool isSubnormal() const;
-    bool isFinite() const;
-    bool isNegative() const;
+    constexpr bool isZero() const {
+        // zero if exponent and mantissa are  zero 
+        return (bits_ & ~SIGN_MASK) == 0;
+    }
+    constexpr bool isInfinity() const {
+        // infinity if exponent is all 1s and mantissa is zero
+        return (bits_ & ~SIGN_MASK) == EXPONENT_MASK;
+    }
+    constexpr bool isNaN() const {
+        // nan if exponent is all 1s and mantissa is not zero
+        return (bits_ & ~SIGN_MASK) > EXPONENT_MASK;
+    }
+    constexpr bool isNormal() const {
+        return exponent() != 0 && exponent() != 0xFF;
+    }
+    constexpr bool isSubnormal() const {
+        return exponent() == 0 && mantissa() != 0;
+    }
+    constexpr bool isFinite() const {
+        return (bits_ & EXPONENT_MASK) != EXPONENT_MASK;
+    }
+    constexpr bool isNegative() const { return sign(); }
     
     // conversion
 
@@ -49,6 +92,9 @@ public:
     double toDouble() const;
     std::string toBinary() const;
     std::string toHex() const;
+
+    // longest toChars result, the Binary format
+    static constexpr size_t MAX_CHARS = 18;
     
     // arithmetic operators
 
@@ -58,11 +104,32 @@ public:
     BFloat16 operator/(const BFloat16& other) const;
     BFloat16 operator-() const;  // unary negation
     
+    // fused multiply-add: a * b + c rounded once
+    static BFloat16 fma(const BFloat16& a, const BFloat16& b, const BFloat16& c);
+    
+    // arithmetic in an explicit rounding mode (Rounding.h), the operators
+    // always round to nearest even
+    
+    static BFloat16 add(const BFloat16& a, const BFloat16& b, RoundingMode mode);
+    static BFloat16 subtract(const BFloat16& a, const BFloat16& b, RoundingMode mode);
+    static BFloat16 multiply(const BFloat16& a, const BFloat16& b, RoundingMode mode);
+    static BFloat16 divide(const BFloat16& a, const BFloat16& b, RoundingMode mode);
+    static BFloat16 fma(const BFloat16& a, const BFloat16& b, const BFloat16& c, RoundingMode mode);
+    static BFloat16 sqrt(const BFloat16& x, RoundingMode mode);
+    
     BFloat16& operator+=(const BFloat16& other);
     BFloat16& operator-=(const BFloat16& other);
     BFloat16& operator*=(const BFloat16& other);
     BFloat16& operator/=(const BFloat16& other);
     
+    // batched arithmetic, same results as the scalar operators
+    // out may alias either input
+
+    static void add(const BFloat16* a, const BFloat16* b, BFloat16* out, size_t n);
+    static void subtract(const BFloat16* a, const BFloat16* b, BFloat16* out, size_t n);
+    static void multiply(const BFloat16* a, const BFloat16* b, BFloat16* out, size_t n);
+    static void scale(const BFloat16* a, BFloat16 s, BFloat16* out, size_t n);
+    
     // comparison operators
 
     bool operator==(const BFloat16& other) const;
@@ -75,7 +142,13 @@ public:
     // mathematical functions
 
     BFloat16 abs() const;
-    BFloat16 sqrt() const;
+    BFloat16 sqrt() const;    // correctly rounded, integer arithmetic only
+    BFloat16 rsqrt() const;   // 1 / sqrt(x) below 0.5 ulp, see FloatFormat::rsqrt
+
+    // batched sqrt / rsqrt, dispatched to the best simd kernel at runtime,
+    // same results as the scalar functions. dst may alias src
+    static void sqrt(const BFloat16* src, BFloat16* dst, size_t n);
+    static void rsqrt(const BFloat16* src, BFloat16* dst, size_t n);
     
     // i/o
 
@@ -88,33 +161,95 @@ public:
     
     // conversion to / from FP32
 
-    uint32_t toFP32Bits() const;
-    static BFloat16 fromFP32Bits(uint32_t fp32_bits);
+    constexpr uint32_t toFP32Bits() const { return static_cast<uint32_t>(bits_) << 16; }
+    static constexpr BFloat16 fromFP32Bits(uint32_t fp32_bits) {
+        // round to nearest even for truncation
+        uint32_t rounding_bias = 0x7FFF + ((fp32_bits >> 16) & 1);
+        return BFloat16(static_cast<uint16_t>((fp32_bits + rounding_bias) >> 16));
+    }
     
 private:
     uint16_t bits_;  // actual representation
     
     // constants
 
-    static constexpr uint16_t SIGN_MASK     = 0x8000u;
-    static constexpr uint16_t EXPONENT_MASK = 0x7F80u;
-    static constexpr uint16_t MANTISSA_MASK = 0x007Fu;
-    static constexpr int EXPONENT_BIAS      = 127;
-    static constexpr int MANTISSA_BITS      = 7;
-    static constexpr int EXPONENT_BITS      = 8;
-    
-    // helper functions
-
-    static uint16_t packBits(bool sign, uint8_t exp, uint8_t mant);
-    static BFloat16 addImpl(const BFloat16& a, const BFloat16& b);
-    static BFloat16 multiplyImpl(const BFloat16& a, const BFloat16& b);
-    static int compareImpl(const BFloat16& a, const BFloat16& b);
-    static BFloat16 normalize(bool sign, int exp, uint32_t significand);
-    static uint16_t roundToNearest(uint32_t value, int shift);
+    static constexpr uint16_t SIGN_MASK     = Format::SIGN_MASK;
+    static constexpr uint16_t EXPONENT_MASK = Format::EXPONENT_MASK;
+    static constexpr uint16_t MANTISSA_MASK = Format::MANTISSA_MASK;
+    static constexpr int EXPONENT_BIAS      = Format::EXPONENT_BIAS;
+    static constexpr int MANTISSA_BITS      = Format::MANTISSA_BITS;
+    static constexpr int EXPONENT_BITS      = Format::EXPONENT_BITS;
 };
 
+// float conversions can't be constexpr before c++20 (no bit_cast),
+// but they are inline so hot loops don't pay for a call
+
+inline BFloat16::BFloat16(float value) {
+    // bf16 is the upper 16 bits of FP32, round to nearest even
+    uint32_t fp32_bits;
+    std::memcpy(&fp32_bits, &value, sizeof(float));
+    bits_ = fromFP32Bits(fp32_bits).bits_;
+}
+
+inline BFloat16::BFloat16(double value) {
+    // narrow to float rounding to odd, then to bf16. float keeps 16 more bits
+    // than bf16, so the second rounding is correct, unlike plain double ->
+    // float -> bf16 which can round twice at a bf16 halfway point
+    float narrowed = static_cast<float>(value);
+    uint32_t fp32_bits;
+    std::memcpy(&fp32_bits, &narrowed, sizeof(float));
+    if (static_cast<double>(narrowed) != value && value == value && (fp32_bits & 1) == 0) {
+        // inexact, step to the odd neighbour between narrowed and value
+        bool away = (static_cast<double>(narrowed) > value) == (value > 0);
+        fp32_bits = away ? fp32_bits - 1 : fp32_bits + 1;
+    }
+    bits_ = fromFP32Bits(fp32_bits).bits_;
+}
+
+inline BFloat16::BFloat16(int value) : BFloat16(static_cast<double>(value)) {
+    // exact in double, so rounded once
+}
+
+inline float BFloat16::toFloat() const {
+    // bf16 -> float by shifting 16 places
+    uint32_t fp32_bits = toFP32Bits();
+    float result;
+    std::memcpy(&result, &fp32_bits, sizeof(float));
+    return result;
+}
+
+inline double BFloat16::toDouble() const {
+    return static_cast<double>(toFloat());
+}
+
 // non member finctions
 BFloat16 abs(const BFloat16& x);
 BFloat16 sqrt(const BFloat16& x);
+BFloat16 rsqrt(const BFloat16& x);
+BFloat16 fma(const BFloat16& a, const BFloat16& b, const BFloat16& c);
+
+// allocation-free text conversion, see Chars.h. Shortest is the fewest
+// significant digits (at most 4) that parse back to the same BFloat16.
+// decimals parse to double and then round to BFloat16, which can only
+// misround an input within 2^-53 relative of a halfway point
+std::to_chars_result toChars(char* first, char* last, BFloat16 value,
+                             CharsFormat format = CharsFormat::Shortest);
+std::from_chars_result fromChars(const char* first, const char* last, BFloat16& value,
+                                 CharsFormat format = CharsFormat::Shortest);
+
+// bulk conversion, dispatches to the best simd kernel at runtime
+// results match BFloat16(float) / toFloat() bit for bit
+void convertToBF16(const float* src, BFloat16* dst, size_t n);
+void convertToFloat(const BFloat16* src, float* dst, size_t n);
+
+// from double, matching BFloat16(double): rounded once, never through a
+// nearest float first
+void convertToBF16(const double* src, BFloat16* dst, size_t n);
+
+// bulk narrowing in any rounding mode. stochastic rounding takes n words
+// from the calling thread's StochasticRng stream, element i the i-th, so
+// the result matches n BFloat16(src[i], Stochastic) calls in a row for any
+// simd level and thread count
+void convertToBF16(const float* src, BFloat16* dst, size_t n, RoundingMode mode);
 
 #endif // 
\ No newline at end of file
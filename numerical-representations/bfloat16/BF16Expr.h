@@ -0,0 +1,70 @@
+#ifndef BFLOAT16_EXPR_H
+#define BFLOAT16_EXPR_H
+
+#include "BF16.h"
+#include "BF16Vector.h"
+#include "Expr.h"
+#include <cstring>
+
+// lazy expressions over BF16Vector, see ../float/Expr.h
+//
+//   BF16Vector r = evaluate(lazy(a) * b + lazy(c) * d - e);   // operator bits
+//   BF16Vector w = evaluate(lazy(a) * b + lazy(c) * d - e, ExprPrecision::Widened);
+//
+// Rounded rounds each node in float registers, so neither mode goes
+// through the soft-float operators. Widened rounds once, through the bulk
+// conversion
+
+inline ExprArray<BFloat16> lazy(const BF16Vector& v) {
+    return ExprArray<BFloat16>(v.data(), v.size());
+}
+
+inline ExprArray<BFloat16> lazy(const BFloat16* data, size_t n) {
+    return ExprArray<BFloat16>(data, n);
+}
+
+template <>
+struct ExprOperand<BF16Vector> {
+    using Type = ExprArray<BFloat16>;
+    static Type get(const BF16Vector& v) { return lazy(v); }
+};
+
+template <>
+struct ExprOperand<BFloat16> {
+    using Type = ExprScalar<BFloat16>;
+    static Type get(BFloat16 value) { return Type(value); }
+};
+
+template <>
+struct ExprVector<BFloat16> {
+    using Type = BF16Vector;
+};
+
+template <>
+struct ExprElement<BFloat16> {
+    // round to nearest even on the float bits: add half an ulp less one,
+    // plus the low kept bit to break ties to even, and clear the low half.
+    // a carry out of the significand steps the exponent, up to infinity
+    static float round(float x) {
+        uint32_t bits;
+        std::memcpy(&bits, &x, sizeof(bits));
+        uint32_t rounded = (bits + 0x7FFFu + ((bits >> 16) & 1u)) & 0xFFFF0000u;
+        bits = (bits & 0x7FFFFFFFu) > 0x7F800000u ? uint32_t(BFloat16::Format::QUIET_NAN) << 16 : rounded;
+        std::memcpy(&x, &bits, sizeof(x));
+        return x;
+    }
+
+    static void narrow(const float* src, BFloat16* dst, size_t n) {
+        for (size_t i = 0; i < n; ++i) {
+            uint32_t bits;
+            std::memcpy(&bits, src + i, sizeof(bits));
+            dst[i] = BFloat16::fromBits(static_cast<uint16_t>(bits >> 16));
+        }
+    }
+
+    // a tile is far below the bulk conversion's parallel threshold, so
+    // this runs on the evaluating thread
+    static void round(const float* src, BFloat16* dst, size_t n) { convertToBF16(src, dst, n); }
+};
+
+#endif
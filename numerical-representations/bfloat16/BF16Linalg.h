@@ -0,0 +1,73 @@
+#ifndef BFLOAT16_LINALG_H
+#define BFLOAT16_LINALG_H
+
+#include "BF16.h"
+#include <cstddef>
+
+// mixed-precision linear algebra: BFloat16 inputs, FP32 accumulation
+//
+// matrices are row-major with a leading dimension (elements between rows).
+//
+// Native   - hardware float, simd kernels, cache-blocked gemm. results are
+//            deterministic on a given machine but the summation order is
+//            the kernel's, not the naive one.
+// Emulated - every product and sum goes through the soft-float FP32 type in
+//            the naive order (k ascending), so results are bit-exact across
+//            compilers and machines. meant as a reference, it is slow.
+//
+// HardwareDot - the AVX512_BF16 vdpbf16ps instruction's arithmetic. each
+//               fp32 lane takes a pair of products, the odd element's then
+//               the even one's, each a fused multiply-add rounded to
+//               nearest even with subnormal inputs read as zero and
+//               subnormal results flushed. cpus with the instruction run
+//               it, any other runs an emulation of it, and both produce the
+//               same bits. see below for the order. arm's BFDOT rounds
+//               its pair of products differently and is not modelled
+//
+// a bf16 x bf16 product has at most 16 significant bits, so it is exact in
+// fp32 in every mode; only the accumulation rounds.
+//
+// the HardwareDot order. a dot runs in chunks of 16384 elements whose
+// results add in index order (as Native does in the Deterministic
+// reduction mode). in a chunk, lane l < 64 accumulates elements 2l + 1
+// then 2l of every block of 128, the last block zero padded. the lanes
+// then fold in ordinary float adds: s[j] = (l[j] + l[j + 16]) +
+// (l[j + 32] + l[j + 48]) for j < 16, then s[j] += s[j + w] for w = 8, 4,
+// 2, 1. gemv is that per row, without the chunks. gemm keeps one lane
+// per output, runs the pairs along k in order with the last one zero
+// padded when k is odd, and ends with alpha * lane + beta * c.
+
+enum class LinalgMode {
+    Native,
+    Emulated,
+    HardwareDot
+};
+
+// sum x[i] * y[i]
+float dot(const BFloat16* x, const BFloat16* y, size_t n,
+          LinalgMode mode = LinalgMode::Native);
+
+// y = alpha * A x + beta * y, A is m x n
+// beta == 0 overwrites y without reading it
+void gemv(size_t m, size_t n, float alpha,
+          const BFloat16* A, size_t lda,
+          const BFloat16* x,
+          float beta, float* y,
+          LinalgMode mode = LinalgMode::Native);
+
+// C = alpha * A B + beta * C, A is m x k, B is k x n, C is m x n
+// beta == 0 overwrites C without reading it
+void gemm(size_t m, size_t n, size_t k, float alpha,
+          const BFloat16* A, size_t lda,
+          const BFloat16* B, size_t ldb,
+          float beta, float* C, size_t ldc,
+          LinalgMode mode = LinalgMode::Native);
+
+// the same on float operands: Native's blocking and kernels without the
+// widening, the fp32 baseline for the bf16 paths (see BF16Solve.h)
+void gemm(size_t m, size_t n, size_t k, float alpha,
+          const float* A, size_t lda,
+          const float* B, size_t ldb,
+          float beta, float* C, size_t ldc);
+
+#endif
@@ -0,0 +1,45 @@
+#ifndef BFLOAT16_MATH_H
+#define BFLOAT16_MATH_H
+
+#include "BF16.h"
+#include <cstddef>
+
+// elementary functions sized for bf16
+//
+// each one evaluates in float with a range reduction and a low-degree
+// polynomial, only as accurate as 8 significand bits need, then rounds to
+// nearest even. the error bounds below are the largest over all 65536
+// inputs against a double reference, in ulps of the result
+//
+//   exp      0.503    e^x, 2^k times a degree 4 polynomial on |r| <= ln2 / 2
+//   log      0.500    k ln2 + log(m), m in [sqrt(1/2), sqrt(2)), odd series in (m - 1) / (m + 1)
+//   tanh     0.499    odd polynomial below 0.25, (e^2x - 1) / (e^2x + 1) above
+//   sigmoid  0.500    1 / (1 + e^-x), or e^x / (1 + e^x) below 0 so nothing overflows
+//   erf      0.501    odd polynomial below 0.5, 1 - erfc(x) above
+//   gelu     0.504    x * Phi(x) with Phi from erfc, so the far negative tail keeps its digits
+//
+// erfc is the Chebyshev fit of Numerical Recipes (error 1.2e-7 relative).
+// nan gives the default nan, the infinities the limits, log of a negative
+// number is nan and log(+-0) is -infinity
+
+BFloat16 exp(const BFloat16& x);
+BFloat16 log(const BFloat16& x);
+BFloat16 tanh(const BFloat16& x);
+BFloat16 sigmoid(const BFloat16& x);
+BFloat16 erf(const BFloat16& x);
+BFloat16 gelu(const BFloat16& x);    // x * Phi(x), the erf form, not the tanh approximation
+
+// batched versions, dispatched to the best simd kernel at runtime and split
+// across the thread pool, same results as the scalar functions. erf and
+// gelu gather from a 64K table of the scalar results (128 KB each, built on
+// first use), their polynomial is too slow to be worth vectorizing. dst may
+// alias src
+
+void exp(const BFloat16* src, BFloat16* dst, size_t n);
+void log(const BFloat16* src, BFloat16* dst, size_t n);
+void tanh(const BFloat16* src, BFloat16* dst, size_t n);
+void sigmoid(const BFloat16* src, BFloat16* dst, size_t n);
+void erf(const BFloat16* src, BFloat16* dst, size_t n);
+void gelu(const BFloat16* src, BFloat16* dst, size_t n);
+
+#endif
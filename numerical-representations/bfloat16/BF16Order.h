@@ -0,0 +1,36 @@
+#ifndef BFLOAT16_ORDER_H
+#define BFLOAT16_ORDER_H
+
+#include "BF16.h"
+#include "Ordering.h"
+#include <cstddef>
+#include <utility>
+
+// bulk order ops over BFloat16 spans, see ../float/Ordering.h for the nan
+// policies
+//
+// every op works on the 16-bit total order key of the bits, so the simd
+// kernels are unsigned min / max / compare on 16 (avx2) or 32 (avx512)
+// lanes, with no branch per element and the same results at every level.
+// argmin / argmax / minmax / clamp split large spans across the thread
+// pool.
+//
+// argmin / argmax give the first index of the smallest / largest element,
+// n for an empty span. minmax of an empty span is (nan, nan). clamp throws
+// std::invalid_argument if lo or hi is nan or lo > hi.
+//
+// sort is ascending. large spans are a counting sort: a histogram of the
+// 65536 keys, then each key's bits written out count times, one read and
+// one write of the data. short spans sort the keys by comparison
+
+size_t argmin(const BFloat16* x, size_t n, NaNPolicy policy = NaNPolicy::Propagate);
+size_t argmax(const BFloat16* x, size_t n, NaNPolicy policy = NaNPolicy::Propagate);
+std::pair<BFloat16, BFloat16> minmax(const BFloat16* x, size_t n, NaNPolicy policy = NaNPolicy::Propagate);
+
+// dst may alias src
+void clamp(const BFloat16* src, BFloat16* dst, size_t n, BFloat16 lo, BFloat16 hi,
+           NaNPolicy policy = NaNPolicy::Propagate);
+
+void sort(BFloat16* x, size_t n, NaNPolicy policy = NaNPolicy::Propagate);
+
+#endif
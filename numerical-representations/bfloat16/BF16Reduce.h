@@ -0,0 +1,33 @@
+#ifndef BFLOAT16_REDUCE_H
+#define BFLOAT16_REDUCE_H
+
+#include "BF16.h"
+#include "Summation.h"
+#include <cstddef>
+
+// reductions over BFloat16 spans, returning float. see ../float/Summation.h
+// for the strategies
+//
+// Naive, Pairwise, Kahan and Neumaier accumulate in BFloat16 precision:
+// every add, and every product in dot / norm2, rounds to the nearest
+// BFloat16 exactly as the operators do. Kahan and Neumaier fold their
+// compensation in at the end, in float. Neumaier's per-add error terms
+// are exact bf16 values and its compensation sums them in float. Widened
+// sums the exact products in float. chunks are combined in float.
+//
+// the bf16-precision strategies follow the calling thread's subnormal mode
+// (Rounding.h): under Flush subnormal terms read as zero and subnormal
+// results flush, as with the operators. Widened sums the stored values.
+//
+// all strategies but Naive have AVX2 / AVX-512 kernels that give the same
+// bits as the scalar one. mean of an empty span is NaN, norm2 does not
+// rescale.
+
+float sum(const BFloat16* x, size_t n, Summation method = Summation::Widened);
+float mean(const BFloat16* x, size_t n, Summation method = Summation::Widened);
+float norm2(const BFloat16* x, size_t n, Summation method = Summation::Widened);
+
+// no default, dot(x, y, n) is the mixed-precision one in BF16Linalg.h
+float dot(const BFloat16* x, const BFloat16* y, size_t n, Summation method);
+
+#endif
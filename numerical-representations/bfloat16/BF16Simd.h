@@ -0,0 +1,59 @@
+#ifndef BFLOAT16_SIMD_H
+#define BFLOAT16_SIMD_H
+
+#include "BF16.h"
+#include "BF16Linalg.h"
+#include "Ordering.h"
+#include "Simd.h"
+#include "Summation.h"
+#include <cstddef>
+#include <utility>
+
+// bulk conversion pinned to a specific kernel, mostly for testing
+// a level the cpu does not support falls back to scalar
+void convertToBF16(const float* src, BFloat16* dst, size_t n, SimdLevel level);
+void convertToBF16(const double* src, BFloat16* dst, size_t n, SimdLevel level);
+void convertToFloat(const BFloat16* src, float* dst, size_t n, SimdLevel level);
+void convertToBF16(const float* src, BFloat16* dst, size_t n, RoundingMode mode, SimdLevel level);
+
+// native linear algebra kernels pinned to a level, see BF16Linalg.h
+float dot(const BFloat16* x, const BFloat16* y, size_t n, SimdLevel level);
+void gemm(size_t m, size_t n, size_t k, float alpha,
+          const BFloat16* A, size_t lda, const BFloat16* B, size_t ldb,
+          float beta, float* C, size_t ldc, SimdLevel level);
+
+// linear algebra in any mode pinned to a level. Native is the pair above,
+// Emulated ignores the level. HardwareDot issues vdpbf16ps at AVX512BF16,
+// emulates it with fma under MXCSR FZ + DAZ at AVX2 / AVX512 and in the
+// soft-float FP32 type at Scalar, with the same bits at every level
+float dot(const BFloat16* x, const BFloat16* y, size_t n, LinalgMode mode, SimdLevel level);
+void gemv(size_t m, size_t n, float alpha, const BFloat16* A, size_t lda, const BFloat16* x,
+          float beta, float* y, LinalgMode mode, SimdLevel level);
+void gemm(size_t m, size_t n, size_t k, float alpha,
+          const BFloat16* A, size_t lda, const BFloat16* B, size_t ldb,
+          float beta, float* C, size_t ldc, LinalgMode mode, SimdLevel level);
+
+// batched sqrt / rsqrt pinned to a level, see BFloat16::sqrt
+void sqrt(const BFloat16* src, BFloat16* dst, size_t n, SimdLevel level);
+void rsqrt(const BFloat16* src, BFloat16* dst, size_t n, SimdLevel level);
+
+// elementary functions pinned to a level, see BF16Math.h
+void exp(const BFloat16* src, BFloat16* dst, size_t n, SimdLevel level);
+void log(const BFloat16* src, BFloat16* dst, size_t n, SimdLevel level);
+void tanh(const BFloat16* src, BFloat16* dst, size_t n, SimdLevel level);
+void sigmoid(const BFloat16* src, BFloat16* dst, size_t n, SimdLevel level);
+void erf(const BFloat16* src, BFloat16* dst, size_t n, SimdLevel level);
+void gelu(const BFloat16* src, BFloat16* dst, size_t n, SimdLevel level);
+
+// reductions pinned to a level, see BF16Reduce.h
+float sum(const BFloat16* x, size_t n, Summation method, SimdLevel level);
+float dot(const BFloat16* x, const BFloat16* y, size_t n, Summation method, SimdLevel level);
+
+// order ops pinned to a level, see BF16Order.h
+size_t argmin(const BFloat16* x, size_t n, NaNPolicy policy, SimdLevel level);
+size_t argmax(const BFloat16* x, size_t n, NaNPolicy policy, SimdLevel level);
+std::pair<BFloat16, BFloat16> minmax(const BFloat16* x, size_t n, NaNPolicy policy, SimdLevel level);
+void clamp(const BFloat16* src, BFloat16* dst, size_t n, BFloat16 lo, BFloat16 hi,
+           NaNPolicy policy, SimdLevel level);
+
+#endif
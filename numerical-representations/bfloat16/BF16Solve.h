@@ -0,0 +1,93 @@
+#ifndef BFLOAT16_SOLVE_H
+#define BFLOAT16_SOLVE_H
+
+#include "BF16Linalg.h"
+#include <cstddef>
+#include <vector>
+
+// mixed-precision linear solves: a blocked LU or Cholesky factorization
+// whose trailing updates, the O(n^3) part, run through gemm on BFloat16
+// operands, then iterative refinement with residuals in FP32 or FP64
+//
+// the factorizations are right-looking on a row-major float matrix. each
+// block column of nb is factored in float (LU with partial pivoting, whole
+// rows swapped), and the rest of the matrix is updated by
+// A22 -= L21 U12 (LU) or A22 -= L21 L21^T (Cholesky, lower block triangle
+// only). with BF16, A is rounded to BFloat16 first, the L21 / U12 panels
+// are rounded before each update, and the update is the mixed-precision
+// gemm in the given LinalgMode, accumulating in float. with FP32 it is the
+// float gemm with the same kernels. the factors are stored in float either
+// way, and the triangular solves run in float
+//
+// the bf16 factors are off by about u = 2^-8 relative to A, so each
+// correction shrinks the error by roughly kappa(A) u. refinement converges
+// while that is below 1 and stagnates or diverges past it, where fp32
+// factors (u = 2^-24) still converge: hilbert 6 (kappa 1.5e7) is one such
+// matrix. a bf16 Cholesky factorization can also break down there
+
+enum class Factorization {
+    LU,
+    Cholesky    // A symmetric positive definite, the factorization reads the lower triangle
+};
+
+enum class FactorPrecision {
+    BF16,
+    FP32
+};
+
+enum class ResidualPrecision {
+    FP32,
+    FP64
+};
+
+struct FactorOptions {
+    FactorPrecision precision = FactorPrecision::BF16;
+    LinalgMode mode = LinalgMode::Native;   // the bf16 gemm's
+    size_t block = 128;                     // nb, the panel width
+};
+
+// in place. LU leaves the unit lower L and U in A, row i swapped with
+// pivots[i] at step i. Cholesky leaves L in the lower triangle and the
+// upper one undefined. false on a zero pivot (LU) or a pivot that is
+// not positive (Cholesky), with A part factored. a zero block or lda < n
+// throws std::invalid_argument
+bool factorLU(size_t n, float* A, size_t lda, size_t* pivots, const FactorOptions& options = FactorOptions());
+bool factorCholesky(size_t n, float* A, size_t lda, const FactorOptions& options = FactorOptions());
+
+// x = A^-1 x from the factors, in place
+void solveLU(size_t n, const float* LU, size_t lda, const size_t* pivots, float* x);
+void solveCholesky(size_t n, const float* L, size_t lda, float* x);
+
+// refinement: x0 solves from the factors, then until converged
+// r = b - A x (in the residual precision, x held in it too), d = A^-1 r
+// from the factors, x += d. it stops on the normwise backward error
+// ||r||inf / (||A||inf ||x||inf + ||b||inf) at or below tolerance
+// (converged), when it stops shrinking (the correction that did not help
+// is undone), or after max_iterations corrections. tolerance 0 is
+// sqrt(n) u of the residual precision, as lapack's dsgesv
+struct RefinementOptions {
+    Factorization factorization = Factorization::LU;
+    FactorOptions factor;
+    ResidualPrecision residual = ResidualPrecision::FP64;
+    size_t max_iterations = 30;
+    double tolerance = 0;
+};
+
+struct RefinementResult {
+    bool factored = false;     // false when the factorization broke down, x untouched
+    bool converged = false;
+    size_t iterations = 0;     // corrections applied
+    double backward_error = 0;
+    std::vector<double> history;   // backward error of x0, then after each correction
+
+    // wall time, the initial solve counts with the factorization
+    double factor_seconds = 0;
+    double refine_seconds = 0;
+    double secondsPerIteration() const { return iterations ? refine_seconds / iterations : 0; }
+};
+
+// A x = b, A n x n row major with leading dimension lda
+RefinementResult solveRefined(size_t n, const double* A, size_t lda, const double* b, double* x,
+                              const RefinementOptions& options = RefinementOptions());
+
+#endif
@@ -0,0 +1,75 @@
+#ifndef BFLOAT16_TABLES_H
+#define BFLOAT16_TABLES_H
+
+#include "BF16.h"
+#include <cstddef>
+#include <cstdint>
+
+// table-backed unary ops
+//
+// bf16 only has 65536 bit patterns, so every unary op can be a single
+// indexed load. the tables are filled from the scalar BFloat16 functions
+// on first use, so results match them bit for bit. sqrt and reciprocal
+// hold the ieee results (SubnormalMode::Preserve) whatever the mode of
+// the thread that builds or reads them. after construction the object is
+// read-only and can be shared freely across threads.
+
+class BFloat16Tables {
+public:
+    // classification flags stored per pattern
+    enum ClassFlags : uint8_t {
+        CLASS_ZERO      = 1u << 0,
+        CLASS_SUBNORMAL = 1u << 1,
+        CLASS_NORMAL    = 1u << 2,
+        CLASS_INFINITY  = 1u << 3,
+        CLASS_NAN       = 1u << 4,
+        CLASS_NEGATIVE  = 1u << 5
+    };
+
+    static constexpr size_t TABLE_SIZE = 65536;
+
+    // built once on first call, thread safe
+    static const BFloat16Tables& instance();
+
+    // unary ops
+
+    BFloat16 sqrt(BFloat16 x) const { return BFloat16::fromBits(sqrt_[x.bits()]); }
+    BFloat16 reciprocal(BFloat16 x) const { return BFloat16::fromBits(reciprocal_[x.bits()]); }
+    BFloat16 abs(BFloat16 x) const { return BFloat16::fromBits(abs_[x.bits()]); }
+    BFloat16 negate(BFloat16 x) const { return BFloat16::fromBits(negate_[x.bits()]); }
+    float toFloat(BFloat16 x) const { return to_float_[x.bits()]; }
+
+    // classification
+
+    uint8_t classify(BFloat16 x) const { return class_[x.bits()]; }
+    bool isZero(BFloat16 x) const { return (class_[x.bits()] & CLASS_ZERO) != 0; }
+    bool isSubnormal(BFloat16 x) const { return (class_[x.bits()] & CLASS_SUBNORMAL) != 0; }
+    bool isNormal(BFloat16 x) const { return (class_[x.bits()] & CLASS_NORMAL) != 0; }
+    bool isInfinity(BFloat16 x) const { return (class_[x.bits()] & CLASS_INFINITY) != 0; }
+    bool isNaN(BFloat16 x) const { return (class_[x.bits()] & CLASS_NAN) != 0; }
+    bool isFinite(BFloat16 x) const {
+        return (class_[x.bits()] & (CLASS_INFINITY | CLASS_NAN)) == 0;
+    }
+
+    // bulk versions, src and dst may alias
+
+    void sqrt(const BFloat16* src, BFloat16* dst, size_t n) const;
+    void reciprocal(const BFloat16* src, BFloat16* dst, size_t n) const;
+    void toFloat(const BFloat16* src, float* dst, size_t n) const;
+
+private:
+    BFloat16Tables();
+    BFloat16Tables(const BFloat16Tables&) = delete;
+    BFloat16Tables& operator=(const BFloat16Tables&) = delete;
+
+    static void lookup(const uint16_t* table, const BFloat16* src, BFloat16* dst, size_t n);
+
+    uint16_t sqrt_[TABLE_SIZE];
+    uint16_t reciprocal_[TABLE_SIZE];
+    uint16_t abs_[TABLE_SIZE];
+    uint16_t negate_[TABLE_SIZE];
+    float to_float_[TABLE_SIZE];
+    uint8_t class_[TABLE_SIZE];
+};
+
+#endif
@@ -0,0 +1,205 @@
+#ifndef BFLOAT16_TENSOR_H
+#define BFLOAT16_TENSOR_H
+
+#include "BF16.h"
+#include "FP32.h"
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// binary tensor files for BFloat16 and FP32 arrays
+//
+// a 96-byte header, every field little-endian:
+//
+//   0   magic       "NRTENSOR"
+//   8   version     u16, 1
+//   10  dtype       u8, TensorDType
+//   11  byte order  u8, 0 little / 1 big, of the elements only
+//   12  rank        u32, at most TENSOR_MAX_RANK (0 is a scalar)
+//   16  alignment   u64, power of two
+//   24  data offset u64, first multiple of alignment past the header, and
+//                   a multiple of the element size
+//   32  shape       u64[8], unused dimensions are 0
+//
+// then the elements, row-major and packed, in the recorded byte order. the
+// writer always uses the host order. a mapped tensor is usable in place only
+// in host order; convertTensorFile rewrites a foreign file in host order.
+//
+// malformed or truncated files throw std::runtime_error, using a tensor
+// with the wrong type throws std::logic_error
+
+enum class TensorDType : uint8_t {
+    FP32 = 1,
+    BF16 = 2
+};
+
+constexpr size_t TENSOR_HEADER_BYTES = 96;
+constexpr size_t TENSOR_MAX_RANK = 8;
+constexpr size_t TENSOR_DEFAULT_ALIGNMENT = 64;
+
+size_t tensorElementBytes(TensorDType dtype);
+
+struct TensorInfo {
+    TensorDType dtype = TensorDType::BF16;
+    std::vector<size_t> shape;
+    bool little_endian = true;
+    size_t alignment = TENSOR_DEFAULT_ALIGNMENT;
+    size_t data_offset = 0;
+
+    size_t elements() const;
+    size_t dataBytes() const { return elements() * tensorElementBytes(dtype); }
+};
+
+// read-only mapping of a tensor file, data is never copied. the mapping
+// lives as long as the object, move-only
+class MappedTensor {
+public:
+    explicit MappedTensor(const std::string& path);
+    ~MappedTensor();
+
+    MappedTensor(MappedTensor&& other) noexcept;
+    MappedTensor& operator=(MappedTensor&& other) noexcept;
+    MappedTensor(const MappedTensor&) = delete;
+    MappedTensor& operator=(const MappedTensor&) = delete;
+
+    const TensorInfo& info() const { return info_; }
+    size_t size() const { return info_.elements(); }
+    bool hostByteOrder() const;
+
+    // raw element bytes, whatever the type and byte order
+    const void* data() const { return data_; }
+
+    // typed spans of size() elements. throw std::logic_error for the other
+    // dtype or a foreign byte order
+    const BFloat16* bf16() const;
+    const FP32* fp32() const;
+
+private:
+    TensorInfo info_;
+    void* base_;
+    size_t mapped_bytes_;
+    const unsigned char* data_;
+
+    void release();
+    void checkUsable(TensorDType dtype) const;
+};
+
+// appends elements to a new tensor file, converting to the file's dtype on
+// the way (BFloat16 narrowing rounds to nearest even). close() throws
+// std::logic_error unless exactly shape-many elements were written; the
+// destructor closes without checking, leaving a file the reader rejects
+class TensorWriter {
+public:
+    TensorWriter(const std::string& path, TensorDType dtype, const std::vector<size_t>& shape,
+                 size_t alignment = TENSOR_DEFAULT_ALIGNMENT);
+    ~TensorWriter();
+
+    TensorWriter(const TensorWriter&) = delete;
+    TensorWriter& operator=(const TensorWriter&) = delete;
+
+    // throw std::length_error past the end of the tensor
+    void write(const BFloat16* data, size_t n);
+    void write(const FP32* data, size_t n);
+    void write(const float* data, size_t n);
+
+    void close();
+
+    const TensorInfo& info() const { return info_; }
+    size_t written() const { return written_; }
+
+private:
+    TensorInfo info_;
+    std::string path_;
+    std::FILE* file_;
+    size_t written_;
+    std::vector<BFloat16> narrow_;   // conversion buffers, one chunk each
+    std::vector<float> wide_;
+
+    void reserve(size_t n);
+    void put(const void* bytes, size_t count);
+};
+
+// one-call save, same as a writer fed the whole span
+void saveTensor(const std::string& path, const BFloat16* data, const std::vector<size_t>& shape);
+void saveTensor(const std::string& path, const FP32* data, const std::vector<size_t>& shape);
+
+// streams src into a new tensor of the given dtype, chunk elements at a
+// time, so neither file is ever held in memory. a foreign byte order is
+// swapped on the way. the pipelined converter below without statistics
+void convertTensorFile(const std::string& src, const std::string& dst, TensorDType dtype,
+                       size_t chunk = size_t(1) << 20);
+
+// the same from a headerless file of host-order float32 values, as written
+// by numpy's tofile(), shaped by shape
+void convertRawFloatFile(const std::string& src, const std::string& dst,
+                         const std::vector<size_t>& shape, TensorDType dtype,
+                         size_t chunk = size_t(1) << 20);
+
+// pipelined conversion
+//
+// a reader thread, the conversion on the calling thread and a writer
+// thread, handing chunks along two bounded rings of depth buffers, so the
+// disk reads the next chunk while this one converts and the last one is
+// written. the conversion splits each chunk across the thread pool and
+// runs the bulk simd kernels a tile at a time; double sources narrow with
+// convertToBF16(const double*), rounded once.
+//
+// the statistics are gathered in the same pass, each tile still in L1, so
+// no element is read twice. the reference is the source value, the error
+// converted - source, both in double: what utils/norms.py's vector_norm
+// and relative_error give for p = 0, 1, 2 and inf. the l2 norms are scaled
+// by the largest magnitude as norms.py scales them, so a double source
+// cannot overflow them. nan and infinite sources, and finite sources that
+// overflow to infinity, are counted and left out of every norm (numpy
+// would make them nan). the result follows reductionMode()
+//
+// direct_io opens both files O_DIRECT where the file system takes it and
+// silently falls back to the page cache where it does not. the output is
+// then written in whole 4096-byte blocks and cut to length, and its data
+// starts at a 4096 alignment. the header is written last, so a conversion
+// that fails part way leaves a file the reader rejects
+
+enum class RawDType : uint8_t {
+    Float32,
+    Float64
+};
+
+struct PipelineOptions {
+    size_t chunk = size_t(1) << 20;   // elements per buffer, rounded up to 4096
+    size_t depth = 4;                 // buffers in each ring, at least 2
+    bool direct_io = false;
+    bool statistics = true;
+};
+
+struct ConversionStats {
+    size_t elements = 0;
+    size_t nonfinite = 0;    // nan or infinite sources
+    size_t overflow = 0;     // finite sources converted to infinity
+    size_t changed = 0;      // p = 0 of the error, elements not exact
+    size_t nonzero = 0;      // p = 0 of the reference
+
+    double error_l1 = 0, error_max = 0, error_scale = 0, error_ssq = 0;
+    double ref_l1 = 0, ref_max = 0, ref_scale = 0, ref_ssq = 0;
+
+    // p is 0, 1, 2 or infinity, anything else throws std::invalid_argument
+    double errorNorm(double p = 2) const;
+    double referenceNorm(double p = 2) const;
+    // errorNorm / referenceNorm, infinity for a zero reference with any
+    // error and 0 without
+    double relativeError(double p = 2) const;
+
+    // the statistics of both spans, this one first
+    ConversionStats& merge(const ConversionStats& other);
+};
+
+ConversionStats convertTensorFile(const std::string& src, const std::string& dst, TensorDType dtype,
+                                  const PipelineOptions& options);
+
+// a headerless file of host-order float32 or float64 values
+ConversionStats convertRawFile(const std::string& src, const std::string& dst,
+                               const std::vector<size_t>& shape, RawDType src_dtype, TensorDType dtype,
+                               const PipelineOptions& options = PipelineOptions());
+
+#endif
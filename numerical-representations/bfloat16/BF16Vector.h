@@ -0,0 +1,26 @@
+#ifndef BFLOAT16_VECTOR_H
+#define BFLOAT16_VECTOR_H
+
+#include "AlignedVector.h"
+#include "BF16.h"
+#include <cstddef>
+#include <cstdint>
+
+// packed array of BFloat16 with 64-byte aligned storage, and the arena for
+// short-lived ones, see ../float/AlignedVector.h
+
+template <>
+struct VectorElement<BFloat16> {
+    using Bits = uint16_t;
+
+    // the bulk conversions, simd and split across the thread pool
+    static void fromFloats(const float* src, BFloat16* dst, size_t n) { convertToBF16(src, dst, n); }
+    static void toFloats(const BFloat16* src, float* dst, size_t n) { convertToFloat(src, dst, n); }
+};
+
+using BF16Arena = VectorArena;
+using BF16Vector = AlignedVector<BFloat16>;
+
+extern template class AlignedVector<BFloat16>;
+
+#endif
@@ -0,0 +1,197 @@
+#ifndef FP8_H
+#define FP8_H
+
+#include "BF16.h"
+#include "BF16Simd.h"
+#include "FloatFormat.h"
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <ostream>
+
+// 8-bit floats for inference experiments
+//
+// both layouts come from FloatFormat (../float/FloatFormat.h) and follow
+// the OCP FP8 spec, as PyTorch's float8_e4m3fn / float8_e5m2 do. E5M2 is
+// IEEE-style (bias 15, max 57344, infinities). E4M3 is E4M3FN (bias 7, max
+// 448): no infinities, S.1111.111 is NaN, and whatever would overflow to
+// infinity is NaN instead, so infinity() is a NaN and isInfinity() is
+// always false. every FP8 value is exact in BFloat16 and float.
+
+template <int E, int M, FloatEncoding ENC = FloatEncoding::Ieee>
+class FP8Tables {
+public:
+    // 256 x 256 results per binary op, indexed by (a << 8) | b
+    static constexpr size_t TABLE_SIZE = 256 * 256;
+
+    // built once on first call, thread safe
+    static const FP8Tables& instance() {
+        static const FP8Tables tables;
+        return tables;
+    }
+
+    uint8_t add(uint8_t a, uint8_t b) const { return add_[index(a, b)]; }
+    uint8_t subtract(uint8_t a, uint8_t b) const { return subtract_[index(a, b)]; }
+    uint8_t multiply(uint8_t a, uint8_t b) const { return multiply_[index(a, b)]; }
+    uint8_t divide(uint8_t a, uint8_t b) const { return divide_[index(a, b)]; }
+
+    // FP32 bit pattern of every value, the source of the gather kernels
+    uint32_t toFP32Bits(uint8_t x) const { return to_fp32_[x]; }
+    const uint32_t* fp32Table() const { return to_fp32_; }
+
+private:
+    // filled from the FloatFormat kernels, so both agree bit for bit
+    FP8Tables();
+    FP8Tables(const FP8Tables&) = delete;
+    FP8Tables& operator=(const FP8Tables&) = delete;
+
+    static size_t index(uint8_t a, uint8_t b) { return (static_cast<size_t>(a) << 8) | b; }
+
+    uint8_t add_[TABLE_SIZE];
+    uint8_t subtract_[TABLE_SIZE];
+    uint8_t multiply_[TABLE_SIZE];
+    uint8_t divide_[TABLE_SIZE];
+    alignas(64) uint32_t to_fp32_[256];
+};
+
+template <int E, int M, FloatEncoding ENC = FloatEncoding::Ieee>
+class FP8 {
+public:
+    using Format = FloatFormat<E, M, SubnormalMode::Preserve, ENC>;
+    using Tables = FP8Tables<E, M, ENC>;
+    static_assert(Format::TOTAL_BITS == 8, "FP8 formats are 8 bits wide");
+
+    // constructors, rounding to nearest even
+
+    constexpr FP8() : bits_(0) {}
+    constexpr explicit FP8(uint8_t bits) : bits_(bits) {}
+    FP8(float value) : bits_(Format::fromFP32Bits(floatBits(value))) {}
+    FP8(double value) : FP8(static_cast<float>(value)) {}
+    FP8(int value) : FP8(static_cast<float>(value)) {}
+    explicit FP8(BFloat16 value) : bits_(Format::fromFP32Bits(value.toFP32Bits())) {}
+
+    // named constructors
+
+    static constexpr FP8 fromBits(uint8_t bits) { return FP8(bits); }
+    static constexpr FP8 zero(bool negative = false) { return FP8(Format::zero(negative)); }
+    static constexpr FP8 infinity(bool negative = false) { return FP8(Format::infinity(negative)); }
+    static constexpr FP8 nan() { return FP8(Format::nan()); }
+    static constexpr FP8 epsilon() { return FP8(Format::epsilon()); }
+    static constexpr FP8 max() { return FP8(Format::maxFinite()); }
+    static constexpr FP8 minNormal() { return FP8(Format::minNormal()); }
+    static constexpr FP8 minSubnormal() { return FP8(Format::minSubnormal()); }
+
+    // accessors
+
+    constexpr uint8_t bits() const { return bits_; }
+    constexpr bool sign() const { return Format::sign(bits_); }
+    constexpr int exponent() const { return Format::field(bits_); }
+    constexpr uint8_t mantissa() const { return static_cast<uint8_t>(bits_ & Format::MANTISSA_MASK); }
+
+    // classification
+
+    constexpr bool isZero() const { return Format::isZero(bits_); }
+    constexpr bool isInfinity() const { return Format::isInfinity(bits_); }
+    constexpr bool isNaN() const { return Format::isNaN(bits_); }
+    constexpr bool isNormal() const { return Format::isNormal(bits_); }
+    constexpr bool isSubnormal() const { return Format::isSubnormal(bits_); }
+    constexpr bool isFinite() const { return Format::isFinite(bits_); }
+    constexpr bool isNegative() const { return sign(); }
+
+    // conversion, widening is exact
+
+    uint32_t toFP32Bits() const { return Format::toFP32Bits(bits_); }
+    static FP8 fromFP32Bits(uint32_t fp32_bits) { return FP8(Format::fromFP32Bits(fp32_bits)); }
+    float toFloat() const {
+        uint32_t fp32_bits = toFP32Bits();
+        float result;
+        std::memcpy(&result, &fp32_bits, sizeof(float));
+        return result;
+    }
+    double toDouble() const { return static_cast<double>(toFloat()); }
+    BFloat16 toBFloat16() const { return BFloat16::fromBits(static_cast<uint16_t>(toFP32Bits() >> 16)); }
+
+    // arithmetic, one table lookup each
+
+    FP8 operator+(const FP8& other) const { return FP8(Tables::instance().add(bits_, other.bits_)); }
+    FP8 operator-(const FP8& other) const { return FP8(Tables::instance().subtract(bits_, other.bits_)); }
+    FP8 operator*(const FP8& other) const { return FP8(Tables::instance().multiply(bits_, other.bits_)); }
+    FP8 operator/(const FP8& other) const { return FP8(Tables::instance().divide(bits_, other.bits_)); }
+    FP8 operator-() const { return FP8(static_cast<uint8_t>(bits_ ^ Format::SIGN_MASK)); }
+
+    FP8& operator+=(const FP8& other) { return *this = *this + other; }
+    FP8& operator-=(const FP8& other) { return *this = *this - other; }
+    FP8& operator*=(const FP8& other) { return *this = *this * other; }
+    FP8& operator/=(const FP8& other) { return *this = *this / other; }
+
+    // three operands would need a 16M entry table, so fma stays computed
+    static FP8 fma(const FP8& a, const FP8& b, const FP8& c) {
+        return FP8(Format::fma(a.bits_, b.bits_, c.bits_));
+    }
+
+    // batched arithmetic, same results as the scalar operators
+    // out may alias either input
+
+    static void add(const FP8* a, const FP8* b, FP8* out, size_t n);
+    static void subtract(const FP8* a, const FP8* b, FP8* out, size_t n);
+    static void multiply(const FP8* a, const FP8* b, FP8* out, size_t n);
+    static void divide(const FP8* a, const FP8* b, FP8* out, size_t n);
+
+    // comparison, NaN is unordered and +0 == -0
+
+    bool operator==(const FP8& other) const { return Format::compare(bits_, other.bits_) == 0; }
+    bool operator!=(const FP8& other) const { return !(*this == other); }
+    bool operator<(const FP8& other) const { return Format::compare(bits_, other.bits_) == -1; }
+    bool operator>(const FP8& other) const { return Format::compare(bits_, other.bits_) == 1; }
+    bool operator<=(const FP8& other) const {
+        int cmp = Format::compare(bits_, other.bits_);
+        return cmp == -1 || cmp == 0;
+    }
+    bool operator>=(const FP8& other) const {
+        int cmp = Format::compare(bits_, other.bits_);
+        return cmp == 1 || cmp == 0;
+    }
+
+    FP8 abs() const { return FP8(static_cast<uint8_t>(bits_ & ~Format::SIGN_MASK)); }
+
+    friend std::ostream& operator<<(std::ostream& os, const FP8& value) {
+        return os << value.toFloat();
+    }
+
+private:
+    uint8_t bits_;
+
+    static uint32_t floatBits(float value) {
+        uint32_t bits;
+        std::memcpy(&bits, &value, sizeof(float));
+        return bits;
+    }
+};
+
+using FP8E4M3 = FP8<4, 3, FloatEncoding::FiniteNaN>;    // OCP E4M3FN
+using FP8E5M2 = FP8<5, 2>;
+
+// the tables and batched code are instantiated once, in fp8.cpp
+extern template class FP8Tables<4, 3, FloatEncoding::FiniteNaN>;
+extern template class FP8Tables<5, 2>;
+extern template class FP8<4, 3, FloatEncoding::FiniteNaN>;
+extern template class FP8<5, 2>;
+
+// bulk conversion, dispatches to the best simd kernel at runtime. widening
+// gathers from the 256-entry FP32 table, narrowing rounds to nearest even
+// and matches the scalar constructors bit for bit
+
+template <int E, int M, FloatEncoding ENC> void convertToFloat(const FP8<E, M, ENC>* src, float* dst, size_t n);
+template <int E, int M, FloatEncoding ENC> void convertToBF16(const FP8<E, M, ENC>* src, BFloat16* dst, size_t n);
+template <int E, int M, FloatEncoding ENC> void convertToFP8(const float* src, FP8<E, M, ENC>* dst, size_t n);
+template <int E, int M, FloatEncoding ENC> void convertToFP8(const BFloat16* src, FP8<E, M, ENC>* dst, size_t n);
+
+// pinned to a specific kernel, mostly for testing
+// a level the cpu does not support falls back to scalar
+
+template <int E, int M, FloatEncoding ENC> void convertToFloat(const FP8<E, M, ENC>* src, float* dst, size_t n, SimdLevel level);
+template <int E, int M, FloatEncoding ENC> void convertToBF16(const FP8<E, M, ENC>* src, BFloat16* dst, size_t n, SimdLevel level);
+template <int E, int M, FloatEncoding ENC> void convertToFP8(const float* src, FP8<E, M, ENC>* dst, size_t n, SimdLevel level);
+template <int E, int M, FloatEncoding ENC> void convertToFP8(const BFloat16* src, FP8<E, M, ENC>* dst, size_t n, SimdLevel level);
+
+#endif
@@ -0,0 +1,106 @@
+#ifndef MX_H
+#define MX_H
+
+#include "BF16.h"
+#include "BF16Simd.h"
+#include "FP32.h"
+#include "FP8.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// block-scaled (microscaling) arrays in the style of the OCP MX formats
+//
+// elements are grouped in blocks of MX_BLOCK. each block stores one E8M0
+// scale byte, a power of two 2^(scale - 127), and MX_BLOCK narrow elements,
+// so value i is element(i) * 2^(scale - 127). 0xFF is the nan scale, every
+// value in such a block reads as nan. an MXFP8 array takes 8.25 bits per
+// value against 16 for BFloat16.
+//
+// quantize picks the block scale from the largest finite magnitude: its
+// unbiased exponent minus the element type's largest normal exponent, so
+// that magnitude lands in the element's top binade. elements round to
+// nearest even and saturate to the element's max. an infinity stays an
+// infinity in E5M2 and is a nan element in E4M3, which has none, and a nan
+// anywhere makes the whole block nan. the last block is padded with zeros.
+//
+// the elements are the FP8 types in FP8.h, E4M3 being the OCP E4M3FN
+// layout (max 448) the MX spec uses.
+
+constexpr size_t MX_BLOCK = 32;
+
+template <typename Element>
+class BlockFloat {
+public:
+    using Format = typename Element::Format;
+
+    // exponent of the element type's largest normal
+    static constexpr int ELEMENT_EMAX = Format::MAX_NORMAL_FIELD - Format::EXPONENT_BIAS;
+    static constexpr uint8_t SCALE_BIAS = 127;
+    static constexpr uint8_t NAN_SCALE = 0xFF;
+
+    BlockFloat() = default;
+    // n zeros, every scale 2^0
+    explicit BlockFloat(size_t n);
+
+    static BlockFloat quantize(const float* src, size_t n);
+    static BlockFloat quantize(const BFloat16* src, size_t n);
+    static BlockFloat quantize(const FP32* src, size_t n);
+
+    // dst holds size() values. bf16 rounds the exact float value to
+    // nearest even
+    void dequantize(float* dst) const;
+    void dequantize(BFloat16* dst) const;
+
+    size_t size() const { return size_; }
+    size_t blocks() const { return scales_.size(); }
+    size_t bytes() const { return scales_.size() + elements_.size() * sizeof(Element); }
+
+    uint8_t scaleBits(size_t block) const { return scales_[block]; }
+    // 2^(scale - 127), nan for the nan scale
+    float scale(size_t block) const { return scaleValue(scales_[block]); }
+    Element element(size_t i) const { return elements_[i]; }
+    float value(size_t i) const { return element(i).toFloat() * scale(i / MX_BLOCK); }
+
+    // blocks() scale bytes, then blocks() * MX_BLOCK elements
+    const uint8_t* scaleData() const { return scales_.data(); }
+    const Element* elementData() const { return elements_.data(); }
+
+    static float scaleValue(uint8_t scale);
+
+private:
+    size_t size_ = 0;
+    std::vector<uint8_t> scales_;
+    std::vector<Element> elements_;
+};
+
+using MXFP8E4M3 = BlockFloat<FP8E4M3>;
+using MXFP8E5M2 = BlockFloat<FP8E5M2>;
+
+extern template class BlockFloat<FP8E4M3>;
+extern template class BlockFloat<FP8E5M2>;
+
+// fused dequantize and dot product against w.size() BFloat16 values,
+// nothing is widened to memory. an FP8 and a bf16 value multiply exactly
+// in float; the products of a block sum in 16 float lanes, each lane is
+// scaled by the block's power of two and added to a running lane total,
+// and the lanes fold pairwise at the end. chunks of blocks are combined in
+// float, so every simd level and thread count gives the same bits
+template <typename Element>
+float dot(const BlockFloat<Element>& w, const BFloat16* x);
+
+// y[r] = dot of row r with x, for a rows x cols row-major w. throws
+// std::invalid_argument unless w.size() == rows * cols and every row is
+// whole blocks (cols a multiple of MX_BLOCK)
+template <typename Element>
+void gemv(const BlockFloat<Element>& w, size_t rows, size_t cols, const BFloat16* x, float* y);
+
+// pinned to a specific kernel, mostly for testing
+// a level the cpu does not support falls back to scalar
+
+template <typename Element>
+float dot(const BlockFloat<Element>& w, const BFloat16* x, SimdLevel level);
+template <typename Element>
+void dequantize(const BlockFloat<Element>& w, float* dst, SimdLevel level);
+
+#endif
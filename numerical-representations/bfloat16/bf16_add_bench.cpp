@@ -0,0 +1,141 @@
+#include "BF16.h"
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <vector>
+
+// ns per BFloat16 addition for operand mixes that hit different parts of
+// addImpl, with native float addition as the floor, in both subnormal
+// modes
+
+static volatile uint32_t sink;
+
+struct Operands {
+    std::vector<BFloat16> a, b;
+};
+
+static double timeAdd(const Operands& ops, SubnormalMode mode) {
+    SubnormalScope scope(mode);
+    const int reps = 7;
+    const size_t n = ops.a.size();
+    double best = 1e30;
+    std::vector<BFloat16> out(n);
+
+    for (int r = 0; r < reps; ++r) {
+        auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < n; ++i) {
+            out[i] = ops.a[i] + ops.b[i];
+        }
+        auto stop = std::chrono::steady_clock::now();
+        sink = out[r].bits();
+
+        double ns = std::chrono::duration<double, std::nano>(stop - start).count();
+        if (ns < best) best = ns;
+    }
+
+    return best / static_cast<double>(n);
+}
+
+static double timeNative(const Operands& ops) {
+    const int reps = 7;
+    const size_t n = ops.a.size();
+    double best = 1e30;
+    std::vector<float> a(n), b(n), out(n);
+    convertToFloat(ops.a.data(), a.data(), n);
+    convertToFloat(ops.b.data(), b.data(), n);
+
+    for (int r = 0; r < reps; ++r) {
+        auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < n; ++i) {
+            out[i] = a[i] + b[i];
+        }
+        auto stop = std::chrono::steady_clock::now();
+        sink = static_cast<uint32_t>(out[r]);
+
+        double ns = std::chrono::duration<double, std::nano>(stop - start).count();
+        if (ns < best) best = ns;
+    }
+
+    return best / static_cast<double>(n);
+}
+
+static BFloat16 randomNormal(std::mt19937& rng, int min_exp, int max_exp) {
+    std::uniform_int_distribution<int> exp(min_exp, max_exp);
+    std::uniform_int_distribution<int> mant(0, 0x7F);
+    std::uniform_int_distribution<int> sign(0, 1);
+    return BFloat16::fromBits(static_cast<uint16_t>((sign(rng) << 15) |
+                                                    ((exp(rng) + 127) << 7) | mant(rng)));
+}
+
+int main() {
+    const size_t n = 1u << 20;
+    std::mt19937 rng(42);
+
+    // uniform: normals within a few binades of each other, random signs
+    Operands uniform;
+    // wide: normals across the whole exponent range, mostly one side dominates
+    Operands wide;
+    // cancellation: b is -a with the low mantissa bits changed, so the sum
+    // needs a long renormalizing shift
+    Operands cancel;
+    // adversarial: a random mix of normals, subnormals, zeros, infinities and
+    // nans, so the special-case branches are unpredictable
+    Operands adversarial;
+    // subnormal: half the operands subnormal, the rest in the bottom few
+    // binades, so many sums are subnormal too
+    Operands tiny;
+
+    std::uniform_int_distribution<uint32_t> any_bits(0, 0xFFFF);
+    std::uniform_int_distribution<int> kind(0, 4);
+    std::uniform_int_distribution<int> low(1, 7);
+    for (size_t i = 0; i < n; ++i) {
+        uniform.a.push_back(randomNormal(rng, -8, 8));
+        uniform.b.push_back(randomNormal(rng, -8, 8));
+
+        wide.a.push_back(randomNormal(rng, -126, 127));
+        wide.b.push_back(randomNormal(rng, -126, 127));
+
+        BFloat16 x = randomNormal(rng, -60, 60);
+        cancel.a.push_back(x);
+        cancel.b.push_back(BFloat16::fromBits(static_cast<uint16_t>((x.bits() ^ 0x8000) ^ low(rng))));
+
+        BFloat16 pair[2];
+        for (BFloat16& v : pair) {
+            switch (kind(rng)) {
+            case 0:  v = BFloat16::fromBits(static_cast<uint16_t>(any_bits(rng) & 0x807F)); break;
+            case 1:  v = BFloat16::zero(any_bits(rng) & 1); break;
+            case 2:  v = BFloat16::infinity(any_bits(rng) & 1); break;
+            case 3:  v = BFloat16::nan(); break;
+            default: v = randomNormal(rng, -126, 127); break;
+            }
+        }
+        adversarial.a.push_back(pair[0]);
+        adversarial.b.push_back(pair[1]);
+
+        for (BFloat16& v : pair) {
+            v = any_bits(rng) & 1 ? BFloat16::fromBits(static_cast<uint16_t>((any_bits(rng) & 0x807F) | 1))
+                                  : randomNormal(rng, -126, -122);
+        }
+        tiny.a.push_back(pair[0]);
+        tiny.b.push_back(pair[1]);
+    }
+
+    std::cout << "BFloat16 addition, ns/op (" << n << " pairs, best of 7)" << std::endl;
+    std::cout << std::fixed << std::setprecision(3);
+    std::cout << std::left << std::setw(14) << "operands" << std::right
+              << std::setw(12) << "bf16 ns" << std::setw(12) << "flush ns" << std::setw(12) << "float ns"
+              << std::endl;
+
+    const Operands* sets[] = {&uniform, &wide, &cancel, &adversarial, &tiny};
+    const char* names[] = {"uniform", "wide", "cancellation", "adversarial", "subnormal"};
+    for (int s = 0; s < 5; ++s) {
+        std::cout << std::left << std::setw(14) << names[s] << std::right
+                  << std::setw(12) << timeAdd(*sets[s], SubnormalMode::Preserve)
+                  << std::setw(12) << timeAdd(*sets[s], SubnormalMode::Flush)
+                  << std::setw(12) << timeNative(*sets[s]) << std::endl;
+    }
+
+    return 0;
+}
@@ -1,164 +1,33 @@
 #include "BF16.h"
-#include <algorithm>
-
-uint16_t BFloat16::roundToNearest(uint32_t value, int shift) {
-    // round to nearest, ties to even (bankers rounding)
-    if (shift <= 0) return static_cast<uint16_t>(value);
-    
-    uint32_t mask = (1u << shift) - 1;
-    uint32_t halfway = 1u << (shift - 1);
-    uint32_t remainder = value & mask;
-    uint32_t result = value >> shift;
-    
-    if (remainder > halfway) {
-        // round up
-        result++;
-    } else if (remainder == halfway) {
-        // tie, round down (lsb = 0)
-        if (result & 1) {
-            result++;
-        }
-    }
-    
-    return static_cast<uint16_t>(result);
+#include "ThreadPool.h"
+
+// the rounding, normalization and special-value logic lives in
+// FloatFormat.h and is shared with FP32 and SmallFloat
+
+// op(format) with the kernels of the calling thread's subnormal mode. the
+// Preserve kernels inline into each operator as they did before the mode
+// existed; Flush is a cold call, so the default path pays one load and a
+// predicted branch. with both inline gcc calls the Preserve kernel too
+template <typename Op>
+__attribute__((noinline, cold))
+static uint16_t flushKernel(Op op) {
+    return op(BFloat16::FormatFor<SubnormalMode::Flush>());
 }
 
-BFloat16 BFloat16::normalize(bool sign, int exp, uint32_t significand) {
-    // normalize the significand and adjust exponent
-    
-    if (significand == 0) {
-        return BFloat16::zero(sign);
-    }
-    
-    // find the position of the leading 1
-    int leading_bit = 31;
-    while (leading_bit >= 0 && !((significand >> leading_bit) & 1)) {
-        leading_bit--;
-    }
-    
-    // adjust exponent based on leading bit position
-    // want the leading bit at position 7 for implicit bit
-    int shift = leading_bit - MANTISSA_BITS;
-    exp += shift;
-    
-    // check for overflow / underflow
-    if (exp >= 255) {
-        return BFloat16::infinity(sign);
-    }
-    
-    if (exp <= 0) {
-        // subnormal or underflow
-        int denorm_shift = 1 - exp;
-        if (denorm_shift > 31) {
-            return BFloat16::zero(sign);
-        }
-        
-        uint16_t mant = roundToNearest(significand, denorm_shift + shift);
-        return BFloat16(packBits(sign, 0, static_cast<uint8_t>(mant)));
-    }
-    
-    // normal number, round and remove implicit bit
-    uint16_t mant;
-    if (shift > 0) {
-        mant = roundToNearest(significand, shift) & MANTISSA_MASK;
-    } else if (shift < 0) {
-        mant = (static_cast<uint16_t>(significand) << (-shift)) & MANTISSA_MASK;
-    } else {
-        mant = static_cast<uint16_t>(significand) & MANTISSA_MASK;
-    }
-    
-    // check for rounding overflow
-    if (mant == 0 && ((significand >> (shift > 0 ? shift - 1 : 0)) & 1)) {
-        exp++;
-        if (exp >= 255) {
-            return BFloat16::infinity(sign);
-        }
-    }
-    
-    return BFloat16(packBits(sign, static_cast<uint8_t>(exp), static_cast<uint8_t>(mant)));
+template <typename Op>
+static inline uint16_t kernel(Op op) {
+    if (__builtin_expect(subnormalMode() == SubnormalMode::Flush, 0)) return flushKernel(op);
+    return op(BFloat16::FormatFor<SubnormalMode::Preserve>());
 }
 
-BFloat16 BFloat16::addImpl(const BFloat16& a, const BFloat16& b) {
-    // handle special cases
-    if (a.isNaN() || b.isNaN()) return BFloat16::nan();
-    
-    if (a.isInfinity()) {
-        if (b.isInfinity() && a.sign() != b.sign()) {
-            return BFloat16::nan(); // Inf - Inf
-        }
-        return a;
-    }
-    
-    if (b.isInfinity()) return b;
-    
-    if (a.isZero()) return b;
-    if (b.isZero()) return a;
-    
-    // extract components
-    bool sign_a = a.sign();
-    bool sign_b = b.sign();
-    int exp_a = a.unbiasedExponent();
-    int exp_b = b.unbiasedExponent();
-    
-    // get significands with implicit bit
-    uint32_t sig_a = a.mantissa();
-    uint32_t sig_b = b.mantissa();
-    
-    if (a.isNormal()) sig_a |= (1u << MANTISSA_BITS);
-    if (b.isNormal()) sig_b |= (1u << MANTISSA_BITS);
-    
-    // align significands, add extra bits for precision
-    sig_a <<= 3;
-    sig_b <<= 3;
-    
-    // make exponents equal by shifting the smaller one
-    if (exp_a > exp_b) {
-        int diff = exp_a - exp_b;
-        if (diff > 15) {
-            sig_b = 0;
-        } else {
-            sig_b >>= diff;
-        }
-        exp_b = exp_a;
-    } else if (exp_b > exp_a) {
-        int diff = exp_b - exp_a;
-        if (diff > 15) {
-            sig_a = 0;
-        } else {
-            sig_a >>= diff;
-        }
-        exp_a = exp_b;
-    }
-    
-    // perform addition or subtraction
-    uint32_t result_sig;
-    bool result_sign;
-    
-    if (sign_a == sign_b) {
-        // ssame sign = add
-        result_sig = sig_a + sig_b;
-        result_sign = sign_a;
-    } else {
-        // different sign = subtract smaller from larger
-        if (sig_a >= sig_b) {
-            result_sig = sig_a - sig_b;
-            result_sign = sign_a;
-        } else {
-            result_sig = sig_b - sig_a;
-            result_sign = sign_b;
-        }
-    }
-    
-    // normalize result
-    return normalize(result_sign, exp_a + EXPONENT_BIAS - 3, result_sig);
-}
+// addition and subtraction
 
 BFloat16 BFloat16::operator+(const BFloat16& other) const {
-    return addImpl(*this, other);
+    return BFloat16(kernel([&](auto f) { return decltype(f)::add(bits_, other.bits_); }));
 }
 
 BFloat16 BFloat16::operator-(const BFloat16& other) const {
-    return addImpl(*this, -other);
+    return BFloat16(kernel([&](auto f) { return decltype(f)::subtract(bits_, other.bits_); }));
 }
 
 BFloat16& BFloat16::operator+=(const BFloat16& other) {
@@ -173,47 +42,8 @@ BFloat16& BFloat16::operator-=(const BFloat16& other) {
 
 // multiplication
 
-BFloat16 BFloat16::multiplyImpl(const BFloat16& a, const BFloat16& b) {
-    if (a.isNaN() || b.isNaN()) return BFloat16::nan();
-    
-    if (a.isInfinity() || b.isInfinity()) {
-        if (a.isZero() || b.isZero()) {
-            return BFloat16::nan(); // 0 * Inf
-        }
-        return BFloat16::infinity(a.sign() != b.sign());
-    }
-    
-    if (a.isZero() || b.isZero()) {
-        return BFloat16::zero(a.sign() != b.sign());
-    }
-    
-    // extract components
-    bool result_sign = a.sign() != b.sign();
-    int exp_a = a.unbiasedExponent();
-    int exp_b = b.unbiasedExponent();
-    
-    // get significands with implicit bit
-    uint32_t sig_a = a.mantissa();
-    uint32_t sig_b = b.mantissa();
-    
-    if (a.isNormal()) sig_a |= (1u << MANTISSA_BITS);
-    if (b.isNormal()) sig_b |= (1u << MANTISSA_BITS);
-    
-    // multiply significands
-    // sig_a and sig_b are 8-bit fixed-point (1 integer bit + 7 fractional)
-    // product will be 16-bit fixed-point, with leading bit at position 14 or 15
-    uint32_t result_sig = sig_a * sig_b;
-    
-    // calculate the final exponent
-    // similar to FP32: result_exp = (exp_a + exp_b + BIAS) - expected_shift
-    // expected_shift is approx 7 for products in range [1, 4)
-    int result_exp = exp_a + exp_b + EXPONENT_BIAS - MANTISSA_BITS;
-    
-    return normalize(result_sign, result_exp, result_sig);
-}
-
 BFloat16 BFloat16::operator*(const BFloat16& other) const {
-    return multiplyImpl(*this, other);
+    return BFloat16(kernel([&](auto f) { return decltype(f)::multiply(bits_, other.bits_); }));
 }
 
 BFloat16& BFloat16::operator*=(const BFloat16& other) {
@@ -221,50 +51,106 @@ BFloat16& BFloat16::operator*=(const BFloat16& other) {
     return *this;
 }
 
+// fused multiply-add
+
+BFloat16 BFloat16::fma(const BFloat16& a, const BFloat16& b, const BFloat16& c) {
+    // a * b + c with a single rounding at the end
+    return BFloat16(kernel([&](auto f) { return decltype(f)::fma(a.bits_, b.bits_, c.bits_); }));
+}
+
+// explicit rounding modes, one kernel instantiation per mode
+
+BFloat16 BFloat16::add(const BFloat16& a, const BFloat16& b, RoundingMode mode) {
+    return BFloat16(kernel([&](auto f) {
+        return withRoundingMode(mode, [&](auto r) { return decltype(f)::template add<decltype(r)::value>(a.bits_, b.bits_); });
+    }));
+}
+
+BFloat16 BFloat16::subtract(const BFloat16& a, const BFloat16& b, RoundingMode mode) {
+    return BFloat16(kernel([&](auto f) {
+        return withRoundingMode(mode, [&](auto r) { return decltype(f)::template subtract<decltype(r)::value>(a.bits_, b.bits_); });
+    }));
+}
+
+BFloat16 BFloat16::multiply(const BFloat16& a, const BFloat16& b, RoundingMode mode) {
+    return BFloat16(kernel([&](auto f) {
+        return withRoundingMode(mode, [&](auto r) { return decltype(f)::template multiply<decltype(r)::value>(a.bits_, b.bits_); });
+    }));
+}
+
+BFloat16 BFloat16::divide(const BFloat16& a, const BFloat16& b, RoundingMode mode) {
+    return BFloat16(kernel([&](auto f) {
+        return withRoundingMode(mode, [&](auto r) { return decltype(f)::template divide<decltype(r)::value>(a.bits_, b.bits_); });
+    }));
+}
+
+BFloat16 BFloat16::fma(const BFloat16& a, const BFloat16& b, const BFloat16& c, RoundingMode mode) {
+    return BFloat16(kernel([&](auto f) {
+        return withRoundingMode(mode, [&](auto r) { return decltype(f)::template fma<decltype(r)::value>(a.bits_, b.bits_, c.bits_); });
+    }));
+}
+
+BFloat16 BFloat16::sqrt(const BFloat16& x, RoundingMode mode) {
+    return BFloat16(kernel([&](auto f) {
+        return withRoundingMode(mode, [&](auto r) { return decltype(f)::template sqrt<decltype(r)::value>(x.bits_); });
+    }));
+}
+
+// batched arithmetic
+// the FloatFormat kernels are inline, so each loop gets its own copy;
+// large spans are split across the thread pool. the subnormal mode is read
+// here, on the calling thread
+
+static const size_t BATCH_GRAIN = chunkElements(3 * sizeof(BFloat16));
+
+void BFloat16::add(const BFloat16* a, const BFloat16* b, BFloat16* out, size_t n) {
+    withSubnormalMode(subnormalMode(), [&](auto sm) {
+        using F = FormatFor<decltype(sm)::value>;
+        parallelChunks(n, BATCH_GRAIN, [=](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i) {
+                out[i] = BFloat16(F::add(a[i].bits_, b[i].bits_));
+            }
+        });
+    });
+}
+
+void BFloat16::subtract(const BFloat16* a, const BFloat16* b, BFloat16* out, size_t n) {
+    withSubnormalMode(subnormalMode(), [&](auto sm) {
+        using F = FormatFor<decltype(sm)::value>;
+        parallelChunks(n, BATCH_GRAIN, [=](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i) {
+                out[i] = BFloat16(F::subtract(a[i].bits_, b[i].bits_));
+            }
+        });
+    });
+}
+
+void BFloat16::multiply(const BFloat16* a, const BFloat16* b, BFloat16* out, size_t n) {
+    withSubnormalMode(subnormalMode(), [&](auto sm) {
+        using F = FormatFor<decltype(sm)::value>;
+        parallelChunks(n, BATCH_GRAIN, [=](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i) {
+                out[i] = BFloat16(F::multiply(a[i].bits_, b[i].bits_));
+            }
+        });
+    });
+}
+
+void BFloat16::scale(const BFloat16* a, BFloat16 s, BFloat16* out, size_t n) {
+    withSubnormalMode(subnormalMode(), [&](auto sm) {
+        using F = FormatFor<decltype(sm)::value>;
+        parallelChunks(n, BATCH_GRAIN, [=](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i) {
+                out[i] = BFloat16(F::multiply(a[i].bits_, s.bits_));
+            }
+        });
+    });
+}
+
 // division
 
 BFloat16 BFloat16::operator/(const BFloat16& other) const {
-    if (isNaN() || other.isNaN()) return BFloat16::nan();
-    
-    if (isInfinity()) {
-        if (other.isInfinity()) {
-            return BFloat16::nan(); // Inf / Inf
-        }
-        return BFloat16::infinity(sign() != other.sign());
-    }
-    
-    if (other.isInfinity()) {
-        return BFloat16::zero(sign() != other.sign());
-    }
-    
-    if (other.isZero()) {
-        if (isZero()) {
-            return BFloat16::nan(); // 0 / 0
-        }
-        return BFloat16::infinity(sign() != other.sign());
-    }
-    
-    if (isZero()) {
-        return BFloat16::zero(sign() != other.sign());
-    }
-    
-    bool result_sign = sign() != other.sign();
-    int exp_a = unbiasedExponent();
-    int exp_b = other.unbiasedExponent();
-    
-    uint32_t sig_a = mantissa();
-    uint32_t sig_b = other.mantissa();
-    
-    if (isNormal()) sig_a |= (1u << MANTISSA_BITS);
-    if (other.isNormal()) sig_b |= (1u << MANTISSA_BITS);
-    
-    sig_a <<= MANTISSA_BITS;
-    
-    uint32_t result_sig = sig_a / sig_b;
-    
-    int result_exp = exp_a - exp_b + EXPONENT_BIAS;
-    
-    return normalize(result_sign, result_exp, result_sig);
+    return BFloat16(kernel([&](auto f) { return decltype(f)::divide(bits_, other.bits_); }));
 }
 
 BFloat16& BFloat16::operator/=(const BFloat16& other) {
@@ -0,0 +1,344 @@
+#include "BF16.h"
+#include "BF16Expr.h"
+#include "BF16Linalg.h"
+#include "BF16Math.h"
+#include "BF16Order.h"
+#include "BF16Reduce.h"
+#include "BF16Simd.h"
+#include "FP8.h"
+#include "MX.h"
+#include "MicroBench.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// every BFloat16 operator next to the same loop on native float, see
+// ../float/MicroBench.h for the flags. `make bench` writes bench_bf16.json
+
+int main(int argc, char** argv) {
+    MicroBench bench("bf16", argc, argv);
+
+    // per-core numbers, the batched calls would otherwise use the pool
+    setThreadCount(1);
+    bench.setContext("threads", "1");
+    bench.setContext("simd", simdLevelName(detectSimdLevel()));
+
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<float> mantissa(1.0f, 2.0f);
+    std::uniform_int_distribution<int> exponent(-20, 20);
+    std::uniform_int_distribution<int> sign(0, 1);
+
+    for (size_t batch : bench.batches()) {
+        // normal operands across a few dozen binades, positive for sqrt.
+        // the native side works on the same values widened to float
+        std::vector<float> fa(batch), fb(batch), fc(batch), fout(batch);
+        for (size_t i = 0; i < batch; ++i) {
+            fa[i] = std::ldexp(mantissa(rng), exponent(rng));
+            fb[i] = std::ldexp(mantissa(rng), exponent(rng)) * (sign(rng) ? -1.0f : 1.0f);
+            fc[i] = std::ldexp(mantissa(rng), exponent(rng));
+        }
+
+        std::vector<BFloat16> a(batch), b(batch), c(batch), out(batch);
+        for (size_t i = 0; i < batch; ++i) {
+            a[i] = BFloat16(fa[i]);
+            b[i] = BFloat16(fb[i]);
+            c[i] = BFloat16(fc[i]);
+            fa[i] = a[i].toFloat();
+            fb[i] = b[i].toFloat();
+            fc[i] = c[i].toFloat();
+        }
+        std::vector<unsigned char> flags(batch);
+
+        bench.run("construct", batch,
+            [&] { for (size_t i = 0; i < batch; ++i) out[i] = BFloat16(fa[i]); },
+            [&] { for (size_t i = 0; i < batch; ++i) fout[i] = fa[i]; });
+
+        bench.run("add", batch,
+            [&] { for (size_t i = 0; i < batch; ++i) out[i] = a[i] + b[i]; },
+            [&] { for (size_t i = 0; i < batch; ++i) fout[i] = fa[i] + fb[i]; });
+
+        bench.run("sub", batch,
+            [&] { for (size_t i = 0; i < batch; ++i) out[i] = a[i] - b[i]; },
+            [&] { for (size_t i = 0; i < batch; ++i) fout[i] = fa[i] - fb[i]; });
+
+        bench.run("mul", batch,
+            [&] { for (size_t i = 0; i < batch; ++i) out[i] = a[i] * b[i]; },
+            [&] { for (size_t i = 0; i < batch; ++i) fout[i] = fa[i] * fb[i]; });
+
+        bench.run("div", batch,
+            [&] { for (size_t i = 0; i < batch; ++i) out[i] = a[i] / b[i]; },
+            [&] { for (size_t i = 0; i < batch; ++i) fout[i] = fa[i] / fb[i]; });
+
+        bench.run("sqrt", batch,
+            [&] { for (size_t i = 0; i < batch; ++i) out[i] = a[i].sqrt(); },
+            [&] { for (size_t i = 0; i < batch; ++i) fout[i] = std::sqrt(fa[i]); });
+
+        bench.run("rsqrt", batch,
+            [&] { for (size_t i = 0; i < batch; ++i) out[i] = a[i].rsqrt(); },
+            [&] { for (size_t i = 0; i < batch; ++i) fout[i] = 1.0f / std::sqrt(fa[i]); });
+
+        bench.run("rsqrt_batch", batch,
+            [&] { BFloat16::rsqrt(a.data(), out.data(), batch); },
+            [&] { for (size_t i = 0; i < batch; ++i) fout[i] = 1.0f / std::sqrt(fa[i]); });
+
+        bench.run("fma", batch,
+            [&] { for (size_t i = 0; i < batch; ++i) out[i] = fma(a[i], b[i], c[i]); },
+            [&] { for (size_t i = 0; i < batch; ++i) fout[i] = std::fma(fa[i], fb[i], fc[i]); });
+
+        bench.run("compare", batch,
+            [&] { for (size_t i = 0; i < batch; ++i) flags[i] = a[i] < b[i]; },
+            [&] { for (size_t i = 0; i < batch; ++i) flags[i] = fa[i] < fb[i]; });
+
+        bench.run("toFloat", batch,
+            [&] { for (size_t i = 0; i < batch; ++i) fout[i] = a[i].toFloat(); },
+            [&] { for (size_t i = 0; i < batch; ++i) fout[i] = fb[i]; });
+
+        bench.run("add_batch", batch,
+            [&] { BFloat16::add(a.data(), b.data(), out.data(), batch); },
+            [&] { for (size_t i = 0; i < batch; ++i) fout[i] = fa[i] + fb[i]; });
+
+        // a * b + c * a - b: eager batched calls with temporaries, then
+        // fused into one pass with each rounding precision
+        std::vector<BFloat16> t1(batch), t2(batch);
+        auto ea = lazy(a.data(), batch);
+        auto eb = lazy(b.data(), batch);
+        auto ec = lazy(c.data(), batch);
+        auto expr_native = [&] {
+            for (size_t i = 0; i < batch; ++i) fout[i] = fa[i] * fb[i] + fc[i] * fa[i] - fb[i];
+        };
+        bench.run("expr_eager", batch, [&] {
+            BFloat16::multiply(a.data(), b.data(), t1.data(), batch);
+            BFloat16::multiply(c.data(), a.data(), t2.data(), batch);
+            BFloat16::add(t1.data(), t2.data(), t1.data(), batch);
+            BFloat16::subtract(t1.data(), b.data(), out.data(), batch);
+        }, expr_native);
+
+        bench.run("expr_fused", batch,
+            [&] { evaluate(ea * eb + ec * ea - eb, out.data()); }, expr_native);
+
+        bench.run("expr_widened", batch,
+            [&] { evaluate(ea * eb + ec * ea - eb, out.data(), ExprPrecision::Widened); }, expr_native);
+
+        bench.run("convert_bulk", batch,
+            [&] { convertToBF16(fa.data(), out.data(), batch); },
+            [&] { for (size_t i = 0; i < batch; ++i) fout[i] = fa[i]; });
+
+        bench.run("convert_stochastic", batch,
+            [&] { convertToBF16(fa.data(), out.data(), batch, RoundingMode::Stochastic); },
+            [&] { for (size_t i = 0; i < batch; ++i) fout[i] = fa[i]; });
+
+        // one reduction per strategy, against a plain float sum
+        const struct { const char* name; Summation method; } sums[] = {
+            {"sum_naive", Summation::Naive},
+            {"sum_pairwise", Summation::Pairwise},
+            {"sum_kahan", Summation::Kahan},
+            {"sum_neumaier", Summation::Neumaier},
+            {"sum_widened", Summation::Widened},
+        };
+        for (const auto& s : sums) {
+            bench.run(s.name, batch,
+                [&] { doNotOptimize(sum(a.data(), batch, s.method)); },
+                [&] {
+                    float total = 0.0f;
+                    for (size_t i = 0; i < batch; ++i) total += fa[i];
+                    doNotOptimize(total);
+                });
+        }
+
+        // activations on [-8, 8] (log on the magnitudes), each scalar and
+        // batched against the libm float function
+        std::uniform_real_distribution<float> activation(-8.0f, 8.0f);
+        std::vector<BFloat16> xa(batch);
+        std::vector<float> fx(batch);
+        for (size_t i = 0; i < batch; ++i) {
+            xa[i] = BFloat16(activation(rng));
+            fx[i] = xa[i].toFloat();
+        }
+        std::vector<BFloat16> xlog(batch);
+        std::vector<float> fxlog(batch);
+        for (size_t i = 0; i < batch; ++i) {
+            xlog[i] = xa[i].abs();
+            fxlog[i] = xlog[i].toFloat();
+        }
+        const struct {
+            const char* name;
+            const char* batch_name;
+            BFloat16 (*scalar)(const BFloat16&);
+            void (*batched)(const BFloat16*, BFloat16*, size_t);
+            float (*native)(float);
+            bool positive;
+        } functions[] = {
+            {"exp", "exp_batch", exp, exp, [](float x) { return std::exp(x); }, false},
+            {"log", "log_batch", log, log, [](float x) { return std::log(x); }, true},
+            {"tanh", "tanh_batch", tanh, tanh, [](float x) { return std::tanh(x); }, false},
+            {"sigmoid", "sigmoid_batch", sigmoid, sigmoid, [](float x) { return 1.0f / (1.0f + std::exp(-x)); }, false},
+            {"erf", "erf_batch", erf, erf, [](float x) { return std::erf(x); }, false},
+            {"gelu", "gelu_batch", gelu, gelu, [](float x) { return 0.5f * x * (1.0f + std::erf(x * 0.70710678f)); }, false},
+        };
+        for (const auto& f : functions) {
+            const BFloat16* x = f.positive ? xlog.data() : xa.data();
+            const float* native_x = f.positive ? fxlog.data() : fx.data();
+            auto native = [&] { for (size_t i = 0; i < batch; ++i) fout[i] = f.native(native_x[i]); };
+            bench.run(f.name, batch,
+                [&] { for (size_t i = 0; i < batch; ++i) out[i] = f.scalar(x[i]); }, native);
+            bench.run(f.batch_name, batch, [&] { f.batched(x, out.data(), batch); }, native);
+        }
+
+        // order ops on the keys against the float loop or algorithm
+        bench.run("argmin", batch,
+            [&] { doNotOptimize(argmin(b.data(), batch)); },
+            [&] { doNotOptimize(std::min_element(fb.begin(), fb.end()) - fb.begin()); });
+
+        bench.run("minmax", batch,
+            [&] { doNotOptimize(minmax(b.data(), batch).first.bits()); },
+            [&] { doNotOptimize(*std::minmax_element(fb.begin(), fb.end()).first); });
+
+        bench.run("clamp", batch,
+            [&] { clamp(b.data(), out.data(), batch, BFloat16(-1.0f), BFloat16(1.0f)); },
+            [&] { for (size_t i = 0; i < batch; ++i) fout[i] = std::clamp(fb[i], -1.0f, 1.0f); });
+
+        // the copy is in both loops, sorting sorted data would flatter both
+        bench.run("sort", batch,
+            [&] { out = b; sort(out.data(), batch); },
+            [&] { fout = fb; std::sort(fout.begin(), fout.end()); });
+
+        bench.run("sort_operator", batch,
+            [&] { out = b; std::sort(out.begin(), out.end()); },
+            [&] { fout = fb; std::sort(fout.begin(), fout.end()); });
+
+        // dot in each linear algebra mode against the float loop. hw_dot is
+        // vdpbf16ps on a cpu with it, the _fma and _soft rows the emulations
+        // of it that other cpus run, all with the same bits
+        auto floatDot = [&] {
+            float acc = 0.0f;
+            for (size_t i = 0; i < batch; ++i) acc += fa[i] * fb[i];
+            doNotOptimize(acc);
+        };
+        bench.run("dot", batch, [&] { doNotOptimize(dot(a.data(), b.data(), batch)); }, floatDot);
+        bench.run("hw_dot", batch,
+            [&] { doNotOptimize(dot(a.data(), b.data(), batch, LinalgMode::HardwareDot)); }, floatDot);
+        if (simdLevelSupported(SimdLevel::AVX2)) {
+            bench.run("hw_dot_fma", batch,
+                [&] { doNotOptimize(dot(a.data(), b.data(), batch, LinalgMode::HardwareDot, SimdLevel::AVX2)); },
+                floatDot);
+        }
+        bench.run("hw_dot_soft", batch,
+            [&] { doNotOptimize(dot(a.data(), b.data(), batch, LinalgMode::HardwareDot, SimdLevel::Scalar)); },
+            floatDot);
+
+        // fp8 e4m3 on the same values (the large ones saturate to inf),
+        // every operator is a table lookup
+        std::vector<FP8E4M3> qa(batch), qb(batch), qout(batch);
+        convertToFP8(fa.data(), qa.data(), batch);
+        convertToFP8(fb.data(), qb.data(), batch);
+
+        bench.run("fp8_mul", batch,
+            [&] { for (size_t i = 0; i < batch; ++i) qout[i] = qa[i] * qb[i]; },
+            [&] { for (size_t i = 0; i < batch; ++i) fout[i] = fa[i] * fb[i]; });
+
+        bench.run("fp8_mul_batch", batch,
+            [&] { FP8E4M3::multiply(qa.data(), qb.data(), qout.data(), batch); },
+            [&] { for (size_t i = 0; i < batch; ++i) fout[i] = fa[i] * fb[i]; });
+
+        bench.run("fp8_from_float", batch,
+            [&] { convertToFP8(fa.data(), qout.data(), batch); },
+            [&] { for (size_t i = 0; i < batch; ++i) fout[i] = fa[i]; });
+
+        bench.run("fp8_to_float", batch,
+            [&] { convertToFloat(qa.data(), fout.data(), batch); },
+            [&] { for (size_t i = 0; i < batch; ++i) fout[i] = fa[i]; });
+
+        // mxfp8 e4m3, a shared scale per 32 values so nothing saturates.
+        // the dot reads 1 + 1/32 weight bytes per value against 4 for float
+        MXFP8E4M3 mx = MXFP8E4M3::quantize(fa.data(), batch);
+
+        bench.run("mx_quantize", batch,
+            [&] { doNotOptimize(MXFP8E4M3::quantize(fa.data(), batch).scaleBits(0)); },
+            [&] { for (size_t i = 0; i < batch; ++i) fout[i] = fa[i]; });
+
+        bench.run("mx_dequantize", batch,
+            [&] { mx.dequantize(fout.data()); },
+            [&] { for (size_t i = 0; i < batch; ++i) fout[i] = fa[i]; });
+
+        bench.run("mx_dot", batch,
+            [&] { doNotOptimize(dot(mx, b.data())); },
+            [&] {
+                float acc = 0.0f;
+                for (size_t i = 0; i < batch; ++i) acc += fa[i] * fb[i];
+                doNotOptimize(acc);
+            });
+
+        // stream formatting costs ~100x an add, cap it so a run stays short
+        if (batch > 65536) continue;
+
+        std::ostringstream os;
+        bench.run("toString", batch,
+            [&] {
+                for (size_t i = 0; i < batch; ++i) {
+                    os.str("");
+                    os << a[i];
+                    doNotOptimize(os.tellp());
+                }
+            },
+            [&] {
+                for (size_t i = 0; i < batch; ++i) {
+                    os.str("");
+                    os << fa[i];
+                    doNotOptimize(os.tellp());
+                }
+            });
+
+        std::vector<std::string> text(batch);
+        for (size_t i = 0; i < batch; ++i) {
+            text[i] = std::to_string(fa[i]);
+        }
+        std::istringstream is;
+        bench.run("fromString", batch,
+            [&] {
+                for (size_t i = 0; i < batch; ++i) {
+                    is.clear();
+                    is.str(text[i]);
+                    is >> out[i];
+                }
+            },
+            [&] {
+                for (size_t i = 0; i < batch; ++i) {
+                    is.clear();
+                    is.str(text[i]);
+                    is >> fout[i];
+                }
+            });
+
+        // the same without streams: caller buffer, no locale, no allocation
+        char chars[64];
+        bench.run("toChars", batch,
+            [&] {
+                for (size_t i = 0; i < batch; ++i) {
+                    doNotOptimize(toChars(chars, chars + sizeof(chars), a[i]).ptr);
+                }
+            },
+            [&] {
+                for (size_t i = 0; i < batch; ++i) {
+                    doNotOptimize(std::to_chars(chars, chars + sizeof(chars), fa[i]).ptr);
+                }
+            });
+
+        bench.run("fromChars", batch,
+            [&] {
+                for (size_t i = 0; i < batch; ++i) {
+                    fromChars(text[i].data(), text[i].data() + text[i].size(), out[i]);
+                }
+            },
+            [&] {
+                for (size_t i = 0; i < batch; ++i) {
+                    std::from_chars(text[i].data(), text[i].data() + text[i].size(), fout[i]);
+                }
+            });
+    }
+
+    return bench.finish();
+}
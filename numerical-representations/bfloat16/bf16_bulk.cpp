@@ -0,0 +1,543 @@
+#include "BF16.h"
+#include "BF16Simd.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define BF16_X86 1
+#include <immintrin.h>
+#endif
+
+#if defined(__aarch64__) && defined(__ARM_NEON)
+#define BF16_NEON 1
+#include <arm_neon.h>
+#endif
+
+static_assert(sizeof(BFloat16) == sizeof(uint16_t), "BFloat16 must be a plain 16-bit value");
+
+// scalar kernels, the reference every simd path has to match
+
+static void convertToBF16Scalar(const float* src, BFloat16* dst, size_t n) {
+    for (size_t i = 0; i < n; ++i) {
+        uint32_t fp32_bits;
+        std::memcpy(&fp32_bits, &src[i], sizeof(float));
+        dst[i] = BFloat16::fromFP32Bits(fp32_bits);
+    }
+}
+
+static void convertToFloatScalar(const BFloat16* src, float* dst, size_t n) {
+    for (size_t i = 0; i < n; ++i) {
+        uint32_t fp32_bits = src[i].toFP32Bits();
+        std::memcpy(&dst[i], &fp32_bits, sizeof(float));
+    }
+}
+
+// double narrowing, BFloat16(double): to float rounding to odd, then to
+// nearest even
+static void convertToBF16Scalar(const double* src, BFloat16* dst, size_t n) {
+    for (size_t i = 0; i < n; ++i) dst[i] = BFloat16(src[i]);
+}
+
+// stochastic narrowing: element i uses word low + i of the block that
+// shares block_key, see StochasticRng
+
+static void convertToBF16StochasticScalar(const float* src, BFloat16* dst, size_t n,
+                                          uint32_t block_key, uint32_t low) {
+    for (size_t i = 0; i < n; ++i) {
+        uint32_t fp32_bits;
+        std::memcpy(&fp32_bits, &src[i], sizeof(float));
+        uint32_t random = StochasticRng::word(block_key, low + static_cast<uint32_t>(i));
+        dst[i] = BFloat16::fromBits(BFloat16::Format::fromFP32BitsStochastic(fp32_bits, random));
+    }
+}
+
+// the directed modes, scalar only
+static void convertToBF16Directed(const float* src, BFloat16* dst, size_t n, RoundingMode mode) {
+    withRoundingMode(mode, [&](auto r) {
+        for (size_t i = 0; i < n; ++i) {
+            uint32_t fp32_bits;
+            std::memcpy(&fp32_bits, &src[i], sizeof(float));
+            dst[i] = BFloat16::fromBits(BFloat16::Format::fromFP32Bits<decltype(r)::value>(fp32_bits));
+        }
+    });
+}
+
+#ifdef BF16_X86
+
+// avx2: same bias trick as fromFP32Bits, 16 floats per iteration
+
+__attribute__((target("avx2")))
+static void convertToBF16AVX2(const float* src, BFloat16* dst, size_t n) {
+    const __m256i one = _mm256_set1_epi32(1);
+    const __m256i bias = _mm256_set1_epi32(0x7FFF);
+    size_t i = 0;
+
+    for (; i + 16 <= n; i += 16) {
+        __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+        __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i + 8));
+
+        // rounded = bits + 0x7FFF + ((bits >> 16) & 1)
+        __m256i lsb_a = _mm256_and_si256(_mm256_srli_epi32(a, 16), one);
+        __m256i lsb_b = _mm256_and_si256(_mm256_srli_epi32(b, 16), one);
+        a = _mm256_srli_epi32(_mm256_add_epi32(a, _mm256_add_epi32(bias, lsb_a)), 16);
+        b = _mm256_srli_epi32(_mm256_add_epi32(b, _mm256_add_epi32(bias, lsb_b)), 16);
+
+        // values are <= 0xFFFF so unsigned saturation is exact,
+        // packus works per 128-bit lane so fix the order afterwards
+        __m256i packed = _mm256_packus_epi32(a, b);
+        packed = _mm256_permute4x64_epi64(packed, 0xD8);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), packed);
+    }
+
+    convertToBF16Scalar(src + i, dst + i, n - i);
+}
+
+__attribute__((target("avx2")))
+static void convertToFloatAVX2(const BFloat16* src, float* dst, size_t n) {
+    size_t i = 0;
+
+    for (; i + 8 <= n; i += 8) {
+        __m128i h = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        __m256i w = _mm256_slli_epi32(_mm256_cvtepu16_epi32(h), 16);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), w);
+    }
+
+    convertToFloatScalar(src + i, dst + i, n - i);
+}
+
+// double -> float rounding to odd, four lanes: an inexact narrowing (never
+// a nan) that came out even steps to the odd neighbour toward v, down in
+// magnitude when the float overshot
+__attribute__((target("avx2")))
+static __m128i roundToOddAVX2(__m256d v) {
+    const __m256d magnitude = _mm256_castsi256_pd(_mm256_set1_epi64x(0x7FFFFFFFFFFFFFFFll));
+    const __m256i low_words = _mm256_setr_epi32(0, 2, 4, 6, 0, 2, 4, 6);
+    __m128 narrowed = _mm256_cvtpd_ps(v);
+    __m256d back = _mm256_cvtps_pd(narrowed);
+    __m256d inexact = _mm256_cmp_pd(back, v, _CMP_NEQ_OQ);
+    __m256d over = _mm256_cmp_pd(_mm256_and_pd(back, magnitude), _mm256_and_pd(v, magnitude), _CMP_GT_OQ);
+
+    // the 64-bit masks down to 32-bit lanes
+    __m128i inexact32 = _mm256_castsi256_si128(_mm256_permutevar8x32_epi32(_mm256_castpd_si256(inexact), low_words));
+    __m128i over32 = _mm256_castsi256_si128(_mm256_permutevar8x32_epi32(_mm256_castpd_si256(over), low_words));
+
+    const __m128i one = _mm_set1_epi32(1);
+    __m128i bits = _mm_castps_si128(narrowed);
+    __m128i even = _mm_cmpeq_epi32(_mm_and_si128(bits, one), _mm_setzero_si128());
+    __m128i step = _mm_and_si128(_mm_and_si128(inexact32, even), _mm_or_si128(over32, one));
+    return _mm_add_epi32(bits, step);
+}
+
+__attribute__((target("avx2")))
+static void convertToBF16AVX2(const double* src, BFloat16* dst, size_t n) {
+    const __m256i one = _mm256_set1_epi32(1);
+    const __m256i bias = _mm256_set1_epi32(0x7FFF);
+    size_t i = 0;
+
+    for (; i + 16 <= n; i += 16) {
+        __m256i a = _mm256_setr_m128i(roundToOddAVX2(_mm256_loadu_pd(src + i)),
+                                      roundToOddAVX2(_mm256_loadu_pd(src + i + 4)));
+        __m256i b = _mm256_setr_m128i(roundToOddAVX2(_mm256_loadu_pd(src + i + 8)),
+                                      roundToOddAVX2(_mm256_loadu_pd(src + i + 12)));
+
+        // then the float kernel's bias trick and pack
+        __m256i lsb_a = _mm256_and_si256(_mm256_srli_epi32(a, 16), one);
+        __m256i lsb_b = _mm256_and_si256(_mm256_srli_epi32(b, 16), one);
+        a = _mm256_srli_epi32(_mm256_add_epi32(a, _mm256_add_epi32(bias, lsb_a)), 16);
+        b = _mm256_srli_epi32(_mm256_add_epi32(b, _mm256_add_epi32(bias, lsb_b)), 16);
+        __m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi32(a, b), 0xD8);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), packed);
+    }
+
+    convertToBF16Scalar(src + i, dst + i, n - i);
+}
+
+// stochastic rounding: the random words are hashed in the lanes, then
+// bits + (~random >> 16) carries into the kept half exactly when the
+// scalar test random < (low half << 16) holds. nan lanes become sign |
+// quiet nan like the scalar kernel
+
+__attribute__((target("avx2")))
+static __m256i mixAVX2(__m256i x) {
+    x = _mm256_xor_si256(x, _mm256_srli_epi32(x, 16));
+    x = _mm256_mullo_epi32(x, _mm256_set1_epi32(0x7FEB352D));
+    x = _mm256_xor_si256(x, _mm256_srli_epi32(x, 15));
+    x = _mm256_mullo_epi32(x, _mm256_set1_epi32(static_cast<int>(0x846CA68Bu)));
+    return _mm256_xor_si256(x, _mm256_srli_epi32(x, 16));
+}
+
+__attribute__((target("avx2")))
+static __m256i roundStochasticAVX2(__m256i v, __m256i counter, __m256i key) {
+    __m256i random = mixAVX2(_mm256_add_epi32(mixAVX2(_mm256_xor_si256(counter, key)), key));
+    __m256i rounded = _mm256_add_epi32(v, _mm256_srli_epi32(_mm256_xor_si256(random, _mm256_set1_epi32(-1)), 16));
+    rounded = _mm256_srli_epi32(rounded, 16);
+
+    __m256i mag = _mm256_and_si256(v, _mm256_set1_epi32(0x7FFFFFFF));
+    __m256i is_nan = _mm256_cmpgt_epi32(mag, _mm256_set1_epi32(0x7F800000));
+    __m256i nan = _mm256_or_si256(_mm256_and_si256(_mm256_srli_epi32(v, 16), _mm256_set1_epi32(0x8000)),
+                                  _mm256_set1_epi32(0x7FC0));
+    return _mm256_blendv_epi8(rounded, nan, is_nan);
+}
+
+__attribute__((target("avx2")))
+static void convertToBF16StochasticAVX2(const float* src, BFloat16* dst, size_t n,
+                                        uint32_t block_key, uint32_t low) {
+    const __m256i key = _mm256_set1_epi32(static_cast<int>(block_key));
+    __m256i counter = _mm256_add_epi32(_mm256_set1_epi32(static_cast<int>(low)),
+                                       _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+    const __m256i eight = _mm256_set1_epi32(8);
+    size_t i = 0;
+
+    for (; i + 16 <= n; i += 16) {
+        __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+        __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i + 8));
+        a = roundStochasticAVX2(a, counter, key);
+        counter = _mm256_add_epi32(counter, eight);
+        b = roundStochasticAVX2(b, counter, key);
+        counter = _mm256_add_epi32(counter, eight);
+
+        __m256i packed = _mm256_packus_epi32(a, b);
+        packed = _mm256_permute4x64_epi64(packed, 0xD8);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), packed);
+    }
+
+    convertToBF16StochasticScalar(src + i, dst + i, n - i, block_key, low + static_cast<uint32_t>(i));
+}
+
+// gcc 12 flags the _mm512_undefined_* placeholders inside its own headers
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#pragma GCC diagnostic ignored "-Wuninitialized"
+#endif
+
+// avx512: 16 floats per register, narrowing store instead of pack
+
+__attribute__((target("avx512f,avx512bw,avx512vl")))
+static __m256i roundToBF16AVX512(__m512i v) {
+    __m512i lsb = _mm512_and_si512(_mm512_srli_epi32(v, 16), _mm512_set1_epi32(1));
+    __m512i rounded = _mm512_add_epi32(v, _mm512_add_epi32(_mm512_set1_epi32(0x7FFF), lsb));
+    return _mm512_cvtepi32_epi16(_mm512_srli_epi32(rounded, 16));
+}
+
+__attribute__((target("avx512f,avx512bw,avx512vl")))
+static void convertToBF16AVX512(const float* src, BFloat16* dst, size_t n) {
+    size_t i = 0;
+
+    for (; i + 16 <= n; i += 16) {
+        __m512i v = _mm512_loadu_si512(src + i);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), roundToBF16AVX512(v));
+    }
+
+    // masked tail so short arrays stay in registers
+    if (i < n) {
+        __mmask16 k = static_cast<__mmask16>((1u << (n - i)) - 1);
+        __m512i v = _mm512_maskz_loadu_epi32(k, src + i);
+        _mm256_mask_storeu_epi16(dst + i, k, roundToBF16AVX512(v));
+    }
+}
+
+// double -> float rounding to odd, eight lanes, as roundToOddAVX2
+__attribute__((target("avx512f,avx512bw,avx512vl")))
+static __m256i roundToOddAVX512(__m512d v) {
+    __m256 narrowed = _mm512_cvtpd_ps(v);
+    __m512d back = _mm512_cvtps_pd(narrowed);
+    __mmask8 inexact = _mm512_cmp_pd_mask(back, v, _CMP_NEQ_OQ);
+    __mmask8 over = _mm512_cmp_pd_mask(_mm512_abs_pd(back), _mm512_abs_pd(v), _CMP_GT_OQ);
+
+    const __m256i one = _mm256_set1_epi32(1);
+    __m256i bits = _mm256_castps_si256(narrowed);
+    __mmask8 step = inexact & _mm256_testn_epi32_mask(bits, one);
+    __m256i delta = _mm256_mask_blend_epi32(over, one, _mm256_set1_epi32(-1));
+    return _mm256_mask_add_epi32(bits, step, bits, delta);
+}
+
+__attribute__((target("avx512f,avx512bw,avx512vl")))
+static __m512i roundToOddAVX512(__m512d lo, __m512d hi) {
+    return _mm512_inserti64x4(_mm512_castsi256_si512(roundToOddAVX512(lo)), roundToOddAVX512(hi), 1);
+}
+
+__attribute__((target("avx512f,avx512bw,avx512vl")))
+static void convertToBF16AVX512(const double* src, BFloat16* dst, size_t n) {
+    size_t i = 0;
+
+    for (; i + 16 <= n; i += 16) {
+        __m512i v = roundToOddAVX512(_mm512_loadu_pd(src + i), _mm512_loadu_pd(src + i + 8));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), roundToBF16AVX512(v));
+    }
+
+    if (i < n) {
+        __mmask16 k = static_cast<__mmask16>((1u << (n - i)) - 1);
+        __m512d lo = _mm512_maskz_loadu_pd(static_cast<__mmask8>(k), src + i);
+        __m512d hi = _mm512_maskz_loadu_pd(static_cast<__mmask8>(k >> 8), src + i + 8);
+        _mm256_mask_storeu_epi16(dst + i, k, roundToBF16AVX512(roundToOddAVX512(lo, hi)));
+    }
+}
+
+__attribute__((target("avx512f,avx512bw,avx512vl")))
+static void convertToFloatAVX512(const BFloat16* src, float* dst, size_t n) {
+    size_t i = 0;
+
+    for (; i + 16 <= n; i += 16) {
+        __m256i h = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+        __m512i w = _mm512_slli_epi32(_mm512_cvtepu16_epi32(h), 16);
+        _mm512_storeu_si512(dst + i, w);
+    }
+
+    if (i < n) {
+        __mmask16 k = static_cast<__mmask16>((1u << (n - i)) - 1);
+        __m256i h = _mm256_maskz_loadu_epi16(k, src + i);
+        __m512i w = _mm512_slli_epi32(_mm512_cvtepu16_epi32(h), 16);
+        _mm512_mask_storeu_epi32(dst + i, k, w);
+    }
+}
+
+__attribute__((target("avx512f,avx512bw,avx512vl")))
+static __m512i mixAVX512(__m512i x) {
+    x = _mm512_xor_si512(x, _mm512_srli_epi32(x, 16));
+    x = _mm512_mullo_epi32(x, _mm512_set1_epi32(0x7FEB352D));
+    x = _mm512_xor_si512(x, _mm512_srli_epi32(x, 15));
+    x = _mm512_mullo_epi32(x, _mm512_set1_epi32(static_cast<int>(0x846CA68Bu)));
+    return _mm512_xor_si512(x, _mm512_srli_epi32(x, 16));
+}
+
+__attribute__((target("avx512f,avx512bw,avx512vl")))
+static __m256i roundStochasticAVX512(__m512i v, __m512i counter, __m512i key) {
+    __m512i random = mixAVX512(_mm512_add_epi32(mixAVX512(_mm512_xor_si512(counter, key)), key));
+    __m512i rounded = _mm512_add_epi32(v, _mm512_srli_epi32(_mm512_ternarylogic_epi32(random, random, random, 0x55), 16));
+    rounded = _mm512_srli_epi32(rounded, 16);
+
+    __mmask16 is_nan = _mm512_cmpgt_epu32_mask(_mm512_and_si512(v, _mm512_set1_epi32(0x7FFFFFFF)),
+                                               _mm512_set1_epi32(0x7F800000));
+    __m512i nan = _mm512_or_si512(_mm512_and_si512(_mm512_srli_epi32(v, 16), _mm512_set1_epi32(0x8000)),
+                                  _mm512_set1_epi32(0x7FC0));
+    return _mm512_cvtepi32_epi16(_mm512_mask_blend_epi32(is_nan, rounded, nan));
+}
+
+__attribute__((target("avx512f,avx512bw,avx512vl")))
+static void convertToBF16StochasticAVX512(const float* src, BFloat16* dst, size_t n,
+                                          uint32_t block_key, uint32_t low) {
+    const __m512i key = _mm512_set1_epi32(static_cast<int>(block_key));
+    __m512i counter = _mm512_add_epi32(_mm512_set1_epi32(static_cast<int>(low)),
+                                       _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15));
+    const __m512i sixteen = _mm512_set1_epi32(16);
+    size_t i = 0;
+
+    for (; i + 16 <= n; i += 16) {
+        __m512i v = _mm512_loadu_si512(src + i);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), roundStochasticAVX512(v, counter, key));
+        counter = _mm512_add_epi32(counter, sixteen);
+    }
+
+    if (i < n) {
+        __mmask16 k = static_cast<__mmask16>((1u << (n - i)) - 1);
+        __m512i v = _mm512_maskz_loadu_epi32(k, src + i);
+        _mm256_mask_storeu_epi16(dst + i, k, roundStochasticAVX512(v, counter, key));
+    }
+}
+
+// avx512_bf16: vcvtneps2bf16 rounds to nearest even like the bias trick,
+// but it quiets nans and treats subnormal inputs as zero, so lanes with an
+// all-zero or all-one exponent are patched with the integer result
+
+__attribute__((target("avx512f,avx512bw,avx512vl,avx512bf16")))
+static void convertToBF16AVX512BF16(const float* src, BFloat16* dst, size_t n) {
+    const __m512i exp_mask = _mm512_set1_epi32(0x7F800000);
+    size_t i = 0;
+
+    for (; i + 16 <= n; i += 16) {
+        __m512 f = _mm512_loadu_ps(src + i);
+        __m512i v = _mm512_castps_si512(f);
+        __m256i result = (__m256i)_mm512_cvtneps_pbh(f);
+
+        __m512i exp = _mm512_and_si512(v, exp_mask);
+        __mmask16 special = _mm512_cmpeq_epi32_mask(exp, _mm512_setzero_si512()) |
+                            _mm512_cmpeq_epi32_mask(exp, exp_mask);
+        if (special) {
+            result = _mm256_mask_blend_epi16(special, result, roundToBF16AVX512(v));
+        }
+
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), result);
+    }
+
+    if (i < n) {
+        convertToBF16AVX512(src + i, dst + i, n - i);
+    }
+}
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+#endif // BF16_X86
+
+#ifdef BF16_NEON
+
+static void convertToBF16NEON(const float* src, BFloat16* dst, size_t n) {
+    const uint32x4_t one = vdupq_n_u32(1);
+    const uint32x4_t bias = vdupq_n_u32(0x7FFF);
+    size_t i = 0;
+
+    for (; i + 8 <= n; i += 8) {
+        uint32x4_t a = vld1q_u32(reinterpret_cast<const uint32_t*>(src + i));
+        uint32x4_t b = vld1q_u32(reinterpret_cast<const uint32_t*>(src + i + 4));
+
+        a = vaddq_u32(a, vaddq_u32(bias, vandq_u32(vshrq_n_u32(a, 16), one)));
+        b = vaddq_u32(b, vaddq_u32(bias, vandq_u32(vshrq_n_u32(b, 16), one)));
+
+        uint16x8_t packed = vcombine_u16(vshrn_n_u32(a, 16), vshrn_n_u32(b, 16));
+        vst1q_u16(reinterpret_cast<uint16_t*>(dst + i), packed);
+    }
+
+    convertToBF16Scalar(src + i, dst + i, n - i);
+}
+
+static void convertToFloatNEON(const BFloat16* src, float* dst, size_t n) {
+    size_t i = 0;
+
+    for (; i + 8 <= n; i += 8) {
+        uint16x8_t h = vld1q_u16(reinterpret_cast<const uint16_t*>(src + i));
+        vst1q_u32(reinterpret_cast<uint32_t*>(dst + i), vshll_n_u16(vget_low_u16(h), 16));
+        vst1q_u32(reinterpret_cast<uint32_t*>(dst + i + 4), vshll_n_u16(vget_high_u16(h), 16));
+    }
+
+    convertToFloatScalar(src + i, dst + i, n - i);
+}
+
+#endif // BF16_NEON
+
+// runtime dispatch, the level detection is in ../float/simd.cpp
+
+void convertToBF16(const float* src, BFloat16* dst, size_t n, SimdLevel level) {
+    if (!simdLevelSupported(level)) level = SimdLevel::Scalar;
+
+    switch (level) {
+#ifdef BF16_X86
+    case SimdLevel::AVX2:       convertToBF16AVX2(src, dst, n); return;
+    case SimdLevel::AVX512:     convertToBF16AVX512(src, dst, n); return;
+    case SimdLevel::AVX512BF16: convertToBF16AVX512BF16(src, dst, n); return;
+#endif
+#ifdef BF16_NEON
+    case SimdLevel::NEON:       convertToBF16NEON(src, dst, n); return;
+#endif
+    default:                    convertToBF16Scalar(src, dst, n); return;
+    }
+}
+
+void convertToBF16(const double* src, BFloat16* dst, size_t n, SimdLevel level) {
+    if (!simdLevelSupported(level)) level = SimdLevel::Scalar;
+
+    // vcvtneps2bf16 has no double form, and neon has no narrowing worth
+    // the rounding fixup, so those levels take the nearest kernel
+    switch (level) {
+#ifdef BF16_X86
+    case SimdLevel::AVX2:       convertToBF16AVX2(src, dst, n); return;
+    case SimdLevel::AVX512:
+    case SimdLevel::AVX512BF16: convertToBF16AVX512(src, dst, n); return;
+#endif
+    default:                    convertToBF16Scalar(src, dst, n); return;
+    }
+}
+
+void convertToFloat(const BFloat16* src, float* dst, size_t n, SimdLevel level) {
+    if (!simdLevelSupported(level)) level = SimdLevel::Scalar;
+
+    switch (level) {
+#ifdef BF16_X86
+    case SimdLevel::AVX2:       convertToFloatAVX2(src, dst, n); return;
+    // there is no widening bf16 instruction worth using, the shift is free
+    case SimdLevel::AVX512:
+    case SimdLevel::AVX512BF16: convertToFloatAVX512(src, dst, n); return;
+#endif
+#ifdef BF16_NEON
+    case SimdLevel::NEON:       convertToFloatNEON(src, dst, n); return;
+#endif
+    default:                    convertToFloatScalar(src, dst, n); return;
+    }
+}
+
+// stochastic narrowing from counter first of stream key. the pieces stop
+// where the counter's high word changes, so each has a single block key
+
+static void convertToBF16Stochastic(const float* src, BFloat16* dst, size_t n,
+                                    uint64_t key, uint64_t first, SimdLevel level) {
+    while (n > 0) {
+        uint32_t low = static_cast<uint32_t>(first);
+        size_t piece = static_cast<size_t>(std::min<uint64_t>(n, (uint64_t(1) << 32) - low));
+        uint32_t block_key = StochasticRng::blockKey(key, first);
+
+        switch (level) {
+#ifdef BF16_X86
+        case SimdLevel::AVX2:       convertToBF16StochasticAVX2(src, dst, piece, block_key, low); break;
+        case SimdLevel::AVX512:
+        case SimdLevel::AVX512BF16: convertToBF16StochasticAVX512(src, dst, piece, block_key, low); break;
+#endif
+        default:                    convertToBF16StochasticScalar(src, dst, piece, block_key, low); break;
+        }
+
+        src += piece;
+        dst += piece;
+        n -= piece;
+        first += piece;
+    }
+}
+
+void convertToBF16(const float* src, BFloat16* dst, size_t n, RoundingMode mode, SimdLevel level) {
+    if (!simdLevelSupported(level)) level = SimdLevel::Scalar;
+
+    if (mode == RoundingMode::NearestEven) {
+        convertToBF16(src, dst, n, level);
+    } else if (mode == RoundingMode::Stochastic) {
+        uint64_t first;
+        uint64_t key = StochasticRng::reserve(n, first);
+        convertToBF16Stochastic(src, dst, n, key, first, level);
+    } else {
+        convertToBF16Directed(src, dst, n, mode);
+    }
+}
+
+// large spans are split across the thread pool, each chunk runs the
+// pinned kernel on its own slice
+
+static const size_t CONVERT_GRAIN = chunkElements(sizeof(float) + sizeof(BFloat16));
+
+void convertToBF16(const float* src, BFloat16* dst, size_t n) {
+    SimdLevel level = detectSimdLevel();
+    parallelChunks(n, CONVERT_GRAIN, [=](size_t begin, size_t end) {
+        convertToBF16(src + begin, dst + begin, end - begin, level);
+    });
+}
+
+void convertToBF16(const double* src, BFloat16* dst, size_t n) {
+    SimdLevel level = detectSimdLevel();
+    parallelChunks(n, chunkElements(sizeof(double) + sizeof(BFloat16)), [=](size_t begin, size_t end) {
+        convertToBF16(src + begin, dst + begin, end - begin, level);
+    });
+}
+
+void convertToBF16(const float* src, BFloat16* dst, size_t n, RoundingMode mode) {
+    if (mode == RoundingMode::NearestEven) {
+        convertToBF16(src, dst, n);
+        return;
+    }
+
+    // the counters are taken on the calling thread, chunk i uses its slice
+    SimdLevel level = detectSimdLevel();
+    uint64_t first = 0;
+    uint64_t key = mode == RoundingMode::Stochastic ? StochasticRng::reserve(n, first) : 0;
+    parallelChunks(n, CONVERT_GRAIN, [=](size_t begin, size_t end) {
+        if (mode == RoundingMode::Stochastic) {
+            convertToBF16Stochastic(src + begin, dst + begin, end - begin, key, first + begin, level);
+        } else {
+            convertToBF16Directed(src + begin, dst + begin, end - begin, mode);
+        }
+    });
+}
+
+void convertToFloat(const BFloat16* src, float* dst, size_t n) {
+    SimdLevel level = detectSimdLevel();
+    parallelChunks(n, CONVERT_GRAIN, [=](size_t begin, size_t end) {
+        convertToFloat(src + begin, dst + begin, end - begin, level);
+    });
+}
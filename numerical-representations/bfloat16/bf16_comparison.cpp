@@ -3,39 +3,6 @@
 
 // comparison impl
 
-int BFloat16::compareImpl(const BFloat16& a, const BFloat16& b) {
-    // nan is unordered with everything
-    if (a.isNaN() || b.isNaN()) {
-        return 2; // special return for unordered
-    }
-    
-    // pos and neg zero equal
-    if (a.isZero() && b.isZero()) {
-        return 0;
-    }
-    
-    // diff signs
-    bool sign_a = a.sign();
-    bool sign_b = b.sign();
-    
-    if (sign_a != sign_b) {
-        return sign_a ? -1 : 1;
-    }
-    
-    // same sign, compare bits
-    if (a.bits_ == b.bits_) {
-        return 0;
-    }
-    
-    if (sign_a) {
-        // both neg, reverse comparison
-        return (a.bits_ > b.bits_) ? -1 : 1;
-    } else {
-        // both pos, normal comparison
-        return (a.bits_ < b.bits_) ? -1 : 1;
-    }
-}
-
 bool BFloat16::operator==(const BFloat16& other) const {
     // nan is not equal to anything 
     if (isNaN() || other.isNaN()) {
@@ -55,22 +22,22 @@ bool BFloat16::operator!=(const BFloat16& other) const {
 }
 
 bool BFloat16::operator<(const BFloat16& other) const {
-    int cmp = compareImpl(*this, other);
+    int cmp = Format::compare(bits_, other.bits_);
     return cmp == -1;
 }
 
 bool BFloat16::operator<=(const BFloat16& other) const {
-    int cmp = compareImpl(*this, other);
+    int cmp = Format::compare(bits_, other.bits_);
     return cmp == -1 || cmp == 0;
 }
 
 bool BFloat16::operator>(const BFloat16& other) const {
-    int cmp = compareImpl(*this, other);
+    int cmp = Format::compare(bits_, other.bits_);
     return cmp == 1;
 }
 
 bool BFloat16::operator>=(const BFloat16& other) const {
-    int cmp = compareImpl(*this, other);
+    int cmp = Format::compare(bits_, other.bits_);
     return cmp == 1 || cmp == 0;
 }
 
@@ -82,20 +49,12 @@ BFloat16 BFloat16::abs() const {
 }
 
 BFloat16 BFloat16::sqrt() const {
-    // handle special cases
-    if (isNaN()) return BFloat16::nan();
-    
-    if (isNegative() && !isZero()) {
-        return BFloat16::nan(); // sqrt of negative number
-    }
-    
-    if (isZero()) return *this;
-    if (isInfinity()) return BFloat16::infinity(false);
-    
-    // float conversion for simplicity
-    float val = toFloat();
-    float result = std::sqrt(val);
-    return BFloat16(result);
+    // integer square root of the significand, see FloatFormat.h
+    return BFloat16(withSubnormalMode(subnormalMode(), [&](auto sm) { return FormatFor<decltype(sm)::value>::sqrt(bits_); }));
+}
+
+BFloat16 BFloat16::rsqrt() const {
+    return BFloat16(withSubnormalMode(subnormalMode(), [&](auto sm) { return FormatFor<decltype(sm)::value>::rsqrt(bits_); }));
 }
 
 // non member func 
@@ -105,4 +64,12 @@ BFloat16 abs(const BFloat16& x) {
 
 BFloat16 sqrt(const BFloat16& x) {
     return x.sqrt();
+}
+
+BFloat16 rsqrt(const BFloat16& x) {
+    return x.rsqrt();
+}
+
+BFloat16 fma(const BFloat16& a, const BFloat16& b, const BFloat16& c) {
+    return BFloat16::fma(a, b, c);
 }
\ No newline at end of file
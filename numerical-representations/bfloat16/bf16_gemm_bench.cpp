@@ -0,0 +1,90 @@
+#include "BF16.h"
+#include "BF16Linalg.h"
+#include "BF16Simd.h"
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <vector>
+
+// bf16 gemm throughput, native blocked kernel vs a naive triple loop, and
+// the HardwareDot mode: vdpbf16ps (the fma emulation on a cpu without it)
+// against its soft-float emulation, the same bits
+// usage: bench_bf16_gemm [max_size]   (default 1024, try 4096)
+
+static double seconds(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static void naiveGemm(size_t n, const std::vector<BFloat16>& A, const std::vector<BFloat16>& B,
+                      std::vector<float>& C) {
+    for (size_t i = 0; i < n; ++i) {
+        for (size_t j = 0; j < n; ++j) {
+            float acc = 0.0f;
+            for (size_t p = 0; p < n; ++p) {
+                acc += A[i * n + p].toFloat() * B[p * n + j].toFloat();
+            }
+            C[i * n + j] = acc;
+        }
+    }
+}
+
+int main(int argc, char** argv) {
+    size_t max_size = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1024;
+
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+
+    std::cout << std::left << std::setw(8) << "n" << std::right
+              << std::setw(14) << "native s" << std::setw(14) << "GFLOP/s"
+              << std::setw(14) << "naive s" << std::setw(14) << "GFLOP/s"
+              << std::setw(14) << "hw dot s" << std::setw(14) << "GFLOP/s"
+              << std::setw(14) << "emulated s" << std::setw(14) << "GFLOP/s" << std::endl;
+    std::cout << std::fixed << std::setprecision(3);
+
+    for (size_t n = 128; n <= max_size; n *= 2) {
+        std::vector<BFloat16> A(n * n), B(n * n);
+        for (size_t i = 0; i < n * n; ++i) {
+            A[i] = BFloat16(dist(rng));
+            B[i] = BFloat16(dist(rng));
+        }
+        std::vector<float> C(n * n);
+        double flops = 2.0 * n * n * n;
+
+        auto start = std::chrono::steady_clock::now();
+        gemm(n, n, n, 1.0f, A.data(), n, B.data(), n, 0.0f, C.data(), n);
+        double native = seconds(start);
+
+        std::cout << std::left << std::setw(8) << n << std::right
+                  << std::setw(14) << native << std::setw(14) << flops / native * 1e-9;
+
+        // the naive loop gets slow fast, stop timing it past 1024
+        if (n <= 1024) {
+            start = std::chrono::steady_clock::now();
+            naiveGemm(n, A, B, C);
+            double naive = seconds(start);
+            std::cout << std::setw(14) << naive << std::setw(14) << flops / naive * 1e-9;
+        } else {
+            std::cout << std::setw(28) << "";
+        }
+
+        SimdLevel level = detectSimdLevel();
+        start = std::chrono::steady_clock::now();
+        gemm(n, n, n, 1.0f, A.data(), n, B.data(), n, 0.0f, C.data(), n, LinalgMode::HardwareDot, level);
+        double hw = seconds(start);
+        std::cout << std::setw(14) << hw << std::setw(14) << flops / hw * 1e-9;
+
+        // a soft-float fma per product, only the smallest size stays short
+        if (n <= 256) {
+            start = std::chrono::steady_clock::now();
+            gemm(n, n, n, 1.0f, A.data(), n, B.data(), n, 0.0f, C.data(), n, LinalgMode::HardwareDot,
+                 SimdLevel::Scalar);
+            double emulated = seconds(start);
+            std::cout << std::setw(14) << emulated << std::setw(14) << flops / emulated * 1e-9;
+        }
+        std::cout << std::endl;
+    }
+
+    return 0;
+}
@@ -1,26 +1,162 @@
 #include "BF16.h"
+#include <algorithm>
+#include <cmath>
 #include <iostream>
-#include <iomanip>
+#include <string_view>
 
+// powers of ten over the BFloat16 range and a little past it, exact for
+// 10^0 .. 10^22
+constexpr int POW10_MIN = -48;
+constexpr int POW10_MAX = 48;
+
+struct PowersOfTen {
+    double value[POW10_MAX - POW10_MIN + 1];
+
+    constexpr PowersOfTen() : value() {
+        double p = 1.0;
+        for (int i = 0; i <= POW10_MAX; ++i, p *= 10.0) value[i - POW10_MIN] = p;
+        p = 1.0;
+        for (int i = 1; i <= -POW10_MIN; ++i) {
+            p *= 10.0;
+            value[-i - POW10_MIN] = 1.0 / p;
+        }
+    }
+    constexpr double operator[](int i) const { return value[i - POW10_MIN]; }
+};
+
+static constexpr PowersOfTen POW10;
+
+// digits * 10^exponent as std::from_chars would parse it
+static double decimalValue(uint32_t digits, int exponent) {
+    // one correctly rounded op while the power of ten is exact
+    if (exponent >= 0 && exponent <= 22) return digits * POW10[exponent];
+    if (exponent < 0 && exponent >= -22) return digits / POW10[-exponent];
+
+    char text[24];
+    char* end = std::to_chars(text, text + 12, digits).ptr;
+    *end = 'e';
+    end = std::to_chars(end + 1, text + sizeof(text), exponent).ptr;
+    double value;
+    std::from_chars(text, end, value);
+    return value;
+}
+
+// digits * 10^exponent in std::to_chars' shortest style: fixed or
+// scientific, whichever is shorter, fixed on a tie
+static std::to_chars_result writeDecimal(char* first, char* last, bool negative,
+                                         uint32_t digits, int exponent) {
+    char text[10];
+    char* text_end = std::to_chars(text, text + sizeof(text), digits).ptr;
+    int n = static_cast<int>(text_end - text);
+    int scientific_exponent = exponent + n - 1;
+    int abs_exponent = scientific_exponent < 0 ? -scientific_exponent : scientific_exponent;
+    int scientific_length = n + (n > 1) + 2 + (abs_exponent >= 100 ? 3 : 2);
+    int fixed_length = exponent >= 0 ? n + exponent
+                     : scientific_exponent >= 0 ? n + 1
+                     : n + 1 - scientific_exponent;
+
+    if (last - first < negative + std::min(fixed_length, scientific_length)) {
+        return {last, std::errc::value_too_large};
+    }
+    if (negative) *first++ = '-';
+
+    if (fixed_length <= scientific_length) {
+        if (exponent >= 0) {
+            first = std::copy(text, text_end, first);
+            first = std::fill_n(first, exponent, '0');
+        } else if (scientific_exponent >= 0) {
+            first = std::copy(text, text + scientific_exponent + 1, first);
+            *first++ = '.';
+            first = std::copy(text + scientific_exponent + 1, text_end, first);
+        } else {
+            *first++ = '0';
+            *first++ = '.';
+            first = std::fill_n(first, -scientific_exponent - 1, '0');
+            first = std::copy(text, text_end, first);
+        }
+        return {first, std::errc()};
+    }
+
+    *first++ = text[0];
+    if (n > 1) {
+        *first++ = '.';
+        first = std::copy(text + 1, text_end, first);
+    }
+    *first++ = 'e';
+    *first++ = scientific_exponent < 0 ? '-' : '+';
+    if (abs_exponent < 10) *first++ = '0';
+    return std::to_chars(first, last, abs_exponent);
+}
+
+std::to_chars_result toChars(char* first, char* last, BFloat16 value, CharsFormat format) {
+    if (format != CharsFormat::Shortest) {
+        return bitsToChars(first, last, value.bits(), BFloat16::Format::EXPONENT_BITS,
+                           BFloat16::Format::MANTISSA_BITS, format);
+    }
+    if (value.isZero() || !value.isFinite()) {
+        return std::to_chars(first, last, value.toFloat());
+    }
+
+    // round to 1, 2, 3 then 4 significant digits until the decimal parses
+    // back to value. 8 significand bits never need more than 4
+    BFloat16 magnitude = BFloat16::fromBits(value.bits() & 0x7FFF);
+    double x = magnitude.toDouble();
+    int binary_exponent;
+    std::frexp(x, &binary_exponent);
+    int k = static_cast<int>(std::floor((binary_exponent - 1) * 0.30102999566398120));
+    if (x >= POW10[k + 1]) ++k;       // now 10^k <= x < 10^(k+1)
+    else if (x < POW10[k]) --k;
+
+    uint32_t digits = 0;
+    int exponent = 0;
+    for (int precision = 1; precision <= 4; ++precision) {
+        exponent = k - precision + 1;
+        double scaled = exponent > 0 && exponent <= 22 ? x / POW10[exponent] : x * POW10[-exponent];
+        digits = static_cast<uint32_t>(std::nearbyint(scaled));
+        if (BFloat16(decimalValue(digits, exponent)).bits() == magnitude.bits()) break;
+    }
+    for (; digits % 10 == 0; digits /= 10) ++exponent;
+    return writeDecimal(first, last, value.sign(), digits, exponent);
+}
+
+std::from_chars_result fromChars(const char* first, const char* last, BFloat16& value, CharsFormat format) {
+    if (format != CharsFormat::Shortest) {
+        uint32_t bits;
+        std::from_chars_result result = bitsFromChars(first, last, bits, BFloat16::Format::EXPONENT_BITS,
+                                                      BFloat16::Format::MANTISSA_BITS, format);
+        if (result.ec == std::errc()) value = BFloat16::fromBits(static_cast<uint16_t>(bits));
+        return result;
+    }
+
+    double parsed;
+    std::from_chars_result result = std::from_chars(first, last, parsed);
+    if (result.ec != std::errc()) return result;
+
+    // in double range but not in bf16's, out of range like std::from_chars
+    BFloat16 rounded(parsed);
+    if ((rounded.isInfinity() && !std::isinf(parsed)) || (rounded.isZero() && parsed != 0.0)) {
+        result.ec = std::errc::result_out_of_range;
+        return result;
+    }
+    value = rounded;
+    return result;
+}
 
 std::ostream& operator<<(std::ostream& os, const BFloat16& bf) {
-    // save stream state
-    std::ios_base::fmtflags flags = os.flags();
-    std::streamsize precision = os.precision();
-    
-    // print the decimal value with appropriate precision 
-    os << std::setprecision(4) << bf.toDouble();
-    
-    // restore stream state
-    os.flags(flags);
-    os.precision(precision);
-    
-    return os;
+    // shortest round-trip decimal, only the stream's width and fill apply
+    char buffer[BFloat16::MAX_CHARS];
+    std::to_chars_result result = toChars(buffer, buffer + sizeof(buffer), bf);
+    return os << std::string_view(buffer, result.ptr - buffer);
 }
 
 std::istream& operator>>(std::istream& is, BFloat16& bf) {
-    float value;
-    is >> value;
-    bf = BFloat16(value);
+    char buffer[64];
+    size_t length = readNumberToken(is, buffer, sizeof(buffer));
+    if (length == 0) return is;
+
+    std::from_chars_result result = fromChars(buffer, buffer + length, bf);
+    if (result.ec != std::errc() || result.ptr != buffer + length) {
+        is.setstate(std::ios_base::failbit);
+    }
     return is;
-}
\ No newline at end of file
+}
@@ -0,0 +1,907 @@
+#include "BF16Linalg.h"
+#include "BF16Simd.h"
+#include "FP32.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define BF16_X86 1
+#include <immintrin.h>
+#endif
+
+// emulated reference, every operation goes through FP32
+
+static FP32 exactProduct(BFloat16 a, BFloat16 b) {
+    // 8 x 8 significant bits, never rounds
+    return FP32(a.toFloat()) * FP32(b.toFloat());
+}
+
+static float combineEmulated(float alpha, FP32 acc, float beta, float y) {
+    FP32 result = FP32(alpha) * acc;
+    if (beta != 0.0f) {
+        result += FP32(beta) * FP32(y);
+    }
+    return result.toFloat();
+}
+
+static float dotEmulated(const BFloat16* x, const BFloat16* y, size_t n) {
+    FP32 acc;
+    for (size_t i = 0; i < n; ++i) {
+        acc += exactProduct(x[i], y[i]);
+    }
+    return acc.toFloat();
+}
+
+static void gemvEmulated(size_t m, size_t n, float alpha, const BFloat16* A, size_t lda,
+                         const BFloat16* x, float beta, float* y) {
+    for (size_t i = 0; i < m; ++i) {
+        FP32 acc;
+        for (size_t j = 0; j < n; ++j) {
+            acc += exactProduct(A[i * lda + j], x[j]);
+        }
+        y[i] = combineEmulated(alpha, acc, beta, y[i]);
+    }
+}
+
+static void gemmEmulated(size_t m, size_t n, size_t k, float alpha,
+                         const BFloat16* A, size_t lda, const BFloat16* B, size_t ldb,
+                         float beta, float* C, size_t ldc) {
+    for (size_t i = 0; i < m; ++i) {
+        for (size_t j = 0; j < n; ++j) {
+            FP32 acc;
+            for (size_t p = 0; p < k; ++p) {
+                acc += exactProduct(A[i * lda + p], B[p * ldb + j]);
+            }
+            C[i * ldc + j] = combineEmulated(alpha, acc, beta, C[i * ldc + j]);
+        }
+    }
+}
+
+// native dot kernels
+
+static float dotScalar(const BFloat16* x, const BFloat16* y, size_t n) {
+    // four independent partial sums so the adds pipeline
+    float acc[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+    size_t i = 0;
+
+    for (; i + 4 <= n; i += 4) {
+        for (size_t l = 0; l < 4; ++l) {
+            acc[l] += x[i + l].toFloat() * y[i + l].toFloat();
+        }
+    }
+    for (; i < n; ++i) {
+        acc[0] += x[i].toFloat() * y[i].toFloat();
+    }
+
+    return (acc[0] + acc[1]) + (acc[2] + acc[3]);
+}
+
+#ifdef BF16_X86
+
+__attribute__((target("avx2,fma")))
+static inline __m256 loadBF16x8(const BFloat16* p) {
+    __m128i h = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    return _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_cvtepu16_epi32(h), 16));
+}
+
+__attribute__((target("avx2,fma")))
+static float dotAVX2(const BFloat16* x, const BFloat16* y, size_t n) {
+    __m256 acc0 = _mm256_setzero_ps();
+    __m256 acc1 = _mm256_setzero_ps();
+    __m256 acc2 = _mm256_setzero_ps();
+    __m256 acc3 = _mm256_setzero_ps();
+    size_t i = 0;
+
+    for (; i + 32 <= n; i += 32) {
+        acc0 = _mm256_fmadd_ps(loadBF16x8(x + i), loadBF16x8(y + i), acc0);
+        acc1 = _mm256_fmadd_ps(loadBF16x8(x + i + 8), loadBF16x8(y + i + 8), acc1);
+        acc2 = _mm256_fmadd_ps(loadBF16x8(x + i + 16), loadBF16x8(y + i + 16), acc2);
+        acc3 = _mm256_fmadd_ps(loadBF16x8(x + i + 24), loadBF16x8(y + i + 24), acc3);
+    }
+    for (; i + 8 <= n; i += 8) {
+        acc0 = _mm256_fmadd_ps(loadBF16x8(x + i), loadBF16x8(y + i), acc0);
+    }
+
+    __m256 sum = _mm256_add_ps(_mm256_add_ps(acc0, acc1), _mm256_add_ps(acc2, acc3));
+    __m128 half = _mm_add_ps(_mm256_castps256_ps128(sum), _mm256_extractf128_ps(sum, 1));
+    half = _mm_add_ps(half, _mm_movehl_ps(half, half));
+    half = _mm_add_ss(half, _mm_movehdup_ps(half));
+    float result = _mm_cvtss_f32(half);
+
+    for (; i < n; ++i) {
+        result += x[i].toFloat() * y[i].toFloat();
+    }
+    return result;
+}
+
+// gcc 12 flags the _mm512_undefined_* placeholders inside its own headers
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#pragma GCC diagnostic ignored "-Wuninitialized"
+#endif
+
+__attribute__((target("avx512f,avx512bw,avx512vl")))
+static inline __m512 loadBF16x16(const BFloat16* p) {
+    __m256i h = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+    return _mm512_castsi512_ps(_mm512_slli_epi32(_mm512_cvtepu16_epi32(h), 16));
+}
+
+__attribute__((target("avx512f,avx512bw,avx512vl")))
+static float dotAVX512(const BFloat16* x, const BFloat16* y, size_t n) {
+    __m512 acc0 = _mm512_setzero_ps();
+    __m512 acc1 = _mm512_setzero_ps();
+    __m512 acc2 = _mm512_setzero_ps();
+    __m512 acc3 = _mm512_setzero_ps();
+    size_t i = 0;
+
+    for (; i + 64 <= n; i += 64) {
+        acc0 = _mm512_fmadd_ps(loadBF16x16(x + i), loadBF16x16(y + i), acc0);
+        acc1 = _mm512_fmadd_ps(loadBF16x16(x + i + 16), loadBF16x16(y + i + 16), acc1);
+        acc2 = _mm512_fmadd_ps(loadBF16x16(x + i + 32), loadBF16x16(y + i + 32), acc2);
+        acc3 = _mm512_fmadd_ps(loadBF16x16(x + i + 48), loadBF16x16(y + i + 48), acc3);
+    }
+    for (; i + 16 <= n; i += 16) {
+        acc0 = _mm512_fmadd_ps(loadBF16x16(x + i), loadBF16x16(y + i), acc0);
+    }
+
+    // masked tail, zero lanes contribute nothing
+    if (i < n) {
+        __mmask16 k = static_cast<__mmask16>((1u << (n - i)) - 1);
+        __m512 xv = _mm512_castsi512_ps(_mm512_slli_epi32(
+            _mm512_cvtepu16_epi32(_mm256_maskz_loadu_epi16(k, x + i)), 16));
+        __m512 yv = _mm512_castsi512_ps(_mm512_slli_epi32(
+            _mm512_cvtepu16_epi32(_mm256_maskz_loadu_epi16(k, y + i)), 16));
+        acc1 = _mm512_fmadd_ps(xv, yv, acc1);
+    }
+
+    __m512 sum = _mm512_add_ps(_mm512_add_ps(acc0, acc1), _mm512_add_ps(acc2, acc3));
+    return _mm512_reduce_add_ps(sum);
+}
+
+#endif // BF16_X86
+
+typedef float (*DotKernel)(const BFloat16*, const BFloat16*, size_t);
+
+static DotKernel dotKernel(SimdLevel level) {
+    if (!simdLevelSupported(level)) level = SimdLevel::Scalar;
+
+    switch (level) {
+#ifdef BF16_X86
+    case SimdLevel::AVX2:       return dotAVX2;
+    case SimdLevel::AVX512:
+    case SimdLevel::AVX512BF16: return dotAVX512;
+#endif
+    default:                    return dotScalar;
+    }
+}
+
+// gemm micro-kernels
+//
+// each kernel computes one MR x NR tile of C += alpha * A_panel * B_panel
+// from packed panels: the A panel holds MR floats per k step, the B panel
+// NR floats per k step, so both are streamed linearly.
+
+typedef void (*MicroKernel)(size_t kc, const float* a, const float* b,
+                            float* c, size_t ldc, float alpha);
+
+static void kernel4x4Scalar(size_t kc, const float* a, const float* b,
+                            float* c, size_t ldc, float alpha) {
+    float acc[4][4] = {};
+
+    for (size_t p = 0; p < kc; ++p) {
+        for (size_t r = 0; r < 4; ++r) {
+            for (size_t j = 0; j < 4; ++j) {
+                acc[r][j] += a[r] * b[j];
+            }
+        }
+        a += 4;
+        b += 4;
+    }
+
+    for (size_t r = 0; r < 4; ++r) {
+        for (size_t j = 0; j < 4; ++j) {
+            c[r * ldc + j] += alpha * acc[r][j];
+        }
+    }
+}
+
+#ifdef BF16_X86
+
+// 6 x 16: 12 ymm accumulators + 2 b rows + 1 broadcast = 15 of 16 registers
+__attribute__((target("avx2,fma")))
+static void kernel6x16AVX2(size_t kc, const float* a, const float* b,
+                           float* c, size_t ldc, float alpha) {
+    __m256 acc[6][2];
+    for (int r = 0; r < 6; ++r) {
+        acc[r][0] = _mm256_setzero_ps();
+        acc[r][1] = _mm256_setzero_ps();
+    }
+
+    for (size_t p = 0; p < kc; ++p) {
+        __m256 b0 = _mm256_loadu_ps(b);
+        __m256 b1 = _mm256_loadu_ps(b + 8);
+#pragma GCC unroll 6
+        for (int r = 0; r < 6; ++r) {
+            __m256 ar = _mm256_broadcast_ss(a + r);
+            acc[r][0] = _mm256_fmadd_ps(ar, b0, acc[r][0]);
+            acc[r][1] = _mm256_fmadd_ps(ar, b1, acc[r][1]);
+        }
+        a += 6;
+        b += 16;
+    }
+
+    __m256 va = _mm256_set1_ps(alpha);
+    for (int r = 0; r < 6; ++r) {
+        float* row = c + r * ldc;
+        _mm256_storeu_ps(row, _mm256_fmadd_ps(va, acc[r][0], _mm256_loadu_ps(row)));
+        _mm256_storeu_ps(row + 8, _mm256_fmadd_ps(va, acc[r][1], _mm256_loadu_ps(row + 8)));
+    }
+}
+
+// 12 x 32: 24 zmm accumulators + 2 b rows + 1 broadcast = 27 of 32 registers
+__attribute__((target("avx512f")))
+static void kernel12x32AVX512(size_t kc, const float* a, const float* b,
+                              float* c, size_t ldc, float alpha) {
+    __m512 acc[12][2];
+    for (int r = 0; r < 12; ++r) {
+        acc[r][0] = _mm512_setzero_ps();
+        acc[r][1] = _mm512_setzero_ps();
+    }
+
+    for (size_t p = 0; p < kc; ++p) {
+        __m512 b0 = _mm512_loadu_ps(b);
+        __m512 b1 = _mm512_loadu_ps(b + 16);
+#pragma GCC unroll 12
+        for (int r = 0; r < 12; ++r) {
+            __m512 ar = _mm512_set1_ps(a[r]);
+            acc[r][0] = _mm512_fmadd_ps(ar, b0, acc[r][0]);
+            acc[r][1] = _mm512_fmadd_ps(ar, b1, acc[r][1]);
+        }
+        a += 12;
+        b += 32;
+    }
+
+    __m512 va = _mm512_set1_ps(alpha);
+    for (int r = 0; r < 12; ++r) {
+        float* row = c + r * ldc;
+        _mm512_storeu_ps(row, _mm512_fmadd_ps(va, acc[r][0], _mm512_loadu_ps(row)));
+        _mm512_storeu_ps(row + 16, _mm512_fmadd_ps(va, acc[r][1], _mm512_loadu_ps(row + 16)));
+    }
+}
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+#endif // BF16_X86
+
+struct KernelShape {
+    size_t mr;
+    size_t nr;
+    MicroKernel kernel;
+};
+
+static KernelShape kernelShape(SimdLevel level) {
+    if (!simdLevelSupported(level)) level = SimdLevel::Scalar;
+
+    switch (level) {
+#ifdef BF16_X86
+    case SimdLevel::AVX2:       return {6, 16, kernel6x16AVX2};
+    case SimdLevel::AVX512:
+    case SimdLevel::AVX512BF16: return {12, 32, kernel12x32AVX512};
+#endif
+    default:                    return {4, 4, kernel4x4Scalar};
+    }
+}
+
+// blocking: a KC x NC panel of B (4 MiB as float) stays in L3, an MC x KC
+// block of A (120 KiB) in L2, and one micro-panel of each in L1.
+// MC and NC are multiples of every kernel's MR and NR.
+static const size_t KC = 256;
+static const size_t MC = 120;
+static const size_t NC = 4096;
+static const size_t MAX_TILE = 12 * 32;
+
+// the packing widens BFloat16 operands to float and copies float ones, so
+// the float gemm runs the same blocking and kernels
+static inline float widen(BFloat16 x) { return x.toFloat(); }
+static inline float widen(float x) { return x; }
+static inline void widenRow(const BFloat16* src, float* dst, size_t n) { convertToFloat(src, dst, n); }
+static inline void widenRow(const float* src, float* dst, size_t n) { std::memcpy(dst, src, n * sizeof(float)); }
+
+// pack an mc x kc block of A into MR-row micro-panels, widening to float
+// and zero-padding the last panel
+template <typename T>
+static void packA(size_t mc, size_t kc, const T* A, size_t lda, size_t mr, float* out) {
+    for (size_t ir = 0; ir < mc; ir += mr) {
+        size_t rows = std::min(mr, mc - ir);
+        for (size_t p = 0; p < kc; ++p) {
+            for (size_t r = 0; r < rows; ++r) {
+                out[r] = widen(A[(ir + r) * lda + p]);
+            }
+            for (size_t r = rows; r < mr; ++r) {
+                out[r] = 0.0f;
+            }
+            out += mr;
+        }
+    }
+}
+
+// pack a kc x nc block of B into NR-column micro-panels
+template <typename T>
+static void packB(size_t kc, size_t nc, const T* B, size_t ldb, size_t nr, float* out) {
+    for (size_t jr = 0; jr < nc; jr += nr) {
+        size_t cols = std::min(nr, nc - jr);
+        for (size_t p = 0; p < kc; ++p) {
+            widenRow(B + p * ldb + jr, out, cols);
+            for (size_t j = cols; j < nr; ++j) {
+                out[j] = 0.0f;
+            }
+            out += nr;
+        }
+    }
+}
+
+static void scaleOutput(size_t m, size_t n, float beta, float* C, size_t ldc) {
+    if (beta == 1.0f) return;
+
+    for (size_t i = 0; i < m; ++i) {
+        float* row = C + i * ldc;
+        if (beta == 0.0f) {
+            std::fill(row, row + n, 0.0f);
+        } else {
+            for (size_t j = 0; j < n; ++j) {
+                row[j] *= beta;
+            }
+        }
+    }
+}
+
+// one mc x kc block of A against the packed B panel
+template <typename T>
+static void gemmBlock(const KernelShape& shape, size_t mc, size_t nc, size_t kc, float alpha,
+                      const T* A, size_t lda, const float* packed_b, float* C, size_t ldc) {
+    // each thread keeps its own A buffer across calls
+    static thread_local std::vector<float> packed_a;
+    packed_a.resize(MC * KC);
+    packA(mc, kc, A, lda, shape.mr, packed_a.data());
+
+    for (size_t jr = 0; jr < nc; jr += shape.nr) {
+        size_t cols = std::min(shape.nr, nc - jr);
+        const float* b_panel = packed_b + jr * kc;
+
+        for (size_t ir = 0; ir < mc; ir += shape.mr) {
+            size_t rows = std::min(shape.mr, mc - ir);
+            const float* a_panel = packed_a.data() + ir * kc;
+            float* c_tile = C + ir * ldc + jr;
+
+            if (rows == shape.mr && cols == shape.nr) {
+                shape.kernel(kc, a_panel, b_panel, c_tile, ldc, alpha);
+                continue;
+            }
+
+            // edge tile: run the full kernel into scratch, copy what fits
+            float scratch[MAX_TILE] = {};
+            shape.kernel(kc, a_panel, b_panel, scratch, shape.nr, alpha);
+            for (size_t r = 0; r < rows; ++r) {
+                for (size_t j = 0; j < cols; ++j) {
+                    c_tile[r * ldc + j] += scratch[r * shape.nr + j];
+                }
+            }
+        }
+    }
+}
+
+template <typename T>
+static void gemmNative(SimdLevel level, size_t m, size_t n, size_t k, float alpha,
+                       const T* A, size_t lda, const T* B, size_t ldb,
+                       float beta, float* C, size_t ldc) {
+    scaleOutput(m, n, beta, C, ldc);
+    if (m == 0 || n == 0 || k == 0 || alpha == 0.0f) return;
+
+    const KernelShape shape = kernelShape(level);
+    // sized to the problem, a small gemm does not clear a whole 4 MiB panel
+    size_t panel_cols = (std::min(NC, n) + shape.nr - 1) / shape.nr * shape.nr;
+    std::vector<float> packed_b(std::min(KC, k) * panel_cols);
+    size_t blocks = (m + MC - 1) / MC;
+    bool parallel = blocks > 1 && m * n >= parallelThreshold();
+
+    for (size_t jc = 0; jc < n; jc += NC) {
+        size_t nc = std::min(NC, n - jc);
+
+        for (size_t pc = 0; pc < k; pc += KC) {
+            size_t kc = std::min(KC, k - pc);
+            packB(kc, nc, B + pc * ldb + jc, ldb, shape.nr, packed_b.data());
+
+            // row blocks write disjoint parts of C, so they split freely
+            auto rowBlocks = [&](size_t first, size_t last) {
+                for (size_t b = first; b < last; ++b) {
+                    size_t ic = b * MC;
+                    gemmBlock(shape, std::min(MC, m - ic), nc, kc, alpha,
+                              A + ic * lda + pc, lda, packed_b.data(), C + ic * ldc + jc, ldc);
+                }
+            };
+            if (parallel) {
+                ThreadPool::instance().parallelFor(blocks, 1, rowBlocks);
+            } else {
+                rowBlocks(0, blocks);
+            }
+        }
+    }
+}
+
+// dot in fixed-size chunks through parallelReduce, so a long dot splits
+// across threads and still rounds the same way for any thread count
+static const size_t DOT_GRAIN = chunkElements(2 * sizeof(BFloat16));
+
+static float dotChunks(DotKernel kernel, const BFloat16* x, const BFloat16* y, size_t n) {
+    return parallelReduce(n, DOT_GRAIN, 0.0f,
+                          [=](size_t begin, size_t end) { return kernel(x + begin, y + begin, end - begin); },
+                          [](float a, float b) { return a + b; });
+}
+
+static void gemvRows(DotKernel kernel, size_t m, size_t n, float alpha,
+                     const BFloat16* A, size_t lda, const BFloat16* x, float beta, float* y) {
+    // row-major A: every output is a contiguous dot product
+    auto rows = [=](size_t first, size_t last) {
+        for (size_t i = first; i < last; ++i) {
+            float d = alpha * kernel(A + i * lda, x, n);
+            y[i] = beta == 0.0f ? d : d + beta * y[i];
+        }
+    };
+
+    if (m * n < parallelThreshold()) {
+        rows(0, m);
+    } else {
+        size_t grain = std::max<size_t>(1, DOT_GRAIN / std::max<size_t>(n, 1));
+        ThreadPool::instance().parallelFor(m, grain, rows);
+    }
+}
+
+// HardwareDot: vdpbf16ps where the cpu has it, bit-exact emulations where
+// it does not. all of them fill the same 64 dot lanes or the same
+// HW_MR x HW_NR gemm tile, and share the code around them
+
+static const size_t HW_LANES = 64;
+static const size_t HW_BLOCK = 2 * HW_LANES;
+static const size_t HW_MR = 8;
+static const size_t HW_NR = 32;
+
+// the instruction's fused step: subnormal inputs read as zero, a
+// subnormal result flushed. the soft-float kernels run inside a flush
+// scope so FP32::fma does exactly that
+static FP32 pairStep(BFloat16 a, BFloat16 b, FP32 acc) {
+    return FP32::fma(FP32(a.toFloat()), FP32(b.toFloat()), acc);
+}
+
+// the fixed fold of the 64 lanes, in ordinary float adds
+static float foldLanes(const float* lanes) {
+    float s[16];
+    for (size_t j = 0; j < 16; ++j) {
+        s[j] = (lanes[j] + lanes[j + 16]) + (lanes[j + 32] + lanes[j + 48]);
+    }
+    for (size_t w = 8; w > 0; w /= 2) {
+        for (size_t j = 0; j < w; ++j) s[j] += s[j + w];
+    }
+    return s[0];
+}
+
+// the kernels run every full block of 128 in place, then the ragged last
+// one from zero-padded copies. false if there is no ragged block
+static bool padLastBlock(const BFloat16* x, const BFloat16* y, size_t n, BFloat16* tx, BFloat16* ty) {
+    size_t full = n - n % HW_BLOCK;
+    if (full == n) return false;
+    std::fill(tx, tx + HW_BLOCK, BFloat16());
+    std::fill(ty, ty + HW_BLOCK, BFloat16());
+    std::copy(x + full, x + n, tx);
+    std::copy(y + full, y + n, ty);
+    return true;
+}
+
+static void hardwareBlockScalar(const BFloat16* x, const BFloat16* y, FP32* acc) {
+    for (size_t l = 0; l < HW_LANES; ++l) {
+        acc[l] = pairStep(x[2 * l + 1], y[2 * l + 1], acc[l]);
+        acc[l] = pairStep(x[2 * l], y[2 * l], acc[l]);
+    }
+}
+
+static float hardwareDotScalar(const BFloat16* x, const BFloat16* y, size_t n) {
+    FP32 acc[HW_LANES];
+    {
+        SubnormalScope flush(SubnormalMode::Flush);
+        size_t full = n - n % HW_BLOCK;
+        for (size_t i = 0; i < full; i += HW_BLOCK) hardwareBlockScalar(x + i, y + i, acc);
+        BFloat16 tx[HW_BLOCK], ty[HW_BLOCK];
+        if (padLastBlock(x, y, n, tx, ty)) hardwareBlockScalar(tx, ty, acc);
+    }
+    float lanes[HW_LANES];
+    for (size_t l = 0; l < HW_LANES; ++l) lanes[l] = acc[l].toFloat();
+    return foldLanes(lanes);
+}
+
+// the gemm tile: a holds HW_MR (even, odd) element pairs per k pair, b
+// HW_NR. the lanes live in acc (row stride ld) between calls: a call
+// continues them, or starts them from zero when first is set, so k can be
+// blocked without changing a lane's chain of steps
+typedef void (*HardwareTileKernel)(size_t pairs, const BFloat16* a, const BFloat16* b,
+                                   float* acc, size_t ld, bool first);
+
+static void hardwareTileScalar(size_t pairs, const BFloat16* a, const BFloat16* b,
+                               float* acc, size_t ld, bool first) {
+    SubnormalScope flush(SubnormalMode::Flush);
+    for (size_t r = 0; r < HW_MR; ++r) {
+        for (size_t j = 0; j < HW_NR; ++j) {
+            FP32 lane = first ? FP32() : FP32(acc[r * ld + j]);
+            for (size_t p = 0; p < pairs; ++p) {
+                const BFloat16* ap = a + 2 * (p * HW_MR + r);
+                const BFloat16* bp = b + 2 * (p * HW_NR + j);
+                lane = pairStep(ap[1], bp[1], lane);
+                lane = pairStep(ap[0], bp[0], lane);
+            }
+            acc[r * ld + j] = lane.toFloat();
+        }
+    }
+}
+
+#ifdef BF16_X86
+
+// the same steps on hardware fma with MXCSR FZ + DAZ, which flush exactly
+// as the instruction does. the fold runs after the mode is put back
+static const unsigned int MXCSR_FLUSH = 0x8040;
+
+__attribute__((target("avx2,fma")))
+static inline void pairSplitAVX2(const BFloat16* p, __m256& odd, __m256& even) {
+    __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+    odd = _mm256_castsi256_ps(_mm256_and_si256(v, _mm256_set1_epi32(static_cast<int>(0xFFFF0000u))));
+    even = _mm256_castsi256_ps(_mm256_slli_epi32(v, 16));
+}
+
+// foldLanes in registers: a scalar reload of the stored lanes stalls on
+// store forwarding. lanes 8r .. 8r + 7 are acc[r]
+__attribute__((target("avx2,fma")))
+static inline float foldLanesAVX2(const __m256* acc) {
+    __m256 lo = _mm256_add_ps(_mm256_add_ps(acc[0], acc[2]), _mm256_add_ps(acc[4], acc[6]));
+    __m256 hi = _mm256_add_ps(_mm256_add_ps(acc[1], acc[3]), _mm256_add_ps(acc[5], acc[7]));
+    __m256 s8 = _mm256_add_ps(lo, hi);
+    __m128 s4 = _mm_add_ps(_mm256_castps256_ps128(s8), _mm256_extractf128_ps(s8, 1));
+    __m128 s2 = _mm_add_ps(s4, _mm_movehl_ps(s4, s4));
+    __m128 s1 = _mm_add_ss(s2, _mm_movehdup_ps(s2));
+    return _mm_cvtss_f32(s1);
+}
+
+__attribute__((target("avx2,fma")))
+static inline void hardwareBlockAVX2(const BFloat16* x, const BFloat16* y, __m256* acc) {
+#pragma GCC unroll 8
+    for (int r = 0; r < 8; ++r) {
+        __m256 xo, xe, yo, ye;
+        pairSplitAVX2(x + 16 * r, xo, xe);
+        pairSplitAVX2(y + 16 * r, yo, ye);
+        acc[r] = _mm256_fmadd_ps(xo, yo, acc[r]);
+        acc[r] = _mm256_fmadd_ps(xe, ye, acc[r]);
+    }
+}
+
+__attribute__((target("avx2,fma")))
+static float hardwareDotAVX2(const BFloat16* x, const BFloat16* y, size_t n) {
+    __m256 acc[8];
+    for (int r = 0; r < 8; ++r) acc[r] = _mm256_setzero_ps();
+
+    unsigned int csr = _mm_getcsr();
+    _mm_setcsr(csr | MXCSR_FLUSH);
+    size_t full = n - n % HW_BLOCK;
+    for (size_t i = 0; i < full; i += HW_BLOCK) hardwareBlockAVX2(x + i, y + i, acc);
+    BFloat16 tx[HW_BLOCK], ty[HW_BLOCK];
+    if (padLastBlock(x, y, n, tx, ty)) hardwareBlockAVX2(tx, ty, acc);
+    _mm_setcsr(csr);
+    return foldLanesAVX2(acc);
+}
+
+// 2 rows x 32 columns at a time: 8 accumulators, 4 broadcasts, one b pair
+__attribute__((target("avx2,fma")))
+static void hardwareTileAVX2(size_t pairs, const BFloat16* a, const BFloat16* b,
+                             float* tile, size_t ld, bool first) {
+    unsigned int csr = _mm_getcsr();
+    _mm_setcsr(csr | MXCSR_FLUSH);
+    for (size_t r = 0; r < HW_MR; r += 2) {
+        __m256 acc[2][4];
+        for (int i = 0; i < 2; ++i) {
+            for (int c = 0; c < 4; ++c) {
+                acc[i][c] = first ? _mm256_setzero_ps() : _mm256_loadu_ps(tile + (r + i) * ld + 8 * c);
+            }
+        }
+        for (size_t p = 0; p < pairs; ++p) {
+            const BFloat16* ap = a + 2 * (p * HW_MR + r);
+            __m256 ao[2], ae[2];
+            for (int i = 0; i < 2; ++i) {
+                ao[i] = _mm256_set1_ps(ap[2 * i + 1].toFloat());
+                ae[i] = _mm256_set1_ps(ap[2 * i].toFloat());
+            }
+#pragma GCC unroll 4
+            for (int c = 0; c < 4; ++c) {
+                __m256 bo, be;
+                pairSplitAVX2(b + 2 * (p * HW_NR + 8 * c), bo, be);
+                for (int i = 0; i < 2; ++i) {
+                    acc[i][c] = _mm256_fmadd_ps(ao[i], bo, acc[i][c]);
+                    acc[i][c] = _mm256_fmadd_ps(ae[i], be, acc[i][c]);
+                }
+            }
+        }
+        for (int i = 0; i < 2; ++i) {
+            for (int c = 0; c < 4; ++c) _mm256_storeu_ps(tile + (r + i) * ld + 8 * c, acc[i][c]);
+        }
+    }
+    _mm_setcsr(csr);
+}
+
+// the instruction itself
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#pragma GCC diagnostic ignored "-Wuninitialized"
+#endif
+
+__attribute__((target("avx512f,avx512bw,avx512vl,avx512bf16")))
+static inline __m512bh loadPairsAVX512BF16(const BFloat16* p) {
+    return (__m512bh)_mm512_loadu_si512(p);
+}
+
+__attribute__((target("avx512f,avx512bw,avx512vl,avx512bf16")))
+static inline void hardwareBlockAVX512BF16(const BFloat16* x, const BFloat16* y, __m512* acc) {
+#pragma GCC unroll 4
+    for (int r = 0; r < 4; ++r) {
+        acc[r] = _mm512_dpbf16_ps(acc[r], loadPairsAVX512BF16(x + 32 * r), loadPairsAVX512BF16(y + 32 * r));
+    }
+}
+
+__attribute__((target("avx512f,avx512bw,avx512vl,avx512bf16")))
+static float hardwareDotAVX512BF16(const BFloat16* x, const BFloat16* y, size_t n) {
+    __m512 acc[4];
+    for (int r = 0; r < 4; ++r) acc[r] = _mm512_setzero_ps();
+
+    size_t full = n - n % HW_BLOCK;
+    for (size_t i = 0; i < full; i += HW_BLOCK) hardwareBlockAVX512BF16(x + i, y + i, acc);
+
+    // the ragged block through masked loads, which zero fill as the padding
+    // does without the store-forwarding stall of a copy
+    if (full < n) {
+        size_t rest = n - full;
+#pragma GCC unroll 4
+        for (size_t r = 0; r < 4; ++r) {
+            size_t count = rest > 32 * r ? std::min<size_t>(32, rest - 32 * r) : 0;
+            __mmask32 k = count == 32 ? ~__mmask32(0) : static_cast<__mmask32>((1u << count) - 1);
+            __m512bh xv = (__m512bh)_mm512_maskz_loadu_epi16(k, x + full + 32 * r);
+            __m512bh yv = (__m512bh)_mm512_maskz_loadu_epi16(k, y + full + 32 * r);
+            acc[r] = _mm512_dpbf16_ps(acc[r], xv, yv);
+        }
+    }
+
+    // foldLanes in registers, lanes 16r .. 16r + 15 are acc[r]
+    __m512 s16 = _mm512_add_ps(_mm512_add_ps(acc[0], acc[1]), _mm512_add_ps(acc[2], acc[3]));
+    __m256 s8 = _mm256_add_ps(_mm512_castps512_ps256(s16),
+                              _mm256_castpd_ps(_mm512_extractf64x4_pd(_mm512_castps_pd(s16), 1)));
+    __m128 s4 = _mm_add_ps(_mm256_castps256_ps128(s8), _mm256_extractf128_ps(s8, 1));
+    __m128 s2 = _mm_add_ps(s4, _mm_movehl_ps(s4, s4));
+    __m128 s1 = _mm_add_ss(s2, _mm_movehdup_ps(s2));
+    return _mm_cvtss_f32(s1);
+}
+
+// 8 x 32: 16 zmm accumulators, 2 b pair rows, 1 broadcast pair
+__attribute__((target("avx512f,avx512bw,avx512vl,avx512bf16")))
+static void hardwareTileAVX512BF16(size_t pairs, const BFloat16* a, const BFloat16* b,
+                                   float* tile, size_t ld, bool first) {
+    __m512 acc[HW_MR][2];
+    for (size_t r = 0; r < HW_MR; ++r) {
+        acc[r][0] = first ? _mm512_setzero_ps() : _mm512_loadu_ps(tile + r * ld);
+        acc[r][1] = first ? _mm512_setzero_ps() : _mm512_loadu_ps(tile + r * ld + 16);
+    }
+
+    for (size_t p = 0; p < pairs; ++p) {
+        __m512bh b0 = loadPairsAVX512BF16(b);
+        __m512bh b1 = loadPairsAVX512BF16(b + 32);
+#pragma GCC unroll 8
+        for (size_t r = 0; r < HW_MR; ++r) {
+            int pair;
+            std::memcpy(&pair, a + 2 * r, sizeof(pair));
+            __m512bh ar = (__m512bh)_mm512_set1_epi32(pair);
+            acc[r][0] = _mm512_dpbf16_ps(acc[r][0], ar, b0);
+            acc[r][1] = _mm512_dpbf16_ps(acc[r][1], ar, b1);
+        }
+        a += 2 * HW_MR;
+        b += 2 * HW_NR;
+    }
+
+    for (size_t r = 0; r < HW_MR; ++r) {
+        _mm512_storeu_ps(tile + r * ld, acc[r][0]);
+        _mm512_storeu_ps(tile + r * ld + 16, acc[r][1]);
+    }
+}
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+#endif // BF16_X86
+
+static DotKernel hardwareDotKernel(SimdLevel level) {
+    if (!simdLevelSupported(level)) level = SimdLevel::Scalar;
+
+    switch (level) {
+#ifdef BF16_X86
+    case SimdLevel::AVX2:
+    case SimdLevel::AVX512:     return hardwareDotAVX2;
+    case SimdLevel::AVX512BF16: return hardwareDotAVX512BF16;
+#endif
+    default:                    return hardwareDotScalar;
+    }
+}
+
+static HardwareTileKernel hardwareTileKernel(SimdLevel level) {
+    if (!simdLevelSupported(level)) level = SimdLevel::Scalar;
+
+    switch (level) {
+#ifdef BF16_X86
+    case SimdLevel::AVX2:
+    case SimdLevel::AVX512:     return hardwareTileAVX2;
+    case SimdLevel::AVX512BF16: return hardwareTileAVX512BF16;
+#endif
+    default:                    return hardwareTileScalar;
+    }
+}
+
+// rows [r0, r0 + rows) or columns of a k-major source as (even, odd)
+// element pairs, `count` wide, zero past the edge and past k
+static void packPairs(size_t k, size_t count, size_t width, const BFloat16* src,
+                      size_t k_stride, size_t stride, BFloat16* out) {
+    size_t pairs = (k + 1) / 2;
+    for (size_t p = 0; p < pairs; ++p) {
+        for (size_t e = 0; e < width; ++e) {
+            BFloat16* dst = out + 2 * (p * width + e);
+            const BFloat16* s = src + e * stride + 2 * p * k_stride;
+            dst[0] = e < count ? s[0] : BFloat16();
+            dst[1] = e < count && 2 * p + 1 < k ? s[k_stride] : BFloat16();
+        }
+    }
+}
+
+// blocking: HW_KP pairs of a B panel (16 KiB) stay in L1 across the
+// HW_MC / HW_MR row blocks of a group, and a group's lanes (HW_MC rows by
+// HW_NC columns of fp32, 128 KiB) carry from one k block to the next
+static const size_t HW_KP = 128;
+static const size_t HW_MC = 64;
+static const size_t HW_NC = 512;
+
+static void gemmHardware(SimdLevel level, size_t m, size_t n, size_t k, float alpha,
+                         const BFloat16* A, size_t lda, const BFloat16* B, size_t ldb,
+                         float beta, float* C, size_t ldc) {
+    if (m == 0 || n == 0) return;
+    if (k == 0 || alpha == 0.0f) {
+        scaleOutput(m, n, beta, C, ldc);
+        return;
+    }
+
+    const HardwareTileKernel kernel = hardwareTileKernel(level);
+    const size_t pairs = (k + 1) / 2;
+    const size_t panels = (n + HW_NR - 1) / HW_NR;
+    const size_t width = panels * HW_NR;
+    const size_t groups = (m + HW_MC - 1) / HW_MC;
+
+    // all of B as HW_NR-column panels, every k block of a panel contiguous
+    std::vector<BFloat16> packed_b(panels * pairs * 2 * HW_NR);
+    for (size_t jp = 0; jp < panels; ++jp) {
+        size_t jr = jp * HW_NR;
+        packPairs(k, std::min(HW_NR, n - jr), HW_NR, B + jr, ldb, 1,
+                  packed_b.data() + jp * pairs * 2 * HW_NR);
+    }
+
+    // every output is its own lane, so the row groups split freely. the
+    // buffers are per call, nothing stays allocated on the pool threads
+    auto rowGroups = [&](size_t first, size_t last) {
+        std::vector<BFloat16> packed_a(HW_MC / HW_MR * pairs * 2 * HW_MR);
+        std::vector<float> lanes(HW_MC * std::min(HW_NC, width));
+
+        for (size_t g = first; g < last; ++g) {
+            size_t ic = g * HW_MC;
+            size_t mc = std::min(HW_MC, m - ic);
+            size_t blocks = (mc + HW_MR - 1) / HW_MR;
+            for (size_t bi = 0; bi < blocks; ++bi) {
+                size_t ir = bi * HW_MR;
+                packPairs(k, std::min(HW_MR, mc - ir), HW_MR, A + (ic + ir) * lda, 1, lda,
+                          packed_a.data() + bi * pairs * 2 * HW_MR);
+            }
+
+            // each column block runs all of k before its lanes are written
+            // out, so every lane still sums its pairs in order
+            for (size_t jc = 0; jc < width; jc += HW_NC) {
+                size_t nc = std::min(HW_NC, width - jc);
+                for (size_t pc = 0; pc < pairs; pc += HW_KP) {
+                    size_t kp = std::min(HW_KP, pairs - pc);
+                    for (size_t jp = jc / HW_NR; jp < (jc + nc) / HW_NR; ++jp) {
+                        const BFloat16* b = packed_b.data() + (jp * pairs + pc) * 2 * HW_NR;
+                        float* lane = lanes.data() + (jp * HW_NR - jc);
+                        for (size_t bi = 0; bi < blocks; ++bi) {
+                            const BFloat16* a = packed_a.data() + (bi * pairs + pc) * 2 * HW_MR;
+                            kernel(kp, a, b, lane + bi * HW_MR * nc, nc, pc == 0);
+                        }
+                    }
+                }
+
+                size_t cols = std::min(nc, n - jc);
+                for (size_t r = 0; r < mc; ++r) {
+                    float* c = C + (ic + r) * ldc + jc;
+                    const float* lane = lanes.data() + r * nc;
+                    for (size_t j = 0; j < cols; ++j) {
+                        float d = alpha * lane[j];
+                        c[j] = beta == 0.0f ? d : d + beta * c[j];
+                    }
+                }
+            }
+        }
+    };
+    if (groups > 1 && m * n >= parallelThreshold()) {
+        ThreadPool::instance().parallelFor(groups, 1, rowGroups);
+    } else {
+        rowGroups(0, groups);
+    }
+}
+
+// public entry points
+
+float dot(const BFloat16* x, const BFloat16* y, size_t n, SimdLevel level) {
+    return dotChunks(dotKernel(level), x, y, n);
+}
+
+void gemm(size_t m, size_t n, size_t k, float alpha,
+          const BFloat16* A, size_t lda, const BFloat16* B, size_t ldb,
+          float beta, float* C, size_t ldc, SimdLevel level) {
+    gemmNative(level, m, n, k, alpha, A, lda, B, ldb, beta, C, ldc);
+}
+
+float dot(const BFloat16* x, const BFloat16* y, size_t n, LinalgMode mode, SimdLevel level) {
+    switch (mode) {
+    case LinalgMode::Emulated:    return dotEmulated(x, y, n);
+    case LinalgMode::HardwareDot: return dotChunks(hardwareDotKernel(level), x, y, n);
+    default:                      return dotChunks(dotKernel(level), x, y, n);
+    }
+}
+
+void gemv(size_t m, size_t n, float alpha, const BFloat16* A, size_t lda, const BFloat16* x,
+          float beta, float* y, LinalgMode mode, SimdLevel level) {
+    switch (mode) {
+    case LinalgMode::Emulated:    gemvEmulated(m, n, alpha, A, lda, x, beta, y); break;
+    case LinalgMode::HardwareDot: gemvRows(hardwareDotKernel(level), m, n, alpha, A, lda, x, beta, y); break;
+    default:                      gemvRows(dotKernel(level), m, n, alpha, A, lda, x, beta, y); break;
+    }
+}
+
+void gemm(size_t m, size_t n, size_t k, float alpha,
+          const BFloat16* A, size_t lda, const BFloat16* B, size_t ldb,
+          float beta, float* C, size_t ldc, LinalgMode mode, SimdLevel level) {
+    switch (mode) {
+    case LinalgMode::Emulated:    gemmEmulated(m, n, k, alpha, A, lda, B, ldb, beta, C, ldc); break;
+    case LinalgMode::HardwareDot: gemmHardware(level, m, n, k, alpha, A, lda, B, ldb, beta, C, ldc); break;
+    default:                      gemmNative(level, m, n, k, alpha, A, lda, B, ldb, beta, C, ldc); break;
+    }
+}
+
+float dot(const BFloat16* x, const BFloat16* y, size_t n, LinalgMode mode) {
+    return dot(x, y, n, mode, detectSimdLevel());
+}
+
+void gemm(size_t m, size_t n, size_t k, float alpha, const float* A, size_t lda, const float* B, size_t ldb,
+          float beta, float* C, size_t ldc) {
+    gemmNative(detectSimdLevel(), m, n, k, alpha, A, lda, B, ldb, beta, C, ldc);
+}
+
+void gemv(size_t m, size_t n, float alpha, const BFloat16* A, size_t lda,
+          const BFloat16* x, float beta, float* y, LinalgMode mode) {
+    gemv(m, n, alpha, A, lda, x, beta, y, mode, detectSimdLevel());
+}
+
+void gemm(size_t m, size_t n, size_t k, float alpha,
+          const BFloat16* A, size_t lda, const BFloat16* B, size_t ldb,
+          float beta, float* C, size_t ldc, LinalgMode mode) {
+    gemm(m, n, k, alpha, A, lda, B, ldb, beta, C, ldc, mode, detectSimdLevel());
+}
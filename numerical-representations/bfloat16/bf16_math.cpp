@@ -0,0 +1,711 @@
+#include "BF16.h"
+#include "BF16Math.h"
+#include "BF16Simd.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define BF16_X86 1
+#include <immintrin.h>
+#endif
+
+// batched sqrt / rsqrt
+//
+// for a positive normal x = m * 2^(2k) with m in [1, 4), sqrt(x) is
+// sqrt(m) * 2^k and rsqrt(x) is rsqrt(m) * 2^-k, and both results are
+// normal. so the 256 values of m (exponent field 127 or 128 and the 7
+// mantissa bits) are looked up in tables filled from the scalar integer
+// functions, and k is added to the exponent field. zeros, subnormals,
+// negatives, infinities and nans go through the scalar functions, so
+// every path gives the scalar bits
+
+struct RootTables {
+    uint32_t sqrt[256];
+    uint32_t rsqrt[256];
+
+    RootTables() {
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint16_t m = static_cast<uint16_t>(0x3F80 + i);   // 1.0 .. 3.98
+            sqrt[i] = BFloat16::Format::sqrt(m);
+            rsqrt[i] = BFloat16::Format::rsqrt(m);
+        }
+    }
+};
+
+static const RootTables& rootTables() {
+    static const RootTables tables;
+    return tables;
+}
+
+template <bool RSQRT>
+static void rootScalar(const BFloat16* src, BFloat16* dst, size_t n) {
+    for (size_t i = 0; i < n; ++i) {
+        dst[i] = RSQRT ? src[i].rsqrt() : src[i].sqrt();
+    }
+}
+
+#ifdef BF16_X86
+
+// avx2: 8 lanes of 32 bits, one gather per register
+
+template <bool RSQRT>
+__attribute__((target("avx2,fma")))
+static void rootAVX2(const BFloat16* src, BFloat16* dst, size_t n) {
+    const uint32_t* table = RSQRT ? rootTables().rsqrt : rootTables().sqrt;
+    const __m256i low_byte = _mm256_set1_epi32(0xFF);
+    const __m256i parity = _mm256_set1_epi32(0x80);
+    const __m256i bias = _mm256_set1_epi32(127);
+    const __m256i lowest = _mm256_set1_epi32(0x0080);
+    const __m256i highest = _mm256_set1_epi32(0x7F7F);
+    size_t i = 0;
+
+    for (; i + 8 <= n; i += 8) {
+        __m128i h = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        __m256i bits = _mm256_cvtepu16_epi32(h);
+
+        // a normal positive x is 0x0080 .. 0x7F7F
+        __m256i special = _mm256_or_si256(_mm256_cmpgt_epi32(lowest, bits), _mm256_cmpgt_epi32(bits, highest));
+        if (!_mm256_testz_si256(special, special)) {
+            rootScalar<RSQRT>(src + i, dst + i, 8);
+            continue;
+        }
+
+        __m256i index = _mm256_and_si256(_mm256_xor_si256(bits, parity), low_byte);
+        __m256i m = _mm256_i32gather_epi32(reinterpret_cast<const int*>(table), index, 4);
+        __m256i k = _mm256_slli_epi32(_mm256_srai_epi32(_mm256_sub_epi32(_mm256_srli_epi32(bits, 7), bias), 1), 7);
+        __m256i result = RSQRT ? _mm256_sub_epi32(m, k) : _mm256_add_epi32(m, k);
+
+        // results are <= 0x7F7F, packus is exact
+        __m128i packed = _mm_packus_epi32(_mm256_castsi256_si128(result), _mm256_extracti128_si256(result, 1));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), packed);
+    }
+
+    rootScalar<RSQRT>(src + i, dst + i, n - i);
+}
+
+// gcc 12 flags the _mm512_undefined_* placeholders inside its own headers
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#pragma GCC diagnostic ignored "-Wuninitialized"
+#endif
+
+// avx512: 16 lanes, the tail is masked
+
+template <bool RSQRT>
+__attribute__((target("avx512f,avx512bw,avx512vl")))
+static __m256i rootLanesAVX512(__m256i h, const uint32_t* table) {
+    __m512i bits = _mm512_cvtepu16_epi32(h);
+    __m512i field = _mm512_srli_epi32(bits, 7);
+    __m512i index = _mm512_and_si512(_mm512_xor_si512(bits, _mm512_set1_epi32(0x80)), _mm512_set1_epi32(0xFF));
+    __m512i m = _mm512_i32gather_epi32(index, table, 4);
+    __m512i k = _mm512_slli_epi32(_mm512_srai_epi32(_mm512_sub_epi32(field, _mm512_set1_epi32(127)), 1), 7);
+    return _mm512_cvtepi32_epi16(RSQRT ? _mm512_sub_epi32(m, k) : _mm512_add_epi32(m, k));
+}
+
+template <bool RSQRT>
+__attribute__((target("avx512f,avx512bw,avx512vl")))
+static void rootAVX512(const BFloat16* src, BFloat16* dst, size_t n) {
+    const uint32_t* table = RSQRT ? rootTables().rsqrt : rootTables().sqrt;
+    // a normal positive x is 0x0080 .. 0x7F7F
+    const __m256i lowest = _mm256_set1_epi16(0x0080);
+    const __m256i highest = _mm256_set1_epi16(0x7F7F);
+    size_t i = 0;
+
+    for (; i < n; i += 16) {
+        __mmask16 k = n - i >= 16 ? static_cast<__mmask16>(0xFFFF)
+                                  : static_cast<__mmask16>((1u << (n - i)) - 1);
+        __m256i h = _mm256_maskz_loadu_epi16(k, src + i);
+        __mmask16 fast = _mm256_cmpge_epu16_mask(h, lowest) & _mm256_cmple_epu16_mask(h, highest);
+        if ((fast & k) != k) {
+            rootScalar<RSQRT>(src + i, dst + i, n - i >= 16 ? 16 : n - i);
+            continue;
+        }
+        _mm256_mask_storeu_epi16(dst + i, k, rootLanesAVX512<RSQRT>(h, table));
+    }
+}
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+#endif // BF16_X86
+
+// dispatch, neon stays on the scalar kernel
+
+template <bool RSQRT>
+static void root(const BFloat16* src, BFloat16* dst, size_t n, SimdLevel level) {
+    if (!simdLevelSupported(level)) level = SimdLevel::Scalar;
+
+    switch (level) {
+#ifdef BF16_X86
+    case SimdLevel::AVX2:       rootAVX2<RSQRT>(src, dst, n); return;
+    case SimdLevel::AVX512:
+    case SimdLevel::AVX512BF16: rootAVX512<RSQRT>(src, dst, n); return;
+#endif
+    default:                    rootScalar<RSQRT>(src, dst, n); return;
+    }
+}
+
+void sqrt(const BFloat16* src, BFloat16* dst, size_t n, SimdLevel level) {
+    root<false>(src, dst, n, level);
+}
+
+void rsqrt(const BFloat16* src, BFloat16* dst, size_t n, SimdLevel level) {
+    root<true>(src, dst, n, level);
+}
+
+static const size_t ROOT_GRAIN = chunkElements(2 * sizeof(BFloat16));
+
+void BFloat16::sqrt(const BFloat16* src, BFloat16* dst, size_t n) {
+    SimdLevel level = detectSimdLevel();
+    SubnormalMode mode = subnormalMode();
+    parallelChunks(n, ROOT_GRAIN, [=](size_t begin, size_t end) {
+        SubnormalScope scope(mode);
+        root<false>(src + begin, dst + begin, end - begin, level);
+    });
+}
+
+void BFloat16::rsqrt(const BFloat16* src, BFloat16* dst, size_t n) {
+    SimdLevel level = detectSimdLevel();
+    SubnormalMode mode = subnormalMode();
+    parallelChunks(n, ROOT_GRAIN, [=](size_t begin, size_t end) {
+        SubnormalScope scope(mode);
+        root<true>(src + begin, dst + begin, end - begin, level);
+    });
+}
+
+// elementary functions
+//
+// the scalar and simd kernels below run the same float operations in the
+// same order, so they round alike. the Makefile builds this file with
+// -ffp-contract=off: gcc would fuse the simd multiply-adds but not the
+// scalar ones, which are compiled for baseline x86-64
+
+enum class Elementary { Exp, Log, Tanh, Sigmoid, Erf, Gelu };
+
+static constexpr float LOG2E = 1.44269504f;
+static constexpr float LN2 = 0.693147182f;
+static constexpr float LN2_HI = 0.693359375f;      // 9 bits, k * LN2_HI is exact
+static constexpr float LN2_LO = -2.12194440e-4f;
+static constexpr float ROUND_MAGIC = 12582912.0f;  // 1.5 * 2^23, adding it rounds to an integer
+static constexpr float SQRT2 = 1.41421354f;
+static constexpr float FRAC_1_SQRT2 = 0.707106769f;
+static constexpr float TWO_23 = 8388608.0f;
+
+// e^x is infinite above EXP_MAX and rounds to 0 below EXP_MIN, the clamp
+// keeps 2^k inside the two scale factors
+static constexpr float EXP_MIN = -104.0f;
+static constexpr float EXP_MAX = 89.0f;
+static constexpr float EXP_C2 = 0.5f;
+static constexpr float EXP_C3 = 0.166666672f;
+static constexpr float EXP_C4 = 0.0416666679f;
+
+static constexpr float LOG_C3 = 0.666666687f;
+static constexpr float LOG_C5 = 0.4f;
+
+// tanh is 1 in bf16 well before 9, and e^18 stays finite
+static constexpr float TANH_SMALL = 0.25f;
+static constexpr float TANH_MAX = 9.0f;
+static constexpr float TANH_C3 = -0.333333343f;
+static constexpr float TANH_C5 = 0.13333334f;
+
+static constexpr float ERF_SMALL = 0.5f;
+static constexpr float ERF_C1 = 1.12837923f;      // 2 / sqrt(pi)
+static constexpr float ERF_C3 = -0.376126409f;
+static constexpr float ERF_C5 = 0.112837918f;
+static constexpr float ERF_C7 = -0.0268661722f;
+
+// erfc(z) = t * exp(-z^2 + P(t)), t = 1 / (1 + z / 2), highest power first
+static constexpr float ERFC_P[] = {0.17087277f, -0.82215223f, 1.48851587f, -1.13520398f, 0.27886807f,
+                                   -0.18628806f, 0.09678418f, 0.37409196f, 1.00002368f, -1.26551223f};
+
+// gelu is -0 in bf16 below -14, the clamp keeps -inf * 0 out
+static constexpr float GELU_MIN = -20.0f;
+
+static inline float floatFromBits(uint32_t bits) {
+    float x;
+    std::memcpy(&x, &bits, sizeof(float));
+    return x;
+}
+
+static inline uint32_t floatBits(float x) {
+    uint32_t bits;
+    std::memcpy(&bits, &x, sizeof(float));
+    return bits;
+}
+
+static inline float scale2(int k) { return floatFromBits(static_cast<uint32_t>(k + 127) << 23); }
+
+static inline float expKernel(float x) {
+    x = std::min(std::max(x, EXP_MIN), EXP_MAX);
+    float kf = (x * LOG2E + ROUND_MAGIC) - ROUND_MAGIC;
+    float r = (x - kf * LN2_HI) - kf * LN2_LO;
+    float p = 1.0f + r * (1.0f + r * (EXP_C2 + r * (EXP_C3 + r * EXP_C4)));
+    // 2^k in two factors, so a subnormal result rounds once
+    int k = static_cast<int>(kf);
+    int half = k >> 1;
+    return p * scale2(half) * scale2(k - half);
+}
+
+// x positive and finite
+static inline float logKernel(float x) {
+    uint32_t bits = floatBits(x);
+    int e = -127;
+    if (bits < 0x00800000u) {
+        bits = floatBits(x * TWO_23);
+        e -= 23;
+    }
+    e += static_cast<int>(bits >> 23);
+    float m = floatFromBits((bits & 0x007FFFFFu) | 0x3F800000u);
+    if (m > SQRT2) {
+        m *= 0.5f;
+        ++e;
+    }
+    float s = (m - 1.0f) / (m + 1.0f);
+    float s2 = s * s;
+    return static_cast<float>(e) * LN2 + s * (2.0f + s2 * (LOG_C3 + s2 * LOG_C5));
+}
+
+static inline float tanhKernel(float x) {
+    float a = std::fabs(x);
+    if (a < TANH_SMALL) {
+        float x2 = x * x;
+        return x + x * (x2 * (TANH_C3 + x2 * TANH_C5));
+    }
+    float e = expKernel(2.0f * std::min(a, TANH_MAX));
+    return std::copysign((e - 1.0f) / (e + 1.0f), x);
+}
+
+static inline float sigmoidKernel(float x) {
+    float t = expKernel(-std::fabs(x));
+    return (x < 0.0f ? t : 1.0f) / (1.0f + t);
+}
+
+// z >= 0
+static inline float erfcKernel(float z) {
+    float t = 1.0f / (1.0f + 0.5f * z);
+    float p = ERFC_P[0];
+    for (size_t i = 1; i < sizeof(ERFC_P) / sizeof(ERFC_P[0]); ++i) p = p * t + ERFC_P[i];
+    return t * expKernel(p - z * z);
+}
+
+static inline float erfKernel(float x) {
+    float a = std::fabs(x);
+    if (a < ERF_SMALL) {
+        float x2 = x * x;
+        return x * (ERF_C1 + x2 * (ERF_C3 + x2 * (ERF_C5 + x2 * ERF_C7)));
+    }
+    return std::copysign(1.0f - erfcKernel(a), x);
+}
+
+static inline float geluKernel(float x) {
+    x = std::max(x, GELU_MIN);
+    float tail = 0.5f * erfcKernel(std::fabs(x * FRAC_1_SQRT2));
+    return x * (x < 0.0f ? tail : 1.0f - tail);
+}
+
+template <Elementary F>
+static inline float kernel(float x) {
+    switch (F) {
+    case Elementary::Exp:     return expKernel(x);
+    case Elementary::Log:     return logKernel(x);
+    case Elementary::Tanh:    return tanhKernel(x);
+    case Elementary::Sigmoid: return sigmoidKernel(x);
+    case Elementary::Erf:     return erfKernel(x);
+    default:                  return geluKernel(x);
+    }
+}
+
+// nan and the edges of log, everything else goes through the kernel
+template <Elementary F>
+static BFloat16 elementary(BFloat16 x) {
+    if (x.isNaN()) return BFloat16::nan();
+    if (F == Elementary::Log) {
+        if (x.isZero()) return BFloat16::infinity(true);
+        if (x.isNegative()) return BFloat16::nan();
+        if (x.isInfinity()) return x;
+    }
+    return BFloat16(kernel<F>(x.toFloat()));
+}
+
+template <Elementary F>
+static void elementaryScalar(const BFloat16* src, BFloat16* dst, size_t n) {
+    for (size_t i = 0; i < n; ++i) dst[i] = elementary<F>(src[i]);
+}
+
+// the erf and gelu batches are lookups instead. their erfc fit costs a
+// divide, an exp and ten multiply-adds, about 2.2 ns a value even with
+// avx512, where one gather from a 64K table of the scalar results takes
+// 0.3 ns. the other functions cost 0.7 - 1.4 ns as polynomials and leave
+// the cache alone, so they stay that way
+
+template <Elementary F>
+struct ElementaryTable {
+    uint16_t bits[65536 + 1];   // a spare entry, the gathers read 32 bits
+
+    ElementaryTable() : bits() {
+        for (uint32_t i = 0; i < 65536; ++i) {
+            bits[i] = elementary<F>(BFloat16::fromBits(static_cast<uint16_t>(i))).bits();
+        }
+    }
+};
+
+// built by the first caller, thread safe
+template <Elementary F>
+static const uint16_t* elementaryTable() {
+    static const ElementaryTable<F> table;
+    return table.bits;
+}
+
+static void lookupScalar(const uint16_t* table, const BFloat16* src, BFloat16* dst, size_t n) {
+    for (size_t i = 0; i < n; ++i) dst[i] = BFloat16::fromBits(table[src[i].bits()]);
+}
+
+#ifdef BF16_X86
+
+// avx2: 8 lanes, the tail goes to the scalar loop
+
+__attribute__((target("avx2,fma")))
+static void lookupAVX2(const uint16_t* table, const BFloat16* src, BFloat16* dst, size_t n) {
+    const __m256i low_half = _mm256_set1_epi32(0xFFFF);
+    size_t i = 0;
+
+    for (; i + 8 <= n; i += 8) {
+        __m256i index = _mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i)));
+        __m256i v = _mm256_i32gather_epi32(reinterpret_cast<const int*>(table), index, 2);
+        v = _mm256_and_si256(v, low_half);
+        __m128i packed = _mm_packus_epi32(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), packed);
+    }
+
+    lookupScalar(table, src + i, dst + i, n - i);
+}
+
+__attribute__((target("avx2,fma")))
+static inline __m256 scale2AVX2(__m256i k) {
+    return _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_add_epi32(k, _mm256_set1_epi32(127)), 23));
+}
+
+__attribute__((target("avx2,fma")))
+static inline __m256 absAVX2(__m256 x) {
+    return _mm256_and_ps(x, _mm256_castsi256_ps(_mm256_set1_epi32(0x7FFFFFFF)));
+}
+
+__attribute__((target("avx2,fma")))
+static inline __m256 copySignAVX2(__m256 magnitude, __m256 x) {
+    return _mm256_or_ps(magnitude, _mm256_and_ps(x, _mm256_castsi256_ps(_mm256_set1_epi32(static_cast<int>(0x80000000u)))));
+}
+
+__attribute__((target("avx2,fma")))
+static inline __m256 expAVX2(__m256 x) {
+    x = _mm256_min_ps(_mm256_max_ps(x, _mm256_set1_ps(EXP_MIN)), _mm256_set1_ps(EXP_MAX));
+    const __m256 magic = _mm256_set1_ps(ROUND_MAGIC);
+    __m256 kf = _mm256_sub_ps(_mm256_add_ps(_mm256_mul_ps(x, _mm256_set1_ps(LOG2E)), magic), magic);
+    __m256 r = _mm256_sub_ps(_mm256_sub_ps(x, _mm256_mul_ps(kf, _mm256_set1_ps(LN2_HI))),
+                             _mm256_mul_ps(kf, _mm256_set1_ps(LN2_LO)));
+    __m256 p = _mm256_add_ps(_mm256_set1_ps(EXP_C3), _mm256_mul_ps(r, _mm256_set1_ps(EXP_C4)));
+    p = _mm256_add_ps(_mm256_set1_ps(EXP_C2), _mm256_mul_ps(r, p));
+    p = _mm256_add_ps(_mm256_set1_ps(1.0f), _mm256_mul_ps(r, p));
+    p = _mm256_add_ps(_mm256_set1_ps(1.0f), _mm256_mul_ps(r, p));
+    __m256i k = _mm256_cvtps_epi32(kf);
+    __m256i half = _mm256_srai_epi32(k, 1);
+    return _mm256_mul_ps(_mm256_mul_ps(p, scale2AVX2(half)), scale2AVX2(_mm256_sub_epi32(k, half)));
+}
+
+__attribute__((target("avx2,fma")))
+static inline __m256 logAVX2(__m256 x) {
+    __m256i bits = _mm256_castps_si256(x);
+    __m256i subnormal = _mm256_cmpgt_epi32(_mm256_set1_epi32(0x00800000), bits);
+    bits = _mm256_blendv_epi8(bits, _mm256_castps_si256(_mm256_mul_ps(x, _mm256_set1_ps(TWO_23))), subnormal);
+    __m256i e = _mm256_add_epi32(_mm256_blendv_epi8(_mm256_set1_epi32(-127), _mm256_set1_epi32(-150), subnormal),
+                                 _mm256_srli_epi32(bits, 23));
+    __m256 m = _mm256_castsi256_ps(_mm256_or_si256(_mm256_and_si256(bits, _mm256_set1_epi32(0x007FFFFF)),
+                                                   _mm256_set1_epi32(0x3F800000)));
+    __m256 big = _mm256_cmp_ps(m, _mm256_set1_ps(SQRT2), _CMP_GT_OQ);
+    m = _mm256_blendv_ps(m, _mm256_mul_ps(m, _mm256_set1_ps(0.5f)), big);
+    e = _mm256_sub_epi32(e, _mm256_castps_si256(big));   // true lanes are -1
+    const __m256 one = _mm256_set1_ps(1.0f);
+    __m256 s = _mm256_div_ps(_mm256_sub_ps(m, one), _mm256_add_ps(m, one));
+    __m256 s2 = _mm256_mul_ps(s, s);
+    __m256 p = _mm256_add_ps(_mm256_set1_ps(LOG_C3), _mm256_mul_ps(s2, _mm256_set1_ps(LOG_C5)));
+    p = _mm256_mul_ps(s, _mm256_add_ps(_mm256_set1_ps(2.0f), _mm256_mul_ps(s2, p)));
+    return _mm256_add_ps(_mm256_mul_ps(_mm256_cvtepi32_ps(e), _mm256_set1_ps(LN2)), p);
+}
+
+__attribute__((target("avx2,fma")))
+static inline __m256 tanhAVX2(__m256 x) {
+    __m256 a = absAVX2(x);
+    __m256 x2 = _mm256_mul_ps(x, x);
+    __m256 small = _mm256_add_ps(_mm256_set1_ps(TANH_C3), _mm256_mul_ps(x2, _mm256_set1_ps(TANH_C5)));
+    small = _mm256_add_ps(x, _mm256_mul_ps(x, _mm256_mul_ps(x2, small)));
+    const __m256 one = _mm256_set1_ps(1.0f);
+    __m256 e = expAVX2(_mm256_mul_ps(_mm256_set1_ps(2.0f), _mm256_min_ps(a, _mm256_set1_ps(TANH_MAX))));
+    __m256 large = copySignAVX2(_mm256_div_ps(_mm256_sub_ps(e, one), _mm256_add_ps(e, one)), x);
+    return _mm256_blendv_ps(large, small, _mm256_cmp_ps(a, _mm256_set1_ps(TANH_SMALL), _CMP_LT_OQ));
+}
+
+__attribute__((target("avx2,fma")))
+static inline __m256 sigmoidAVX2(__m256 x) {
+    const __m256 one = _mm256_set1_ps(1.0f);
+    __m256 t = expAVX2(_mm256_xor_ps(absAVX2(x), _mm256_set1_ps(-0.0f)));
+    __m256 numerator = _mm256_blendv_ps(one, t, _mm256_cmp_ps(x, _mm256_setzero_ps(), _CMP_LT_OQ));
+    return _mm256_div_ps(numerator, _mm256_add_ps(one, t));
+}
+
+template <Elementary F>
+__attribute__((target("avx2,fma")))
+static inline __m256 kernelAVX2(__m256 x) {
+    switch (F) {
+    case Elementary::Exp:     return expAVX2(x);
+    case Elementary::Log:     return logAVX2(x);
+    case Elementary::Tanh:    return tanhAVX2(x);
+    default:                  return sigmoidAVX2(x);
+    }
+}
+
+template <Elementary F>
+__attribute__((target("avx2,fma")))
+static void elementaryAVX2(const BFloat16* src, BFloat16* dst, size_t n) {
+    const __m256i magnitude = _mm256_set1_epi32(0x7FFF);
+    size_t i = 0;
+
+    for (; i + 8 <= n; i += 8) {
+        __m128i h = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        __m256i bits = _mm256_cvtepu16_epi32(h);
+        __m256 y = kernelAVX2<F>(_mm256_castsi256_ps(_mm256_slli_epi32(bits, 16)));
+
+        // round to nearest even as BFloat16(float) does
+        __m256i v = _mm256_castps_si256(y);
+        __m256i lsb = _mm256_and_si256(_mm256_srli_epi32(v, 16), _mm256_set1_epi32(1));
+        __m256i result = _mm256_srli_epi32(_mm256_add_epi32(v, _mm256_add_epi32(magnitude, lsb)), 16);
+
+        __m256i abs_bits = _mm256_and_si256(bits, magnitude);
+        if (F == Elementary::Log) {
+            __m256i negative = _mm256_cmpgt_epi32(bits, _mm256_set1_epi32(0x8000));
+            __m256i zero = _mm256_cmpeq_epi32(abs_bits, _mm256_setzero_si256());
+            __m256i infinity = _mm256_cmpeq_epi32(bits, _mm256_set1_epi32(0x7F80));
+            result = _mm256_blendv_epi8(result, _mm256_set1_epi32(BFloat16::nan().bits()), negative);
+            result = _mm256_blendv_epi8(result, _mm256_set1_epi32(BFloat16::infinity(true).bits()), zero);
+            result = _mm256_blendv_epi8(result, bits, infinity);
+        }
+        __m256i nan = _mm256_cmpgt_epi32(abs_bits, _mm256_set1_epi32(0x7F80));
+        result = _mm256_blendv_epi8(result, _mm256_set1_epi32(BFloat16::nan().bits()), nan);
+
+        __m128i packed = _mm_packus_epi32(_mm256_castsi256_si128(result), _mm256_extracti128_si256(result, 1));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), packed);
+    }
+
+    elementaryScalar<F>(src + i, dst + i, n - i);
+}
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#pragma GCC diagnostic ignored "-Wuninitialized"
+#endif
+
+// avx512: 16 lanes, the tail is masked
+
+__attribute__((target("avx512f,avx512bw,avx512vl")))
+static void lookupAVX512(const uint16_t* table, const BFloat16* src, BFloat16* dst, size_t n) {
+    for (size_t i = 0; i < n; i += 16) {
+        __mmask16 k = n - i >= 16 ? static_cast<__mmask16>(0xFFFF)
+                                  : static_cast<__mmask16>((1u << (n - i)) - 1);
+        __m512i index = _mm512_cvtepu16_epi32(_mm256_maskz_loadu_epi16(k, src + i));
+        __m512i v = _mm512_mask_i32gather_epi32(_mm512_setzero_si512(), k, index, table, 2);
+        _mm256_mask_storeu_epi16(dst + i, k, _mm512_cvtepi32_epi16(v));
+    }
+}
+
+__attribute__((target("avx512f,avx512bw,avx512vl")))
+static inline __m512 scale2AVX512(__m512i k) {
+    return _mm512_castsi512_ps(_mm512_slli_epi32(_mm512_add_epi32(k, _mm512_set1_epi32(127)), 23));
+}
+
+__attribute__((target("avx512f,avx512bw,avx512vl")))
+static inline __m512 copySignAVX512(__m512 magnitude, __m512 x) {
+    return _mm512_castsi512_ps(_mm512_ternarylogic_epi32(_mm512_castps_si512(magnitude), _mm512_castps_si512(x),
+                                                         _mm512_set1_epi32(static_cast<int>(0x80000000u)), 0xF8));
+}
+
+__attribute__((target("avx512f,avx512bw,avx512vl")))
+static inline __m512 expAVX512(__m512 x) {
+    x = _mm512_min_ps(_mm512_max_ps(x, _mm512_set1_ps(EXP_MIN)), _mm512_set1_ps(EXP_MAX));
+    const __m512 magic = _mm512_set1_ps(ROUND_MAGIC);
+    __m512 kf = _mm512_sub_ps(_mm512_add_ps(_mm512_mul_ps(x, _mm512_set1_ps(LOG2E)), magic), magic);
+    __m512 r = _mm512_sub_ps(_mm512_sub_ps(x, _mm512_mul_ps(kf, _mm512_set1_ps(LN2_HI))),
+                             _mm512_mul_ps(kf, _mm512_set1_ps(LN2_LO)));
+    __m512 p = _mm512_add_ps(_mm512_set1_ps(EXP_C3), _mm512_mul_ps(r, _mm512_set1_ps(EXP_C4)));
+    p = _mm512_add_ps(_mm512_set1_ps(EXP_C2), _mm512_mul_ps(r, p));
+    p = _mm512_add_ps(_mm512_set1_ps(1.0f), _mm512_mul_ps(r, p));
+    p = _mm512_add_ps(_mm512_set1_ps(1.0f), _mm512_mul_ps(r, p));
+    __m512i k = _mm512_cvtps_epi32(kf);
+    __m512i half = _mm512_srai_epi32(k, 1);
+    return _mm512_mul_ps(_mm512_mul_ps(p, scale2AVX512(half)), scale2AVX512(_mm512_sub_epi32(k, half)));
+}
+
+__attribute__((target("avx512f,avx512bw,avx512vl")))
+static inline __m512 logAVX512(__m512 x) {
+    __m512i bits = _mm512_castps_si512(x);
+    __mmask16 subnormal = _mm512_cmplt_epu32_mask(bits, _mm512_set1_epi32(0x00800000));
+    bits = _mm512_mask_blend_epi32(subnormal, bits, _mm512_castps_si512(_mm512_mul_ps(x, _mm512_set1_ps(TWO_23))));
+    __m512i e = _mm512_add_epi32(_mm512_mask_blend_epi32(subnormal, _mm512_set1_epi32(-127), _mm512_set1_epi32(-150)),
+                                 _mm512_srli_epi32(bits, 23));
+    __m512 m = _mm512_castsi512_ps(_mm512_or_si512(_mm512_and_si512(bits, _mm512_set1_epi32(0x007FFFFF)),
+                                                   _mm512_set1_epi32(0x3F800000)));
+    __mmask16 big = _mm512_cmp_ps_mask(m, _mm512_set1_ps(SQRT2), _CMP_GT_OQ);
+    m = _mm512_mask_mul_ps(m, big, m, _mm512_set1_ps(0.5f));
+    e = _mm512_mask_add_epi32(e, big, e, _mm512_set1_epi32(1));
+    const __m512 one = _mm512_set1_ps(1.0f);
+    __m512 s = _mm512_div_ps(_mm512_sub_ps(m, one), _mm512_add_ps(m, one));
+    __m512 s2 = _mm512_mul_ps(s, s);
+    __m512 p = _mm512_add_ps(_mm512_set1_ps(LOG_C3), _mm512_mul_ps(s2, _mm512_set1_ps(LOG_C5)));
+    p = _mm512_mul_ps(s, _mm512_add_ps(_mm512_set1_ps(2.0f), _mm512_mul_ps(s2, p)));
+    return _mm512_add_ps(_mm512_mul_ps(_mm512_cvtepi32_ps(e), _mm512_set1_ps(LN2)), p);
+}
+
+__attribute__((target("avx512f,avx512bw,avx512vl")))
+static inline __m512 tanhAVX512(__m512 x) {
+    __m512 a = _mm512_abs_ps(x);
+    __m512 x2 = _mm512_mul_ps(x, x);
+    __m512 small = _mm512_add_ps(_mm512_set1_ps(TANH_C3), _mm512_mul_ps(x2, _mm512_set1_ps(TANH_C5)));
+    small = _mm512_add_ps(x, _mm512_mul_ps(x, _mm512_mul_ps(x2, small)));
+    const __m512 one = _mm512_set1_ps(1.0f);
+    __m512 e = expAVX512(_mm512_mul_ps(_mm512_set1_ps(2.0f), _mm512_min_ps(a, _mm512_set1_ps(TANH_MAX))));
+    __m512 large = copySignAVX512(_mm512_div_ps(_mm512_sub_ps(e, one), _mm512_add_ps(e, one)), x);
+    return _mm512_mask_blend_ps(_mm512_cmp_ps_mask(a, _mm512_set1_ps(TANH_SMALL), _CMP_LT_OQ), large, small);
+}
+
+__attribute__((target("avx512f,avx512bw,avx512vl")))
+static inline __m512 sigmoidAVX512(__m512 x) {
+    const __m512 one = _mm512_set1_ps(1.0f);
+    __m512 t = expAVX512(_mm512_castsi512_ps(_mm512_or_si512(_mm512_castps_si512(_mm512_abs_ps(x)),
+                                                              _mm512_set1_epi32(static_cast<int>(0x80000000u)))));
+    __m512 numerator = _mm512_mask_blend_ps(_mm512_cmp_ps_mask(x, _mm512_setzero_ps(), _CMP_LT_OQ), one, t);
+    return _mm512_div_ps(numerator, _mm512_add_ps(one, t));
+}
+
+template <Elementary F>
+__attribute__((target("avx512f,avx512bw,avx512vl")))
+static inline __m512 kernelAVX512(__m512 x) {
+    switch (F) {
+    case Elementary::Exp:     return expAVX512(x);
+    case Elementary::Log:     return logAVX512(x);
+    case Elementary::Tanh:    return tanhAVX512(x);
+    default:                  return sigmoidAVX512(x);
+    }
+}
+
+template <Elementary F>
+__attribute__((target("avx512f,avx512bw,avx512vl")))
+static void elementaryAVX512(const BFloat16* src, BFloat16* dst, size_t n) {
+    const __m512i magnitude = _mm512_set1_epi32(0x7FFF);
+    const __m512i nan = _mm512_set1_epi32(BFloat16::nan().bits());
+
+    for (size_t i = 0; i < n; i += 16) {
+        __mmask16 k = n - i >= 16 ? static_cast<__mmask16>(0xFFFF)
+                                  : static_cast<__mmask16>((1u << (n - i)) - 1);
+        __m512i bits = _mm512_cvtepu16_epi32(_mm256_maskz_loadu_epi16(k, src + i));
+        __m512 y = kernelAVX512<F>(_mm512_castsi512_ps(_mm512_slli_epi32(bits, 16)));
+
+        __m512i v = _mm512_castps_si512(y);
+        __m512i lsb = _mm512_and_si512(_mm512_srli_epi32(v, 16), _mm512_set1_epi32(1));
+        __m512i result = _mm512_srli_epi32(_mm512_add_epi32(v, _mm512_add_epi32(magnitude, lsb)), 16);
+
+        __m512i abs_bits = _mm512_and_si512(bits, magnitude);
+        if (F == Elementary::Log) {
+            __mmask16 negative = _mm512_cmpgt_epu32_mask(bits, _mm512_set1_epi32(0x8000));
+            __mmask16 zero = _mm512_cmpeq_epi32_mask(abs_bits, _mm512_setzero_si512());
+            __mmask16 infinity = _mm512_cmpeq_epi32_mask(bits, _mm512_set1_epi32(0x7F80));
+            result = _mm512_mask_blend_epi32(negative, result, nan);
+            result = _mm512_mask_blend_epi32(zero, result, _mm512_set1_epi32(BFloat16::infinity(true).bits()));
+            result = _mm512_mask_blend_epi32(infinity, result, bits);
+        }
+        result = _mm512_mask_blend_epi32(_mm512_cmpgt_epu32_mask(abs_bits, _mm512_set1_epi32(0x7F80)), result, nan);
+
+        _mm256_mask_storeu_epi16(dst + i, k, _mm512_cvtepi32_epi16(result));
+    }
+}
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+#endif // BF16_X86
+
+template <Elementary F>
+static void elementary(const BFloat16* src, BFloat16* dst, size_t n, SimdLevel level) {
+    if (!simdLevelSupported(level)) level = SimdLevel::Scalar;
+
+    if constexpr (F == Elementary::Erf || F == Elementary::Gelu) {
+        const uint16_t* table = elementaryTable<F>();
+        switch (level) {
+#ifdef BF16_X86
+        case SimdLevel::AVX2:       lookupAVX2(table, src, dst, n); return;
+        case SimdLevel::AVX512:
+        case SimdLevel::AVX512BF16: lookupAVX512(table, src, dst, n); return;
+#endif
+        default:                    lookupScalar(table, src, dst, n); return;
+        }
+    }
+
+    switch (level) {
+#ifdef BF16_X86
+    case SimdLevel::AVX2:       elementaryAVX2<F>(src, dst, n); return;
+    case SimdLevel::AVX512:
+    case SimdLevel::AVX512BF16: elementaryAVX512<F>(src, dst, n); return;
+#endif
+    default:                    elementaryScalar<F>(src, dst, n); return;
+    }
+}
+
+template <Elementary F>
+static void elementary(const BFloat16* src, BFloat16* dst, size_t n) {
+    SimdLevel level = detectSimdLevel();
+    parallelChunks(n, ROOT_GRAIN, [=](size_t begin, size_t end) {
+        elementary<F>(src + begin, dst + begin, end - begin, level);
+    });
+}
+
+// public entry points
+
+BFloat16 exp(const BFloat16& x) { return elementary<Elementary::Exp>(x); }
+BFloat16 log(const BFloat16& x) { return elementary<Elementary::Log>(x); }
+BFloat16 tanh(const BFloat16& x) { return elementary<Elementary::Tanh>(x); }
+BFloat16 sigmoid(const BFloat16& x) { return elementary<Elementary::Sigmoid>(x); }
+BFloat16 erf(const BFloat16& x) { return elementary<Elementary::Erf>(x); }
+BFloat16 gelu(const BFloat16& x) { return elementary<Elementary::Gelu>(x); }
+
+void exp(const BFloat16* src, BFloat16* dst, size_t n) { elementary<Elementary::Exp>(src, dst, n); }
+void log(const BFloat16* src, BFloat16* dst, size_t n) { elementary<Elementary::Log>(src, dst, n); }
+void tanh(const BFloat16* src, BFloat16* dst, size_t n) { elementary<Elementary::Tanh>(src, dst, n); }
+void sigmoid(const BFloat16* src, BFloat16* dst, size_t n) { elementary<Elementary::Sigmoid>(src, dst, n); }
+void erf(const BFloat16* src, BFloat16* dst, size_t n) { elementary<Elementary::Erf>(src, dst, n); }
+void gelu(const BFloat16* src, BFloat16* dst, size_t n) { elementary<Elementary::Gelu>(src, dst, n); }
+
+void exp(const BFloat16* src, BFloat16* dst, size_t n, SimdLevel level) {
+    elementary<Elementary::Exp>(src, dst, n, level);
+}
+
+void log(const BFloat16* src, BFloat16* dst, size_t n, SimdLevel level) {
+    elementary<Elementary::Log>(src, dst, n, level);
+}
+
+void tanh(const BFloat16* src, BFloat16* dst, size_t n, SimdLevel level) {
+    elementary<Elementary::Tanh>(src, dst, n, level);
+}
+
+void sigmoid(const BFloat16* src, BFloat16* dst, size_t n, SimdLevel level) {
+    elementary<Elementary::Sigmoid>(src, dst, n, level);
+}
+
+void erf(const BFloat16* src, BFloat16* dst, size_t n, SimdLevel level) {
+    elementary<Elementary::Erf>(src, dst, n, level);
+}
+
+void gelu(const BFloat16* src, BFloat16* dst, size_t n, SimdLevel level) {
+    elementary<Elementary::Gelu>(src, dst, n, level);
+}
@@ -0,0 +1,113 @@
+#include "BF16.h"
+#include "BF16Linalg.h"
+#include "BF16Simd.h"
+#include "FP32Reduce.h"
+#include "MethodBench.h"
+#include <algorithm>
+#include <random>
+#include <vector>
+
+// the dot and gemm modes as whole methods, through the MethodBench harness:
+// seconds per call to a confidence interval, pinned, with perf counters.
+// `make bench-methods` writes bench_bf16_methods.json, whose "results" is
+// utils/plotting.py's compare_methods input, and bench_bf16_methods.csv,
+// which a later run can take as --baseline. every MethodBench flag works,
+// e.g. --filter=gemm --sizes=64,128
+
+struct DotProblem {
+    std::vector<float> xf, yf;
+    std::vector<FP32> x32, y32;
+    std::vector<BFloat16> x16, y16;
+};
+
+struct GemmProblem {
+    size_t n;
+    std::vector<BFloat16> A, B;
+    std::vector<float> C;
+    std::vector<float> Af, Bf;
+};
+
+static DotProblem dotProblem(size_t n) {
+    std::mt19937 rng(static_cast<uint32_t>(n));
+    std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+    DotProblem p;
+    for (size_t i = 0; i < n; ++i) {
+        // the same values in every format, bf16 exact
+        float x = BFloat16(dist(rng)).toFloat(), y = BFloat16(dist(rng)).toFloat();
+        p.xf.push_back(x);
+        p.yf.push_back(y);
+        p.x32.emplace_back(x);
+        p.y32.emplace_back(y);
+        p.x16.emplace_back(x);
+        p.y16.emplace_back(y);
+    }
+    return p;
+}
+
+static GemmProblem gemmProblem(size_t n) {
+    std::mt19937 rng(static_cast<uint32_t>(n));
+    std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+    GemmProblem p;
+    p.n = n;
+    p.A.resize(n * n);
+    p.B.resize(n * n);
+    p.C.resize(n * n);
+    for (size_t i = 0; i < n * n; ++i) {
+        p.A[i] = BFloat16(dist(rng));
+        p.B[i] = BFloat16(dist(rng));
+        p.Af.push_back(p.A[i].toFloat());
+        p.Bf.push_back(p.B[i].toFloat());
+    }
+    return p;
+}
+
+// the native float reference, i-k-j so the inner loop vectorizes
+static void floatGemm(GemmProblem& p) {
+    const size_t n = p.n;
+    std::fill(p.C.begin(), p.C.end(), 0.0f);
+    for (size_t i = 0; i < n; ++i) {
+        for (size_t k = 0; k < n; ++k) {
+            float a = p.Af[i * n + k];
+            for (size_t j = 0; j < n; ++j) p.C[i * n + j] += a * p.Bf[k * n + j];
+        }
+    }
+}
+
+static void bf16Gemm(GemmProblem& p, LinalgMode mode) {
+    gemm(p.n, p.n, p.n, 1.0f, p.A.data(), p.n, p.B.data(), p.n, 0.0f, p.C.data(), p.n, mode);
+}
+
+int main(int argc, char** argv) {
+    MethodBench bench("bf16 methods", argc, argv);
+    bench.setContext("simd", simdLevelName(detectSimdLevel()));
+
+    using DotMethod = std::function<void(DotProblem&)>;
+    std::vector<std::pair<std::string, DotMethod>> dots = {
+        {"dot/float", [](DotProblem& p) {
+             float sum = 0.0f;
+             for (size_t i = 0; i < p.xf.size(); ++i) sum += p.xf[i] * p.yf[i];
+             doNotOptimize(sum);
+         }},
+        {"dot/fp32", [](DotProblem& p) { doNotOptimize(dot(p.x32.data(), p.y32.data(), p.x32.size())); }},
+        {"dot/bf16 native", [](DotProblem& p) {
+             doNotOptimize(dot(p.x16.data(), p.y16.data(), p.x16.size(), LinalgMode::Native));
+         }},
+        {"dot/bf16 hardware", [](DotProblem& p) {
+             doNotOptimize(dot(p.x16.data(), p.y16.data(), p.x16.size(), LinalgMode::HardwareDot));
+         }},
+        {"dot/bf16 emulated", [](DotProblem& p) {
+             doNotOptimize(dot(p.x16.data(), p.y16.data(), p.x16.size(), LinalgMode::Emulated));
+         }},
+    };
+    benchmarkMethods<DotProblem>(bench, dots, bench.sizes({1024, 16384, 262144}), dotProblem);
+
+    using GemmMethod = std::function<void(GemmProblem&)>;
+    std::vector<std::pair<std::string, GemmMethod>> gemms = {
+        {"gemm/float", floatGemm},
+        {"gemm/bf16 native", [](GemmProblem& p) { bf16Gemm(p, LinalgMode::Native); }},
+        {"gemm/bf16 hardware", [](GemmProblem& p) { bf16Gemm(p, LinalgMode::HardwareDot); }},
+    };
+    benchmarkMethods<GemmProblem>(bench, gemms, bench.sizes({64, 128, 256}), gemmProblem);
+
+    return bench.finish();
+}
@@ -0,0 +1,465 @@
+#include "BF16Order.h"
+#include "BF16Simd.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define BF16_X86 1
+#include <immintrin.h>
+#endif
+
+using Format = BFloat16::Format;
+
+// everything runs on Format::orderKey: positive patterns gain the top bit,
+// negative ones are inverted. in simd that is x ^ ((x >>s 15) | 0x8000)
+// and back k ^ (~(k >>s 15) | 0x8000), then unsigned 16-bit min / max
+
+static constexpr size_t RANGE_GRAIN = chunkElements(sizeof(BFloat16));
+static constexpr size_t CLAMP_GRAIN = chunkElements(2 * sizeof(BFloat16));
+
+// smallest and largest key of a span
+struct KeyRange {
+    uint16_t lo;
+    uint16_t hi;
+};
+
+// the key a nan takes in the reductions. under Propagate it sits below
+// every number for the minimum and above every number for the maximum,
+// under Ignore the other way round, so it wins only when nothing else is
+// left. both keys decode to nan patterns, no number has them
+struct NaNKeys {
+    bool remap;
+    uint16_t lo;
+    uint16_t hi;
+};
+
+static NaNKeys nanKeys(NaNPolicy policy) {
+    switch (policy) {
+    case NaNPolicy::Propagate: return {true, 0x0000, 0xFFFF};
+    case NaNPolicy::Ignore:    return {true, 0xFFFF, 0x0000};
+    default:                   return {false, 0, 0};
+    }
+}
+
+// the clamp bounds as keys, and whether nans keep their bits
+struct ClampKeys {
+    uint16_t lo;
+    uint16_t hi;
+    bool keep_nan;
+};
+
+// scalar kernels
+
+static KeyRange rangeScalar(const BFloat16* x, size_t n, NaNKeys nan) {
+    KeyRange range = {0xFFFF, 0x0000};
+    for (size_t i = 0; i < n; ++i) {
+        uint16_t bits = x[i].bits();
+        uint16_t key = Format::orderKey(bits);
+        bool is_nan = nan.remap && Format::isNaN(bits);
+        range.lo = std::min(range.lo, is_nan ? nan.lo : key);
+        range.hi = std::max(range.hi, is_nan ? nan.hi : key);
+    }
+    return range;
+}
+
+static size_t findBitsScalar(const BFloat16* x, size_t n, uint16_t target) {
+    for (size_t i = 0; i < n; ++i) {
+        if (x[i].bits() == target) return i;
+    }
+    return n;
+}
+
+static size_t findNaNScalar(const BFloat16* x, size_t n) {
+    for (size_t i = 0; i < n; ++i) {
+        if (x[i].isNaN()) return i;
+    }
+    return n;
+}
+
+static void clampScalar(const BFloat16* src, BFloat16* dst, size_t n, ClampKeys c) {
+    for (size_t i = 0; i < n; ++i) {
+        uint16_t bits = src[i].bits();
+        uint16_t key = std::min(std::max(Format::orderKey(bits), c.lo), c.hi);
+        dst[i] = BFloat16::fromBits(c.keep_nan && Format::isNaN(bits) ? bits : Format::fromOrderKey(key));
+    }
+}
+
+#ifdef BF16_X86
+
+// avx2: 16 lanes, the tail goes to the scalar kernels
+
+__attribute__((target("avx2,fma")))
+static inline __m256i orderKeyAVX2(__m256i x) {
+    return _mm256_xor_si256(x, _mm256_or_si256(_mm256_srai_epi16(x, 15), _mm256_set1_epi16(INT16_MIN)));
+}
+
+__attribute__((target("avx2,fma")))
+static inline __m256i fromOrderKeyAVX2(__m256i k) {
+    __m256i flip = _mm256_andnot_si256(_mm256_srai_epi16(k, 15), _mm256_set1_epi16(-1));
+    return _mm256_xor_si256(k, _mm256_or_si256(flip, _mm256_set1_epi16(INT16_MIN)));
+}
+
+__attribute__((target("avx2,fma")))
+static inline __m256i isNaNAVX2(__m256i x) {
+    __m256i magnitude = _mm256_and_si256(x, _mm256_set1_epi16(0x7FFF));
+    return _mm256_cmpgt_epi16(magnitude, _mm256_set1_epi16(0x7F80));
+}
+
+__attribute__((target("avx2,fma")))
+static KeyRange rangeAVX2(const BFloat16* x, size_t n, NaNKeys nan) {
+    __m256i lo = _mm256_set1_epi16(-1);
+    __m256i hi = _mm256_setzero_si256();
+    const __m256i nan_lo = _mm256_set1_epi16(static_cast<short>(nan.lo));
+    const __m256i nan_hi = _mm256_set1_epi16(static_cast<short>(nan.hi));
+    size_t i = 0;
+
+    for (; i + 16 <= n; i += 16) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(x + i));
+        __m256i key = orderKeyAVX2(v);
+        __m256i key_lo = key;
+        __m256i key_hi = key;
+        if (nan.remap) {
+            __m256i is_nan = isNaNAVX2(v);
+            key_lo = _mm256_blendv_epi8(key, nan_lo, is_nan);
+            key_hi = _mm256_blendv_epi8(key, nan_hi, is_nan);
+        }
+        lo = _mm256_min_epu16(lo, key_lo);
+        hi = _mm256_max_epu16(hi, key_hi);
+    }
+
+    alignas(32) uint16_t lo_lanes[16];
+    alignas(32) uint16_t hi_lanes[16];
+    _mm256_store_si256(reinterpret_cast<__m256i*>(lo_lanes), lo);
+    _mm256_store_si256(reinterpret_cast<__m256i*>(hi_lanes), hi);
+    KeyRange range = rangeScalar(x + i, n - i, nan);
+    for (int l = 0; l < 16; ++l) {
+        range.lo = std::min(range.lo, lo_lanes[l]);
+        range.hi = std::max(range.hi, hi_lanes[l]);
+    }
+    return range;
+}
+
+__attribute__((target("avx2,fma")))
+static size_t findBitsAVX2(const BFloat16* x, size_t n, uint16_t target) {
+    const __m256i t = _mm256_set1_epi16(static_cast<short>(target));
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(x + i));
+        unsigned hits = static_cast<unsigned>(_mm256_movemask_epi8(_mm256_cmpeq_epi16(v, t)));
+        if (hits) return i + __builtin_ctz(hits) / 2;
+    }
+    return i + findBitsScalar(x + i, n - i, target);
+}
+
+__attribute__((target("avx2,fma")))
+static size_t findNaNAVX2(const BFloat16* x, size_t n) {
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(x + i));
+        unsigned hits = static_cast<unsigned>(_mm256_movemask_epi8(isNaNAVX2(v)));
+        if (hits) return i + __builtin_ctz(hits) / 2;
+    }
+    return i + findNaNScalar(x + i, n - i);
+}
+
+__attribute__((target("avx2,fma")))
+static void clampAVX2(const BFloat16* src, BFloat16* dst, size_t n, ClampKeys c) {
+    const __m256i lo = _mm256_set1_epi16(static_cast<short>(c.lo));
+    const __m256i hi = _mm256_set1_epi16(static_cast<short>(c.hi));
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+        __m256i key = _mm256_min_epu16(_mm256_max_epu16(orderKeyAVX2(v), lo), hi);
+        __m256i out = fromOrderKeyAVX2(key);
+        if (c.keep_nan) out = _mm256_blendv_epi8(out, v, isNaNAVX2(v));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), out);
+    }
+    clampScalar(src + i, dst + i, n - i, c);
+}
+
+// avx512: 32 lanes, the tail is masked
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#pragma GCC diagnostic ignored "-Wuninitialized"
+#endif
+
+static inline __mmask32 tailMask(size_t remaining) {
+    return remaining >= 32 ? ~__mmask32(0) : static_cast<__mmask32>((1u << remaining) - 1);
+}
+
+__attribute__((target("avx512f,avx512bw,avx512vl")))
+static inline __m512i orderKeyAVX512(__m512i x) {
+    return _mm512_xor_si512(x, _mm512_or_si512(_mm512_srai_epi16(x, 15), _mm512_set1_epi16(INT16_MIN)));
+}
+
+__attribute__((target("avx512f,avx512bw,avx512vl")))
+static inline __m512i fromOrderKeyAVX512(__m512i k) {
+    __m512i flip = _mm512_andnot_si512(_mm512_srai_epi16(k, 15), _mm512_set1_epi16(-1));
+    return _mm512_xor_si512(k, _mm512_or_si512(flip, _mm512_set1_epi16(INT16_MIN)));
+}
+
+__attribute__((target("avx512f,avx512bw,avx512vl")))
+static inline __mmask32 isNaNAVX512(__m512i x) {
+    __m512i magnitude = _mm512_and_si512(x, _mm512_set1_epi16(0x7FFF));
+    return _mm512_cmpgt_epi16_mask(magnitude, _mm512_set1_epi16(0x7F80));
+}
+
+__attribute__((target("avx512f,avx512bw,avx512vl")))
+static KeyRange rangeAVX512(const BFloat16* x, size_t n, NaNKeys nan) {
+    __m512i lo = _mm512_set1_epi16(-1);
+    __m512i hi = _mm512_setzero_si512();
+    const __m512i nan_lo = _mm512_set1_epi16(static_cast<short>(nan.lo));
+    const __m512i nan_hi = _mm512_set1_epi16(static_cast<short>(nan.hi));
+
+    for (size_t i = 0; i < n; i += 32) {
+        __mmask32 k = tailMask(n - i);
+        __m512i v = _mm512_maskz_loadu_epi16(k, x + i);
+        __m512i key = orderKeyAVX512(v);
+        __m512i key_lo = key;
+        __m512i key_hi = key;
+        if (nan.remap) {
+            __mmask32 is_nan = isNaNAVX512(v);
+            key_lo = _mm512_mask_mov_epi16(key, is_nan, nan_lo);
+            key_hi = _mm512_mask_mov_epi16(key, is_nan, nan_hi);
+        }
+        lo = _mm512_mask_min_epu16(lo, k, lo, key_lo);
+        hi = _mm512_mask_max_epu16(hi, k, hi, key_hi);
+    }
+
+    // fold 32 lanes to 16 and finish in 32-bit lanes
+    __m512i lo32 = _mm512_min_epu32(_mm512_cvtepu16_epi32(_mm512_castsi512_si256(lo)),
+                                     _mm512_cvtepu16_epi32(_mm512_extracti64x4_epi64(lo, 1)));
+    __m512i hi32 = _mm512_max_epu32(_mm512_cvtepu16_epi32(_mm512_castsi512_si256(hi)),
+                                     _mm512_cvtepu16_epi32(_mm512_extracti64x4_epi64(hi, 1)));
+    return {static_cast<uint16_t>(_mm512_reduce_min_epu32(lo32)),
+            static_cast<uint16_t>(_mm512_reduce_max_epu32(hi32))};
+}
+
+__attribute__((target("avx512f,avx512bw,avx512vl")))
+static size_t findBitsAVX512(const BFloat16* x, size_t n, uint16_t target) {
+    const __m512i t = _mm512_set1_epi16(static_cast<short>(target));
+    for (size_t i = 0; i < n; i += 32) {
+        __mmask32 k = tailMask(n - i);
+        __m512i v = _mm512_maskz_loadu_epi16(k, x + i);
+        __mmask32 hits = _mm512_mask_cmpeq_epi16_mask(k, v, t);
+        if (hits) return i + __builtin_ctz(hits);
+    }
+    return n;
+}
+
+__attribute__((target("avx512f,avx512bw,avx512vl")))
+static size_t findNaNAVX512(const BFloat16* x, size_t n) {
+    for (size_t i = 0; i < n; i += 32) {
+        __mmask32 k = tailMask(n - i);
+        __m512i v = _mm512_maskz_loadu_epi16(k, x + i);
+        __mmask32 hits = isNaNAVX512(v) & k;
+        if (hits) return i + __builtin_ctz(hits);
+    }
+    return n;
+}
+
+__attribute__((target("avx512f,avx512bw,avx512vl")))
+static void clampAVX512(const BFloat16* src, BFloat16* dst, size_t n, ClampKeys c) {
+    const __m512i lo = _mm512_set1_epi16(static_cast<short>(c.lo));
+    const __m512i hi = _mm512_set1_epi16(static_cast<short>(c.hi));
+    for (size_t i = 0; i < n; i += 32) {
+        __mmask32 k = tailMask(n - i);
+        __m512i v = _mm512_maskz_loadu_epi16(k, src + i);
+        __m512i key = _mm512_min_epu16(_mm512_max_epu16(orderKeyAVX512(v), lo), hi);
+        __m512i out = fromOrderKeyAVX512(key);
+        if (c.keep_nan) out = _mm512_mask_mov_epi16(out, isNaNAVX512(v), v);
+        _mm512_mask_storeu_epi16(dst + i, k, out);
+    }
+}
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+#endif // BF16_X86
+
+// dispatch, neon stays on the scalar kernels
+
+static SimdLevel orderLevel(SimdLevel level) {
+    return simdLevelSupported(level) ? level : SimdLevel::Scalar;
+}
+
+static KeyRange range(const BFloat16* x, size_t n, NaNKeys nan, SimdLevel level) {
+    switch (level) {
+#ifdef BF16_X86
+    case SimdLevel::AVX2:       return rangeAVX2(x, n, nan);
+    case SimdLevel::AVX512:
+    case SimdLevel::AVX512BF16: return rangeAVX512(x, n, nan);
+#endif
+    default:                    return rangeScalar(x, n, nan);
+    }
+}
+
+static size_t findBits(const BFloat16* x, size_t n, uint16_t target, SimdLevel level) {
+    switch (level) {
+#ifdef BF16_X86
+    case SimdLevel::AVX2:       return findBitsAVX2(x, n, target);
+    case SimdLevel::AVX512:
+    case SimdLevel::AVX512BF16: return findBitsAVX512(x, n, target);
+#endif
+    default:                    return findBitsScalar(x, n, target);
+    }
+}
+
+static size_t findNaN(const BFloat16* x, size_t n, SimdLevel level) {
+    switch (level) {
+#ifdef BF16_X86
+    case SimdLevel::AVX2:       return findNaNAVX2(x, n);
+    case SimdLevel::AVX512:
+    case SimdLevel::AVX512BF16: return findNaNAVX512(x, n);
+#endif
+    default:                    return findNaNScalar(x, n);
+    }
+}
+
+static void clampKernel(const BFloat16* src, BFloat16* dst, size_t n, ClampKeys c, SimdLevel level) {
+    switch (level) {
+#ifdef BF16_X86
+    case SimdLevel::AVX2:       clampAVX2(src, dst, n, c); return;
+    case SimdLevel::AVX512:
+    case SimdLevel::AVX512BF16: clampAVX512(src, dst, n, c); return;
+#endif
+    default:                    clampScalar(src, dst, n, c); return;
+    }
+}
+
+static KeyRange keyRange(const BFloat16* x, size_t n, NaNPolicy policy, SimdLevel level) {
+    NaNKeys nan = nanKeys(policy);
+    return parallelReduce(n, RANGE_GRAIN, KeyRange{0xFFFF, 0x0000},
+        [=](size_t begin, size_t end) { return range(x + begin, end - begin, nan, level); },
+        [](KeyRange a, KeyRange b) { return KeyRange{std::min(a.lo, b.lo), std::max(a.hi, b.hi)}; });
+}
+
+// one pass for the extreme key, a second that stops at its first copy
+template <bool MAX>
+static size_t argExtreme(const BFloat16* x, size_t n, NaNPolicy policy, SimdLevel level) {
+    if (n == 0) return n;
+    level = orderLevel(level);
+
+    KeyRange r = keyRange(x, n, policy, level);
+    uint16_t target = Format::fromOrderKey(MAX ? r.hi : r.lo);
+    if (policy == NaNPolicy::Total || !Format::isNaN(target)) return findBits(x, n, target, level);
+
+    // a nan won: the first one under Propagate, and under Ignore it means
+    // every element is nan
+    if (policy == NaNPolicy::Ignore) return n;
+    return findNaN(x, n, level);
+}
+
+size_t argmin(const BFloat16* x, size_t n, NaNPolicy policy, SimdLevel level) {
+    return argExtreme<false>(x, n, policy, level);
+}
+
+size_t argmax(const BFloat16* x, size_t n, NaNPolicy policy, SimdLevel level) {
+    return argExtreme<true>(x, n, policy, level);
+}
+
+std::pair<BFloat16, BFloat16> minmax(const BFloat16* x, size_t n, NaNPolicy policy, SimdLevel level) {
+    if (n == 0) return {BFloat16::nan(), BFloat16::nan()};
+
+    KeyRange r = keyRange(x, n, policy, orderLevel(level));
+    BFloat16 lo = BFloat16::fromBits(Format::fromOrderKey(r.lo));
+    BFloat16 hi = BFloat16::fromBits(Format::fromOrderKey(r.hi));
+    if (policy != NaNPolicy::Total && (lo.isNaN() || hi.isNaN())) return {BFloat16::nan(), BFloat16::nan()};
+    return {lo, hi};
+}
+
+void clamp(const BFloat16* src, BFloat16* dst, size_t n, BFloat16 lo, BFloat16 hi,
+           NaNPolicy policy, SimdLevel level) {
+    ClampKeys c = {Format::orderKey(lo.bits()), Format::orderKey(hi.bits()), policy != NaNPolicy::Total};
+    if (lo.isNaN() || hi.isNaN() || c.lo > c.hi) {
+        throw std::invalid_argument("clamp: lo and hi must be numbers with lo <= hi");
+    }
+
+    level = orderLevel(level);
+    parallelChunks(n, CLAMP_GRAIN, [=](size_t begin, size_t end) {
+        clampKernel(src + begin, dst + begin, end - begin, c, level);
+    });
+}
+
+size_t argmin(const BFloat16* x, size_t n, NaNPolicy policy) {
+    return argmin(x, n, policy, detectSimdLevel());
+}
+
+size_t argmax(const BFloat16* x, size_t n, NaNPolicy policy) {
+    return argmax(x, n, policy, detectSimdLevel());
+}
+
+std::pair<BFloat16, BFloat16> minmax(const BFloat16* x, size_t n, NaNPolicy policy) {
+    return minmax(x, n, policy, detectSimdLevel());
+}
+
+void clamp(const BFloat16* src, BFloat16* dst, size_t n, BFloat16 lo, BFloat16 hi, NaNPolicy policy) {
+    clamp(src, dst, n, lo, hi, policy, detectSimdLevel());
+}
+
+// sort
+
+// below this many elements, clearing and scanning 65536 counters costs
+// more than comparison sorting the keys
+static constexpr size_t COUNTING_MIN = 2048;
+
+// the keys index the counters, and since a key decodes back to its bits
+// the output is regenerated from the counts alone. the nans that keep
+// their place were packed at the front, they go after the numbers
+template <typename Count>
+static void countingSort(BFloat16* x, size_t n, bool keep_nan) {
+    std::vector<Count> count(65536, 0);
+    size_t nans = 0;
+    for (size_t i = 0; i < n; ++i) {
+        uint16_t bits = x[i].bits();
+        if (keep_nan && Format::isNaN(bits)) {
+            x[nans++] = x[i];
+            continue;
+        }
+        count[Format::orderKey(bits)]++;
+    }
+    std::memmove(x + (n - nans), x, nans * sizeof(BFloat16));
+
+    BFloat16* out = x;
+    for (uint32_t key = 0; key <= 0xFFFF; ++key) {
+        if (count[key] == 0) continue;
+        out = std::fill_n(out, count[key], BFloat16::fromBits(Format::fromOrderKey(static_cast<uint16_t>(key))));
+    }
+}
+
+void sort(BFloat16* x, size_t n, NaNPolicy policy) {
+    if (n < 2) return;
+    bool keep_nan = policy != NaNPolicy::Total;
+
+    if (n >= COUNTING_MIN) {
+        if (n <= std::numeric_limits<uint32_t>::max()) {
+            countingSort<uint32_t>(x, n, keep_nan);
+        } else {
+            countingSort<size_t>(x, n, keep_nan);
+        }
+        return;
+    }
+
+    // nans packed at the front as the keys are built, then moved back
+    std::vector<uint16_t> keys(n);
+    size_t nans = 0;
+    size_t m = 0;
+    for (size_t i = 0; i < n; ++i) {
+        uint16_t bits = x[i].bits();
+        if (keep_nan && Format::isNaN(bits)) {
+            x[nans++] = x[i];
+            continue;
+        }
+        keys[m++] = Format::orderKey(bits);
+    }
+    std::memmove(x + m, x, nans * sizeof(BFloat16));
+    std::sort(keys.begin(), keys.begin() + m);
+    for (size_t i = 0; i < m; ++i) x[i] = BFloat16::fromBits(Format::fromOrderKey(keys[i]));
+}
@@ -0,0 +1,506 @@
+#include "BF16Reduce.h"
+#include "BF16Simd.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define BF16_X86 1
+#include <immintrin.h>
+#endif
+
+// bf16 arithmetic in hardware float: the exact sum or product of two bf16
+// values rounded to float and then to bf16 is the correctly rounded bf16
+// result (float has more than 2 * 8 + 2 bits), the same bits as the
+// soft-float operators. nans here come from bf16 inputs or the default
+// nan, so their low half is zero and the rounding keeps them nan.
+//
+// every kernel runs SUMMATION_LANES lanes whatever the simd width: element
+// i of a chunk goes to lane i % 16, a short last row is padded with zeros
+// and the lanes fold as the same tree, so all levels agree bit for bit
+//
+// the bf16-precision kernels take the subnormal mode, read once on the
+// calling thread. under Flush a subnormal term reads as a zero of its sign
+// and every rounded result that lands on a subnormal becomes one, as the
+// operators do. bf16 and float share the exponent range, so a subnormal
+// of either has a zero exponent field. Widened and the float folds see
+// the stored bits
+
+static constexpr size_t REDUCE_GRAIN = chunkElements(2 * sizeof(BFloat16));
+static_assert(REDUCE_GRAIN % SUMMATION_BLOCK == 0, "chunks hold whole pairwise blocks");
+
+typedef float (*ReduceKernel)(const BFloat16*, const BFloat16*, size_t);
+
+template <SubnormalMode S>
+static inline float flushBF16(float v) {
+    if (S == SubnormalMode::Preserve) return v;
+    uint32_t bits;
+    std::memcpy(&bits, &v, sizeof(float));
+    if ((bits & 0x7F800000u) == 0) bits &= 0x80000000u;
+    std::memcpy(&v, &bits, sizeof(float));
+    return v;
+}
+
+template <SubnormalMode S>
+static inline float roundBF16(float v) {
+    uint32_t bits;
+    std::memcpy(&bits, &v, sizeof(float));
+    bits = (bits + 0x7FFFu + ((bits >> 16) & 1u)) & 0xFFFF0000u;
+    std::memcpy(&v, &bits, sizeof(float));
+    return flushBF16<S>(v);
+}
+
+// scalar kernels
+
+// element i of the sum, or the product x[i] * y[i], rounded to bf16 unless
+// the strategy is Widened. zero past the end
+template <bool DOT, bool ROUND, SubnormalMode S = SubnormalMode::Preserve>
+static inline float termScalar(const BFloat16* x, const BFloat16* y, size_t i, size_t n) {
+    if (i >= n) return 0.0f;
+    float v = flushBF16<S>(x[i].toFloat());
+    if (!DOT) return v;
+    v *= flushBF16<S>(y[i].toFloat());
+    return ROUND ? roundBF16<S>(v) : v;
+}
+
+// lane l absorbs lane l + width, halving the width each round
+template <bool ROUND, SubnormalMode S = SubnormalMode::Preserve>
+static float foldScalar(float* lanes) {
+    for (size_t width = SUMMATION_LANES / 2; width > 0; width /= 2) {
+        for (size_t l = 0; l < width; ++l) {
+            float v = lanes[l] + lanes[l + width];
+            lanes[l] = ROUND ? roundBF16<S>(v) : v;
+        }
+    }
+    return lanes[0];
+}
+
+template <SubnormalMode S, bool DOT>
+static float naive(const BFloat16* x, const BFloat16* y, size_t n) {
+    float acc = 0.0f;
+    for (size_t i = 0; i < n; ++i) {
+        acc = roundBF16<S>(acc + termScalar<DOT, true, S>(x, y, i, n));
+    }
+    return acc;
+}
+
+// n <= SUMMATION_BLOCK terms, one short bf16 sum per lane
+template <SubnormalMode S, bool DOT>
+static float pairwiseBlockScalar(const BFloat16* x, const BFloat16* y, size_t n) {
+    float lanes[SUMMATION_LANES] = {};
+    for (size_t i = 0; i < n; i += SUMMATION_LANES) {
+        for (size_t l = 0; l < SUMMATION_LANES; ++l) {
+            lanes[l] = roundBF16<S>(lanes[l] + termScalar<DOT, true, S>(x, y, i + l, n));
+        }
+    }
+    return foldScalar<true, S>(lanes);
+}
+
+template <SubnormalMode S, bool DOT>
+static float kahanScalar(const BFloat16* x, const BFloat16* y, size_t n) {
+    float sum[SUMMATION_LANES] = {};
+    float compensation[SUMMATION_LANES] = {};
+    for (size_t i = 0; i < n; i += SUMMATION_LANES) {
+        for (size_t l = 0; l < SUMMATION_LANES; ++l) {
+            float corrected = roundBF16<S>(termScalar<DOT, true, S>(x, y, i + l, n) - compensation[l]);
+            float t = roundBF16<S>(sum[l] + corrected);
+            compensation[l] = roundBF16<S>(roundBF16<S>(t - sum[l]) - corrected);
+            sum[l] = t;
+        }
+    }
+
+    float lanes[SUMMATION_LANES];
+    for (size_t l = 0; l < SUMMATION_LANES; ++l) {
+        lanes[l] = sum[l] - compensation[l];
+    }
+    return foldScalar<false>(lanes);
+}
+
+template <SubnormalMode S, bool DOT>
+static float neumaierScalar(const BFloat16* x, const BFloat16* y, size_t n) {
+    float sum[SUMMATION_LANES] = {};
+    float compensation[SUMMATION_LANES] = {};
+    for (size_t i = 0; i < n; i += SUMMATION_LANES) {
+        for (size_t l = 0; l < SUMMATION_LANES; ++l) {
+            float v = termScalar<DOT, true, S>(x, y, i + l, n);
+            float t = roundBF16<S>(sum[l] + v);
+            // the smaller operand lost its low bits, exactly a bf16 value.
+            // the compensation sums them in float, a bf16 one would stall
+            float low = std::fabs(sum[l]) >= std::fabs(v) ? roundBF16<S>(roundBF16<S>(sum[l] - t) + v)
+                                                          : roundBF16<S>(roundBF16<S>(v - t) + sum[l]);
+            compensation[l] += low;
+            sum[l] = t;
+        }
+    }
+
+    float lanes[SUMMATION_LANES];
+    for (size_t l = 0; l < SUMMATION_LANES; ++l) {
+        lanes[l] = sum[l] + compensation[l];
+    }
+    return foldScalar<false>(lanes);
+}
+
+template <bool DOT>
+static float widenedScalar(const BFloat16* x, const BFloat16* y, size_t n) {
+    float lanes[SUMMATION_LANES] = {};
+    for (size_t i = 0; i < n; i += SUMMATION_LANES) {
+        for (size_t l = 0; l < SUMMATION_LANES; ++l) {
+            lanes[l] += termScalar<DOT, false>(x, y, i + l, n);
+        }
+    }
+    return foldScalar<false>(lanes);
+}
+
+// the block sums of a chunk combined as a binary counter: block k merges
+// once for every trailing zero bit of k, which builds the tree left to
+// right without recursion
+template <SubnormalMode S, ReduceKernel BLOCK>
+static float pairwise(const BFloat16* x, const BFloat16* y, size_t n) {
+    float stack[64];
+    size_t top = 0;
+    size_t count = 1;
+    for (size_t i = 0; i < n; i += SUMMATION_BLOCK, ++count) {
+        stack[top++] = BLOCK(x + i, y + i, std::min(SUMMATION_BLOCK, n - i));
+        for (size_t m = count; (m & 1) == 0; m >>= 1) {
+            --top;
+            stack[top - 1] = roundBF16<S>(stack[top - 1] + stack[top]);
+        }
+    }
+    while (top > 1) {
+        --top;
+        stack[top - 1] = roundBF16<S>(stack[top - 1] + stack[top]);
+    }
+    return top ? stack[0] : 0.0f;
+}
+
+#ifdef BF16_X86
+
+// avx2: the 16 lanes are two registers, lanes 0-7 and 8-15
+
+// a zero exponent field keeps only the sign
+template <SubnormalMode S>
+__attribute__((target("avx2,fma")))
+static inline __m256i flushBF16x8(__m256i bits) {
+    if (S == SubnormalMode::Preserve) return bits;
+    __m256i tiny = _mm256_cmpeq_epi32(_mm256_and_si256(bits, _mm256_set1_epi32(0x7F800000)), _mm256_setzero_si256());
+    return _mm256_andnot_si256(_mm256_and_si256(tiny, _mm256_set1_epi32(0x7FFFFFFF)), bits);
+}
+
+template <SubnormalMode S>
+__attribute__((target("avx2,fma")))
+static inline __m128i flushBF16x4(__m128i bits) {
+    if (S == SubnormalMode::Preserve) return bits;
+    __m128i tiny = _mm_cmpeq_epi32(_mm_and_si128(bits, _mm_set1_epi32(0x7F800000)), _mm_setzero_si128());
+    return _mm_andnot_si128(_mm_and_si128(tiny, _mm_set1_epi32(0x7FFFFFFF)), bits);
+}
+
+template <SubnormalMode S>
+__attribute__((target("avx2,fma")))
+static inline __m256 roundBF16x8(__m256 v) {
+    __m256i bits = _mm256_castps_si256(v);
+    __m256i lsb = _mm256_and_si256(_mm256_srli_epi32(bits, 16), _mm256_set1_epi32(1));
+    bits = _mm256_add_epi32(bits, _mm256_add_epi32(lsb, _mm256_set1_epi32(0x7FFF)));
+    bits = _mm256_and_si256(bits, _mm256_set1_epi32(static_cast<int>(0xFFFF0000u)));
+    return _mm256_castsi256_ps(flushBF16x8<S>(bits));
+}
+
+template <SubnormalMode S>
+__attribute__((target("avx2,fma")))
+static inline __m128 roundBF16x4(__m128 v) {
+    __m128i bits = _mm_castps_si128(v);
+    __m128i lsb = _mm_and_si128(_mm_srli_epi32(bits, 16), _mm_set1_epi32(1));
+    bits = _mm_add_epi32(bits, _mm_add_epi32(lsb, _mm_set1_epi32(0x7FFF)));
+    bits = _mm_and_si128(bits, _mm_set1_epi32(static_cast<int>(0xFFFF0000u)));
+    return _mm_castsi128_ps(flushBF16x4<S>(bits));
+}
+
+// 8 elements from i, zero past n
+template <SubnormalMode S>
+__attribute__((target("avx2,fma")))
+static inline __m256 loadBF16x8(const BFloat16* p, size_t i, size_t n) {
+    __m128i h;
+    if (i + 8 <= n) {
+        h = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i));
+    } else {
+        uint16_t tail[8] = {};
+        if (i < n) std::memcpy(tail, p + i, (n - i) * sizeof(BFloat16));
+        h = _mm_loadu_si128(reinterpret_cast<const __m128i*>(tail));
+    }
+    return _mm256_castsi256_ps(flushBF16x8<S>(_mm256_slli_epi32(_mm256_cvtepu16_epi32(h), 16)));
+}
+
+template <bool DOT, bool ROUND, SubnormalMode S = SubnormalMode::Preserve>
+__attribute__((target("avx2,fma")))
+static inline __m256 termAVX2(const BFloat16* x, const BFloat16* y, size_t i, size_t n) {
+    __m256 v = loadBF16x8<S>(x, i, n);
+    if (!DOT) return v;
+    v = _mm256_mul_ps(v, loadBF16x8<S>(y, i, n));
+    return ROUND ? roundBF16x8<S>(v) : v;
+}
+
+// the foldScalar tree: 0-7 + 8-15, then 0-3 + 4-7, 0-1 + 2-3, 0 + 1
+template <bool ROUND, SubnormalMode S = SubnormalMode::Preserve>
+__attribute__((target("avx2,fma")))
+static inline float foldAVX2(__m256 lo, __m256 hi) {
+    __m256 v = _mm256_add_ps(lo, hi);
+    if (ROUND) v = roundBF16x8<S>(v);
+    __m128 h = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+    if (ROUND) h = roundBF16x4<S>(h);
+    h = _mm_add_ps(h, _mm_movehl_ps(h, h));
+    if (ROUND) h = roundBF16x4<S>(h);
+    h = _mm_add_ss(h, _mm_movehdup_ps(h));
+    if (ROUND) h = roundBF16x4<S>(h);
+    return _mm_cvtss_f32(h);
+}
+
+template <SubnormalMode S, bool DOT>
+__attribute__((target("avx2,fma")))
+static float pairwiseBlockAVX2(const BFloat16* x, const BFloat16* y, size_t n) {
+    __m256 acc[2] = {_mm256_setzero_ps(), _mm256_setzero_ps()};
+    for (size_t i = 0; i < n; i += SUMMATION_LANES) {
+        for (size_t h = 0; h < 2; ++h) {
+            acc[h] = roundBF16x8<S>(_mm256_add_ps(acc[h], termAVX2<DOT, true, S>(x, y, i + 8 * h, n)));
+        }
+    }
+    return foldAVX2<true, S>(acc[0], acc[1]);
+}
+
+template <SubnormalMode S, bool DOT>
+__attribute__((target("avx2,fma")))
+static float kahanAVX2(const BFloat16* x, const BFloat16* y, size_t n) {
+    __m256 sum[2] = {_mm256_setzero_ps(), _mm256_setzero_ps()};
+    __m256 compensation[2] = {_mm256_setzero_ps(), _mm256_setzero_ps()};
+    for (size_t i = 0; i < n; i += SUMMATION_LANES) {
+        for (size_t h = 0; h < 2; ++h) {
+            __m256 corrected = roundBF16x8<S>(_mm256_sub_ps(termAVX2<DOT, true, S>(x, y, i + 8 * h, n), compensation[h]));
+            __m256 t = roundBF16x8<S>(_mm256_add_ps(sum[h], corrected));
+            compensation[h] = roundBF16x8<S>(_mm256_sub_ps(roundBF16x8<S>(_mm256_sub_ps(t, sum[h])), corrected));
+            sum[h] = t;
+        }
+    }
+    return foldAVX2<false>(_mm256_sub_ps(sum[0], compensation[0]), _mm256_sub_ps(sum[1], compensation[1]));
+}
+
+template <SubnormalMode S, bool DOT>
+__attribute__((target("avx2,fma")))
+static float neumaierAVX2(const BFloat16* x, const BFloat16* y, size_t n) {
+    const __m256 magnitude = _mm256_castsi256_ps(_mm256_set1_epi32(0x7FFFFFFF));
+    __m256 sum[2] = {_mm256_setzero_ps(), _mm256_setzero_ps()};
+    __m256 compensation[2] = {_mm256_setzero_ps(), _mm256_setzero_ps()};
+    for (size_t i = 0; i < n; i += SUMMATION_LANES) {
+        for (size_t h = 0; h < 2; ++h) {
+            __m256 v = termAVX2<DOT, true, S>(x, y, i + 8 * h, n);
+            __m256 t = roundBF16x8<S>(_mm256_add_ps(sum[h], v));
+            __m256 sum_larger = _mm256_cmp_ps(_mm256_and_ps(sum[h], magnitude), _mm256_and_ps(v, magnitude), _CMP_GE_OQ);
+            __m256 from_sum = roundBF16x8<S>(_mm256_add_ps(roundBF16x8<S>(_mm256_sub_ps(sum[h], t)), v));
+            __m256 from_term = roundBF16x8<S>(_mm256_add_ps(roundBF16x8<S>(_mm256_sub_ps(v, t)), sum[h]));
+            compensation[h] = _mm256_add_ps(compensation[h], _mm256_blendv_ps(from_term, from_sum, sum_larger));
+            sum[h] = t;
+        }
+    }
+    return foldAVX2<false>(_mm256_add_ps(sum[0], compensation[0]), _mm256_add_ps(sum[1], compensation[1]));
+}
+
+template <bool DOT>
+__attribute__((target("avx2,fma")))
+static float widenedAVX2(const BFloat16* x, const BFloat16* y, size_t n) {
+    __m256 acc[2] = {_mm256_setzero_ps(), _mm256_setzero_ps()};
+    for (size_t i = 0; i < n; i += SUMMATION_LANES) {
+        for (size_t h = 0; h < 2; ++h) {
+            acc[h] = _mm256_add_ps(acc[h], termAVX2<DOT, false>(x, y, i + 8 * h, n));
+        }
+    }
+    return foldAVX2<false>(acc[0], acc[1]);
+}
+
+// gcc 12 flags the _mm512_undefined_* placeholders inside its own headers
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#pragma GCC diagnostic ignored "-Wuninitialized"
+#endif
+
+// avx512: one register holds all 16 lanes, the tail is a masked load
+
+template <SubnormalMode S>
+__attribute__((target("avx512f,avx512bw,avx512vl")))
+static inline __m512i flushBF16x16(__m512i bits) {
+    if (S == SubnormalMode::Preserve) return bits;
+    __mmask16 tiny = _mm512_testn_epi32_mask(bits, _mm512_set1_epi32(0x7F800000));
+    return _mm512_mask_and_epi32(bits, tiny, bits, _mm512_set1_epi32(static_cast<int>(0x80000000u)));
+}
+
+template <SubnormalMode S>
+__attribute__((target("avx512f,avx512bw,avx512vl")))
+static inline __m512 roundBF16x16(__m512 v) {
+    __m512i bits = _mm512_castps_si512(v);
+    __m512i lsb = _mm512_and_si512(_mm512_srli_epi32(bits, 16), _mm512_set1_epi32(1));
+    bits = _mm512_add_epi32(bits, _mm512_add_epi32(lsb, _mm512_set1_epi32(0x7FFF)));
+    bits = _mm512_and_si512(bits, _mm512_set1_epi32(static_cast<int>(0xFFFF0000u)));
+    return _mm512_castsi512_ps(flushBF16x16<S>(bits));
+}
+
+template <SubnormalMode S>
+__attribute__((target("avx512f,avx512bw,avx512vl")))
+static inline __m512 loadBF16x16(const BFloat16* p, __mmask16 k) {
+    __m256i h = _mm256_maskz_loadu_epi16(k, p);
+    return _mm512_castsi512_ps(flushBF16x16<S>(_mm512_slli_epi32(_mm512_cvtepu16_epi32(h), 16)));
+}
+
+template <bool DOT, bool ROUND, SubnormalMode S = SubnormalMode::Preserve>
+__attribute__((target("avx512f,avx512bw,avx512vl")))
+static inline __m512 termAVX512(const BFloat16* x, const BFloat16* y, size_t i, size_t n) {
+    __mmask16 k = n - i >= 16 ? static_cast<__mmask16>(0xFFFF) : static_cast<__mmask16>((1u << (n - i)) - 1);
+    __m512 v = loadBF16x16<S>(x + i, k);
+    if (!DOT) return v;
+    v = _mm512_mul_ps(v, loadBF16x16<S>(y + i, k));
+    return ROUND ? roundBF16x16<S>(v) : v;
+}
+
+template <bool ROUND, SubnormalMode S = SubnormalMode::Preserve>
+__attribute__((target("avx512f,avx512bw,avx512vl")))
+static inline float foldAVX512(__m512 v) {
+    __m256 hi = _mm256_castpd_ps(_mm512_extractf64x4_pd(_mm512_castps_pd(v), 1));
+    return foldAVX2<ROUND, S>(_mm512_castps512_ps256(v), hi);
+}
+
+template <SubnormalMode S, bool DOT>
+__attribute__((target("avx512f,avx512bw,avx512vl")))
+static float pairwiseBlockAVX512(const BFloat16* x, const BFloat16* y, size_t n) {
+    __m512 acc = _mm512_setzero_ps();
+    for (size_t i = 0; i < n; i += SUMMATION_LANES) {
+        acc = roundBF16x16<S>(_mm512_add_ps(acc, termAVX512<DOT, true, S>(x, y, i, n)));
+    }
+    return foldAVX512<true, S>(acc);
+}
+
+template <SubnormalMode S, bool DOT>
+__attribute__((target("avx512f,avx512bw,avx512vl")))
+static float kahanAVX512(const BFloat16* x, const BFloat16* y, size_t n) {
+    __m512 sum = _mm512_setzero_ps();
+    __m512 compensation = _mm512_setzero_ps();
+    for (size_t i = 0; i < n; i += SUMMATION_LANES) {
+        __m512 corrected = roundBF16x16<S>(_mm512_sub_ps(termAVX512<DOT, true, S>(x, y, i, n), compensation));
+        __m512 t = roundBF16x16<S>(_mm512_add_ps(sum, corrected));
+        compensation = roundBF16x16<S>(_mm512_sub_ps(roundBF16x16<S>(_mm512_sub_ps(t, sum)), corrected));
+        sum = t;
+    }
+    return foldAVX512<false>(_mm512_sub_ps(sum, compensation));
+}
+
+template <SubnormalMode S, bool DOT>
+__attribute__((target("avx512f,avx512bw,avx512vl")))
+static float neumaierAVX512(const BFloat16* x, const BFloat16* y, size_t n) {
+    __m512 sum = _mm512_setzero_ps();
+    __m512 compensation = _mm512_setzero_ps();
+    for (size_t i = 0; i < n; i += SUMMATION_LANES) {
+        __m512 v = termAVX512<DOT, true, S>(x, y, i, n);
+        __m512 t = roundBF16x16<S>(_mm512_add_ps(sum, v));
+        __mmask16 sum_larger = _mm512_cmp_ps_mask(_mm512_abs_ps(sum), _mm512_abs_ps(v), _CMP_GE_OQ);
+        __m512 from_sum = roundBF16x16<S>(_mm512_add_ps(roundBF16x16<S>(_mm512_sub_ps(sum, t)), v));
+        __m512 from_term = roundBF16x16<S>(_mm512_add_ps(roundBF16x16<S>(_mm512_sub_ps(v, t)), sum));
+        compensation = _mm512_add_ps(compensation, _mm512_mask_blend_ps(sum_larger, from_term, from_sum));
+        sum = t;
+    }
+    return foldAVX512<false>(_mm512_add_ps(sum, compensation));
+}
+
+template <bool DOT>
+__attribute__((target("avx512f,avx512bw,avx512vl")))
+static float widenedAVX512(const BFloat16* x, const BFloat16* y, size_t n) {
+    __m512 acc = _mm512_setzero_ps();
+    for (size_t i = 0; i < n; i += SUMMATION_LANES) {
+        acc = _mm512_add_ps(acc, termAVX512<DOT, false>(x, y, i, n));
+    }
+    return foldAVX512<false>(acc);
+}
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+#endif // BF16_X86
+
+// dispatch, neon stays on the scalar kernels
+
+template <SubnormalMode S, bool DOT>
+static ReduceKernel reduceKernel(Summation method, SimdLevel level) {
+    if (!simdLevelSupported(level)) level = SimdLevel::Scalar;
+
+    switch (level) {
+#ifdef BF16_X86
+    case SimdLevel::AVX2:
+        switch (method) {
+        case Summation::Pairwise: return pairwise<S, pairwiseBlockAVX2<S, DOT>>;
+        case Summation::Kahan:    return kahanAVX2<S, DOT>;
+        case Summation::Neumaier: return neumaierAVX2<S, DOT>;
+        default:                  return widenedAVX2<DOT>;
+        }
+    case SimdLevel::AVX512:
+    case SimdLevel::AVX512BF16:
+        switch (method) {
+        case Summation::Pairwise: return pairwise<S, pairwiseBlockAVX512<S, DOT>>;
+        case Summation::Kahan:    return kahanAVX512<S, DOT>;
+        case Summation::Neumaier: return neumaierAVX512<S, DOT>;
+        default:                  return widenedAVX512<DOT>;
+        }
+#endif
+    default:
+        switch (method) {
+        case Summation::Pairwise: return pairwise<S, pairwiseBlockScalar<S, DOT>>;
+        case Summation::Kahan:    return kahanScalar<S, DOT>;
+        case Summation::Neumaier: return neumaierScalar<S, DOT>;
+        default:                  return widenedScalar<DOT>;
+        }
+    }
+}
+
+template <bool DOT>
+static float reduce(Summation method, SimdLevel level, const BFloat16* x, const BFloat16* y, size_t n) {
+    // read here, the pool threads have their own
+    SubnormalMode mode = subnormalMode();
+
+    // one pass on the calling thread, the same bits as an operator+= loop
+    if (method == Summation::Naive) {
+        return withSubnormalMode(mode, [&](auto sm) { return naive<decltype(sm)::value, DOT>(x, y, n); });
+    }
+
+    ReduceKernel kernel =
+        withSubnormalMode(mode, [&](auto sm) { return reduceKernel<decltype(sm)::value, DOT>(method, level); });
+    // a single chunk skips the partials vector, same bits
+    if (n <= REDUCE_GRAIN) {
+        return 0.0f + kernel(x, y, n);
+    }
+    return parallelReduce(n, REDUCE_GRAIN, 0.0f,
+                          [=](size_t begin, size_t end) { return kernel(x + begin, y + begin, end - begin); },
+                          [](float a, float b) { return a + b; });
+}
+
+// public entry points
+
+float sum(const BFloat16* x, size_t n, Summation method, SimdLevel level) {
+    return reduce<false>(method, level, x, x, n);
+}
+
+float dot(const BFloat16* x, const BFloat16* y, size_t n, Summation method, SimdLevel level) {
+    return reduce<true>(method, level, x, y, n);
+}
+
+float sum(const BFloat16* x, size_t n, Summation method) {
+    return sum(x, n, method, detectSimdLevel());
+}
+
+float mean(const BFloat16* x, size_t n, Summation method) {
+    if (n == 0) return std::numeric_limits<float>::quiet_NaN();
+    return static_cast<float>(static_cast<double>(sum(x, n, method)) / static_cast<double>(n));
+}
+
+float norm2(const BFloat16* x, size_t n, Summation method) {
+    return std::sqrt(dot(x, x, n, method, detectSimdLevel()));
+}
+
+float dot(const BFloat16* x, const BFloat16* y, size_t n, Summation method) {
+    return dot(x, y, n, method, detectSimdLevel());
+}
@@ -0,0 +1,340 @@
+#include "BF16Solve.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+
+static void checkArguments(size_t n, size_t lda, size_t block) {
+    if (block == 0) throw std::invalid_argument("factorization block must be positive");
+    if (lda < n) throw std::invalid_argument("leading dimension below the matrix size");
+}
+
+// C -= L U, L m x k, U k x n. the bf16 path rounds both panels first, into
+// the caller's buffers
+static void trailingUpdate(const FactorOptions& options, size_t m, size_t n, size_t k,
+                           const float* L, size_t ldl, const float* U, size_t ldu, float* C, size_t ldc,
+                           std::vector<BFloat16>& l_panel, std::vector<BFloat16>& u_panel) {
+    if (m == 0 || n == 0 || k == 0) return;
+
+    if (options.precision == FactorPrecision::FP32) {
+        gemm(m, n, k, -1.0f, L, ldl, U, ldu, 1.0f, C, ldc);
+        return;
+    }
+
+    l_panel.resize(m * k);
+    u_panel.resize(k * n);
+    for (size_t i = 0; i < m; ++i) convertToBF16(L + i * ldl, l_panel.data() + i * k, k);
+    for (size_t p = 0; p < k; ++p) convertToBF16(U + p * ldu, u_panel.data() + p * n, n);
+    gemm(m, n, k, -1.0f, l_panel.data(), k, u_panel.data(), n, 1.0f, C, ldc, options.mode);
+}
+
+// the bf16 factorizations start from A rounded to BFloat16
+static void roundInput(const FactorOptions& options, size_t n, float* A, size_t lda) {
+    if (options.precision != FactorPrecision::BF16) return;
+
+    std::vector<BFloat16> row(n);
+    for (size_t i = 0; i < n; ++i) {
+        convertToBF16(A + i * lda, row.data(), n);
+        convertToFloat(row.data(), A + i * lda, n);
+    }
+}
+
+// the panels are blocked again by IB in float, so only O(n^2 IB) of the
+// work is outside gemm
+static const size_t IB = 16;
+
+// rows r0..r1 of columns c0..c1 = L^-1 of them, L the unit lower triangle
+// of rows and columns r0..r1
+static void lowerSolve(float* A, size_t lda, size_t r0, size_t r1, size_t c0, size_t c1) {
+    for (size_t s0 = r0; s0 < r1; s0 += IB) {
+        size_t s1 = std::min(s0 + IB, r1);
+        for (size_t j = s0; j < s1; ++j) {
+            const float* pivot_row = A + j * lda;
+            for (size_t i = j + 1; i < s1; ++i) {
+                float* row = A + i * lda;
+                float l = row[j];
+                for (size_t c = c0; c < c1; ++c) row[c] -= l * pivot_row[c];
+            }
+        }
+        gemm(r1 - s1, c1 - c0, s1 - s0, -1.0f, A + s1 * lda + s0, lda, A + s0 * lda + c0, lda,
+             1.0f, A + s1 * lda + c0, lda);
+    }
+}
+
+// columns c0..c1 over rows c0..n, partial pivoting with whole rows swapped
+static bool panelLU(size_t n, float* A, size_t lda, size_t c0, size_t c1, size_t* pivots) {
+    for (size_t j0 = c0; j0 < c1; j0 += IB) {
+        size_t j1 = std::min(j0 + IB, c1);
+        for (size_t j = j0; j < j1; ++j) {
+            size_t p = j;
+            for (size_t i = j + 1; i < n; ++i) {
+                if (std::fabs(A[i * lda + j]) > std::fabs(A[p * lda + j])) p = i;
+            }
+            pivots[j] = p;
+            if (A[p * lda + j] == 0.0f) return false;
+            if (p != j) std::swap_ranges(A + j * lda, A + j * lda + n, A + p * lda);
+
+            float inverse = 1.0f / A[j * lda + j];
+            const float* pivot_row = A + j * lda;
+            for (size_t i = j + 1; i < n; ++i) {
+                float* row = A + i * lda;
+                float l = row[j] *= inverse;
+                for (size_t c = j + 1; c < j1; ++c) row[c] -= l * pivot_row[c];
+            }
+        }
+        lowerSolve(A, lda, j0, j1, j1, c1);
+        gemm(n - j1, c1 - j1, j1 - j0, -1.0f, A + j1 * lda + j0, lda, A + j0 * lda + j1, lda,
+             1.0f, A + j1 * lda + j1, lda);
+    }
+    return true;
+}
+
+bool factorLU(size_t n, float* A, size_t lda, size_t* pivots, const FactorOptions& options) {
+    checkArguments(n, lda, options.block);
+    roundInput(options, n, A, lda);
+
+    // reused across panels, the largest is the first
+    std::vector<BFloat16> l_panel, u_panel;
+    for (size_t k0 = 0; k0 < n; k0 += options.block) {
+        size_t k1 = std::min(k0 + options.block, n);
+        if (!panelLU(n, A, lda, k0, k1, pivots)) return false;
+        lowerSolve(A, lda, k0, k1, k1, n);   // U12
+        trailingUpdate(options, n - k1, n - k1, k1 - k0, A + k1 * lda + k0, lda, A + k0 * lda + k1, lda,
+                       A + k1 * lda + k1, lda, l_panel, u_panel);
+    }
+    return true;
+}
+
+// rows r0..n of columns c0..c1 transposed into out, c1 - c0 rows of n - r0
+static void transpose(const float* A, size_t lda, size_t n, size_t r0, size_t c0, size_t c1,
+                      std::vector<float>& out) {
+    size_t rows = n - r0;
+    out.resize((c1 - c0) * rows);
+    for (size_t i = 0; i < rows; ++i) {
+        for (size_t p = c0; p < c1; ++p) out[(p - c0) * rows + i] = A[(r0 + i) * lda + p];
+    }
+}
+
+// columns c0..c1 of L over rows c0..n. the earlier columns are already
+// subtracted by their updates
+static bool panelCholesky(size_t n, float* A, size_t lda, size_t c0, size_t c1, std::vector<float>& scratch) {
+    for (size_t j0 = c0; j0 < c1; j0 += IB) {
+        size_t j1 = std::min(j0 + IB, c1);
+        for (size_t j = j0; j < j1; ++j) {
+            const float* lj = A + j * lda;
+            float d = lj[j];
+            for (size_t p = j0; p < j; ++p) d -= lj[p] * lj[p];
+            if (!(d > 0.0f)) return false;
+            float diagonal = std::sqrt(d);
+            A[j * lda + j] = diagonal;
+
+            for (size_t i = j + 1; i < n; ++i) {
+                float* li = A + i * lda;
+                float s = li[j];
+                for (size_t p = j0; p < j; ++p) s -= li[p] * lj[p];
+                li[j] = s / diagonal;
+            }
+        }
+        if (j1 == c1) break;
+        // the rest of the panel, rows j1..n of columns j1..c1
+        transpose(A, lda, c1, j1, j0, j1, scratch);
+        gemm(n - j1, c1 - j1, j1 - j0, -1.0f, A + j1 * lda + j0, lda, scratch.data(), c1 - j1,
+             1.0f, A + j1 * lda + j1, lda);
+    }
+    return true;
+}
+
+static void gemmUpdate(const FactorOptions&, size_t m, size_t n, size_t k, const float* A, size_t lda,
+                       const float* B, size_t ldb, float* C, size_t ldc) {
+    gemm(m, n, k, -1.0f, A, lda, B, ldb, 1.0f, C, ldc);
+}
+
+static void gemmUpdate(const FactorOptions& options, size_t m, size_t n, size_t k, const BFloat16* A, size_t lda,
+                       const BFloat16* B, size_t ldb, float* C, size_t ldc) {
+    gemm(m, n, k, -1.0f, A, lda, B, ldb, 1.0f, C, ldc, options.mode);
+}
+
+// the lower block triangle of the m x m C -= L L^T, L m x k and lt its
+// transpose with m columns
+template <typename T>
+static void choleskyUpdate(const FactorOptions& options, size_t m, size_t k, size_t block, const T* L, size_t ldl,
+                           const T* lt, float* C, size_t ldc) {
+    for (size_t j0 = 0; j0 < m; j0 += block) {
+        size_t width = std::min(block, m - j0);
+        gemmUpdate(options, m - j0, width, k, L + j0 * ldl, ldl, lt + j0, m, C + j0 * ldc + j0, ldc);
+    }
+}
+
+bool factorCholesky(size_t n, float* A, size_t lda, const FactorOptions& options) {
+    checkArguments(n, lda, options.block);
+    roundInput(options, n, A, lda);
+
+    std::vector<float> transposed, scratch;
+    std::vector<BFloat16> panel, panel_t;
+    for (size_t k0 = 0; k0 < n; k0 += options.block) {
+        size_t k1 = std::min(k0 + options.block, n);
+        if (!panelCholesky(n, A, lda, k0, k1, scratch)) return false;
+
+        // A22 -= L21 L21^T, one block column of the lower triangle at a
+        // time, from its diagonal block down
+        size_t rest = n - k1, kb = k1 - k0;
+        if (rest == 0) break;
+        transpose(A, lda, n, k1, k0, k1, transposed);
+        if (options.precision == FactorPrecision::FP32) {
+            choleskyUpdate(options, rest, kb, options.block, A + k1 * lda + k0, lda, transposed.data(),
+                           A + k1 * lda + k1, lda);
+            continue;
+        }
+        // both panels rounded once for all the block columns
+        panel.resize(rest * kb);
+        panel_t.resize(kb * rest);
+        for (size_t i = 0; i < rest; ++i) convertToBF16(A + (k1 + i) * lda + k0, panel.data() + i * kb, kb);
+        convertToBF16(transposed.data(), panel_t.data(), kb * rest);
+        choleskyUpdate(options, rest, kb, options.block, panel.data(), kb, panel_t.data(), A + k1 * lda + k1, lda);
+    }
+    return true;
+}
+
+
+void solveLU(size_t n, const float* LU, size_t lda, const size_t* pivots, float* x) {
+    for (size_t i = 0; i < n; ++i) {
+        if (pivots[i] != i) std::swap(x[i], x[pivots[i]]);
+    }
+    for (size_t i = 0; i < n; ++i) {
+        const float* row = LU + i * lda;
+        float s = x[i];
+        for (size_t j = 0; j < i; ++j) s -= row[j] * x[j];
+        x[i] = s;
+    }
+    for (size_t i = n; i-- > 0;) {
+        const float* row = LU + i * lda;
+        float s = x[i];
+        for (size_t j = i + 1; j < n; ++j) s -= row[j] * x[j];
+        x[i] = s / row[i];
+    }
+}
+
+void solveCholesky(size_t n, const float* L, size_t lda, float* x) {
+    for (size_t i = 0; i < n; ++i) {
+        const float* row = L + i * lda;
+        float s = x[i];
+        for (size_t j = 0; j < i; ++j) s -= row[j] * x[j];
+        x[i] = s / row[i];
+    }
+    // L^T by rows of L, each solved element is subtracted from the ones above
+    for (size_t i = n; i-- > 0;) {
+        const float* row = L + i * lda;
+        x[i] /= row[i];
+        for (size_t j = 0; j < i; ++j) x[j] -= row[j] * x[i];
+    }
+}
+
+static double seconds(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// the refinement loop in the residual precision T, A in T too. fp64 reads
+// the caller's matrix, fp32 a rounded copy
+template <typename T>
+static void refine(size_t n, const T* A, size_t lda, const double* b, double* x_out,
+                   const RefinementOptions& options, const float* factors, const std::vector<size_t>& pivots,
+                   RefinementResult& result) {
+    auto solve = [&](float* v) {
+        if (options.factorization == Factorization::LU) {
+            solveLU(n, factors, n, pivots.data(), v);
+        } else {
+            solveCholesky(n, factors, n, v);
+        }
+    };
+
+    double norm_a = 0, norm_b = 0;
+    for (size_t i = 0; i < n; ++i) {
+        double row = 0;
+        for (size_t j = 0; j < n; ++j) {
+            row += std::fabs(static_cast<double>(A[i * lda + j]));
+        }
+        norm_a = std::max(norm_a, row);
+        norm_b = std::max(norm_b, std::fabs(static_cast<double>(static_cast<T>(b[i]))));
+    }
+
+    double unit = std::numeric_limits<T>::epsilon() / 2;
+    double tolerance = options.tolerance > 0 ? options.tolerance : std::sqrt(static_cast<double>(n)) * unit;
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<float> d(n);
+    std::vector<T> x(n), r(n), previous;
+    for (size_t i = 0; i < n; ++i) d[i] = static_cast<float>(b[i]);
+    solve(d.data());
+    for (size_t i = 0; i < n; ++i) x[i] = static_cast<T>(d[i]);
+    result.factor_seconds += seconds(start);
+
+    start = std::chrono::steady_clock::now();
+    for (;;) {
+        double norm_r = 0, norm_x = 0;
+        for (size_t i = 0; i < n; ++i) {
+            const T* row = A + i * lda;
+            T s = static_cast<T>(b[i]);
+            for (size_t j = 0; j < n; ++j) s -= row[j] * x[j];
+            r[i] = s;
+            norm_r = std::max(norm_r, std::fabs(static_cast<double>(s)));
+            norm_x = std::max(norm_x, std::fabs(static_cast<double>(x[i])));
+        }
+        double denominator = norm_a * norm_x + norm_b;
+        double error = denominator > 0 ? norm_r / denominator : 0;
+        // nan never compares, so a blown up solve also stops
+        bool shrinking = result.history.empty() || error < result.history.back();
+        result.history.push_back(error);
+
+        if (error <= tolerance) {
+            result.converged = true;
+            break;
+        }
+        if (!shrinking) {
+            // the last correction made things worse, it is not kept
+            x.swap(previous);
+            --result.iterations;
+            break;
+        }
+        if (result.iterations == options.max_iterations) break;
+
+        previous = x;
+        for (size_t i = 0; i < n; ++i) d[i] = static_cast<float>(r[i]);
+        solve(d.data());
+        for (size_t i = 0; i < n; ++i) x[i] += static_cast<T>(d[i]);
+        ++result.iterations;
+    }
+    result.refine_seconds = seconds(start);
+
+    result.backward_error = result.history[result.iterations];
+    for (size_t i = 0; i < n; ++i) x_out[i] = static_cast<double>(x[i]);
+}
+
+RefinementResult solveRefined(size_t n, const double* A, size_t lda, const double* b, double* x,
+                              const RefinementOptions& options) {
+    checkArguments(n, lda, options.factor.block);
+
+    RefinementResult result;
+    auto start = std::chrono::steady_clock::now();
+    std::vector<float> factors(n * n);
+    for (size_t i = 0; i < n; ++i) {
+        for (size_t j = 0; j < n; ++j) factors[i * n + j] = static_cast<float>(A[i * lda + j]);
+    }
+    std::vector<float> rounded;
+    if (options.residual == ResidualPrecision::FP32) rounded = factors;
+
+    std::vector<size_t> pivots(n);
+    result.factored = options.factorization == Factorization::LU
+                          ? factorLU(n, factors.data(), n, pivots.data(), options.factor)
+                          : factorCholesky(n, factors.data(), n, options.factor);
+    result.factor_seconds = seconds(start);
+    if (!result.factored) return result;
+
+    if (options.residual == ResidualPrecision::FP64) {
+        refine(n, A, lda, b, x, options, factors.data(), pivots, result);
+    } else {
+        refine(n, rounded.data(), n, b, x, options, factors.data(), pivots, result);
+    }
+    return result;
+}
@@ -0,0 +1,166 @@
+#include "BF16Solve.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+// mixed-precision iterative refinement across a sweep of condition
+// numbers: the bf16 factorizations (Native and HardwareDot gemm) against
+// the fp32 one, each refined to the residual precision. prints the
+// corrections to convergence, factorization time and time per iteration
+// usage: bench_bf16_solve [n] [fp64|fp32]   (default 1024, fp64 residuals)
+//
+// the matrices follow utils/matrix_generators.py: conditioned_matrix is
+// U diag(sigma) V^T with sigma geometric from 1 to 1 / kappa, here with U
+// and V products of two random householder reflections rather than a qr
+// of a gaussian matrix, and the spd ones U diag(sigma) U^T. hilbert_matrix
+// is 1 / (i + j + 1)
+
+using Matrix = std::vector<double>;
+
+// A = (I - 2 v v^T) A from the left, or A (I - 2 v v^T) from the right
+static void reflect(size_t n, Matrix& A, const std::vector<double>& v, bool left) {
+    std::vector<double> w(n, 0.0);
+    for (size_t i = 0; i < n; ++i) {
+        for (size_t j = 0; j < n; ++j) {
+            if (left) {
+                w[j] += v[i] * A[i * n + j];
+            } else {
+                w[i] += A[i * n + j] * v[j];
+            }
+        }
+    }
+    for (size_t i = 0; i < n; ++i) {
+        for (size_t j = 0; j < n; ++j) {
+            A[i * n + j] -= left ? 2 * v[i] * w[j] : 2 * w[i] * v[j];
+        }
+    }
+}
+
+static std::vector<double> unitVector(size_t n, std::mt19937_64& rng) {
+    std::normal_distribution<double> normal;
+    std::vector<double> v(n);
+    double norm = 0;
+    for (double& x : v) {
+        x = normal(rng);
+        norm += x * x;
+    }
+    for (double& x : v) x /= std::sqrt(norm);
+    return v;
+}
+
+static Matrix conditioned(size_t n, double kappa, bool symmetric, std::mt19937_64& rng) {
+    Matrix A(n * n, 0.0);
+    for (size_t i = 0; i < n; ++i) {
+        A[i * n + i] = n > 1 ? std::pow(kappa, -static_cast<double>(i) / (n - 1)) : 1.0;
+    }
+    for (int k = 0; k < 2; ++k) {
+        std::vector<double> u = unitVector(n, rng);
+        reflect(n, A, u, true);
+        reflect(n, A, symmetric ? u : unitVector(n, rng), false);
+    }
+    if (symmetric) {
+        // the reflections leave it symmetric up to rounding, make it exact
+        for (size_t i = 0; i < n; ++i) {
+            for (size_t j = 0; j < i; ++j) A[j * n + i] = A[i * n + j];
+        }
+    }
+    return A;
+}
+
+static Matrix hilbert(size_t n) {
+    Matrix A(n * n);
+    for (size_t i = 0; i < n; ++i) {
+        for (size_t j = 0; j < n; ++j) A[i * n + j] = 1.0 / static_cast<double>(i + j + 1);
+    }
+    return A;
+}
+
+struct Config {
+    const char* name;
+    FactorPrecision precision;
+    LinalgMode mode;
+};
+
+static const Config CONFIGS[] = {
+    {"fp32", FactorPrecision::FP32, LinalgMode::Native},
+    {"bf16", FactorPrecision::BF16, LinalgMode::Native},
+    {"bf16 hw", FactorPrecision::BF16, LinalgMode::HardwareDot},
+};
+
+static void run(const std::string& name, size_t n, const Matrix& A, Factorization factorization,
+                ResidualPrecision residual, std::mt19937_64& rng) {
+    std::normal_distribution<double> normal;
+    std::vector<double> x_true(n), b(n, 0.0), x(n);
+    for (double& v : x_true) v = normal(rng);
+    for (size_t i = 0; i < n; ++i) {
+        for (size_t j = 0; j < n; ++j) b[i] += A[i * n + j] * x_true[j];
+    }
+
+    double baseline = 0;
+    for (const Config& config : CONFIGS) {
+        RefinementOptions options;
+        options.factorization = factorization;
+        options.residual = residual;
+        options.factor.precision = config.precision;
+        options.factor.mode = config.mode;
+        RefinementResult result = solveRefined(n, A.data(), n, b.data(), x.data(), options);
+
+        std::cout << std::left << std::setw(22) << name << std::setw(10) << config.name << std::right;
+        if (!result.factored) {
+            std::cout << "   factorization broke down" << std::endl;
+            continue;
+        }
+
+        double error = 0, reference = 0;
+        for (size_t i = 0; i < n; ++i) {
+            error = std::max(error, std::fabs(x[i] - x_true[i]));
+            reference = std::max(reference, std::fabs(x_true[i]));
+        }
+        if (config.precision == FactorPrecision::FP32) baseline = result.factor_seconds;
+
+        std::cout << std::setw(7) << result.iterations << std::setw(6) << (result.converged ? "yes" : "no")
+                  << std::fixed << std::setprecision(4)
+                  << std::setw(11) << result.factor_seconds
+                  << std::setw(8) << std::setprecision(2) << baseline / result.factor_seconds << "x"
+                  << std::setw(12) << std::setprecision(6) << result.secondsPerIteration()
+                  << std::setw(11) << std::setprecision(4) << result.factor_seconds + result.refine_seconds
+                  << std::scientific << std::setprecision(2)
+                  << std::setw(12) << result.backward_error << std::setw(12) << error / reference
+                  << std::defaultfloat << std::endl;
+    }
+}
+
+int main(int argc, char** argv) {
+    size_t n = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1024;
+    ResidualPrecision residual = argc > 2 && std::strcmp(argv[2], "fp32") == 0 ? ResidualPrecision::FP32
+                                                                              : ResidualPrecision::FP64;
+    std::mt19937_64 rng(42);
+
+    std::cout << "iterative refinement, n = " << n << ", "
+              << (residual == ResidualPrecision::FP64 ? "fp64" : "fp32") << " residuals" << std::endl;
+    std::cout << std::left << std::setw(22) << "matrix" << std::setw(10) << "factor" << std::right
+              << std::setw(7) << "iters" << std::setw(6) << "conv"
+              << std::setw(11) << "factor s" << std::setw(9) << "vs fp32"
+              << std::setw(12) << "s / iter" << std::setw(11) << "total s"
+              << std::setw(12) << "backward" << std::setw(12) << "forward" << std::endl;
+
+    for (double kappa : {1e1, 1e2, 1e3, 1e5}) {
+        std::string tag = "1e" + std::to_string(static_cast<int>(std::lround(std::log10(kappa))));
+        run("lu, kappa " + tag, n, conditioned(n, kappa, false, rng), Factorization::LU, residual, rng);
+        run("cholesky, kappa " + tag, n, conditioned(n, kappa, true, rng), Factorization::Cholesky, residual,
+            rng);
+    }
+    // small, their condition grows about 30x per row
+    for (size_t size : {4, 6}) {
+        run("lu, hilbert " + std::to_string(size), size, hilbert(size), Factorization::LU, residual, rng);
+        run("cholesky, hilbert " + std::to_string(size), size, hilbert(size), Factorization::Cholesky, residual,
+            rng);
+    }
+    return 0;
+}
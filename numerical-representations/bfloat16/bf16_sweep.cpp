@@ -0,0 +1,282 @@
+#include "BF16.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <atomic>
+#include <cfenv>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// exhaustive check of the BFloat16 operators: every one of the 2^32
+// (a, b) bit pattern pairs against the hardware float result rounded to
+// bf16, split across the thread pool a row of 65536 pairs at a time
+//
+// float then bf16 is a correct reference. a sum, difference or product of
+// two bf16 values is exact in float or rounds once with 16 bits to spare,
+// and a quotient rounded to 24 bits and then to 8 bits is the quotient
+// rounded to 8 bits (24 >= 2 * 8 + 2). the directed modes nest the same
+// way, with the float op run under the matching fesetround
+//
+//   --ops=add,sub,mul,div             operators to sweep (default all four)
+//   --modes=nearest,zero,up,down      rounding modes (default nearest, the
+//                                     operators; the others go through the
+//                                     RoundingMode overloads)
+//   --stride=N                        only every n-th first operand, for a
+//                                     quick run (default 1, every pair)
+//   --threads=N                       pool size (default every core)
+//   --report=N                        mismatches listed per sweep (default 10)
+//
+// exits 1 if any pair mismatches. nan results only need to be nan
+
+enum class Op { Add, Subtract, Multiply, Divide };
+
+struct OpInfo {
+    Op op;
+    const char* name;
+    char symbol;
+};
+
+static const OpInfo OPS[] = {
+    {Op::Add, "add", '+'},
+    {Op::Subtract, "sub", '-'},
+    {Op::Multiply, "mul", '*'},
+    {Op::Divide, "div", '/'},
+};
+
+struct ModeInfo {
+    RoundingMode mode;
+    const char* name;
+    int fenv;
+};
+
+static const ModeInfo MODES[] = {
+    {RoundingMode::NearestEven, "nearest", FE_TONEAREST},
+    {RoundingMode::TowardZero, "zero", FE_TOWARDZERO},
+    {RoundingMode::Upward, "up", FE_UPWARD},
+    {RoundingMode::Downward, "down", FE_DOWNWARD},
+};
+
+struct Mismatch {
+    uint16_t a, b, got, expected;
+
+    bool operator<(const Mismatch& other) const {
+        return a != other.a ? a < other.a : b < other.b;
+    }
+};
+
+template <Op OP>
+static BFloat16 apply(BFloat16 a, BFloat16 b) {
+    switch (OP) {
+    case Op::Add:      return a + b;
+    case Op::Subtract: return a - b;
+    case Op::Multiply: return a * b;
+    default:           return a / b;
+    }
+}
+
+template <Op OP>
+static BFloat16 apply(BFloat16 a, BFloat16 b, RoundingMode mode) {
+    switch (OP) {
+    case Op::Add:      return BFloat16::add(a, b, mode);
+    case Op::Subtract: return BFloat16::subtract(a, b, mode);
+    case Op::Multiply: return BFloat16::multiply(a, b, mode);
+    default:           return BFloat16::divide(a, b, mode);
+    }
+}
+
+// the float op, in whatever rounding mode the thread is in
+template <Op OP>
+static float reference(float a, float b) {
+    switch (OP) {
+    case Op::Add:      return a + b;
+    case Op::Subtract: return a - b;
+    case Op::Multiply: return a * b;
+    default:           return a / b;
+    }
+}
+
+static bool same(BFloat16 got, BFloat16 expected) {
+    return expected.isNaN() ? got.isNaN() : got.bits() == expected.bits();
+}
+
+struct Sweep {
+    const std::vector<float>* values;   // every pattern as a float
+    const ModeInfo* mode;
+    size_t stride;
+    size_t report;
+
+    std::atomic<uint64_t> mismatches{0};
+    std::mutex lock;
+    std::vector<Mismatch> first;        // the lowest (a, b) pairs, at most report
+};
+
+// rows [begin, end) of the sweep, each row one first operand against all
+// 65536 second operands
+template <Op OP>
+static void sweepRows(Sweep& sweep, size_t begin, size_t end) {
+    const float* values = sweep.values->data();
+    const RoundingMode mode = sweep.mode->mode;
+    const bool nearest = mode == RoundingMode::NearestEven;
+    std::vector<Mismatch> found;
+    uint64_t count = 0;
+
+    // the rounding mode is per thread, so set it on whichever thread runs
+    // this chunk and put it back after
+    std::fesetround(sweep.mode->fenv);
+    for (size_t row = begin; row < end; ++row) {
+        uint16_t a_bits = static_cast<uint16_t>(row * sweep.stride);
+        BFloat16 a = BFloat16::fromBits(a_bits);
+        float fa = values[a_bits];
+
+        for (uint32_t b_bits = 0; b_bits <= 0xFFFF; ++b_bits) {
+            BFloat16 b = BFloat16::fromBits(static_cast<uint16_t>(b_bits));
+            float exact = reference<OP>(fa, values[b_bits]);
+            BFloat16 expected = nearest ? BFloat16(exact) : BFloat16(exact, mode);
+            BFloat16 got = nearest ? apply<OP>(a, b) : apply<OP>(a, b, mode);
+            if (same(got, expected)) continue;
+
+            if (found.size() < sweep.report) {
+                found.push_back({a_bits, static_cast<uint16_t>(b_bits), got.bits(), expected.bits()});
+            }
+            ++count;
+        }
+    }
+    std::fesetround(FE_TONEAREST);
+
+    if (count == 0) return;
+    sweep.mismatches += count;
+    std::lock_guard<std::mutex> guard(sweep.lock);
+    sweep.first.insert(sweep.first.end(), found.begin(), found.end());
+    std::sort(sweep.first.begin(), sweep.first.end());
+    if (sweep.first.size() > sweep.report) sweep.first.resize(sweep.report);
+}
+
+static void runSweep(Op op, Sweep& sweep, size_t rows) {
+    // 64 rows is 4M pairs a chunk, enough to hide the scheduling and
+    // small enough to balance the slow division rows
+    ThreadPool::instance().parallelFor(rows, 64, [&](size_t begin, size_t end) {
+        switch (op) {
+        case Op::Add:      sweepRows<Op::Add>(sweep, begin, end); break;
+        case Op::Subtract: sweepRows<Op::Subtract>(sweep, begin, end); break;
+        case Op::Multiply: sweepRows<Op::Multiply>(sweep, begin, end); break;
+        case Op::Divide:   sweepRows<Op::Divide>(sweep, begin, end); break;
+        }
+    });
+}
+
+static std::vector<std::string> parseNames(const std::string& text) {
+    std::vector<std::string> names;
+    std::stringstream ss(text);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        if (!item.empty()) names.push_back(item);
+    }
+    return names;
+}
+
+static bool startsWith(const std::string& s, const std::string& prefix) {
+    return s.compare(0, prefix.size(), prefix) == 0;
+}
+
+static std::string hex(uint16_t bits) {
+    std::ostringstream os;
+    os << "0x" << std::hex << std::uppercase << std::setw(4) << std::setfill('0') << bits;
+    return os.str();
+}
+
+int main(int argc, char** argv) {
+    std::vector<std::string> op_names = {"add", "sub", "mul", "div"};
+    std::vector<std::string> mode_names = {"nearest"};
+    size_t stride = 1;
+    size_t report = 10;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (startsWith(arg, "--ops=")) {
+            op_names = parseNames(arg.substr(6));
+        } else if (startsWith(arg, "--modes=")) {
+            mode_names = parseNames(arg.substr(8));
+        } else if (startsWith(arg, "--stride=")) {
+            stride = std::max<size_t>(1, std::strtoull(arg.c_str() + 9, nullptr, 10));
+        } else if (startsWith(arg, "--threads=")) {
+            setThreadCount(std::strtoull(arg.c_str() + 10, nullptr, 10));
+        } else if (startsWith(arg, "--report=")) {
+            report = std::strtoull(arg.c_str() + 9, nullptr, 10);
+        } else {
+            std::cerr << "unknown flag " << arg << " (see bf16_sweep.cpp)" << std::endl;
+            return 2;
+        }
+    }
+
+    std::vector<const OpInfo*> ops;
+    for (const std::string& name : op_names) {
+        auto it = std::find_if(std::begin(OPS), std::end(OPS), [&](const OpInfo& o) { return name == o.name; });
+        if (it == std::end(OPS)) {
+            std::cerr << "unknown op " << name << std::endl;
+            return 2;
+        }
+        ops.push_back(&*it);
+    }
+    std::vector<const ModeInfo*> modes;
+    for (const std::string& name : mode_names) {
+        auto it = std::find_if(std::begin(MODES), std::end(MODES), [&](const ModeInfo& m) { return name == m.name; });
+        if (it == std::end(MODES)) {
+            std::cerr << "unknown mode " << name << std::endl;
+            return 2;
+        }
+        modes.push_back(&*it);
+    }
+
+    std::vector<BFloat16> patterns(65536);
+    std::vector<float> values(65536);
+    for (uint32_t bits = 0; bits <= 0xFFFF; ++bits) patterns[bits] = BFloat16::fromBits(static_cast<uint16_t>(bits));
+    convertToFloat(patterns.data(), values.data(), values.size());
+
+    const size_t rows = (65536 + stride - 1) / stride;
+    const double pairs = static_cast<double>(rows) * 65536.0;
+    const size_t threads = ThreadPool::instance().threads();
+    std::cout << "BFloat16 operator sweep: " << rows << " x 65536 pairs per op, "
+              << threads << " thread" << (threads == 1 ? "" : "s") << std::endl;
+    std::cout << std::left << std::setw(14) << "op" << std::right << std::setw(12) << "mismatches"
+              << std::setw(10) << "seconds" << std::setw(14) << "Mpairs/s" << std::setw(16)
+              << "ns/pair/thread" << std::endl;
+
+    uint64_t total = 0;
+    for (const ModeInfo* mode : modes) {
+        for (const OpInfo* op : ops) {
+            Sweep sweep;
+            sweep.values = &values;
+            sweep.mode = mode;
+            sweep.stride = stride;
+            sweep.report = report;
+
+            auto start = std::chrono::steady_clock::now();
+            runSweep(op->op, sweep, rows);
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+            uint64_t mismatches = sweep.mismatches;
+            std::string name = std::string(op->name) + "/" + mode->name;
+            std::cout << std::left << std::setw(14) << name << std::right << std::setw(12) << mismatches
+                      << std::fixed << std::setprecision(2) << std::setw(10) << seconds
+                      << std::setw(14) << pairs / seconds / 1e6
+                      << std::setw(16) << seconds * 1e9 * threads / pairs
+                      << std::defaultfloat << std::endl;
+            for (const Mismatch& m : sweep.first) {
+                std::cout << "    " << hex(m.a) << " " << op->symbol << " " << hex(m.b)
+                          << ": got " << hex(m.got) << ", expected " << hex(m.expected)
+                          << "  (" << BFloat16::fromBits(m.a) << " " << op->symbol << " "
+                          << BFloat16::fromBits(m.b) << ")" << std::endl;
+            }
+            total += mismatches;
+        }
+    }
+
+    std::cout << (total == 0 ? "every pair matches" : "MISMATCHES FOUND") << std::endl;
+    return total == 0 ? 0 : 1;
+}
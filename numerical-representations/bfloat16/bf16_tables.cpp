@@ -0,0 +1,53 @@
+#include "BF16Tables.h"
+
+const BFloat16Tables& BFloat16Tables::instance() {
+    // function local static: built by the first caller, c++11 guarantees
+    // other threads wait for the constructor to finish
+    static const BFloat16Tables tables;
+    return tables;
+}
+
+BFloat16Tables::BFloat16Tables() {
+    const uint16_t one = BFloat16(1.0f).bits();
+
+    for (size_t i = 0; i < TABLE_SIZE; ++i) {
+        BFloat16 x = BFloat16::fromBits(static_cast<uint16_t>(i));
+
+        // fill from the ieee kernels, not the operators: those follow the
+        // calling thread's subnormal mode, and the tables are shared
+        sqrt_[i] = BFloat16::Format::sqrt(x.bits());
+        reciprocal_[i] = BFloat16::Format::divide(one, x.bits());
+        abs_[i] = x.abs().bits();
+        negate_[i] = (-x).bits();
+        to_float_[i] = x.toFloat();
+
+        uint8_t flags = 0;
+        if (x.isZero()) flags |= CLASS_ZERO;
+        if (x.isSubnormal()) flags |= CLASS_SUBNORMAL;
+        if (x.isNormal()) flags |= CLASS_NORMAL;
+        if (x.isInfinity()) flags |= CLASS_INFINITY;
+        if (x.isNaN()) flags |= CLASS_NAN;
+        if (x.isNegative()) flags |= CLASS_NEGATIVE;
+        class_[i] = flags;
+    }
+}
+
+void BFloat16Tables::lookup(const uint16_t* table, const BFloat16* src, BFloat16* dst, size_t n) {
+    for (size_t i = 0; i < n; ++i) {
+        dst[i] = BFloat16::fromBits(table[src[i].bits()]);
+    }
+}
+
+void BFloat16Tables::sqrt(const BFloat16* src, BFloat16* dst, size_t n) const {
+    lookup(sqrt_, src, dst, n);
+}
+
+void BFloat16Tables::reciprocal(const BFloat16* src, BFloat16* dst, size_t n) const {
+    lookup(reciprocal_, src, dst, n);
+}
+
+void BFloat16Tables::toFloat(const BFloat16* src, float* dst, size_t n) const {
+    for (size_t i = 0; i < n; ++i) {
+        dst[i] = to_float_[src[i].bits()];
+    }
+}
@@ -0,0 +1,101 @@
+#include "BF16.h"
+#include "BF16Tables.h"
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <vector>
+
+// compares the table-backed unary ops against the scalar ones
+// (bf16_comparison.cpp / inline accessors) over random bit patterns
+
+static volatile uint32_t sink;
+
+template <typename Op>
+static double timeOp(const std::vector<BFloat16>& input, Op op) {
+    const int reps = 7;
+    double best = 1e30;
+
+    for (int r = 0; r < reps; ++r) {
+        uint32_t acc = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (const BFloat16& x : input) {
+            acc += op(x);
+        }
+        auto stop = std::chrono::steady_clock::now();
+        sink = acc;
+
+        double ns = std::chrono::duration<double, std::nano>(stop - start).count();
+        if (ns < best) best = ns;
+    }
+
+    return best / static_cast<double>(input.size());
+}
+
+static void report(const char* name, double scalar_ns, double table_ns) {
+    std::cout << std::left << std::setw(12) << name << std::right
+              << std::setw(12) << scalar_ns
+              << std::setw(12) << table_ns
+              << std::setw(10) << scalar_ns / table_ns << "x" << std::endl;
+}
+
+int main() {
+    const size_t n = 1u << 20;
+
+    // positive finite values for sqrt / reciprocal so both paths do real work,
+    // raw random patterns for the classifiers
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<uint32_t> positive(0x0001, 0x7F7F);
+    std::uniform_int_distribution<uint32_t> any(0x0000, 0xFFFF);
+
+    std::vector<BFloat16> finite(n), mixed(n);
+    for (size_t i = 0; i < n; ++i) {
+        finite[i] = BFloat16::fromBits(static_cast<uint16_t>(positive(rng)));
+        mixed[i] = BFloat16::fromBits(static_cast<uint16_t>(any(rng)));
+    }
+
+    auto build_start = std::chrono::steady_clock::now();
+    const BFloat16Tables& tables = BFloat16Tables::instance();
+    auto build_stop = std::chrono::steady_clock::now();
+
+    std::cout << "BFloat16 table vs scalar unary ops (" << n << " values, best of 7)" << std::endl;
+    std::cout << "Table build: "
+              << std::chrono::duration<double, std::milli>(build_stop - build_start).count()
+              << " ms, " << sizeof(BFloat16Tables) / 1024 << " KiB" << std::endl;
+    std::cout << std::fixed << std::setprecision(3);
+    std::cout << std::left << std::setw(12) << "op" << std::right
+              << std::setw(12) << "scalar ns" << std::setw(12) << "table ns"
+              << std::setw(11) << "speedup" << std::endl;
+
+    report("sqrt",
+           timeOp(finite, [](BFloat16 x) { return x.sqrt().bits(); }),
+           timeOp(finite, [&](BFloat16 x) { return tables.sqrt(x).bits(); }));
+
+    const BFloat16 one(1.0f);
+    report("reciprocal",
+           timeOp(finite, [&](BFloat16 x) { return (one / x).bits(); }),
+           timeOp(finite, [&](BFloat16 x) { return tables.reciprocal(x).bits(); }));
+
+    report("abs",
+           timeOp(mixed, [](BFloat16 x) { return x.abs().bits(); }),
+           timeOp(mixed, [&](BFloat16 x) { return tables.abs(x).bits(); }));
+
+    report("negate",
+           timeOp(mixed, [](BFloat16 x) { return (-x).bits(); }),
+           timeOp(mixed, [&](BFloat16 x) { return tables.negate(x).bits(); }));
+
+    report("isNaN",
+           timeOp(mixed, [](BFloat16 x) { return static_cast<uint32_t>(x.isNaN()); }),
+           timeOp(mixed, [&](BFloat16 x) { return static_cast<uint32_t>(tables.isNaN(x)); }));
+
+    report("isNormal",
+           timeOp(mixed, [](BFloat16 x) { return static_cast<uint32_t>(x.isNormal()); }),
+           timeOp(mixed, [&](BFloat16 x) { return static_cast<uint32_t>(tables.isNormal(x)); }));
+
+    report("toFloat",
+           timeOp(mixed, [](BFloat16 x) { return static_cast<uint32_t>(x.toFloat() > 0.0f); }),
+           timeOp(mixed, [&](BFloat16 x) { return static_cast<uint32_t>(tables.toFloat(x) > 0.0f); }));
+
+    return 0;
+}
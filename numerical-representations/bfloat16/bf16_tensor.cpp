@@ -0,0 +1,947 @@
+#include "BF16Tensor.h"
+#include "BF16Simd.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <condition_variable>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <stdexcept>
+#include <thread>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+static_assert(sizeof(BFloat16) == 2 && sizeof(FP32) == 4, "tensor elements are packed bit patterns");
+
+static const char TENSOR_MAGIC[8] = {'N', 'R', 'T', 'E', 'N', 'S', 'O', 'R'};
+static const uint16_t TENSOR_VERSION = 1;
+
+// elements converted per pass by the writer and the file converters'
+// minimum, small enough to stay in L2
+static const size_t CONVERT_CHUNK = 16384;
+
+static bool hostLittleEndian() {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    return false;
+#else
+    return true;
+#endif
+}
+
+static std::runtime_error fileError(const std::string& path, const std::string& what) {
+    return std::runtime_error(path + ": " + what);
+}
+
+static std::runtime_error systemError(const std::string& path, const char* call) {
+    return fileError(path, std::string(call) + " failed: " + std::strerror(errno));
+}
+
+size_t tensorElementBytes(TensorDType dtype) {
+    return dtype == TensorDType::FP32 ? sizeof(FP32) : sizeof(BFloat16);
+}
+
+size_t TensorInfo::elements() const {
+    size_t count = 1;
+    for (size_t d : shape) count *= d;
+    return count;
+}
+
+// header encoding, little-endian whatever the host
+
+static void putLE(unsigned char* p, uint64_t value, size_t bytes) {
+    for (size_t i = 0; i < bytes; ++i) {
+        p[i] = static_cast<unsigned char>(value >> (8 * i));
+    }
+}
+
+static uint64_t getLE(const unsigned char* p, size_t bytes) {
+    uint64_t value = 0;
+    for (size_t i = 0; i < bytes; ++i) {
+        value |= static_cast<uint64_t>(p[i]) << (8 * i);
+    }
+    return value;
+}
+
+static void encodeHeader(const TensorInfo& info, unsigned char* out) {
+    std::memset(out, 0, TENSOR_HEADER_BYTES);
+    std::memcpy(out, TENSOR_MAGIC, sizeof(TENSOR_MAGIC));
+    putLE(out + 8, TENSOR_VERSION, 2);
+    out[10] = static_cast<unsigned char>(info.dtype);
+    out[11] = info.little_endian ? 0 : 1;
+    putLE(out + 12, info.shape.size(), 4);
+    putLE(out + 16, info.alignment, 8);
+    putLE(out + 24, info.data_offset, 8);
+    for (size_t d = 0; d < info.shape.size(); ++d) {
+        putLE(out + 32 + 8 * d, info.shape[d], 8);
+    }
+}
+
+static TensorInfo decodeHeader(const unsigned char* in, const std::string& path) {
+    if (std::memcmp(in, TENSOR_MAGIC, sizeof(TENSOR_MAGIC)) != 0) {
+        throw fileError(path, "not a tensor file");
+    }
+    if (getLE(in + 8, 2) != TENSOR_VERSION) {
+        throw fileError(path, "unsupported tensor version " + std::to_string(getLE(in + 8, 2)));
+    }
+
+    TensorInfo info;
+    if (in[10] != static_cast<unsigned char>(TensorDType::FP32) &&
+        in[10] != static_cast<unsigned char>(TensorDType::BF16)) {
+        throw fileError(path, "unknown dtype " + std::to_string(in[10]));
+    }
+    info.dtype = static_cast<TensorDType>(in[10]);
+    if (in[11] > 1) throw fileError(path, "bad byte order flag");
+    info.little_endian = in[11] == 0;
+
+    uint64_t rank = getLE(in + 12, 4);
+    uint64_t alignment = getLE(in + 16, 8);
+    uint64_t offset = getLE(in + 24, 8);
+    if (rank > TENSOR_MAX_RANK) throw fileError(path, "rank " + std::to_string(rank) + " is too large");
+    // the elements are read in place through typed pointers, so the offset
+    // must keep them aligned whatever the recorded alignment
+    if (alignment == 0 || (alignment & (alignment - 1)) != 0 || offset < TENSOR_HEADER_BYTES || offset % alignment ||
+        offset % tensorElementBytes(info.dtype)) {
+        throw fileError(path, "bad alignment or data offset");
+    }
+    info.alignment = alignment;
+    info.data_offset = offset;
+
+    // the element count and byte size must not wrap
+    size_t bytes = tensorElementBytes(info.dtype);
+    for (size_t d = 0; d < TENSOR_MAX_RANK; ++d) {
+        uint64_t dim = getLE(in + 32 + 8 * d, 8);
+        if (d >= rank) {
+            if (dim != 0) throw fileError(path, "shape has entries past its rank");
+            continue;
+        }
+        if (__builtin_mul_overflow(bytes, dim, &bytes)) throw fileError(path, "tensor too large");
+        info.shape.push_back(dim);
+    }
+    if (__builtin_add_overflow(bytes, offset, &bytes)) throw fileError(path, "tensor too large");
+    return info;
+}
+
+static size_t alignUp(size_t value, size_t alignment) {
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+static uint64_t fileBytes(const std::string& path) {
+    struct stat st;
+    if (::stat(path.c_str(), &st) != 0) throw systemError(path, "stat");
+    return static_cast<uint64_t>(st.st_size);
+}
+
+// MappedTensor
+
+MappedTensor::MappedTensor(const std::string& path)
+    : base_(nullptr), mapped_bytes_(0), data_(nullptr) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) throw systemError(path, "open");
+
+    struct stat st;
+    if (::fstat(fd, &st) != 0) {
+        ::close(fd);
+        throw systemError(path, "fstat");
+    }
+    size_t bytes = static_cast<size_t>(st.st_size);
+    if (bytes < TENSOR_HEADER_BYTES) {
+        ::close(fd);
+        throw fileError(path, "too short for a tensor header");
+    }
+
+    // the mapping keeps the file open on its own
+    void* base = ::mmap(nullptr, bytes, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (base == MAP_FAILED) throw systemError(path, "mmap");
+    base_ = base;
+    mapped_bytes_ = bytes;
+
+    try {
+        info_ = decodeHeader(static_cast<const unsigned char*>(base), path);
+        if (info_.data_offset + info_.dataBytes() > bytes) {
+            throw fileError(path, "truncated, expected " + std::to_string(info_.data_offset + info_.dataBytes()) +
+                                  " bytes, found " + std::to_string(bytes));
+        }
+    } catch (...) {
+        release();
+        throw;
+    }
+    data_ = static_cast<const unsigned char*>(base) + info_.data_offset;
+}
+
+MappedTensor::~MappedTensor() {
+    release();
+}
+
+MappedTensor::MappedTensor(MappedTensor&& other) noexcept
+    : info_(std::move(other.info_)), base_(other.base_), mapped_bytes_(other.mapped_bytes_), data_(other.data_) {
+    other.base_ = nullptr;
+    other.mapped_bytes_ = 0;
+    other.data_ = nullptr;
+}
+
+MappedTensor& MappedTensor::operator=(MappedTensor&& other) noexcept {
+    if (this != &other) {
+        release();
+        info_ = std::move(other.info_);
+        base_ = other.base_;
+        mapped_bytes_ = other.mapped_bytes_;
+        data_ = other.data_;
+        other.base_ = nullptr;
+        other.mapped_bytes_ = 0;
+        other.data_ = nullptr;
+    }
+    return *this;
+}
+
+void MappedTensor::release() {
+    if (base_) ::munmap(base_, mapped_bytes_);
+    base_ = nullptr;
+    mapped_bytes_ = 0;
+}
+
+bool MappedTensor::hostByteOrder() const {
+    return info_.little_endian == hostLittleEndian();
+}
+
+void MappedTensor::checkUsable(TensorDType dtype) const {
+    if (info_.dtype != dtype) {
+        throw std::logic_error(dtype == TensorDType::BF16 ? "tensor holds fp32, not bf16"
+                                                          : "tensor holds bf16, not fp32");
+    }
+    if (!hostByteOrder()) {
+        throw std::logic_error("tensor is in foreign byte order, convert it first");
+    }
+}
+
+const BFloat16* MappedTensor::bf16() const {
+    checkUsable(TensorDType::BF16);
+    return reinterpret_cast<const BFloat16*>(data_);
+}
+
+const FP32* MappedTensor::fp32() const {
+    checkUsable(TensorDType::FP32);
+    return reinterpret_cast<const FP32*>(data_);
+}
+
+// TensorWriter
+
+TensorWriter::TensorWriter(const std::string& path, TensorDType dtype, const std::vector<size_t>& shape,
+                           size_t alignment)
+    : path_(path), file_(nullptr), written_(0) {
+    if (shape.size() > TENSOR_MAX_RANK) {
+        throw std::invalid_argument("tensor rank is at most " + std::to_string(TENSOR_MAX_RANK));
+    }
+    if (alignment == 0 || (alignment & (alignment - 1)) != 0) {
+        throw std::invalid_argument("tensor alignment must be a power of two");
+    }
+    info_.dtype = dtype;
+    info_.shape = shape;
+    info_.little_endian = hostLittleEndian();
+    info_.alignment = alignment;
+    info_.data_offset = alignUp(TENSOR_HEADER_BYTES, alignment);
+
+    file_ = std::fopen(path.c_str(), "wb");
+    if (!file_) throw systemError(path, "open");
+
+    // header, then zeros up to the data offset
+    unsigned char header[TENSOR_HEADER_BYTES];
+    encodeHeader(info_, header);
+    put(header, sizeof(header));
+    std::vector<unsigned char> padding(info_.data_offset - TENSOR_HEADER_BYTES, 0);
+    put(padding.data(), padding.size());
+}
+
+TensorWriter::~TensorWriter() {
+    if (file_) std::fclose(file_);
+}
+
+void TensorWriter::reserve(size_t n) {
+    if (!file_) throw std::logic_error("tensor writer is closed");
+    if (n > info_.elements() - written_) {
+        throw std::length_error("writing past the end of the tensor");
+    }
+}
+
+void TensorWriter::put(const void* bytes, size_t count) {
+    if (count && std::fwrite(bytes, 1, count, file_) != count) {
+        throw systemError(path_, "write");
+    }
+}
+
+void TensorWriter::write(const BFloat16* data, size_t n) {
+    reserve(n);
+    if (info_.dtype == TensorDType::BF16) {
+        put(data, n * sizeof(BFloat16));
+    } else {
+        wide_.resize(std::min(n, CONVERT_CHUNK));
+        for (size_t i = 0; i < n; i += CONVERT_CHUNK) {
+            size_t m = std::min(CONVERT_CHUNK, n - i);
+            convertToFloat(data + i, wide_.data(), m);
+            put(wide_.data(), m * sizeof(float));
+        }
+    }
+    written_ += n;
+}
+
+void TensorWriter::write(const float* data, size_t n) {
+    reserve(n);
+    if (info_.dtype == TensorDType::FP32) {
+        put(data, n * sizeof(float));
+    } else {
+        narrow_.resize(std::min(n, CONVERT_CHUNK));
+        for (size_t i = 0; i < n; i += CONVERT_CHUNK) {
+            size_t m = std::min(CONVERT_CHUNK, n - i);
+            convertToBF16(data + i, narrow_.data(), m);
+            put(narrow_.data(), m * sizeof(BFloat16));
+        }
+    }
+    written_ += n;
+}
+
+void TensorWriter::write(const FP32* data, size_t n) {
+    if (info_.dtype == TensorDType::FP32) {
+        reserve(n);
+        put(data, n * sizeof(FP32));
+        written_ += n;
+        return;
+    }
+
+    // narrowing wants floats, copy the bit patterns over a chunk at a time
+    std::vector<float> floats(std::min(n, CONVERT_CHUNK));
+    for (size_t i = 0; i < n; i += CONVERT_CHUNK) {
+        size_t m = std::min(CONVERT_CHUNK, n - i);
+        std::memcpy(floats.data(), data + i, m * sizeof(float));
+        write(floats.data(), m);
+    }
+}
+
+void TensorWriter::close() {
+    if (!file_) return;
+    std::FILE* file = file_;
+    file_ = nullptr;
+    if (written_ != info_.elements()) {
+        std::fclose(file);
+        throw std::logic_error("tensor closed after " + std::to_string(written_) + " of " +
+                               std::to_string(info_.elements()) + " elements");
+    }
+    if (std::fclose(file) != 0) throw systemError(path_, "close");
+}
+
+void saveTensor(const std::string& path, const BFloat16* data, const std::vector<size_t>& shape) {
+    TensorWriter writer(path, TensorDType::BF16, shape);
+    writer.write(data, writer.info().elements());
+    writer.close();
+}
+
+void saveTensor(const std::string& path, const FP32* data, const std::vector<size_t>& shape) {
+    TensorWriter writer(path, TensorDType::FP32, shape);
+    writer.write(data, writer.info().elements());
+    writer.close();
+}
+
+// ConversionStats
+
+// the power of two at or below the largest magnitude, so every scaled value
+// is below 2 and scaling is exact. clamped so its reciprocal is finite
+static double squareScale(double max) {
+    return max > 0 ? std::ldexp(1.0, std::max(std::ilogb(max), -1022)) : 0.0;
+}
+
+static double scaledSquares(const double* v, size_t n, double scale) {
+    if (scale == 0) return 0;
+    const double inverse = 1.0 / scale;
+    double s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        double x0 = v[i] * inverse, x1 = v[i + 1] * inverse;
+        double x2 = v[i + 2] * inverse, x3 = v[i + 3] * inverse;
+        s0 += x0 * x0;
+        s1 += x1 * x1;
+        s2 += x2 * x2;
+        s3 += x3 * x3;
+    }
+    for (; i < n; ++i) s0 += (v[i] * inverse) * (v[i] * inverse);
+    return (s0 + s1) + (s2 + s3);
+}
+
+static void mergeSquares(double& scale, double& ssq, double other_scale, double other_ssq) {
+    if (other_scale == 0) return;
+    if (scale < other_scale) {
+        double r = scale / other_scale;
+        ssq = ssq * r * r + other_ssq;
+        scale = other_scale;
+    } else {
+        double r = other_scale / scale;
+        ssq += other_ssq * r * r;
+    }
+}
+
+static double norm(double p, size_t count, double l1, double max, double scale, double ssq) {
+    if (p == 0) return static_cast<double>(count);
+    if (p == 1) return l1;
+    if (p == 2) return scale * std::sqrt(ssq);
+    if (std::isinf(p) && p > 0) return max;
+    throw std::invalid_argument("norm order must be 0, 1, 2 or infinity");
+}
+
+double ConversionStats::errorNorm(double p) const {
+    return norm(p, changed, error_l1, error_max, error_scale, error_ssq);
+}
+
+double ConversionStats::referenceNorm(double p) const {
+    return norm(p, nonzero, ref_l1, ref_max, ref_scale, ref_ssq);
+}
+
+double ConversionStats::relativeError(double p) const {
+    double error = errorNorm(p);
+    double reference = referenceNorm(p);
+    if (reference == 0) return error > 0 ? HUGE_VAL : 0.0;
+    return error / reference;
+}
+
+ConversionStats& ConversionStats::merge(const ConversionStats& other) {
+    elements += other.elements;
+    nonfinite += other.nonfinite;
+    overflow += other.overflow;
+    changed += other.changed;
+    nonzero += other.nonzero;
+    error_l1 += other.error_l1;
+    ref_l1 += other.ref_l1;
+    error_max = std::max(error_max, other.error_max);
+    ref_max = std::max(ref_max, other.ref_max);
+    mergeSquares(error_scale, error_ssq, other.error_scale, other.error_ssq);
+    mergeSquares(ref_scale, ref_ssq, other.ref_scale, other.ref_ssq);
+    return *this;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+
+// the same four lanes in one register, so the sums come out bit for bit
+// as above. plain avx2 without fma, nothing is contracted
+
+__attribute__((target("avx2")))
+static void sumMagnitudesAVX2(const double* v, size_t n, double& sum, double& max, size_t& nonzero) {
+    __m256d s = _mm256_setzero_pd(), m = _mm256_setzero_pd();
+    __m256i z = _mm256_setzero_si256();
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256d x = _mm256_loadu_pd(v + i);
+        s = _mm256_add_pd(s, x);
+        m = _mm256_max_pd(x, m);
+        // all ones is -1
+        z = _mm256_sub_epi64(z, _mm256_castpd_si256(_mm256_cmp_pd(x, _mm256_setzero_pd(), _CMP_NEQ_UQ)));
+    }
+    alignas(32) double sl[4], ml[4];
+    alignas(32) int64_t zl[4];
+    _mm256_store_pd(sl, s);
+    _mm256_store_pd(ml, m);
+    _mm256_store_si256(reinterpret_cast<__m256i*>(zl), z);
+    for (; i < n; ++i) {
+        sl[0] += v[i];
+        ml[0] = std::max(ml[0], v[i]);
+        zl[0] += v[i] != 0;
+    }
+    sum = (sl[0] + sl[1]) + (sl[2] + sl[3]);
+    max = std::max(std::max(ml[0], ml[1]), std::max(ml[2], ml[3]));
+    nonzero = static_cast<size_t>((zl[0] + zl[1]) + (zl[2] + zl[3]));
+}
+
+__attribute__((target("avx2")))
+static double scaledSquaresAVX2(const double* v, size_t n, double scale) {
+    if (scale == 0) return 0;
+    const double inverse = 1.0 / scale;
+    const __m256d k = _mm256_set1_pd(inverse);
+    __m256d s = _mm256_setzero_pd();
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256d x = _mm256_mul_pd(_mm256_loadu_pd(v + i), k);
+        s = _mm256_add_pd(s, _mm256_mul_pd(x, x));
+    }
+    alignas(32) double sl[4];
+    _mm256_store_pd(sl, s);
+    for (; i < n; ++i) sl[0] += (v[i] * inverse) * (v[i] * inverse);
+    return (sl[0] + sl[1]) + (sl[2] + sl[3]);
+}
+
+static const bool STATS_AVX2 = simdLevelSupported(SimdLevel::AVX2);
+
+#else
+
+static const bool STATS_AVX2 = false;
+
+#endif
+
+// chunk conversion, a tile at a time: swapped in place, narrowed with the
+// bulk kernels, then measured while both sides are still in L1
+
+static const size_t CONVERT_TILE = 1024;
+
+static void swapBytes(BFloat16* v, size_t n) {
+    for (size_t i = 0; i < n; ++i) v[i] = BFloat16::fromBits(__builtin_bswap16(v[i].bits()));
+}
+
+static void swapBytes(float* v, size_t n) {
+    for (size_t i = 0; i < n; ++i) {
+        uint32_t bits;
+        std::memcpy(&bits, &v[i], sizeof(float));
+        bits = __builtin_bswap32(bits);
+        std::memcpy(&v[i], &bits, sizeof(float));
+    }
+}
+
+static void swapBytes(double*, size_t) {
+    // raw files are host order
+}
+
+static void narrow(const BFloat16* src, BFloat16* dst, size_t n) { std::memcpy(dst, src, n * sizeof(BFloat16)); }
+static void narrow(const BFloat16* src, float* dst, size_t n) { convertToFloat(src, dst, n); }
+static void narrow(const float* src, BFloat16* dst, size_t n) { convertToBF16(src, dst, n); }
+static void narrow(const float* src, float* dst, size_t n) { std::memcpy(dst, src, n * sizeof(float)); }
+static void narrow(const double* src, BFloat16* dst, size_t n) { convertToBF16(src, dst, n); }
+
+static void narrow(const double* src, float* dst, size_t n) {
+    for (size_t i = 0; i < n; ++i) dst[i] = static_cast<float>(src[i]);
+}
+
+static double widen(BFloat16 x) { return x.toFloat(); }
+static double widen(float x) { return x; }
+static double widen(double x) { return x; }
+
+// sum, largest and nonzero count of n magnitudes, in four lanes so the
+// adds overlap
+static void sumMagnitudes(const double* v, size_t n, double& sum, double& max, size_t& nonzero) {
+    double s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+    double m0 = 0, m1 = 0, m2 = 0, m3 = 0;
+    size_t z0 = 0, z1 = 0, z2 = 0, z3 = 0;
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        s0 += v[i];
+        s1 += v[i + 1];
+        s2 += v[i + 2];
+        s3 += v[i + 3];
+        m0 = std::max(m0, v[i]);
+        m1 = std::max(m1, v[i + 1]);
+        m2 = std::max(m2, v[i + 2]);
+        m3 = std::max(m3, v[i + 3]);
+        z0 += v[i] != 0;
+        z1 += v[i + 1] != 0;
+        z2 += v[i + 2] != 0;
+        z3 += v[i + 3] != 0;
+    }
+    for (; i < n; ++i) {
+        s0 += v[i];
+        m0 = std::max(m0, v[i]);
+        z0 += v[i] != 0;
+    }
+    sum = (s0 + s1) + (s2 + s3);
+    max = std::max(std::max(m0, m1), std::max(m2, m3));
+    nonzero = (z0 + z1) + (z2 + z3);
+}
+
+template <typename S, typename D>
+static ConversionStats measureTile(const S* src, const D* dst, size_t n) {
+    ConversionStats t;
+    t.elements = n;
+    // the magnitudes, zero where a side is not finite
+    double error[CONVERT_TILE], reference[CONVERT_TILE];
+    for (size_t i = 0; i < n; ++i) {
+        double r = widen(src[i]);
+        double x = widen(dst[i]);
+        bool source_finite = std::isfinite(r);
+        bool finite = source_finite && std::isfinite(x);
+        t.nonfinite += !source_finite;
+        t.overflow += source_finite && !finite;
+        // exact: the rounding error of a narrowing fits the wider type
+        error[i] = finite ? std::fabs(x - r) : 0.0;
+        reference[i] = finite ? std::fabs(r) : 0.0;
+    }
+    if (STATS_AVX2) {
+        sumMagnitudesAVX2(error, n, t.error_l1, t.error_max, t.changed);
+        sumMagnitudesAVX2(reference, n, t.ref_l1, t.ref_max, t.nonzero);
+    } else {
+        sumMagnitudes(error, n, t.error_l1, t.error_max, t.changed);
+        sumMagnitudes(reference, n, t.ref_l1, t.ref_max, t.nonzero);
+    }
+    t.error_scale = squareScale(t.error_max);
+    t.ref_scale = squareScale(t.ref_max);
+    if (STATS_AVX2) {
+        t.error_ssq = scaledSquaresAVX2(error, n, t.error_scale);
+        t.ref_ssq = scaledSquaresAVX2(reference, n, t.ref_scale);
+    } else {
+        t.error_ssq = scaledSquares(error, n, t.error_scale);
+        t.ref_ssq = scaledSquares(reference, n, t.ref_scale);
+    }
+    return t;
+}
+
+template <typename S, typename D>
+static ConversionStats convertSpan(S* src, D* dst, size_t n, bool swap, bool statistics) {
+    ConversionStats stats;
+    for (size_t i = 0; i < n; i += CONVERT_TILE) {
+        size_t m = std::min(CONVERT_TILE, n - i);
+        if (swap) swapBytes(src + i, m);
+        narrow(src + i, dst + i, m);
+        if (statistics) stats.merge(measureTile(src + i, dst + i, m));
+    }
+    return stats;
+}
+
+template <typename S, typename D>
+static ConversionStats convertChunk(void* src, void* dst, size_t n, bool swap, bool statistics) {
+    S* s = static_cast<S*>(src);
+    D* d = static_cast<D*>(dst);
+    return parallelReduce(
+        n, chunkElements(sizeof(S) + sizeof(D)), ConversionStats(),
+        [&](size_t begin, size_t end) { return convertSpan(s + begin, d + begin, end - begin, swap, statistics); },
+        [](ConversionStats a, const ConversionStats& b) { return a.merge(b); });
+}
+
+// the pipeline
+
+enum class SourceType {
+    BF16,
+    Float32,
+    Float64
+};
+
+static size_t sourceBytes(SourceType type) {
+    return type == SourceType::BF16 ? sizeof(BFloat16) : type == SourceType::Float32 ? sizeof(float)
+                                                                                      : sizeof(double);
+}
+
+// O_DIRECT transfers start, end and sit in memory on this boundary
+static const size_t DIRECT_BLOCK = 4096;
+
+struct FreeDeleter {
+    void operator()(void* p) const { std::free(p); }
+};
+typedef std::unique_ptr<unsigned char, FreeDeleter> AlignedBuffer;
+
+static AlignedBuffer alignedBuffer(size_t bytes) {
+    void* p = std::aligned_alloc(DIRECT_BLOCK, alignUp(std::max<size_t>(bytes, 1), DIRECT_BLOCK));
+    if (!p) throw std::bad_alloc();
+    return AlignedBuffer(static_cast<unsigned char*>(p));
+}
+
+class FileDescriptor {
+public:
+    FileDescriptor(int fd, const std::string& path) : fd_(fd) {
+        if (fd < 0) throw systemError(path, "open");
+    }
+    ~FileDescriptor() {
+        if (fd_ >= 0) ::close(fd_);
+    }
+    FileDescriptor(const FileDescriptor&) = delete;
+    FileDescriptor& operator=(const FileDescriptor&) = delete;
+
+    int get() const { return fd_; }
+    int release() {
+        int fd = fd_;
+        fd_ = -1;
+        return fd;
+    }
+
+private:
+    int fd_;
+};
+
+static bool setDirect(int fd, bool on) {
+#ifdef O_DIRECT
+    int flags = ::fcntl(fd, F_GETFL);
+    return flags != -1 && ::fcntl(fd, F_SETFL, on ? flags | O_DIRECT : flags & ~O_DIRECT) == 0 && on;
+#else
+    (void)fd;
+    (void)on;
+    return false;
+#endif
+}
+
+// count bytes at offset, or as many as the file holds. a direct transfer
+// the file system refuses is retried through the page cache, for good
+static size_t readAt(int fd, bool& direct, unsigned char* dst, size_t count, uint64_t offset,
+                     const std::string& path) {
+    size_t done = 0;
+    while (done < count) {
+        ssize_t r = ::pread(fd, dst + done, count - done, static_cast<off_t>(offset + done));
+        if (r < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EINVAL && direct) {
+                direct = setDirect(fd, false);
+                continue;
+            }
+            throw systemError(path, "read");
+        }
+        if (r == 0) break;
+        done += static_cast<size_t>(r);
+    }
+    return done;
+}
+
+static void writeAt(int fd, bool& direct, const unsigned char* src, size_t count, uint64_t offset,
+                    const std::string& path) {
+    size_t done = 0;
+    while (done < count) {
+        ssize_t r = ::pwrite(fd, src + done, count - done, static_cast<off_t>(offset + done));
+        if (r < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EINVAL && direct) {
+                direct = setDirect(fd, false);
+                continue;
+            }
+            throw systemError(path, "write");
+        }
+        done += static_cast<size_t>(r);
+    }
+}
+
+// a fixed ring of buffers handed from one stage to the next in order:
+// chunk c takes slot c % depth once the consumer released chunk c - depth.
+// abort() wakes both sides, which then give up
+class StageRing {
+public:
+    struct Slot {
+        AlignedBuffer buffer;
+        size_t offset = 0;   // where the elements start in buffer
+        size_t count = 0;
+    };
+
+    StageRing(size_t depth, size_t bytes) : slots_(depth) {
+        for (Slot& slot : slots_) slot.buffer = alignedBuffer(bytes);
+    }
+
+    Slot& slot(size_t chunk) { return slots_[chunk % slots_.size()]; }
+
+    bool waitFree(size_t chunk) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        ready_.wait(lock, [&] { return aborted_ || chunk < released_ + slots_.size(); });
+        return !aborted_;
+    }
+
+    bool waitFull(size_t chunk) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        ready_.wait(lock, [&] { return aborted_ || chunk < published_; });
+        return !aborted_;
+    }
+
+    void publish() { advance(published_); }
+    void release() { advance(released_); }
+
+    void abort() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        aborted_ = true;
+        ready_.notify_all();
+    }
+
+private:
+    std::vector<Slot> slots_;
+    std::mutex mutex_;
+    std::condition_variable ready_;
+    size_t published_ = 0;
+    size_t released_ = 0;
+    bool aborted_ = false;
+
+    void advance(size_t& counter) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        ++counter;
+        ready_.notify_all();
+    }
+};
+
+typedef ConversionStats (*ChunkConverter)(void*, void*, size_t, bool, bool);
+
+static ChunkConverter chunkConverter(SourceType source, TensorDType dtype) {
+    bool bf16 = dtype == TensorDType::BF16;
+    switch (source) {
+    case SourceType::BF16:    return bf16 ? convertChunk<BFloat16, BFloat16> : convertChunk<BFloat16, float>;
+    case SourceType::Float32: return bf16 ? convertChunk<float, BFloat16> : convertChunk<float, float>;
+    default:                  return bf16 ? convertChunk<double, BFloat16> : convertChunk<double, float>;
+    }
+}
+
+// n elements of source type at src_offset of in, converted into a new
+// tensor at dst described by info (its data offset is set here)
+static ConversionStats runPipeline(FileDescriptor& in, const std::string& src, uint64_t src_offset,
+                                   SourceType source, bool swap, const std::string& dst, TensorInfo info,
+                                   const PipelineOptions& options) {
+    if (options.direct_io) info.alignment = std::max(info.alignment, DIRECT_BLOCK);
+    info.data_offset = alignUp(TENSOR_HEADER_BYTES, info.alignment);
+
+    const size_t n = info.elements();
+    const size_t in_bytes = sourceBytes(source);
+    const size_t out_bytes = tensorElementBytes(info.dtype);
+    // whole blocks of output per chunk, so direct writes stay aligned
+    const size_t chunk = alignUp(std::max<size_t>(options.chunk, 1), DIRECT_BLOCK);
+    const size_t depth = std::max<size_t>(options.depth, 2);
+    const size_t chunks = (n + chunk - 1) / chunk;
+    const ChunkConverter convert = chunkConverter(source, info.dtype);
+
+    FileDescriptor out(::open(dst.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644), dst);
+    bool in_direct = options.direct_io && setDirect(in.get(), true);
+    bool out_direct = options.direct_io && setDirect(out.get(), true);
+    if (!in_direct) ::posix_fadvise(in.get(), 0, 0, POSIX_FADV_SEQUENTIAL);
+
+    // an unaligned chunk start reads from the block before it, and its end
+    // up to the next block
+    StageRing read_ring(depth, std::min(chunk, std::max<size_t>(n, 1)) * in_bytes + 2 * DIRECT_BLOCK);
+    StageRing write_ring(depth, std::min(chunk, alignUp(std::max<size_t>(n, 1), DIRECT_BLOCK)) * out_bytes);
+
+    std::mutex error_lock;
+    std::exception_ptr error;
+    auto fail = [&] {
+        {
+            std::lock_guard<std::mutex> lock(error_lock);
+            if (!error) error = std::current_exception();
+        }
+        read_ring.abort();
+        write_ring.abort();
+    };
+
+    auto reader = [&] {
+        try {
+            for (size_t c = 0; c < chunks; ++c) {
+                if (!read_ring.waitFree(c)) return;
+                StageRing::Slot& slot = read_ring.slot(c);
+                size_t begin = c * chunk;
+                slot.count = std::min(chunk, n - begin);
+                uint64_t offset = src_offset + begin * in_bytes;
+                uint64_t start = in_direct ? offset & ~uint64_t(DIRECT_BLOCK - 1) : offset;
+                size_t need = static_cast<size_t>(offset - start) + slot.count * in_bytes;
+                size_t want = in_direct ? alignUp(need, DIRECT_BLOCK) : need;
+                if (readAt(in.get(), in_direct, slot.buffer.get(), want, start, src) < need) {
+                    throw fileError(src, "truncated tensor data");
+                }
+                slot.offset = static_cast<size_t>(offset - start);
+                read_ring.publish();
+            }
+        } catch (...) {
+            fail();
+        }
+    };
+
+    auto writer = [&] {
+        try {
+            for (size_t c = 0; c < chunks; ++c) {
+                if (!write_ring.waitFull(c)) return;
+                StageRing::Slot& slot = write_ring.slot(c);
+                size_t bytes = slot.count * out_bytes;
+                size_t count = bytes;
+                if (out_direct) {
+                    // the padding is cut off below
+                    count = alignUp(bytes, DIRECT_BLOCK);
+                    std::memset(slot.buffer.get() + bytes, 0, count - bytes);
+                }
+                writeAt(out.get(), out_direct, slot.buffer.get(), count,
+                        info.data_offset + c * chunk * out_bytes, dst);
+                write_ring.release();
+            }
+
+            // the header last, so a failed conversion leaves no valid file
+            AlignedBuffer header = alignedBuffer(info.data_offset);
+            std::memset(header.get(), 0, info.data_offset);
+            encodeHeader(info, header.get());
+            writeAt(out.get(), out_direct, header.get(), info.data_offset, 0, dst);
+            if (::ftruncate(out.get(), static_cast<off_t>(info.data_offset + n * out_bytes)) != 0) {
+                throw systemError(dst, "truncate");
+            }
+        } catch (...) {
+            fail();
+        }
+    };
+
+    ConversionStats stats;
+    std::thread read_thread(reader);
+    std::thread write_thread;
+    try {
+        write_thread = std::thread(writer);
+        for (size_t c = 0; c < chunks; ++c) {
+            if (!read_ring.waitFull(c) || !write_ring.waitFree(c)) break;
+            StageRing::Slot& from = read_ring.slot(c);
+            StageRing::Slot& to = write_ring.slot(c);
+            stats.merge(convert(from.buffer.get() + from.offset, to.buffer.get(), from.count, swap,
+                                options.statistics));
+            to.count = from.count;
+            read_ring.release();
+            write_ring.publish();
+        }
+    } catch (...) {
+        fail();
+    }
+    read_thread.join();
+    if (write_thread.joinable()) write_thread.join();
+    if (error) std::rethrow_exception(error);
+
+    if (::close(out.release()) != 0) throw systemError(dst, "close");
+    return stats;
+}
+
+ConversionStats convertTensorFile(const std::string& src, const std::string& dst, TensorDType dtype,
+                                  const PipelineOptions& options) {
+    FileDescriptor in(::open(src.c_str(), O_RDONLY | O_CLOEXEC), src);
+    unsigned char header[TENSOR_HEADER_BYTES];
+    bool direct = false;
+    if (readAt(in.get(), direct, header, sizeof(header), 0, src) != sizeof(header)) {
+        throw fileError(src, "too short for a tensor header");
+    }
+    TensorInfo info = decodeHeader(header, src);
+    if (info.data_offset + info.dataBytes() > fileBytes(src)) {
+        throw fileError(src, "truncated tensor data");
+    }
+
+    TensorInfo out;
+    out.dtype = dtype;
+    out.shape = info.shape;
+    out.little_endian = hostLittleEndian();
+    out.alignment = info.alignment;
+    SourceType source = info.dtype == TensorDType::BF16 ? SourceType::BF16 : SourceType::Float32;
+    return runPipeline(in, src, info.data_offset, source, info.little_endian != hostLittleEndian(), dst, out,
+                       options);
+}
+
+ConversionStats convertRawFile(const std::string& src, const std::string& dst,
+                               const std::vector<size_t>& shape, RawDType src_dtype, TensorDType dtype,
+                               const PipelineOptions& options) {
+    if (shape.size() > TENSOR_MAX_RANK) {
+        throw std::invalid_argument("tensor rank is at most " + std::to_string(TENSOR_MAX_RANK));
+    }
+    TensorInfo out;
+    out.dtype = dtype;
+    out.shape = shape;
+    out.little_endian = hostLittleEndian();
+
+    SourceType source = src_dtype == RawDType::Float64 ? SourceType::Float64 : SourceType::Float32;
+    const size_t bytes = out.elements() * sourceBytes(source);
+    FileDescriptor in(::open(src.c_str(), O_RDONLY | O_CLOEXEC), src);
+    if (fileBytes(src) != bytes) {
+        throw fileError(src, "expected " + std::to_string(bytes) + " bytes of " +
+                                 (source == SourceType::Float64 ? "float64" : "float32") + " for the shape");
+    }
+    return runPipeline(in, src, 0, source, false, dst, out, options);
+}
+
+void convertTensorFile(const std::string& src, const std::string& dst, TensorDType dtype, size_t chunk) {
+    PipelineOptions options;
+    options.chunk = chunk;
+    options.statistics = false;
+    convertTensorFile(src, dst, dtype, options);
+}
+
+void convertRawFloatFile(const std::string& src, const std::string& dst,
+                         const std::vector<size_t>& shape, TensorDType dtype, size_t chunk) {
+    PipelineOptions options;
+    options.chunk = chunk;
+    options.statistics = false;
+    convertRawFile(src, dst, shape, RawDType::Float32, dtype, options);
+}
@@ -1,8 +1,30 @@
 #include "BF16.h"
+#include "BF16Simd.h"
+#include "BF16Tables.h"
+#include "BF16Vector.h"
+#include "BF16Expr.h"
+#include "BF16Linalg.h"
+#include "BF16Math.h"
+#include "BF16Reduce.h"
+#include "BF16Order.h"
+#include "BF16Tensor.h"
+#include "BF16Solve.h"
+#include "FP32.h"
+#include "FP8.h"
+#include "MX.h"
+#include "ThreadPool.h"
 #include <iostream>
 #include <iomanip>
+#include <sstream>
 #include <cassert>
+#include <cstdint>
+#include <cstdio>
+#include <stdexcept>
 #include <cstring>
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <limits>
 
 void testConstruction() {
     std::cout << "\nTesting Construction" << std::endl;
@@ -232,6 +254,2089 @@ void testDynamicRange() {
     std::cout << "This makes it ideal for ML where range > precision" << std::endl;
 }
 
+void testFMA() {
+    std::cout << "\nTesting Fused Multiply-Add" << std::endl;
+    
+    // (1 + 2^-7)^2 = 1 + 2^-6 + 2^-14, the 2^-14 term is lost by a separate multiply
+    BFloat16 a = BFloat16::fromBits(0x3F81);
+    BFloat16 c = BFloat16::fromBits(0xBF82); // -(1 + 2^-6)
+    BFloat16 fused = fma(a, a, c);
+    BFloat16 separate = a * a + c;
+    
+    std::cout << std::scientific << std::setprecision(4);
+    std::cout << "fma(a, a, c) = " << fused << " (expected: 2^-14 = 6.1035e-05)" << std::endl;
+    std::cout << "a * a + c    = " << separate << " (double rounding)" << std::endl;
+    assert(fused.bits() == BFloat16(6.103515625e-05f).bits());
+    assert(separate.isZero());
+    
+    // a tie in the product is broken by the addend instead of rounding to even
+    BFloat16 x = BFloat16::fromBits(0x3F88); // 1.0625
+    BFloat16 y = BFloat16::fromBits(0x3F88);
+    BFloat16 tiny = BFloat16::fromBits(0x0001);
+    assert(fma(x, y, BFloat16::zero()).bits() == (x * y).bits());
+    assert(fma(x, y, tiny).bits() == BFloat16::fromBits(static_cast<uint16_t>((x * y).bits() + 1)).bits());
+    
+    // special values
+    BFloat16 inf = BFloat16::infinity(false);
+    BFloat16 zero = BFloat16::zero();
+    BFloat16 one(1.0f);
+    assert(fma(inf, zero, one).isNaN());
+    assert(fma(inf, one, -inf).isNaN());
+    assert(fma(inf, one, one).isInfinity());
+    assert(fma(zero, one, -zero).bits() == zero.bits());
+    assert(fma(-zero, one, -zero).bits() == (-zero).bits());
+    assert(fma(one, one, -one).bits() == zero.bits());
+    assert(fma(BFloat16(3.0f), BFloat16(2.0f), one) == BFloat16(7.0f));
+}
+
+void testAddRounding() {
+    std::cout << "\nTesting Addition Rounding" << std::endl;
+    
+    // random pairs against the double sum rounded once to bf16 (float then
+    // bf16 is safe, float has more than 2 * 8 + 2 bits)
+    uint32_t state = 2024;
+    size_t mismatches = 0;
+    const size_t trials = 2000000;
+    for (size_t i = 0; i < trials; ++i) {
+        state = state * 1664525u + 1013904223u;
+        BFloat16 a = BFloat16::fromBits(static_cast<uint16_t>(state >> 16));
+        BFloat16 b = BFloat16::fromBits(static_cast<uint16_t>(state));
+        if (i & 1) {
+            // close to -a so the sum cancels
+            b = BFloat16::fromBits(static_cast<uint16_t>((a.bits() ^ 0x8000) + (state >> 7) % 512 - 256));
+        }
+        
+        BFloat16 expected(a.toDouble() + b.toDouble());
+        BFloat16 got = a + b;
+        if (expected.isNaN() ? !got.isNaN() : got.bits() != expected.bits()) {
+            mismatches++;
+        }
+    }
+    assert(mismatches == 0);
+    
+    // operands far apart still round on the bits that were shifted out
+    BFloat16 tiny = BFloat16::fromBits(0x3B81); // just over half an ulp of 1
+    assert((BFloat16(1.0f) + tiny).bits() == 0x3F81);
+    
+    // signed zeros and the subnormal / normal boundary
+    assert((BFloat16(0.0f) + BFloat16(-0.0f)).bits() == 0x0000);
+    assert((BFloat16(-0.0f) + BFloat16(-0.0f)).bits() == 0x8000);
+    assert((BFloat16(1.5f) - BFloat16(1.5f)).bits() == 0x0000);
+    assert((BFloat16::fromBits(0x007F) + BFloat16::fromBits(0x0001)).bits() == 0x0080);
+    assert((BFloat16::fromBits(0x0080) - BFloat16::fromBits(0x0001)).bits() == 0x007F);
+    
+    std::cout << std::dec << trials << " random sums are correctly rounded" << std::endl;
+}
+
+void testDivideRounding() {
+    std::cout << "\nTesting Division Rounding" << std::endl;
+    
+    // every divisor bit pattern, specials and subnormals included, against
+    // the double quotient rounded to bf16 (safe for the same reason as the
+    // sums above)
+    uint32_t state = 4242;
+    size_t mismatches = 0;
+    size_t trials = 0;
+    for (uint32_t y = 0; y <= 0xFFFF; ++y) {
+        for (int k = 0; k < 32; ++k) {
+            state = state * 1664525u + 1013904223u;
+            BFloat16 a = BFloat16::fromBits(static_cast<uint16_t>(state >> 16));
+            BFloat16 b = BFloat16::fromBits(static_cast<uint16_t>(y));
+            
+            BFloat16 expected(a.toDouble() / b.toDouble());
+            BFloat16 got = a / b;
+            if (expected.isNaN() ? !got.isNaN() : got.bits() != expected.bits()) {
+                mismatches++;
+            }
+            trials++;
+        }
+    }
+    assert(mismatches == 0);
+    
+    assert((BFloat16(1.0f) / BFloat16(3.0f)).bits() == 0x3EAB);
+    assert((BFloat16(1.0f) / BFloat16::fromBits(0x3F81)).bits() == 0x3F7E);
+    
+    // overflow, underflow to the smallest subnormal, and ties at the bottom
+    assert((BFloat16::fromBits(0x7F7F) / BFloat16(0.5f)).isInfinity());
+    assert((BFloat16::fromBits(0x0080) / BFloat16(128.0f)).bits() == 0x0001);
+    assert((BFloat16::fromBits(0x0001) / BFloat16(2.0f)).bits() == 0x0000);
+    assert((BFloat16::fromBits(0x0003) / BFloat16(2.0f)).bits() == 0x0002);
+    assert((BFloat16::fromBits(0x0001) / BFloat16::fromBits(0x0001)).bits() == 0x3F80);
+    
+    std::cout << std::dec << trials << " random quotients are correctly rounded" << std::endl;
+}
+
+void testConstexprAccessors() {
+    std::cout << "\nTesting Constexpr Accessors" << std::endl;
+    
+    // evaluated at compile time, these fail the build if they stop being constexpr
+    static_assert(BFloat16::fromBits(0x3F80).exponent() == 127, "1.0 exponent");
+    static_assert(BFloat16::epsilon().unbiasedExponent() == -7, "epsilon is 2^-7");
+    static_assert(BFloat16::nan().isNaN() && !BFloat16::nan().isFinite(), "nan");
+    static_assert(BFloat16::infinity(true).isInfinity() && BFloat16::infinity(true).sign(), "-inf");
+    static_assert(BFloat16::zero(true).isZero() && BFloat16::zero(true).isNegative(), "-0");
+    static_assert(BFloat16::fromBits(0x0001).isSubnormal(), "min subnormal");
+    static_assert(BFloat16::fromFP32Bits(0x3F808000u).bits() == 0x3F80, "tie rounds to even");
+    static_assert(BFloat16::fromFP32Bits(0x3F818000u).bits() == 0x3F82, "tie rounds to even");
+    
+    // classify every pattern once: each one falls in exactly one class
+    int zeros = 0, subnormals = 0, normals = 0, infinities = 0, nans = 0;
+    for (uint32_t i = 0; i < 65536; ++i) {
+        BFloat16 v = BFloat16::fromBits(static_cast<uint16_t>(i));
+        int classes = v.isZero() + v.isSubnormal() + v.isNormal() + v.isInfinity() + v.isNaN();
+        assert(classes == 1);
+        assert(v.isFinite() == !(v.isInfinity() || v.isNaN()));
+        zeros += v.isZero();
+        subnormals += v.isSubnormal();
+        normals += v.isNormal();
+        infinities += v.isInfinity();
+        nans += v.isNaN();
+    }
+    assert(zeros == 2 && infinities == 2 && subnormals == 254 && nans == 254);
+    std::cout << std::dec << "zero: " << zeros << ", subnormal: " << subnormals << ", normal: " << normals
+              << ", infinity: " << infinities << ", nan: " << nans << std::endl;
+}
+
+void testBulkConversion() {
+    std::cout << "\nTesting Bulk Conversion" << std::endl;
+    std::cout << "Detected SIMD level: " << simdLevelName(detectSimdLevel()) << std::endl;
+    
+    // every bf16 pattern, then every fp32 pattern that rounds into it with
+    // the low half swept through the tie / carry / nan payload cases
+    const uint32_t low_halves[] = {0x0000, 0x0001, 0x7FFF, 0x8000, 0x8001, 0xFFFF};
+    const size_t n = 65536 * 6 + 13; // odd length to exercise the tails
+    
+    std::vector<float> src(n);
+    for (size_t i = 0; i + 13 < n; ++i) {
+        uint32_t fp32_bits = (static_cast<uint32_t>(i / 6) << 16) | low_halves[i % 6];
+        std::memcpy(&src[i], &fp32_bits, sizeof(float));
+    }
+    for (size_t i = n - 13; i < n; ++i) {
+        src[i] = static_cast<float>(i) * 0.37f;
+    }
+    
+    std::vector<BFloat16> expected(n);
+    for (size_t i = 0; i < n; ++i) {
+        expected[i] = BFloat16(src[i]);
+    }
+    
+    const SimdLevel levels[] = {SimdLevel::Scalar, SimdLevel::AVX2, SimdLevel::AVX512,
+                                SimdLevel::AVX512BF16, SimdLevel::NEON};
+    for (SimdLevel level : levels) {
+        if (!simdLevelSupported(level)) continue;
+        
+        std::vector<BFloat16> narrowed(n);
+        std::vector<float> widened(n);
+        for (size_t len : {n, size_t(0), size_t(1), size_t(15), size_t(17), size_t(33)}) {
+            convertToBF16(src.data(), narrowed.data(), len, level);
+            for (size_t i = 0; i < len; ++i) {
+                assert(narrowed[i].bits() == expected[i].bits());
+            }
+            
+            convertToFloat(narrowed.data(), widened.data(), len, level);
+            for (size_t i = 0; i < len; ++i) {
+                uint32_t fp32_bits;
+                std::memcpy(&fp32_bits, &widened[i], sizeof(float));
+                assert(fp32_bits == expected[i].toFP32Bits());
+            }
+        }
+        std::cout << simdLevelName(level) << ": matches scalar on " << std::dec << n << " values" << std::endl;
+    }
+    
+    // doubles at, next to and a hair off every halfway point, where going
+    // through the nearest float first would round twice, plus the float
+    // overflow and underflow edges
+    std::vector<double> wide;
+    for (uint32_t bits = 0; bits < 0xFFFF; ++bits) {
+        double lo = BFloat16::fromBits(static_cast<uint16_t>(bits)).toDouble();
+        double hi = BFloat16::fromBits(static_cast<uint16_t>(bits + 1)).toDouble();
+        double tie = lo + (hi - lo) / 2;
+        double hair = (hi - lo) * 0x1p-30;
+        for (double d : {lo, tie, tie + hair, tie - hair, lo + hair}) wide.push_back(d);
+    }
+    for (double d : {1e39, -1e39, 3.4e38, 3.402823466e38, 1.7976931348623157e308, 1e-310, -1e-46, 1e-41}) {
+        wide.push_back(d);
+    }
+    std::vector<BFloat16> wide_expected(wide.size());
+    for (size_t i = 0; i < wide.size(); ++i) wide_expected[i] = BFloat16(wide[i]);
+    for (SimdLevel level : levels) {
+        if (!simdLevelSupported(level)) continue;
+        std::vector<BFloat16> got(wide.size());
+        for (size_t len : {wide.size(), size_t(0), size_t(1), size_t(15), size_t(17), size_t(33)}) {
+            convertToBF16(wide.data(), got.data(), len, level);
+            for (size_t i = 0; i < len; ++i) assert(got[i].bits() == wide_expected[i].bits());
+        }
+    }
+    std::vector<BFloat16> got(wide.size());
+    convertToBF16(wide.data(), got.data(), wide.size());
+    assert(std::memcmp(got.data(), wide_expected.data(), got.size() * sizeof(BFloat16)) == 0);
+    std::cout << "double narrowing matches BFloat16(double) on " << wide.size() << " values" << std::endl;
+}
+
+void testTables() {
+    std::cout << "\nTesting Lookup Tables" << std::endl;
+    
+    // the first caller builds the tables, here under Flush: the shared
+    // entries must still be the ieee ones
+    const BFloat16Tables* built;
+    {
+        SubnormalScope flush(SubnormalMode::Flush);
+        built = &BFloat16Tables::instance();
+        assert(built->sqrt(BFloat16::fromBits(0x0040)).bits() == 0x1FB5);
+        assert(built->reciprocal(BFloat16::fromBits(0x7F00)).bits() == 0x0040);
+    }
+    const BFloat16Tables& tables = BFloat16Tables::instance();
+    assert(&tables == built);
+    
+    // exhaustive: the tables must reproduce the scalar ops for every pattern
+    const BFloat16 one(1.0f);
+    for (uint32_t i = 0; i < BFloat16Tables::TABLE_SIZE; ++i) {
+        BFloat16 x = BFloat16::fromBits(static_cast<uint16_t>(i));
+        assert(tables.sqrt(x).bits() == x.sqrt().bits());
+        assert(tables.reciprocal(x).bits() == (one / x).bits());
+        assert(tables.abs(x).bits() == x.abs().bits());
+        assert(tables.negate(x).bits() == (-x).bits());
+        assert(x.isNaN() || tables.toFloat(x) == x.toFloat());
+        assert(tables.isZero(x) == x.isZero());
+        assert(tables.isSubnormal(x) == x.isSubnormal());
+        assert(tables.isNormal(x) == x.isNormal());
+        assert(tables.isInfinity(x) == x.isInfinity());
+        assert(tables.isNaN(x) == x.isNaN());
+        assert(tables.isFinite(x) == x.isFinite());
+    }
+    
+    BFloat16 values[] = {BFloat16(4.0f), BFloat16(2.0f), BFloat16(0.25f)};
+    tables.sqrt(values, values, 3); // in place
+    std::cout << std::fixed << std::setprecision(4);
+    std::cout << "sqrt {4, 2, 0.25} = {" << values[0] << ", " << values[1] << ", "
+              << values[2] << "}" << std::endl;
+    std::cout << "All " << std::dec << BFloat16Tables::TABLE_SIZE
+              << " table entries match the scalar ops" << std::endl;
+}
+
+void testVector() {
+    std::cout << "\nTesting Vector Container" << std::endl;
+    
+    BF16Vector a(1000, BFloat16(1.5f));
+    BF16Vector b(1000, BFloat16(0.25f));
+    assert(reinterpret_cast<uintptr_t>(a.data()) % BF16Vector::ALIGNMENT == 0);
+    
+    // element-wise ops agree with the scalar operators
+    BF16Vector sum = a + b;
+    BF16Vector prod = a * b;
+    BF16Vector scaled = a * BFloat16(3.0f);
+    for (size_t i = 0; i < a.size(); ++i) {
+        assert(sum[i].bits() == (a[i] + b[i]).bits());
+        assert(prod[i].bits() == (a[i] * b[i]).bits());
+        assert(scaled[i].bits() == (a[i] * BFloat16(3.0f)).bits());
+    }
+    std::cout << "1.5 + 0.25 = " << sum[0] << ", 1.5 * 0.25 = " << prod[0]
+              << ", 1.5 * 3 = " << scaled[0] << std::endl;
+    
+    // temporaries from an arena never touch the heap
+    BF16Arena arena(64 * 1024);
+    BF16Vector x(256, arena, BFloat16(2.0f));
+    BF16Vector y = x * x;
+    assert(y.arena() == &arena && arena.used() == 2 * 256 * sizeof(BFloat16));
+    assert(reinterpret_cast<uintptr_t>(y.data()) % BF16Vector::ALIGNMENT == 0);
+    assert(y[255] == BFloat16(4.0f));
+    
+    // zero-copy view over raw bits
+    uint16_t raw[4] = {BFloat16(1.0f).bits(), BFloat16(2.0f).bits(), BFloat16(3.0f).bits(), BFloat16(4.0f).bits()};
+    BF16Vector view = BF16Vector::view(raw, 4);
+    assert(view.isView() && view.bits() == raw);
+    view *= BFloat16(2.0f);
+    assert(raw[3] == BFloat16(8.0f).bits());
+    
+    bool threw = false;
+    try {
+        view.push_back(BFloat16(1.0f));
+    } catch (const std::logic_error&) {
+        threw = true;
+    }
+    assert(threw);
+    
+    threw = false;
+    try {
+        a += view;
+    } catch (const std::invalid_argument&) {
+        threw = true;
+    }
+    assert(threw);
+    std::cout << "view scaled in place: raw[3] = " << BFloat16::fromBits(raw[3]) << std::endl;
+}
+
+void testLinalg() {
+    std::cout << "\nTesting Mixed-Precision Linear Algebra" << std::endl;
+    
+    // odd sizes that cross the mc/kc block sizes, so every edge tile,
+    // panel boundary and vector tail is exercised
+    const size_t m = 131, n = 53, k = 263;
+    std::vector<BFloat16> A(m * k), B(k * n), x(k);
+    uint32_t state = 12345;
+    auto next = [&state]() {
+        state = state * 1664525u + 1013904223u;
+        return static_cast<float>(state >> 8) / 16777216.0f * 2.0f - 1.0f;
+    };
+    for (BFloat16& v : A) v = BFloat16(next());
+    for (BFloat16& v : B) v = BFloat16(next());
+    for (BFloat16& v : x) v = BFloat16(next());
+    std::vector<float> C0(m * n);
+    for (float& v : C0) v = next();
+    
+    const float alpha = 1.5f, beta = -0.5f;
+    
+    // double reference; products are exact, only fp32 accumulation differs
+    std::vector<double> reference(m * n);
+    for (size_t i = 0; i < m; ++i) {
+        for (size_t j = 0; j < n; ++j) {
+            double acc = 0.0;
+            for (size_t p = 0; p < k; ++p) {
+                acc += A[i * k + p].toDouble() * B[p * n + j].toDouble();
+            }
+            reference[i * n + j] = alpha * acc + beta * C0[i * n + j];
+        }
+    }
+    
+    const SimdLevel levels[] = {SimdLevel::Scalar, SimdLevel::AVX2, SimdLevel::AVX512,
+                                SimdLevel::AVX512BF16, SimdLevel::NEON};
+    for (SimdLevel level : levels) {
+        if (!simdLevelSupported(level)) continue;
+        
+        std::vector<float> C = C0;
+        gemm(m, n, k, alpha, A.data(), k, B.data(), n, beta, C.data(), n, level);
+        double max_error = 0.0;
+        for (size_t i = 0; i < m * n; ++i) {
+            max_error = std::max(max_error, std::fabs(C[i] - reference[i]));
+        }
+        assert(max_error < 1e-4);
+        
+        // beta == 0 must not read C, poison it first
+        std::vector<float> D(m * n, std::numeric_limits<float>::quiet_NaN());
+        gemm(m, n, k, 1.0f, A.data(), k, B.data(), n, 0.0f, D.data(), n, level);
+        for (size_t i = 0; i < m * n; ++i) {
+            assert(!std::isnan(D[i]));
+        }
+        
+        float d = dot(A.data(), x.data(), k, level);
+        double dot_reference = 0.0;
+        for (size_t p = 0; p < k; ++p) {
+            dot_reference += A[p].toDouble() * x[p].toDouble();
+        }
+        assert(std::fabs(d - dot_reference) < 1e-4);
+        
+        std::cout << simdLevelName(level) << ": gemm " << m << "x" << n << "x" << k
+                  << " max error " << std::scientific << max_error << std::fixed << std::endl;
+    }
+    
+    // gemv agrees with gemm on a one-column B
+    std::vector<float> y(m, 0.25f), y_gemm(m, 0.25f);
+    gemv(m, k, alpha, A.data(), k, x.data(), beta, y.data());
+    gemm(m, 1, k, alpha, A.data(), k, x.data(), 1, beta, y_gemm.data(), 1);
+    for (size_t i = 0; i < m; ++i) {
+        assert(std::fabs(y[i] - y_gemm[i]) < 1e-4);
+    }
+    
+    // emulated mode is the naive loop through the FP32 type, bit for bit
+    std::vector<float> C = C0;
+    gemm(m, n, k, alpha, A.data(), k, B.data(), n, beta, C.data(), n, LinalgMode::Emulated);
+    for (size_t i = 0; i < m; ++i) {
+        for (size_t j = 0; j < n; ++j) {
+            FP32 acc;
+            for (size_t p = 0; p < k; ++p) {
+                acc += FP32(A[i * k + p].toFloat()) * FP32(B[p * n + j].toFloat());
+            }
+            FP32 expected = FP32(alpha) * acc + FP32(beta) * FP32(C0[i * n + j]);
+            assert(C[i * n + j] == expected.toFloat());
+        }
+    }
+    
+    std::vector<float> y_emulated(m);
+    gemv(m, k, 1.0f, A.data(), k, x.data(), 0.0f, y_emulated.data(), LinalgMode::Emulated);
+    for (size_t i = 0; i < m; ++i) {
+        FP32 acc;
+        for (size_t p = 0; p < k; ++p) {
+            acc += FP32(A[i * k + p].toFloat()) * FP32(x[p].toFloat());
+        }
+        assert(y_emulated[i] == acc.toFloat());
+    }
+    assert(dot(A.data(), x.data(), k, LinalgMode::Emulated) == y_emulated[0]);
+    std::cout << "emulated gemm/gemv/dot match the FP32 loop bit for bit" << std::endl;
+}
+
+void testParallel() {
+    std::cout << "\nTesting Parallel Bulk Ops" << std::endl;
+    
+    const size_t n = 300007;
+    std::vector<float> src(n);
+    for (size_t i = 0; i < n; ++i) {
+        src[i] = std::sin(static_cast<float>(i)) * 100.0f;
+    }
+    
+    // serial references from the pinned kernels and the scalar loops
+    std::vector<BFloat16> expected(n), a(n), b(n), sum(n);
+    convertToBF16(src.data(), expected.data(), n, SimdLevel::Scalar);
+    for (size_t i = 0; i < n; ++i) {
+        a[i] = expected[i];
+        b[i] = expected[n - 1 - i];
+        sum[i] = a[i] + b[i];
+    }
+    float serial_dot = dot(a.data(), b.data(), n);
+    
+    size_t old_threshold = parallelThreshold();
+    setParallelThreshold(0);
+    for (size_t threads : {2, 4}) {
+        setThreadCount(threads);
+        
+        std::vector<BFloat16> narrowed(n), added(n);
+        convertToBF16(src.data(), narrowed.data(), n);
+        BFloat16::add(a.data(), b.data(), added.data(), n);
+        for (size_t i = 0; i < n; ++i) {
+            assert(narrowed[i].bits() == expected[i].bits());
+            assert(added[i].bits() == sum[i].bits());
+        }
+        
+        // chunked dot rounds the same way whatever the thread count
+        assert(dot(a.data(), b.data(), n) == serial_dot);
+    }
+    
+    // gemm row blocks are independent, so splitting them changes no bits
+    const size_t m = 250, k = 64, cols = 40;
+    std::vector<float> C_serial(m * cols), C_parallel(m * cols);
+    setThreadCount(1);
+    gemm(m, cols, k, 1.0f, a.data(), k, b.data(), cols, 0.0f, C_serial.data(), cols);
+    setThreadCount(4);
+    gemm(m, cols, k, 1.0f, a.data(), k, b.data(), cols, 0.0f, C_parallel.data(), cols);
+    assert(C_serial == C_parallel);
+    
+    setThreadCount(0);
+    setParallelThreshold(old_threshold);
+    std::cout << "convert / add / dot / gemm match on 1, 2 and 4 threads, dot = "
+              << std::fixed << std::setprecision(2) << serial_dot << std::endl;
+}
+
+// neighbours in the bf16 order, stepping across zero
+static BFloat16 nextUp(BFloat16 x) {
+    if (x.isZero()) return BFloat16::fromBits(0x0001);
+    return BFloat16::fromBits(static_cast<uint16_t>(x.isNegative() ? x.bits() - 1 : x.bits() + 1));
+}
+
+static BFloat16 nextDown(BFloat16 x) {
+    if (x.isZero()) return BFloat16::fromBits(0x8001);
+    return BFloat16::fromBits(static_cast<uint16_t>(x.isNegative() ? x.bits() + 1 : x.bits() - 1));
+}
+
+// the exact (or, for division, faithful enough) double result rounded in
+// the given mode: round to nearest through float, then step once if that
+// landed on the wrong side
+static BFloat16 roundReference(double exact, RoundingMode mode) {
+    BFloat16 nearest(static_cast<float>(exact));
+    double value = nearest.toDouble();
+    switch (mode) {
+    case RoundingMode::Upward:   return value < exact ? nextUp(nearest) : nearest;
+    case RoundingMode::Downward: return value > exact ? nextDown(nearest) : nearest;
+    case RoundingMode::TowardZero:
+        if (exact > 0 && value > exact) return nextDown(nearest);
+        if (exact < 0 && value < exact) return nextUp(nearest);
+        return nearest;
+    default:                     return nearest;
+    }
+}
+
+void testRoundingModes() {
+    std::cout << "\nTesting Rounding Modes" << std::endl;
+    
+    const float just_over = 1.0f + std::ldexp(1.0f, -9);   // a quarter ulp above 1
+    assert(BFloat16(just_over, RoundingMode::NearestEven).bits() == 0x3F80);
+    assert(BFloat16(just_over, RoundingMode::TowardZero).bits() == 0x3F80);
+    assert(BFloat16(just_over, RoundingMode::Upward).bits() == 0x3F81);
+    assert(BFloat16(just_over, RoundingMode::Downward).bits() == 0x3F80);
+    assert(BFloat16(-just_over, RoundingMode::Upward).bits() == 0xBF80);
+    assert(BFloat16(-just_over, RoundingMode::Downward).bits() == 0xBF81);
+    
+    // overflow saturates when the mode rounds toward zero
+    const float big = std::numeric_limits<float>::max();
+    assert(BFloat16(big, RoundingMode::TowardZero).bits() == 0x7F7F);
+    assert(BFloat16(big, RoundingMode::Upward).isInfinity());
+    assert(BFloat16(-big, RoundingMode::Upward).bits() == 0xFF7F);
+    assert(BFloat16(-big, RoundingMode::Downward).isInfinity());
+    
+    // random operations in every directed mode against the double result
+    const RoundingMode directed[] = {RoundingMode::TowardZero, RoundingMode::Upward, RoundingMode::Downward};
+    uint32_t state = 77;
+    size_t mismatches = 0;
+    size_t checked = 0;
+    for (size_t i = 0; i < 300000; ++i) {
+        state = state * 1664525u + 1013904223u;
+        BFloat16 a = BFloat16::fromBits(static_cast<uint16_t>(state >> 16));
+        BFloat16 b = BFloat16::fromBits(static_cast<uint16_t>(state));
+        if (!a.isFinite() || !b.isFinite()) continue;
+        
+        for (RoundingMode mode : directed) {
+            // double is exact for the sum as long as the exponents are close
+            if (std::abs(a.exponent() - b.exponent()) < 30) {
+                BFloat16 got = BFloat16::add(a, b, mode);
+                mismatches += got != roundReference(a.toDouble() + b.toDouble(), mode);
+                checked++;
+            }
+            BFloat16 product = BFloat16::multiply(a, b, mode);
+            mismatches += product != roundReference(a.toDouble() * b.toDouble(), mode);
+            if (!b.isZero()) {
+                BFloat16 quotient = BFloat16::divide(a, b, mode);
+                mismatches += quotient != roundReference(a.toDouble() / b.toDouble(), mode);
+                checked++;
+            }
+            checked++;
+        }
+    }
+    assert(mismatches == 0);
+    
+    // exact cancellation gives -0 only when rounding down
+    BFloat16 x(3.25f);
+    assert(BFloat16::subtract(x, x, RoundingMode::Downward).bits() == 0x8000);
+    assert(BFloat16::subtract(x, x, RoundingMode::Upward).bits() == 0x0000);
+    assert(BFloat16::fma(x, BFloat16(1.0f), -x, RoundingMode::Downward).bits() == 0x8000);
+    
+    // stochastic: up with probability equal to the dropped fraction
+    StochasticRng::seed(1);
+    const size_t draws = 100000;
+    size_t ups = 0;
+    for (size_t i = 0; i < draws; ++i) {
+        ups += BFloat16(just_over, RoundingMode::Stochastic).bits() == 0x3F81;
+    }
+    double up_rate = static_cast<double>(ups) / draws;
+    assert(up_rate > 0.24 && up_rate < 0.26);
+    assert(BFloat16(std::nanf(""), RoundingMode::Stochastic).isNaN());
+    assert(BFloat16(1.5f, RoundingMode::Stochastic).bits() == 0x3FC0);   // exact values never move
+    
+    // an accumulator that round to nearest freezes keeps growing on average
+    BFloat16 nearest_sum(1.0f);
+    BFloat16 stochastic_sum(1.0f);
+    const BFloat16 step(std::ldexp(1.0f, -10));
+    for (int i = 0; i < 4096; ++i) {
+        nearest_sum += step;
+        stochastic_sum = BFloat16::add(stochastic_sum, step, RoundingMode::Stochastic);
+    }
+    assert(nearest_sum.toFloat() == 1.0f);
+    assert(stochastic_sum.toFloat() > 4.5f && stochastic_sum.toFloat() < 5.5f);
+    
+    // bulk conversion draws the same words as a scalar loop, whatever the
+    // kernel or thread count, and always lands on a neighbour
+    const size_t n = 100003;
+    std::vector<float> src(n);
+    for (size_t i = 0; i < n; ++i) {
+        src[i] = std::sin(static_cast<float>(i)) * 1000.0f;
+    }
+    std::vector<BFloat16> expected(n), got(n);
+    StochasticRng::seed(42);
+    for (size_t i = 0; i < n; ++i) {
+        expected[i] = BFloat16(src[i], RoundingMode::Stochastic);
+        BFloat16 down(src[i], RoundingMode::Downward);
+        BFloat16 up(src[i], RoundingMode::Upward);
+        assert(expected[i].bits() == down.bits() || expected[i].bits() == up.bits());
+    }
+    uint32_t following = StochasticRng::next();
+    
+    for (SimdLevel level : {SimdLevel::Scalar, SimdLevel::AVX2, SimdLevel::AVX512, SimdLevel::NEON}) {
+        StochasticRng::seed(42);
+        convertToBF16(src.data(), got.data(), n, RoundingMode::Stochastic, level);
+        for (size_t i = 0; i < n; ++i) {
+            assert(got[i].bits() == expected[i].bits());
+        }
+        assert(StochasticRng::next() == following);
+    }
+    
+    size_t old_threshold = parallelThreshold();
+    setParallelThreshold(0);
+    for (size_t threads : {1, 4}) {
+        setThreadCount(threads);
+        StochasticRng::seed(42);
+        convertToBF16(src.data(), got.data(), n, RoundingMode::Stochastic);
+        for (size_t i = 0; i < n; ++i) {
+            assert(got[i].bits() == expected[i].bits());
+        }
+        
+        // directed modes in bulk match the scalar constructor
+        convertToBF16(src.data(), got.data(), n, RoundingMode::Upward);
+        for (size_t i = 0; i < n; ++i) {
+            assert(got[i].bits() == BFloat16(src[i], RoundingMode::Upward).bits());
+        }
+    }
+    setThreadCount(0);
+    setParallelThreshold(old_threshold);
+    
+    // a span that crosses a 2^32 counter boundary changes block key midway
+    const size_t span = 40;
+    uint64_t first;
+    StochasticRng::seed(9);
+    StochasticRng::reserve((uint64_t(1) << 32) - 17, first);
+    for (size_t i = 0; i < span; ++i) {
+        expected[i] = BFloat16(src[i], RoundingMode::Stochastic);
+    }
+    for (SimdLevel level : {SimdLevel::Scalar, SimdLevel::AVX2, SimdLevel::AVX512}) {
+        StochasticRng::seed(9);
+        StochasticRng::reserve((uint64_t(1) << 32) - 17, first);
+        convertToBF16(src.data(), got.data(), span, RoundingMode::Stochastic, level);
+        for (size_t i = 0; i < span; ++i) {
+            assert(got[i].bits() == expected[i].bits());
+        }
+    }
+    
+    std::cout << checked << " directed ops correctly rounded, stochastic up rate "
+              << std::fixed << std::setprecision(4) << up_rate
+              << ", 4096 x 2^-10 sums to " << stochastic_sum.toFloat() << std::endl;
+}
+
+void testReductions() {
+    std::cout << "\nTesting Reductions" << std::endl;
+    
+    // uniform [0, 1) terms against a double reference
+    const size_t n = 300007;
+    std::vector<BFloat16> x(n), y(n);
+    uint32_t state = 4242;
+    double exact_sum = 0.0;
+    double exact_dot = 0.0;
+    for (size_t i = 0; i < n; ++i) {
+        state = state * 1664525u + 1013904223u;
+        x[i] = BFloat16(static_cast<float>(state >> 8) * 0x1p-24f);
+        y[i] = BFloat16(1.0f - x[i].toFloat() * 0.5f);
+        exact_sum += x[i].toDouble();
+        exact_dot += x[i].toDouble() * y[i].toDouble();
+    }
+    auto error = [](float got, double exact) { return std::fabs(got - exact) / std::fabs(exact); };
+    
+    // naive is the operator loop, bit for bit
+    BFloat16 loop_sum;
+    BFloat16 loop_dot;
+    for (size_t i = 0; i < n; ++i) {
+        loop_sum += x[i];
+        loop_dot += x[i] * y[i];
+    }
+    assert(sum(x.data(), n, Summation::Naive) == loop_sum.toFloat());
+    assert(dot(x.data(), y.data(), n, Summation::Naive) == loop_dot.toFloat());
+    
+    // the running bf16 sum stalls once its ulp outgrows the terms
+    double naive_error = error(loop_sum.toFloat(), exact_sum);
+    double pairwise_error = error(sum(x.data(), n, Summation::Pairwise), exact_sum);
+    double kahan_error = error(sum(x.data(), n, Summation::Kahan), exact_sum);
+    double neumaier_error = error(sum(x.data(), n, Summation::Neumaier), exact_sum);
+    double widened_error = error(sum(x.data(), n, Summation::Widened), exact_sum);
+    assert(naive_error > 0.9);
+    assert(pairwise_error < 0.02);
+    assert(kahan_error < 1e-3);
+    assert(neumaier_error < 1e-3);
+    assert(widened_error < 1e-5);
+    assert(error(dot(x.data(), y.data(), n, Summation::Kahan), exact_dot) < 1e-3);
+    assert(error(dot(x.data(), y.data(), n, Summation::Widened), exact_dot) < 1e-5);
+    
+    // Kahan loses the 1s next to a large term in the same lane, Neumaier
+    // keeps them
+    std::vector<BFloat16> spiky(64);
+    spiky[0] = BFloat16(1.0f);
+    spiky[16] = BFloat16(1048576.0f);
+    spiky[32] = BFloat16(1.0f);
+    spiky[48] = BFloat16(-1048576.0f);
+    assert(sum(spiky.data(), 64, Summation::Kahan) == 0.0f);
+    assert(sum(spiky.data(), 64, Summation::Neumaier) == 2.0f);
+    assert(sum(spiky.data(), 64, Summation::Widened) == 2.0f);
+    
+    const Summation methods[] = {Summation::Naive, Summation::Pairwise, Summation::Kahan,
+                                 Summation::Neumaier, Summation::Widened};
+    BFloat16 small[] = {BFloat16(3.0f), BFloat16(4.0f), BFloat16(1.0f), BFloat16(2.0f)};
+    for (Summation method : methods) {
+        assert(mean(small, 4, method) == 2.5f);
+        assert(norm2(small, 2, method) == 5.0f);
+        assert(dot(small, small + 2, 2, method) == 11.0f);
+        assert(sum(small, 0, method) == 0.0f && std::isnan(mean(small, 0, method)));
+    }
+    
+    // every simd level gives the scalar bits, short tails included
+    size_t compared = 0;
+    for (size_t length : {size_t(1), size_t(7), size_t(15), size_t(16), size_t(17), size_t(255),
+                          size_t(256), size_t(257), size_t(5000), n}) {
+        for (Summation method : methods) {
+            float scalar_sum = sum(x.data(), length, method, SimdLevel::Scalar);
+            float scalar_dot = dot(x.data(), y.data(), length, method, SimdLevel::Scalar);
+            for (SimdLevel level : {SimdLevel::AVX2, SimdLevel::AVX512, SimdLevel::AVX512BF16}) {
+                assert(sum(x.data(), length, method, level) == scalar_sum);
+                assert(dot(x.data(), y.data(), length, method, level) == scalar_dot);
+                compared += 2;
+            }
+        }
+    }
+    
+    // and so does any thread count
+    size_t old_threshold = parallelThreshold();
+    setParallelThreshold(0);
+    setThreadCount(1);
+    std::vector<float> serial;
+    for (Summation method : methods) serial.push_back(dot(x.data(), y.data(), n, method));
+    setThreadCount(4);
+    for (size_t m = 0; m < 5; ++m) assert(dot(x.data(), y.data(), n, methods[m]) == serial[m]);
+    setThreadCount(0);
+    setParallelThreshold(old_threshold);
+    
+    std::cout << std::nouppercase << std::scientific << std::setprecision(2) << "relative error of a " << std::dec << n
+              << " term sum: naive " << naive_error << ", pairwise " << pairwise_error
+              << ", kahan " << kahan_error << ", neumaier " << neumaier_error
+              << ", widened " << widened_error << "; " << compared << " kernel results match scalar" << std::endl;
+}
+
+// both fp8 layouts: table ops against the double result rounded through
+// float, then every simd conversion against the scalar constructors
+template <typename T>
+static void checkFP8(const char* name) {
+    // every pair through all four operators, scalar and batched
+    std::vector<T> a(65536), b(65536), sums(65536), diffs(65536), products(65536), quotients(65536);
+    for (uint32_t i = 0; i < 65536; ++i) {
+        a[i] = T::fromBits(static_cast<uint8_t>(i >> 8));
+        b[i] = T::fromBits(static_cast<uint8_t>(i));
+    }
+    T::add(a.data(), b.data(), sums.data(), a.size());
+    T::subtract(a.data(), b.data(), diffs.data(), a.size());
+    T::multiply(a.data(), b.data(), products.data(), a.size());
+    T::divide(a.data(), b.data(), quotients.data(), a.size());
+    
+    size_t mismatches = 0;
+    for (uint32_t i = 0; i < 65536; ++i) {
+        double x = a[i].toDouble();
+        double y = b[i].toDouble();
+        const T expected[] = {T(static_cast<float>(x + y)), T(static_cast<float>(x - y)),
+                              T(static_cast<float>(x * y)), T(static_cast<float>(x / y))};
+        const T scalar[] = {a[i] + b[i], a[i] - b[i], a[i] * b[i], a[i] / b[i]};
+        const T batched[] = {sums[i], diffs[i], products[i], quotients[i]};
+        for (int op = 0; op < 4; ++op) {
+            bool ok = expected[op].isNaN() ? scalar[op].isNaN()
+                                           : scalar[op].bits() == expected[op].bits();
+            mismatches += !ok || batched[op].bits() != scalar[op].bits();
+        }
+    }
+    assert(mismatches == 0);
+    
+    // narrowing sources: every bf16 pattern widened with the low half swept
+    // through tie / carry / nan payload cases, plus an odd tail
+    const uint32_t low_halves[] = {0x0000, 0x0001, 0x7FFF, 0x8000, 0x8001, 0xFFFF};
+    const size_t n = 65536 * 6 + 13;
+    std::vector<float> src(n);
+    for (size_t i = 0; i + 13 < n; ++i) {
+        uint32_t fp32_bits = (static_cast<uint32_t>(i / 6) << 16) | low_halves[i % 6];
+        std::memcpy(&src[i], &fp32_bits, sizeof(float));
+    }
+    for (size_t i = n - 13; i < n; ++i) {
+        src[i] = static_cast<float>(i) * 1e-7f;
+    }
+    std::vector<BFloat16> bf16_src(65536);
+    for (uint32_t i = 0; i < 65536; ++i) {
+        bf16_src[i] = BFloat16::fromBits(static_cast<uint16_t>(i));
+    }
+    std::vector<T> patterns(256 * 3 + 7);
+    for (size_t i = 0; i < patterns.size(); ++i) {
+        patterns[i] = T::fromBits(static_cast<uint8_t>(i * 13));
+    }
+    
+    const SimdLevel levels[] = {SimdLevel::Scalar, SimdLevel::AVX2, SimdLevel::AVX512,
+                                SimdLevel::AVX512BF16, SimdLevel::NEON};
+    for (SimdLevel level : levels) {
+        if (!simdLevelSupported(level)) continue;
+        
+        std::vector<T> narrowed(n);
+        std::vector<float> widened(patterns.size());
+        std::vector<BFloat16> widened_bf16(patterns.size());
+        for (size_t len : {size_t(0), size_t(1), size_t(15), size_t(17), size_t(33), patterns.size()}) {
+            convertToFloat(patterns.data(), widened.data(), len, level);
+            convertToBF16(patterns.data(), widened_bf16.data(), len, level);
+            for (size_t i = 0; i < len; ++i) {
+                uint32_t fp32_bits;
+                std::memcpy(&fp32_bits, &widened[i], sizeof(float));
+                assert(fp32_bits == patterns[i].toFP32Bits());
+                assert(widened_bf16[i].bits() == patterns[i].toBFloat16().bits());
+            }
+        }
+        
+        convertToFP8(src.data(), narrowed.data(), n, level);
+        for (size_t i = 0; i < n; ++i) {
+            assert(narrowed[i].bits() == T(src[i]).bits());
+        }
+        convertToFP8(bf16_src.data(), narrowed.data(), 65536 - 5, level);
+        for (size_t i = 0; i < 65536 - 5; ++i) {
+            assert(narrowed[i].bits() == T(bf16_src[i]).bits());
+        }
+    }
+    
+    // the round trip through bf16 is exact
+    for (uint32_t i = 0; i < 256; ++i) {
+        T x = T::fromBits(static_cast<uint8_t>(i));
+        assert(x.isNaN() || T(x.toBFloat16()).bits() == x.bits());
+    }
+    std::cout << name << ": " << 4 * 65536 << " table results and " << n
+              << " conversions per simd level match" << std::endl;
+}
+
+void testFP8() {
+    std::cout << "\nTesting FP8" << std::endl;
+    
+    static_assert(FP8E4M3::max().bits() == 0x7E && FP8E5M2::max().bits() == 0x7B, "largest finite");
+    static_assert(FP8E4M3::Format::EXPONENT_BIAS == 7 && FP8E5M2::Format::EXPONENT_BIAS == 15, "bias");
+    
+    // e4m3 is e4m3fn: the top binade is finite up to 448, past that is nan
+    assert(FP8E4M3::max().toFloat() == 448.0f && FP8E4M3::fromBits(0x78).toFloat() == 256.0f);
+    assert(FP8E4M3(240.0f).bits() == 0x77u && FP8E4M3(248.0f).bits() == 0x78u);
+    assert(FP8E4M3(464.0f).bits() == 0x7Eu && FP8E4M3(-480.0f).bits() == 0xFFu);   // tie to even, overflow
+    assert(FP8E4M3(INFINITY).isNaN() && FP8E4M3::infinity().isNaN());
+    assert((FP8E4M3::max() + FP8E4M3::max()).isNaN() && (FP8E4M3(1.0f) / FP8E4M3(0.0f)).isNaN());
+    assert((FP8E4M3(224.0f) * FP8E4M3(2.0f)).bits() == 0x7Eu);
+    assert(FP8E4M3(std::ldexp(1.0f, -9)).bits() == 0x01u);   // smallest subnormal
+    assert(FP8E4M3(std::ldexp(1.0f, -10)).bits() == 0x00u);  // tie to even
+    assert(FP8E5M2(57344.0f).bits() == 0x7Bu && FP8E5M2(-61440.0f).isInfinity());
+    assert(FP8E5M2(BFloat16(1.5f)).bits() == 0x3Eu);
+    assert((FP8E4M3(1.0f) + FP8E4M3(0.0625f)).bits() == FP8E4M3(1.0f).bits());
+    assert((FP8E4M3(3.0f) / FP8E4M3(2.0f)).toFloat() == 1.5f);
+    
+    // nan and infinity patterns
+    int nans = 0;
+    int infinities = 0;
+    for (uint32_t i = 0; i < 256; ++i) {
+        FP8E4M3 x = FP8E4M3::fromBits(static_cast<uint8_t>(i));
+        nans += x.isNaN();
+        infinities += x.isInfinity();
+        assert(x.isZero() + x.isSubnormal() + x.isNormal() + x.isInfinity() + x.isNaN() == 1);
+    }
+    assert(nans == 2 && infinities == 0);
+    
+    checkFP8<FP8E4M3>("e4m3");
+    checkFP8<FP8E5M2>("e5m2");
+}
+
+// true if calling f throws E
+template <typename E, typename F>
+static bool throwsError(F f) {
+    try {
+        f();
+    } catch (const E&) {
+        return true;
+    }
+    return false;
+}
+
+void testTensorFiles() {
+    std::cout << "\nTesting Tensor Files" << std::endl;
+    
+    const std::string bf16_path = "tensor_test_bf16.nrt";
+    const std::string fp32_path = "tensor_test_fp32.nrt";
+    const std::string conv_path = "tensor_test_conv.nrt";
+    const std::string raw_path = "tensor_test_raw.f32";
+    
+    const size_t rows = 37, cols = 1000;
+    std::vector<float> values(rows * cols);
+    for (size_t i = 0; i < values.size(); ++i) {
+        values[i] = std::sin(0.001f * i) * 100.0f + 1e-3f * (i % 7);
+    }
+    std::vector<BFloat16> narrow(values.size());
+    convertToBF16(values.data(), narrow.data(), values.size());
+    std::vector<FP32> wide(values.begin(), values.end());
+    
+    // round trips, the data starts on the alignment
+    saveTensor(bf16_path, narrow.data(), {rows, cols});
+    saveTensor(fp32_path, wide.data(), {rows, cols});
+    {
+        MappedTensor t(bf16_path);
+        assert(t.info().dtype == TensorDType::BF16 && t.info().shape.size() == 2);
+        assert(t.info().shape[0] == rows && t.info().shape[1] == cols && t.size() == values.size());
+        assert(t.hostByteOrder());
+        assert(reinterpret_cast<uintptr_t>(t.data()) % TENSOR_DEFAULT_ALIGNMENT == 0);
+        assert(std::memcmp(t.bf16(), narrow.data(), narrow.size() * sizeof(BFloat16)) == 0);
+        assert(throwsError<std::logic_error>([&] { t.fp32(); }));
+        
+        MappedTensor moved(std::move(t));
+        assert(moved.bf16()[5].bits() == narrow[5].bits());
+    }
+    {
+        MappedTensor t(fp32_path);
+        assert(std::memcmp(t.fp32(), wide.data(), wide.size() * sizeof(FP32)) == 0);
+    }
+    
+    // streaming writer in uneven pieces, float input narrowed on the way
+    {
+        TensorWriter writer(conv_path, TensorDType::BF16, {values.size()}, 4096);
+        for (size_t i = 0; i < values.size(); i += 9999) {
+            writer.write(values.data() + i, std::min<size_t>(9999, values.size() - i));
+        }
+        writer.close();
+        MappedTensor t(conv_path);
+        assert(t.info().data_offset == 4096 && t.info().alignment == 4096);
+        assert(std::memcmp(t.bf16(), narrow.data(), narrow.size() * sizeof(BFloat16)) == 0);
+    }
+    
+    // fp32 -> bf16 rounds like convertToBF16, bf16 -> fp32 is exact
+    convertTensorFile(fp32_path, conv_path, TensorDType::BF16, 1000);
+    {
+        MappedTensor t(conv_path);
+        assert(t.info().shape[0] == rows && t.info().shape[1] == cols);
+        assert(std::memcmp(t.bf16(), narrow.data(), narrow.size() * sizeof(BFloat16)) == 0);
+    }
+    convertTensorFile(bf16_path, conv_path, TensorDType::FP32);
+    {
+        MappedTensor t(conv_path);
+        for (size_t i = 0; i < narrow.size(); ++i) {
+            assert(t.fp32()[i].toFloat() == narrow[i].toFloat());
+        }
+    }
+    
+    // headerless float32, as numpy's tofile() writes it
+    {
+        std::FILE* f = std::fopen(raw_path.c_str(), "wb");
+        std::fwrite(values.data(), sizeof(float), values.size(), f);
+        std::fclose(f);
+    }
+    convertRawFloatFile(raw_path, conv_path, {cols, rows}, TensorDType::BF16);
+    {
+        MappedTensor t(conv_path);
+        assert(t.info().shape[0] == cols && t.info().shape[1] == rows);
+        assert(std::memcmp(t.bf16(), narrow.data(), narrow.size() * sizeof(BFloat16)) == 0);
+    }
+    assert(throwsError<std::runtime_error>([&] {
+        convertRawFloatFile(raw_path, conv_path, {rows, cols + 1}, TensorDType::BF16);
+    }));
+    
+    // writer misuse
+    assert(throwsError<std::invalid_argument>([&] {
+        TensorWriter(conv_path, TensorDType::BF16, std::vector<size_t>(9, 1));
+    }));
+    assert(throwsError<std::invalid_argument>([&] { TensorWriter(conv_path, TensorDType::BF16, {4}, 48); }));
+    {
+        TensorWriter writer(conv_path, TensorDType::FP32, {4});
+        assert(throwsError<std::length_error>([&] { writer.write(values.data(), 5); }));
+        writer.write(values.data(), 3);
+        assert(throwsError<std::logic_error>([&] { writer.close(); }));
+    }
+    // the short file left behind is rejected as truncated
+    assert(throwsError<std::runtime_error>([&] { MappedTensor t(conv_path); }));
+    
+    // malformed files
+    const size_t offset = MappedTensor(bf16_path).info().data_offset;
+    std::vector<unsigned char> image;
+    {
+        std::FILE* f = std::fopen(bf16_path.c_str(), "rb");
+        image.resize(offset + 8 * sizeof(BFloat16));
+        size_t got = std::fread(image.data(), 1, image.size(), f);
+        std::fclose(f);
+        assert(got == image.size());
+    }
+    auto writeImage = [&](const std::vector<unsigned char>& bytes) {
+        std::FILE* f = std::fopen(conv_path.c_str(), "wb");
+        std::fwrite(bytes.data(), 1, bytes.size(), f);
+        std::fclose(f);
+    };
+    std::vector<unsigned char> bad = image;
+    bad[0] = 'X';
+    writeImage(bad);
+    assert(throwsError<std::runtime_error>([&] { MappedTensor t(conv_path); }));
+    writeImage(std::vector<unsigned char>(image.begin(), image.begin() + 40));
+    assert(throwsError<std::runtime_error>([&] { MappedTensor t(conv_path); }));
+    assert(throwsError<std::runtime_error>([&] { MappedTensor t("tensor_test_missing.nrt"); }));
+    
+    // alignment 1 is allowed, but not a data offset that misaligns the elements
+    std::vector<unsigned char> packed(image.begin(), image.begin() + TENSOR_HEADER_BYTES);
+    std::memset(&packed[12], 0, 4 + 8 + 8 + 8 * 8);
+    packed[12] = 1;
+    packed[16] = 1;
+    packed[24] = TENSOR_HEADER_BYTES;
+    packed[32] = 8;
+    packed.insert(packed.end(), image.begin() + offset, image.end());
+    writeImage(packed);
+    assert(MappedTensor(conv_path).size() == 8);
+    packed[24] = TENSOR_HEADER_BYTES + 1;
+    packed.insert(packed.begin() + TENSOR_HEADER_BYTES, 0);
+    writeImage(packed);
+    assert(throwsError<std::runtime_error>([&] { MappedTensor t(conv_path); }));
+    
+    // a big-endian file of 8 elements: mapped but unusable until converted
+    std::vector<unsigned char> big = image;
+    big[11] = 1;
+    std::memset(&big[32], 0, 8 * 8);
+    big[12] = 1;
+    big[32] = 8;
+    for (size_t i = 0; i < 8; ++i) {
+        uint16_t bits = narrow[i].bits();
+        big[offset + 2 * i] = static_cast<unsigned char>(bits >> 8);
+        big[offset + 2 * i + 1] = static_cast<unsigned char>(bits);
+    }
+    writeImage(big);
+    {
+        MappedTensor t(conv_path);
+        assert(t.size() == 8 && !t.hostByteOrder());
+        assert(throwsError<std::logic_error>([&] { t.bf16(); }));
+    }
+    convertTensorFile(conv_path, bf16_path, TensorDType::BF16);
+    {
+        MappedTensor t(bf16_path);
+        assert(t.hostByteOrder());
+        assert(std::memcmp(t.bf16(), narrow.data(), 8 * sizeof(BFloat16)) == 0);
+    }
+    std::cout << "round trips, streaming writes, conversion and malformed files checked" << std::endl;
+    
+    std::remove(bf16_path.c_str());
+    std::remove(fp32_path.c_str());
+    std::remove(conv_path.c_str());
+    std::remove(raw_path.c_str());
+}
+
+void testTensorPipeline() {
+    std::cout << "\nTesting Pipelined Conversion" << std::endl;
+    
+    const std::string raw_path = "pipeline_test.f64";
+    const std::string fp32_path = "pipeline_test_fp32.nrt";
+    const std::string out_path = "pipeline_test_out.nrt";
+    const std::string again_path = "pipeline_test_again.nrt";
+    
+    // a few chunks and a ragged end, with a nan, infinities and a value
+    // past bf16's largest
+    const size_t n = 3 * 4096 + 777;
+    std::vector<double> values(n);
+    uint32_t state = 77;
+    for (size_t i = 0; i < n; ++i) {
+        state = state * 1664525u + 1013904223u;
+        values[i] = std::ldexp(static_cast<double>(state) / 4294967296.0 - 0.5, static_cast<int>(i % 41) - 20);
+    }
+    values[5] = 0.0;
+    values[100] = std::nan("");
+    values[101] = HUGE_VAL;
+    values[102] = -HUGE_VAL;
+    values[103] = 3.4e38;
+    {
+        std::FILE* f = std::fopen(raw_path.c_str(), "wb");
+        std::fwrite(values.data(), sizeof(double), n, f);
+        std::fclose(f);
+    }
+    std::vector<BFloat16> expected(n);
+    convertToBF16(values.data(), expected.data(), n);
+    
+    // norms.py on the same data: the finite sources that stay finite
+    long double e1 = 0, e2 = 0, r1 = 0, r2 = 0;
+    double emax = 0, rmax = 0;
+    size_t changed = 0, nonzero = 0;
+    for (size_t i = 0; i < n; ++i) {
+        double x = expected[i].toDouble();
+        if (!std::isfinite(values[i]) || !std::isfinite(x)) continue;
+        double e = std::fabs(x - values[i]), r = std::fabs(values[i]);
+        e1 += e;
+        e2 += static_cast<long double>(e) * e;
+        r1 += r;
+        r2 += static_cast<long double>(r) * r;
+        emax = std::max(emax, e);
+        rmax = std::max(rmax, r);
+        changed += e != 0;
+        nonzero += r != 0;
+    }
+    auto close = [](double got, long double want) {
+        return std::fabs(got - static_cast<double>(want)) <= 1e-12 * std::fabs(static_cast<double>(want));
+    };
+    
+    PipelineOptions options;
+    options.chunk = 4096;
+    options.depth = 2;
+    ConversionStats stats = convertRawFile(raw_path, out_path, {n}, RawDType::Float64, TensorDType::BF16, options);
+    {
+        MappedTensor t(out_path);
+        assert(t.size() == n && t.info().dtype == TensorDType::BF16);
+        assert(std::memcmp(t.bf16(), expected.data(), n * sizeof(BFloat16)) == 0);
+    }
+    assert(stats.elements == n && stats.nonfinite == 3 && stats.overflow == 1);
+    assert(stats.changed == changed && stats.nonzero == nonzero);
+    assert(stats.errorNorm(0) == changed && stats.referenceNorm(0) == nonzero);
+    assert(close(stats.errorNorm(1), e1) && close(stats.referenceNorm(1), r1));
+    assert(close(stats.errorNorm(2), std::sqrt(e2)) && close(stats.referenceNorm(2), std::sqrt(r2)));
+    assert(stats.errorNorm(HUGE_VAL) == emax && stats.referenceNorm(HUGE_VAL) == rmax);
+    assert(close(stats.relativeError(), std::sqrt(e2) / std::sqrt(r2)));
+    assert(throwsError<std::invalid_argument>([&] { stats.errorNorm(3); }));
+    
+    // direct io (or its fallback) writes the same tensor with the data on
+    // a 4096 boundary, and the same statistics bit for bit
+    options.direct_io = true;
+    options.depth = 3;
+    ConversionStats direct = convertRawFile(raw_path, again_path, {n}, RawDType::Float64, TensorDType::BF16, options);
+    {
+        MappedTensor t(again_path);
+        assert(t.info().data_offset == 4096 && t.size() == n);
+        assert(std::memcmp(t.bf16(), expected.data(), n * sizeof(BFloat16)) == 0);
+    }
+    assert(std::memcmp(&direct.error_l1, &stats.error_l1, 8 * sizeof(double)) == 0);
+    
+    // a tensor source: fp32 narrowed like convertToBF16, bf16 back to fp32
+    // exactly, with no error
+    std::vector<FP32> wide(n);
+    for (size_t i = 0; i < n; ++i) wide[i] = FP32(static_cast<float>(values[i]));
+    saveTensor(fp32_path, wide.data(), {n});
+    options.direct_io = false;
+    convertTensorFile(fp32_path, again_path, TensorDType::BF16, options);
+    {
+        std::vector<float> floats(n);
+        std::vector<BFloat16> narrow(n);
+        for (size_t i = 0; i < n; ++i) floats[i] = wide[i].toFloat();
+        convertToBF16(floats.data(), narrow.data(), n);
+        MappedTensor t(again_path);
+        assert(std::memcmp(t.bf16(), narrow.data(), n * sizeof(BFloat16)) == 0);
+    }
+    ConversionStats back = convertTensorFile(again_path, fp32_path, TensorDType::FP32, options);
+    assert(back.changed == 0 && back.errorNorm(2) == 0 && back.relativeError() == 0);
+    assert(back.nonfinite == 4 && back.overflow == 0);
+    
+    // an empty source, then sources too short for their shapes
+    std::fclose(std::fopen(out_path.c_str(), "wb"));
+    convertRawFile(out_path, again_path, {0}, RawDType::Float64, TensorDType::BF16, options);
+    assert(MappedTensor(again_path).size() == 0);
+    assert(throwsError<std::runtime_error>([&] {
+        convertRawFile(raw_path, out_path, {n + 1}, RawDType::Float64, TensorDType::BF16, options);
+    }));
+    {
+        std::vector<char> image(256);
+        std::FILE* f = std::fopen(fp32_path.c_str(), "rb");
+        size_t got = std::fread(image.data(), 1, image.size(), f);
+        std::fclose(f);
+        assert(got == image.size());
+        f = std::fopen(fp32_path.c_str(), "wb");
+        std::fwrite(image.data(), 1, image.size(), f);
+        std::fclose(f);
+    }
+    assert(throwsError<std::runtime_error>([&] { convertTensorFile(fp32_path, out_path, TensorDType::BF16, options); }));
+    std::cout << n << " doubles through the pipeline at chunk 4096, statistics match norms.py" << std::endl;
+    
+    std::remove(raw_path.c_str());
+    std::remove(fp32_path.c_str());
+    std::remove(out_path.c_str());
+    std::remove(again_path.c_str());
+}
+
+void testCharConversion() {
+    std::cout << "\nTesting Text Conversion" << std::endl;
+    
+    char buffer[BFloat16::MAX_CHARS];
+    char* end = buffer + sizeof(buffer);
+    auto text = [&](BFloat16 x, CharsFormat format) {
+        std::to_chars_result r = toChars(buffer, end, x, format);
+        assert(r.ec == std::errc());
+        return std::string(buffer, r.ptr);
+    };
+    
+    // fewest digits that come back, not the float's
+    assert(text(BFloat16(0.1f), CharsFormat::Shortest) == "0.1");
+    assert(text(BFloat16(3.14159f), CharsFormat::Shortest) == "3.14");
+    assert(text(BFloat16(65536.0f), CharsFormat::Shortest) == "65500");
+    assert(text(BFloat16::fromBits(0x0001), CharsFormat::Shortest) == "9e-41");
+    assert(text(BFloat16(1.0f), CharsFormat::Hex) == "0x3F80");
+    assert(text(BFloat16(-2.0f), CharsFormat::Binary) == "1 10000000 0000000");
+    assert(BFloat16(1.0f).toHex() == "0x3F80" && BFloat16(1.0f).toBinary() == "0 01111111 0000000");
+    assert(toChars(buffer, buffer + 5, BFloat16(1.0f), CharsFormat::Hex).ec == std::errc::value_too_large);
+    
+    // every pattern in every format parses back to the same bits, and no
+    // decimal one digit shorter would
+    const CharsFormat formats[] = {CharsFormat::Shortest, CharsFormat::Hex, CharsFormat::Binary};
+    size_t longest = 0;
+    for (uint32_t i = 0; i < 65536; ++i) {
+        BFloat16 x = BFloat16::fromBits(static_cast<uint16_t>(i));
+        for (CharsFormat format : formats) {
+            std::to_chars_result r = toChars(buffer, end, x, format);
+            assert(r.ec == std::errc());
+            BFloat16 y;
+            std::from_chars_result p = fromChars(buffer, r.ptr, y, format);
+            assert(p.ec == std::errc() && p.ptr == r.ptr);
+            assert(y.bits() == x.bits() || (format == CharsFormat::Shortest && x.isNaN() && y.isNaN()));
+            longest = std::max(longest, static_cast<size_t>(r.ptr - buffer));
+        }
+        if (x.isFinite() && !x.isZero()) {
+            std::to_chars_result r = toChars(buffer, end, x);
+            // significant digits: the mantissa without leading or trailing zeros
+            std::string mantissa(buffer, std::find(buffer, r.ptr, 'e'));
+            mantissa.erase(std::remove_if(mantissa.begin(), mantissa.end(),
+                                          [](char c) { return c == '-' || c == '.'; }), mantissa.end());
+            size_t digits = mantissa.find_last_not_of('0') + 1 - mantissa.find_first_not_of('0');
+            assert(digits >= 1 && digits <= 4);
+            if (digits > 1) {
+                char shorter[32];
+                std::to_chars_result s2 = std::to_chars(shorter, shorter + sizeof(shorter), x.toDouble(),
+                                                        std::chars_format::scientific, static_cast<int>(digits) - 2);
+                BFloat16 z;
+                fromChars(shorter, s2.ptr, z);
+                assert(z.bits() != x.bits());
+            }
+        }
+    }
+    std::cout << "longest text: " << longest << " of " << BFloat16::MAX_CHARS << " chars" << std::endl;
+    
+    // a decimal just above a bf16 halfway point rounds up, not through
+    // float to the halfway point and then to even
+    assert(BFloat16(1.0 + std::ldexp(1.0, -8) + std::ldexp(1.0, -30)).bits() == 0x3F81u);
+    BFloat16 y;
+    const char* above = "1.0039062500001";
+    assert(fromChars(above, above + std::strlen(above), y).ec == std::errc() && y.bits() == 0x3F81u);
+    
+    // out of bf16 range, value untouched
+    y = BFloat16(7.0f);
+    const char* bad[] = {"3.4e38", "1e-42", "+1", "e5"};
+    for (const char* s : bad) {
+        assert(fromChars(s, s + std::strlen(s), y).ec != std::errc() && y.toFloat() == 7.0f);
+    }
+    
+    // Shortest stops at the x of a hex pattern, Hex takes it
+    const char* hex = "0x3f80";
+    assert(fromChars(hex, hex + 6, y).ptr == hex + 1 && y.isZero());
+    assert(fromChars(hex, hex + 6, y, CharsFormat::Hex).ec == std::errc() && y.toFloat() == 1.0f);
+    hex = "3f80";
+    assert(fromChars(hex, hex + 4, y, CharsFormat::Hex).ec == std::errc() && y.toFloat() == 1.0f);
+    const char* wide = "0x13F80";
+    assert(fromChars(wide, wide + 7, y, CharsFormat::Hex).ec == std::errc::result_out_of_range);
+    
+    // streams
+    std::ostringstream os;
+    os << std::setprecision(8) << BFloat16(3.14159f) << ' ' << std::left << std::setw(5) << BFloat16(-1.0f) << '|';
+    assert(os.str() == "3.14 -1   |");
+    std::istringstream is("3.14159 -0.1 nan 1e39");
+    BFloat16 a, b, c, d(2.0f);
+    is >> a >> b >> c;
+    assert(is && a.bits() == BFloat16(3.14159).bits() && b.bits() == BFloat16(-0.1).bits() && c.isNaN());
+    is >> d;
+    assert(is.fail() && d.toFloat() == 2.0f);
+}
+
+void testSqrt() {
+    std::cout << "\nSquare Root" << std::endl;
+    
+    assert(BFloat16(4.0f).sqrt().toFloat() == 2.0f && BFloat16(0.25f).rsqrt().toFloat() == 2.0f);
+    assert(BFloat16::zero(true).sqrt().bits() == 0x8000 && BFloat16(-1.0f).sqrt().isNaN());
+    assert(BFloat16::infinity().sqrt().isInfinity() && BFloat16::infinity().rsqrt().isZero());
+    assert(BFloat16::zero(true).rsqrt().bits() == BFloat16::infinity(true).bits());
+    assert(BFloat16::nan().rsqrt().isNaN() && BFloat16(-4.0f).rsqrt().isNaN());
+    
+    // every pattern: sqrt against the float square root (correctly rounded
+    // twice is still correct for bf16), in every deterministic mode, and
+    // rsqrt against the double reciprocal root
+    const RoundingMode directed[] = {RoundingMode::TowardZero, RoundingMode::Downward, RoundingMode::Upward};
+    std::vector<BFloat16> all(65536);
+    double max_ulp = 0.0;
+    for (uint32_t bits = 0; bits <= 0xFFFF; ++bits) {
+        BFloat16 x = BFloat16::fromBits(static_cast<uint16_t>(bits));
+        all[bits] = x;
+        float root = std::sqrt(x.toFloat());
+        BFloat16 expected(root);
+        assert(expected.isNaN() ? x.sqrt().isNaN() : x.sqrt().bits() == expected.bits());
+        for (RoundingMode mode : directed) {
+            BFloat16 rounded(root, mode);
+            assert(rounded.isNaN() ? BFloat16::sqrt(x, mode).isNaN()
+                                   : BFloat16::sqrt(x, mode).bits() == rounded.bits());
+        }
+        
+        if (x.isNaN() || x.isZero() || x.isInfinity() || x.isNegative()) continue;
+        double exact = 1.0 / std::sqrt(x.toDouble());
+        double ulp = std::ldexp(1.0, std::ilogb(exact) - BFloat16::Format::MANTISSA_BITS);
+        max_ulp = std::max(max_ulp, std::fabs(x.rsqrt().toDouble() - exact) / ulp);
+    }
+    assert(max_ulp < 0.5);   // correctly rounded
+    
+    // stochastic rounding lands on one of the two neighbours
+    BFloat16 two(2.0f);
+    for (int i = 0; i < 100; ++i) {
+        uint16_t r = BFloat16::sqrt(two, RoundingMode::Stochastic).bits();
+        assert(r == 0x3FB5 || r == 0x3FB6);
+    }
+    
+    // the batched kernels match the scalar functions at every level, on
+    // runs with and without special values and a short tail
+    std::vector<BFloat16> out(all.size());
+    for (SimdLevel level : {SimdLevel::Scalar, SimdLevel::AVX2, SimdLevel::AVX512}) {
+        sqrt(all.data(), out.data(), all.size() - 3, level);
+        for (size_t i = 0; i + 3 < all.size(); ++i) assert(out[i].bits() == all[i].sqrt().bits());
+        rsqrt(all.data(), out.data(), all.size() - 3, level);
+        for (size_t i = 0; i + 3 < all.size(); ++i) assert(out[i].bits() == all[i].rsqrt().bits());
+    }
+    out = all;
+    BFloat16::rsqrt(out.data(), out.data(), out.size());   // in place
+    for (size_t i = 0; i < all.size(); ++i) assert(out[i].bits() == all[i].rsqrt().bits());
+    BFloat16::sqrt(all.data(), out.data(), all.size());
+    for (size_t i = 0; i < all.size(); ++i) assert(out[i].bits() == all[i].sqrt().bits());
+    
+    std::cout << "all 65536 patterns correctly rounded, rsqrt within "
+              << std::defaultfloat << std::setprecision(4) << max_ulp << " ulp" << std::endl;
+}
+
+static double sigmoidReference(double x) {
+    return x < 0 ? std::exp(x) / (1.0 + std::exp(x)) : 1.0 / (1.0 + std::exp(-x));
+}
+
+static double geluReference(double x) {
+    double tail = 0.5 * std::erfc(std::fabs(x) / std::sqrt(2.0));
+    return x < 0 ? x * tail : x * (1.0 - tail);
+}
+
+void testElementary() {
+    std::cout << "\nElementary Functions" << std::endl;
+    
+    assert(exp(BFloat16(0.0f)).toFloat() == 1.0f && log(BFloat16(1.0f)).isZero());
+    assert(exp(BFloat16::infinity(true)).isZero() && exp(BFloat16(100.0f)).isInfinity());
+    assert(log(BFloat16::zero(true)).bits() == BFloat16::infinity(true).bits());
+    assert(log(BFloat16(-1.0f)).isNaN() && log(BFloat16::infinity()).isInfinity());
+    assert(tanh(BFloat16::infinity(true)).toFloat() == -1.0f && sigmoid(BFloat16::infinity()).toFloat() == 1.0f);
+    assert(erf(BFloat16::zero(true)).bits() == 0x8000 && erf(BFloat16(10.0f)).toFloat() == 1.0f);
+    assert(gelu(BFloat16::infinity()).isInfinity() && gelu(BFloat16(-30.0f)).isZero());
+    assert(exp(BFloat16::nan()).isNaN() && gelu(BFloat16::nan()).isNaN());
+    
+    typedef BFloat16 (*Scalar)(const BFloat16&);
+    typedef void (*Batched)(const BFloat16*, BFloat16*, size_t);
+    typedef void (*Pinned)(const BFloat16*, BFloat16*, size_t, SimdLevel);
+    struct Function {
+        const char* name;
+        Scalar scalar;
+        Batched batched;
+        Pinned pinned;
+        double (*reference)(double);
+        double bound;
+    };
+    const Function functions[] = {
+        {"exp", exp, exp, exp, [](double x) { return std::exp(x); }, 0.503},
+        {"log", log, log, log, [](double x) { return std::log(x); }, 0.500},
+        {"tanh", tanh, tanh, tanh, [](double x) { return std::tanh(x); }, 0.499},
+        {"sigmoid", sigmoid, sigmoid, sigmoid, sigmoidReference, 0.500},
+        {"erf", erf, erf, erf, [](double x) { return std::erf(x); }, 0.501},
+        {"gelu", gelu, gelu, gelu, geluReference, 0.504},
+    };
+    
+    std::vector<BFloat16> all(65536), out(65536), expected(65536);
+    for (uint32_t bits = 0; bits <= 0xFFFF; ++bits) all[bits] = BFloat16::fromBits(static_cast<uint16_t>(bits));
+    
+    const double largest = BFloat16::fromBits(0x7F7F).toDouble();
+    for (const Function& f : functions) {
+        // every finite result against the double reference, in ulps of the
+        // result (subnormal results in ulps of the smallest normal)
+        double max_ulp = 0.0;
+        for (uint32_t bits = 0; bits <= 0xFFFF; ++bits) {
+            BFloat16 y = f.scalar(all[bits]);
+            expected[bits] = y;
+            double exact = f.reference(all[bits].toDouble());
+            if (std::isnan(exact) || std::fabs(exact) > largest) continue;
+            assert(y.isFinite());
+            int e = exact == 0.0 ? -126 : std::max(std::ilogb(exact), -126);
+            double ulp = std::ldexp(1.0, e - BFloat16::Format::MANTISSA_BITS);
+            max_ulp = std::max(max_ulp, std::fabs(y.toDouble() - exact) / ulp);
+        }
+        assert(max_ulp <= f.bound);
+        
+        // every level gives the scalar results, with a short tail
+        for (SimdLevel level : {SimdLevel::Scalar, SimdLevel::AVX2, SimdLevel::AVX512}) {
+            f.pinned(all.data(), out.data(), all.size() - 3, level);
+            for (size_t i = 0; i + 3 < all.size(); ++i) assert(out[i].bits() == expected[i].bits());
+        }
+        out = all;
+        f.batched(out.data(), out.data(), out.size());   // in place
+        for (size_t i = 0; i < all.size(); ++i) assert(out[i].bits() == expected[i].bits());
+        
+        std::cout << f.name << " within " << std::defaultfloat
+                  << std::setprecision(4) << max_ulp << " ulp over all 65536 patterns" << std::endl;
+    }
+}
+
+void testOrder() {
+    std::cout << "\nOrder Ops" << std::endl;
+    
+    using Format = BFloat16::Format;
+    // the keys sort as the values do, for every pair of numbers
+    for (uint32_t a = 0; a <= 0xFFFF; a += 7) {
+        BFloat16 x = BFloat16::fromBits(static_cast<uint16_t>(a));
+        assert(Format::fromOrderKey(Format::orderKey(x.bits())) == x.bits());
+        for (uint32_t b = 0; b <= 0xFFFF; b += 251) {
+            BFloat16 y = BFloat16::fromBits(static_cast<uint16_t>(b));
+            if (x.isNaN() || y.isNaN() || x.isZero() || y.isZero()) continue;
+            assert((x < y) == (Format::orderKey(x.bits()) < Format::orderKey(y.bits())));
+        }
+    }
+    
+    // every pattern twice, shuffled, past the parallel threshold
+    const size_t n = 2 * 65536 + 5;
+    std::vector<BFloat16> x(n);
+    uint32_t state = 99;
+    for (size_t i = 0; i < n; ++i) x[i] = BFloat16::fromBits(static_cast<uint16_t>(i));
+    for (size_t i = n - 1; i > 0; --i) {
+        state = state * 1664525u + 1013904223u;
+        std::swap(x[i], x[state % (i + 1)]);
+    }
+    
+    auto key = [](const BFloat16& v) { return Format::orderKey(v.bits()); };
+    auto byKey = [&](const BFloat16& a, const BFloat16& b) { return key(a) < key(b); };
+    auto firstBits = [&](uint16_t bits) {
+        return static_cast<size_t>(std::find_if(x.begin(), x.end(), [=](const BFloat16& e) { return e.bits() == bits; }) - x.begin());
+    };
+    size_t first_nan = static_cast<size_t>(std::find_if(x.begin(), x.end(), [](const BFloat16& e) { return e.isNaN(); }) - x.begin());
+    
+    // every level, and a run whose extremes sit in the masked tail
+    std::vector<BFloat16> tail(45, BFloat16(1.0f));
+    tail[41] = BFloat16(-3.0f);
+    tail[44] = BFloat16(5.0f);
+    for (SimdLevel level : {SimdLevel::Scalar, SimdLevel::AVX2, SimdLevel::AVX512}) {
+        assert(argmin(x.data(), n, NaNPolicy::Propagate, level) == first_nan);
+        assert(argmax(x.data(), n, NaNPolicy::Propagate, level) == first_nan);
+        assert(argmin(x.data(), n, NaNPolicy::Ignore, level) == firstBits(0xFF80));   // -inf
+        assert(argmax(x.data(), n, NaNPolicy::Ignore, level) == firstBits(0x7F80));
+        assert(argmin(x.data(), n, NaNPolicy::Total, level) == firstBits(0xFFFF));    // -nan, largest payload
+        assert(argmax(x.data(), n, NaNPolicy::Total, level) == firstBits(0x7FFF));
+        
+        std::pair<BFloat16, BFloat16> r = minmax(x.data(), n, NaNPolicy::Propagate, level);
+        assert(r.first.isNaN() && r.second.isNaN());
+        r = minmax(x.data(), n, NaNPolicy::Ignore, level);
+        assert(r.first.bits() == 0xFF80 && r.second.bits() == 0x7F80);
+        
+        assert(argmin(tail.data(), tail.size(), NaNPolicy::Propagate, level) == 41);
+        assert(argmax(tail.data(), tail.size(), NaNPolicy::Propagate, level) == 44);
+        r = minmax(tail.data(), tail.size(), NaNPolicy::Propagate, level);
+        assert(r.first.toFloat() == -3.0f && r.second.toFloat() == 5.0f);
+        
+        std::vector<BFloat16> clamped(n);
+        clamp(x.data(), clamped.data(), n - 3, BFloat16(-1.0f), BFloat16(2.0f), NaNPolicy::Propagate, level);
+        for (size_t i = 0; i + 3 < n; ++i) {
+            BFloat16 expected = x[i].isNaN() ? x[i] : key(x[i]) < key(BFloat16(-1.0f)) ? BFloat16(-1.0f)
+                              : key(x[i]) > key(BFloat16(2.0f)) ? BFloat16(2.0f) : x[i];
+            assert(clamped[i].bits() == expected.bits());
+        }
+        clamp(x.data(), clamped.data(), n, BFloat16(-1.0f), BFloat16(2.0f), NaNPolicy::Total, level);
+        for (size_t i = 0; i < n; ++i) {
+            if (x[i].isNaN()) assert(clamped[i].bits() == (x[i].sign() ? BFloat16(-1.0f) : BFloat16(2.0f)).bits());
+        }
+    }
+    
+    // -0 is below +0, the first of equal values wins, nothing is left of
+    // an all-nan span under Ignore
+    std::vector<BFloat16> small = {BFloat16(1.0f), BFloat16(0.0f), BFloat16(-0.0f), BFloat16(-0.0f)};
+    assert(argmin(small.data(), small.size()) == 2 && argmax(small.data(), small.size()) == 0);
+    std::vector<BFloat16> nans(40, BFloat16::nan());
+    assert(argmax(nans.data(), nans.size(), NaNPolicy::Ignore) == 40 && argmin(nans.data(), 0) == 0);
+    assert(minmax(nans.data(), nans.size(), NaNPolicy::Ignore).second.isNaN());
+    bool threw = false;
+    try { clamp(x.data(), x.data(), n, BFloat16::nan(), BFloat16(1.0f)); } catch (const std::invalid_argument&) { threw = true; }
+    assert(threw);
+    
+    // sort, counting and comparison sized: numbers by key then the nans in
+    // input order, or everything by key under Total
+    for (size_t size : {n, size_t(1000)}) {
+        std::vector<BFloat16> input(x.begin(), x.begin() + size);
+        std::vector<BFloat16> expected;
+        for (const BFloat16& v : input) {
+            if (!v.isNaN()) expected.push_back(v);
+        }
+        std::sort(expected.begin(), expected.end(), byKey);
+        for (const BFloat16& v : input) {
+            if (v.isNaN()) expected.push_back(v);
+        }
+        std::vector<BFloat16> sorted = input;
+        sort(sorted.data(), size);
+        for (size_t i = 0; i < size; ++i) assert(sorted[i].bits() == expected[i].bits());
+        
+        expected = input;
+        std::sort(expected.begin(), expected.end(), byKey);
+        sorted = input;
+        sort(sorted.data(), size, NaNPolicy::Total);
+        for (size_t i = 0; i < size; ++i) assert(sorted[i].bits() == expected[i].bits());
+    }
+    
+    std::cout << "argmin / argmax / minmax / clamp at every level and sort match the key-order reference" << std::endl;
+}
+
+template <typename T>
+static void checkMX(const char* name) {
+    using Block = BlockFloat<T>;
+    const int bias = T::Format::EXPONENT_BIAS;
+    const int m = T::Format::MANTISSA_BITS;
+    
+    // small values, a partial block, then past the parallel threshold
+    const size_t n = 100003;
+    std::vector<float> values(n);
+    uint32_t state = 7;
+    for (size_t i = 0; i < n; ++i) {
+        state = state * 1664525u + 1013904223u;
+        float v = static_cast<float>(static_cast<int32_t>(state >> 8) - (1 << 23)) / 8388608.0f;
+        // a different magnitude per block, some far from 1
+        values[i] = BFloat16(std::ldexp(v, static_cast<int>((i / MX_BLOCK) % 41) - 20)).toFloat();
+    }
+    std::vector<BFloat16> halves(n);
+    std::vector<FP32> singles(n);
+    for (size_t i = 0; i < n; ++i) {
+        halves[i] = BFloat16(values[i]);
+        singles[i] = FP32(values[i]);
+    }
+    
+    Block w = Block::quantize(values.data(), n);
+    Block from_halves = Block::quantize(halves.data(), n);
+    Block from_singles = Block::quantize(singles.data(), n);
+    assert(w.size() == n && w.blocks() == (n + MX_BLOCK - 1) / MX_BLOCK);
+    assert(w.bytes() == w.blocks() * (MX_BLOCK + 1));
+    for (size_t i = 0; i < n; ++i) {
+        assert(from_halves.element(i).bits() == w.element(i).bits() && from_singles.element(i).bits() == w.element(i).bits());
+    }
+    
+    // every value within half an element ulp at the block's scale, a
+    // saturated one within the gap from the max to the top of its binade
+    for (size_t i = 0; i < n; ++i) {
+        double scale = static_cast<double>(w.scale(i / MX_BLOCK));
+        double error = std::fabs(static_cast<double>(w.value(i)) - values[i]);
+        double ulp = std::ldexp(scale, std::max(std::ilogb(w.element(i).toFloat()), 1 - bias) - m);
+        if (w.element(i).isZero()) ulp = std::ldexp(scale, 1 - bias - m);
+        double headroom = (std::ldexp(1.0, Block::ELEMENT_EMAX + 1) - T::max().toDouble()) * scale;
+        bool saturated = w.element(i).abs().bits() == T::max().bits();
+        assert(error <= (saturated ? headroom : ulp / 2));
+    }
+    
+    // dequantize and the fused dot agree at every level
+    std::vector<BFloat16> x(n);
+    for (size_t i = 0; i < n; ++i) x[i] = BFloat16(std::sin(static_cast<float>(i)));
+    double reference = 0.0;
+    double magnitude = 0.0;
+    for (size_t i = 0; i < n; ++i) {
+        reference += static_cast<double>(w.value(i)) * x[i].toDouble();
+        magnitude += std::fabs(static_cast<double>(w.value(i)) * x[i].toDouble());
+    }
+    const float product = dot(w, x.data(), SimdLevel::Scalar);
+    assert(std::fabs(product - reference) <= 1e-5 * magnitude);
+    std::vector<float> wide(n);
+    std::vector<BFloat16> narrow(n);
+    w.dequantize(narrow.data());
+    for (SimdLevel level : {SimdLevel::Scalar, SimdLevel::AVX2, SimdLevel::AVX512}) {
+        std::fill(wide.begin(), wide.end(), 0.0f);
+        dequantize(w, wide.data(), level);
+        for (size_t i = 0; i < n; ++i) assert(wide[i] == w.value(i));
+        for (size_t length : {n, size_t(45), size_t(64), size_t(0)}) {
+            Block part = Block::quantize(values.data(), length);
+            assert(dot(part, x.data(), level) == dot(part, x.data(), SimdLevel::Scalar));
+        }
+        assert(dot(w, x.data(), level) == product);
+    }
+    for (size_t i = 0; i < n; ++i) assert(narrow[i].bits() == BFloat16(w.value(i)).bits());
+    
+    // gemv rows are the dot of each row on its own
+    const size_t rows = 37;
+    const size_t cols = 96;
+    Block matrix = Block::quantize(values.data(), rows * cols);
+    std::vector<float> y(rows);
+    gemv(matrix, rows, cols, x.data(), y.data());
+    for (size_t r = 0; r < rows; ++r) {
+        assert(y[r] == dot(Block::quantize(values.data() + r * cols, cols), x.data()));
+    }
+    bool threw = false;
+    try { gemv(matrix, rows * 2, cols / 2, x.data(), y.data()); } catch (const std::invalid_argument&) { threw = true; }
+    assert(threw);
+    
+    std::cout << name << ": " << n << " values in " << w.bytes() << " bytes, within the rounding bound, dot matches at every level" << std::endl;
+}
+
+void testMX() {
+    std::cout << "\nMX Block Formats" << std::endl;
+    
+    assert(MXFP8E4M3::ELEMENT_EMAX == 8 && MXFP8E5M2::ELEMENT_EMAX == 15);
+    assert(MXFP8E4M3::scaleValue(127) == 1.0f && MXFP8E4M3::scaleValue(0) == std::ldexp(1.0f, -127));
+    assert(MXFP8E4M3::scaleValue(254) == std::ldexp(1.0f, 127) && std::isnan(MXFP8E4M3::scaleValue(0xFF)));
+    
+    // the largest magnitude sets the scale, 3 is in the top binade of 2^-7
+    std::vector<float> block(MX_BLOCK, 0.25f);
+    block[5] = -3.0f;
+    MXFP8E4M3 q = MXFP8E4M3::quantize(block.data(), block.size());
+    assert(q.scaleBits(0) == 127 + 1 - 8 && q.value(5) == -3.0f && q.value(0) == 0.25f);
+    
+    // rounding past the element max saturates (247 at scale 2^-1 is 494,
+    // above 448), an infinity stays one in e5m2 and is a nan element in
+    // e4m3, a nan poisons its block only
+    block[5] = 247.0f;
+    block[6] = -std::numeric_limits<float>::infinity();
+    block.resize(2 * MX_BLOCK, 1.0f);
+    block[40] = std::numeric_limits<float>::quiet_NaN();
+    q = MXFP8E4M3::quantize(block.data(), block.size());
+    assert(q.scaleBits(0) == 126 && q.value(5) == 224.0f && std::isnan(q.value(6)));
+    assert(q.scaleBits(1) == MXFP8E4M3::NAN_SCALE && std::isnan(q.value(33)));
+    MXFP8E5M2 q5 = MXFP8E5M2::quantize(block.data(), block.size());
+    assert(q5.value(5) == 224.0f && q5.value(6) == -std::numeric_limits<float>::infinity());
+    
+    MXFP8E5M2 zeros(70);
+    assert(zeros.blocks() == 3 && zeros.value(69) == 0.0f);
+    
+    checkMX<FP8E4M3>("mxfp8 e4m3");
+    checkMX<FP8E5M2>("mxfp8 e5m2");
+}
+
+void testExpr() {
+    std::cout << "\nExpression Templates" << std::endl;
+    
+    // past the parallel threshold, with a ragged tile at the end
+    const size_t n = 100003;
+    BF16Vector a(n), b(n), c(n), d(n), e(n);
+    uint32_t state = 5;
+    auto next = [&] {
+        state = state * 1664525u + 1013904223u;
+        return std::ldexp(static_cast<float>(state >> 8) / 16777216.0f + 0.5f, static_cast<int>(state % 9) - 4);
+    };
+    for (size_t i = 0; i < n; ++i) {
+        a[i] = BFloat16(next());
+        b[i] = BFloat16(-next());
+        c[i] = BFloat16(next());
+        d[i] = BFloat16(next());
+        e[i] = BFloat16(next());
+    }
+    
+    // Rounded gives the operator chain's bits, in one pass
+    BF16Vector eager = a * b + c * d - e;
+    BF16Vector fused = evaluate(lazy(a) * b + lazy(c) * d - e);
+    for (size_t i = 0; i < n; ++i) assert(fused[i].bits() == eager[i].bits());
+    
+    eager = b - a;
+    fused = evaluate(-lazy(a) + b);
+    for (size_t i = 0; i < n; ++i) assert(fused[i].bits() == eager[i].bits());
+    eager = a * BFloat16(0.375f) + b * BFloat16(3.0f);
+    fused = evaluate(lazy(a) * BFloat16(0.375f) + BFloat16(3.0f) * lazy(b));
+    for (size_t i = 0; i < n; ++i) assert(fused[i].bits() == eager[i].bits());
+    
+    // every bit pattern, so overflow, subnormals, infinities and nans too
+    BF16Vector pa(65536), pb(65536), pc(65536);
+    for (uint32_t i = 0; i < 65536; ++i) {
+        pa[i] = BFloat16::fromBits(static_cast<uint16_t>(i));
+        pb[i] = BFloat16::fromBits(static_cast<uint16_t>(i * 40503u));
+        pc[i] = BFloat16::fromBits(static_cast<uint16_t>(i * 25033u + 7u));
+    }
+    eager = pa * pb - pc;
+    fused = evaluate(lazy(pa) * pb - pc);
+    for (size_t i = 0; i < eager.size(); ++i) assert(fused[i].bits() == eager[i].bits());
+    fused = evaluate(-lazy(pa));
+    for (size_t i = 0; i < fused.size(); ++i) assert(fused[i].bits() == (-pa[i]).bits());
+    
+    // Widened runs in float and rounds once, closer to the exact value
+    BF16Vector widened = evaluate(lazy(a) * b + lazy(c) * d - e, ExprPrecision::Widened);
+    eager = a * b + c * d - e;
+    double widened_error = 0.0;
+    double rounded_error = 0.0;
+    for (size_t i = 0; i < n; ++i) {
+        float wide = a[i].toFloat() * b[i].toFloat() + c[i].toFloat() * d[i].toFloat() - e[i].toFloat();
+        assert(widened[i].bits() == BFloat16(wide).bits());
+        double exact = a[i].toDouble() * b[i].toDouble() + c[i].toDouble() * d[i].toDouble() - e[i].toDouble();
+        widened_error += std::fabs(widened[i].toDouble() - exact);
+        rounded_error += std::fabs(eager[i].toDouble() - exact);
+    }
+    assert(widened_error < rounded_error);
+    
+    // in place into an operand, and the size checks
+    BF16Vector expected = a * b + c;
+    assign(a, lazy(a) * b + c);
+    for (size_t i = 0; i < n; ++i) assert(a[i].bits() == expected[i].bits());
+    BF16Vector shorter(n - 1);
+    bool threw = false;
+    try { evaluate(lazy(a) + shorter); } catch (const std::invalid_argument&) { threw = true; }
+    assert(threw);
+    threw = false;
+    try { assign(shorter, lazy(a) + b); } catch (const std::invalid_argument&) { threw = true; }
+    assert(threw);
+    
+    std::cout << "Rounded matches the operator chain, Widened error " << widened_error / rounded_error
+              << "x of Rounded" << std::endl;
+}
+
+void testSubnormalMode() {
+    std::cout << "\nFlush-to-Zero Mode" << std::endl;
+    
+    // Flush is Preserve on operands read as zero, with a subnormal result
+    // then also a zero of its sign: checked for every pattern against a
+    // spread of second operands, through the operators
+    using Preserve = BFloat16::FormatFor<SubnormalMode::Preserve>;
+    auto daz = [](uint16_t x) { return (x & 0x7F80) == 0 ? static_cast<uint16_t>(x & 0x8000) : x; };
+    auto ftz = [&](uint16_t x) { return daz(x); };
+    size_t flushed = 0;
+    {
+        SubnormalScope flush(SubnormalMode::Flush);
+        for (uint32_t i = 0; i < 65536; ++i) {
+            uint16_t a = static_cast<uint16_t>(i);
+            for (uint32_t k = 0; k < 8; ++k) {
+                // the bottom binades and the subnormals, then anything
+                uint16_t b = static_cast<uint16_t>(k < 4 ? ((i * 7919u + k * 131u) & 0x83FF) : i * 40503u + k);
+                BFloat16 x = BFloat16::fromBits(a);
+                BFloat16 y = BFloat16::fromBits(b);
+                uint16_t preserved[4] = {Preserve::add(a, b), Preserve::subtract(a, b),
+                                         Preserve::multiply(a, b), Preserve::divide(a, b)};
+                uint16_t expected[4] = {ftz(Preserve::add(daz(a), daz(b))), ftz(Preserve::subtract(daz(a), daz(b))),
+                                        ftz(Preserve::multiply(daz(a), daz(b))), ftz(Preserve::divide(daz(a), daz(b)))};
+                BFloat16 got[4] = {x + y, x - y, x * y, x / y};
+                for (int op = 0; op < 4; ++op) {
+                    assert(got[op].bits() == expected[op]);
+                    flushed += expected[op] != preserved[op];
+                }
+            }
+            BFloat16 x = BFloat16::fromBits(a);
+            assert(x.sqrt().bits() == ftz(Preserve::sqrt(daz(a))));
+            assert(BFloat16::fma(x, x, x).bits() == ftz(Preserve::fma(daz(a), daz(a), daz(a))));
+        }
+        
+        // rounding-mode overloads flush too, and a batched call on every
+        // pool thread
+        BFloat16 min_normal = BFloat16::fromBits(0x0080);
+        BFloat16 half(0.5f);
+        assert(BFloat16::multiply(min_normal, half, RoundingMode::Upward).bits() == 0x0000);
+        const size_t n = 200003;
+        std::vector<BFloat16> a(n, min_normal), b(n, half), out(n);
+        BFloat16::multiply(a.data(), b.data(), out.data(), n);
+        for (size_t i = 0; i < n; ++i) assert(out[i].bits() == 0);
+        std::vector<BFloat16> tiny(n, BFloat16::fromBits(0x0040));
+        BFloat16::sqrt(tiny.data(), out.data(), n);
+        for (size_t i = 0; i < n; ++i) assert(out[i].bits() == 0);
+        
+        // lazy expressions and the bf16-precision reductions too: the
+        // bottom binades and the subnormals, times [0.125, 0.5)
+        BF16Vector lo(n), hi(n);
+        for (size_t i = 0; i < n; ++i) {
+            lo[i] = BFloat16::fromBits(static_cast<uint16_t>((i * 40503u) & 0x81FF));
+            hi[i] = BFloat16::fromBits(static_cast<uint16_t>(0x3E00 + ((i * 7919u) & 0x1FF)));
+        }
+        BF16Vector lazy_result = evaluate(lazy(lo) * hi + lo);
+        for (size_t i = 0; i < n; ++i) assert(lazy_result[i].bits() == (lo[i] * hi[i] + lo[i]).bits());
+        
+        BFloat16 loop_sum, loop_dot;
+        for (size_t i = 0; i < n; ++i) {
+            loop_sum += lo[i];
+            loop_dot += lo[i] * hi[i];
+        }
+        assert(sum(lo.data(), n, Summation::Naive) == loop_sum.toFloat());
+        assert(dot(lo.data(), hi.data(), n, Summation::Naive) == loop_dot.toFloat());
+        for (Summation method : {Summation::Pairwise, Summation::Kahan, Summation::Neumaier}) {
+            float scalar = sum(lo.data(), n, method, SimdLevel::Scalar);
+            float scalar_dot = dot(lo.data(), hi.data(), n, method, SimdLevel::Scalar);
+            for (SimdLevel level : {SimdLevel::AVX2, SimdLevel::AVX512, SimdLevel::AVX512BF16}) {
+                assert(sum(lo.data(), n, method, level) == scalar);
+                assert(dot(lo.data(), hi.data(), n, method, level) == scalar_dot);
+            }
+            // every term and product is subnormal or flushes
+            assert(sum(tiny.data(), n, method) == 0.0f && dot(a.data(), b.data(), n, method) == 0.0f);
+        }
+        assert(sum(tiny.data(), n, Summation::Widened) > 0.0f);
+    }
+    assert(subnormalMode() == SubnormalMode::Preserve);
+    assert((BFloat16::fromBits(0x0080) * BFloat16(0.5f)).bits() == 0x0040);
+    BFloat16 subnormal = BFloat16::fromBits(0x0040);
+    assert(sum(&subnormal, 1, Summation::Pairwise) > 0.0f);
+    
+    std::cout << "every pattern through + - * / sqrt fma, " << flushed
+              << " results flushed, lazy and bf16 reductions flush" << std::endl;
+}
+
+void testHardwareDot() {
+    std::cout << "\nTesting HardwareDot (vdpbf16ps) Mode" << std::endl;
+    
+    // the documented order written out on FP32: lane l takes elements
+    // 2l + 1 then 2l of each zero-padded block of 128, one flushing fma a
+    // step, then the fixed fold in float
+    auto pairStep = [](BFloat16 a, BFloat16 b, FP32 acc) {
+        return FP32::fma(FP32(a.toFloat()), FP32(b.toFloat()), acc);
+    };
+    auto at = [](const BFloat16* v, size_t n, size_t i) { return i < n ? v[i] : BFloat16(); };
+    auto rowReference = [&](const BFloat16* x, const BFloat16* y, size_t n) {
+        FP32 acc[64];
+        {
+            SubnormalScope flush(SubnormalMode::Flush);
+            for (size_t i = 0; i < n; i += 128) {
+                for (size_t l = 0; l < 64; ++l) {
+                    size_t e = i + 2 * l;
+                    acc[l] = pairStep(at(x, n, e + 1), at(y, n, e + 1), acc[l]);
+                    acc[l] = pairStep(at(x, n, e), at(y, n, e), acc[l]);
+                }
+            }
+        }
+        float s[16];
+        for (size_t j = 0; j < 16; ++j) {
+            s[j] = (acc[j].toFloat() + acc[j + 16].toFloat()) + (acc[j + 32].toFloat() + acc[j + 48].toFloat());
+        }
+        for (size_t w = 8; w > 0; w /= 2) {
+            for (size_t j = 0; j < w; ++j) s[j] += s[j + w];
+        }
+        return s[0];
+    };
+    auto dotReference = [&](const BFloat16* x, const BFloat16* y, size_t n) {
+        float result = 0.0f;
+        for (size_t i = 0; i < n; i += 16384) result += rowReference(x + i, y + i, std::min<size_t>(16384, n - i));
+        return result;
+    };
+    auto same = [](float a, float b) {
+        uint32_t ua, ub;
+        std::memcpy(&ua, &a, 4);
+        std::memcpy(&ub, &b, 4);
+        return std::isnan(a) ? std::isnan(b) : ua == ub;
+    };
+    
+    // normals around 1, subnormals (read as zero) and small normals whose
+    // products fall under the fp32 range (flushed), a few infinities
+    uint32_t state = 2024;
+    auto next = [&state]() {
+        state = state * 1664525u + 1013904223u;
+        return state;
+    };
+    auto operand = [&](bool specials) {
+        uint32_t r = next();
+        uint32_t e = r % 8 == 0 ? (r >> 8) % 2 : r % 8 == 1 ? 1 + (r >> 8) % 40 : 122 + (r >> 8) % 8;
+        if (specials && (r >> 12) % 512 == 0) e = 255;
+        return BFloat16::fromBits(static_cast<uint16_t>(((r >> 16) & 0x8000) | (e << 7) | ((r >> 20) & 0x7F)));
+    };
+    
+    const SimdLevel levels[] = {SimdLevel::Scalar, SimdLevel::AVX2, SimdLevel::AVX512,
+                                SimdLevel::AVX512BF16, SimdLevel::NEON};
+    // the edge sizes, one with infinities and one over a chunk, then
+    // random lengths
+    std::vector<size_t> sizes = {0, 1, 2, 127, 128, 129, 1000, 40001};
+    for (int i = 0; i < 20; ++i) sizes.push_back(129 + next() % 2000);
+    size_t checked = 0;
+    for (size_t n : sizes) {
+        std::vector<BFloat16> x(n), y(n);
+        for (size_t i = 0; i < n; ++i) {
+            x[i] = operand(n == 1000);
+            y[i] = operand(false);
+        }
+        float expected = dotReference(x.data(), y.data(), n);
+        for (SimdLevel level : levels) {
+            if (!simdLevelSupported(level)) continue;
+            assert(same(dot(x.data(), y.data(), n, LinalgMode::HardwareDot, level), expected));
+            ++checked;
+        }
+        assert(same(dot(x.data(), y.data(), n, LinalgMode::HardwareDot), expected));
+    }
+    
+    // the pair order shows in one lane: 1, then 2^-24 (a tie, back to 1)
+    // and -2^-24 gives 1 - 2^-24, where -2^-24 first would come back to 1
+    std::vector<BFloat16> ones(130, BFloat16()), order(130, BFloat16());
+    ones[0] = ones[128] = ones[129] = BFloat16(1.0f);
+    order[0] = BFloat16(1.0f);
+    order[128] = BFloat16(-std::ldexp(1.0f, -24));
+    order[129] = BFloat16(std::ldexp(1.0f, -24));
+    for (SimdLevel level : levels) {
+        if (!simdLevelSupported(level)) continue;
+        assert(dot(order.data(), ones.data(), 130, LinalgMode::HardwareDot, level) == std::nextafter(1.0f, 0.0f));
+    }
+    assert(dot(order.data(), ones.data(), 130, LinalgMode::Emulated) == 1.0f);
+    
+    // gemm with one lane per output along k, odd k, edge tiles and more
+    // than one k block and row group; gemv as rows of the dot order
+    const size_t m = 70, n = 45, k = 301;
+    const float alpha = 0.75f, beta = -1.5f;
+    std::vector<BFloat16> A(m * k), B(k * n), Bt(n * k), x(k);
+    for (BFloat16& v : A) v = operand(false);
+    for (BFloat16& v : B) v = operand(false);
+    for (BFloat16& v : x) v = operand(false);
+    for (size_t p = 0; p < k; ++p) {
+        for (size_t j = 0; j < n; ++j) Bt[j * k + p] = B[p * n + j];
+    }
+    std::vector<float> C0(m * n), expected(m * n), y0(m), y_expected(m);
+    for (size_t i = 0; i < m * n; ++i) C0[i] = static_cast<float>(next() % 1000) / 250.0f - 2.0f;
+    for (size_t i = 0; i < m; ++i) y0[i] = C0[i];
+    for (size_t i = 0; i < m; ++i) {
+        for (size_t j = 0; j < n; ++j) {
+            FP32 lane;
+            {
+                SubnormalScope flush(SubnormalMode::Flush);
+                for (size_t p = 0; p < k; p += 2) {
+                    lane = pairStep(at(A.data() + i * k, k, p + 1), at(Bt.data() + j * k, k, p + 1), lane);
+                    lane = pairStep(A[i * k + p], Bt[j * k + p], lane);
+                }
+            }
+            expected[i * n + j] = alpha * lane.toFloat() + beta * C0[i * n + j];
+        }
+        y_expected[i] = alpha * rowReference(A.data() + i * k, x.data(), k) + beta * y0[i];
+    }
+    for (SimdLevel level : levels) {
+        if (!simdLevelSupported(level)) continue;
+        std::vector<float> C = C0, y = y0;
+        gemm(m, n, k, alpha, A.data(), k, B.data(), n, beta, C.data(), n, LinalgMode::HardwareDot, level);
+        gemv(m, k, alpha, A.data(), k, x.data(), beta, y.data(), LinalgMode::HardwareDot, level);
+        for (size_t i = 0; i < m * n; ++i) assert(same(C[i], expected[i]));
+        for (size_t i = 0; i < m; ++i) assert(same(y[i], y_expected[i]));
+        
+        // beta == 0 must not read C
+        std::vector<float> D(m * n, std::numeric_limits<float>::quiet_NaN());
+        gemm(m, n, k, 1.0f, A.data(), k, B.data(), n, 0.0f, D.data(), n, LinalgMode::HardwareDot, level);
+        for (float v : D) assert(!std::isnan(v));
+        checked += 2;
+    }
+    
+    // wider than one column block: every column matches the gemm of that
+    // column alone
+    const size_t wide_m = 9, wide_n = 1100, wide_k = 37;
+    std::vector<BFloat16> WA(wide_m * wide_k), WB(wide_k * wide_n);
+    for (BFloat16& v : WA) v = operand(false);
+    for (BFloat16& v : WB) v = operand(false);
+    for (SimdLevel level : levels) {
+        if (!simdLevelSupported(level)) continue;
+        std::vector<float> C(wide_m * wide_n, 1.0f), column(wide_m * wide_n, 1.0f);
+        gemm(wide_m, wide_n, wide_k, alpha, WA.data(), wide_k, WB.data(), wide_n, beta, C.data(), wide_n,
+             LinalgMode::HardwareDot, level);
+        for (size_t j = 0; j < wide_n; ++j) {
+            gemm(wide_m, 1, wide_k, alpha, WA.data(), wide_k, WB.data() + j, wide_n, beta, column.data() + j,
+                 wide_n, LinalgMode::HardwareDot, level);
+        }
+        for (size_t i = 0; i < C.size(); ++i) assert(same(C[i], column[i]));
+        ++checked;
+    }
+    
+    // the flush is real: a product under the fp32 range is lost, where
+    // the other modes keep it
+    BFloat16 tiny[2] = {BFloat16(std::ldexp(1.0f, -100)), BFloat16()};
+    BFloat16 small[2] = {BFloat16(std::ldexp(1.0f, -30)), BFloat16()};
+    assert(dot(tiny, small, 2, LinalgMode::HardwareDot) == 0.0f);
+    assert(dot(tiny, small, 2, LinalgMode::Emulated) == std::ldexp(1.0f, -130));
+    
+    std::cout << checked << " dot / gemm / gemv runs match the documented order bit for bit at "
+              << simdLevelName(detectSimdLevel()) << std::endl;
+}
+
+void testSolve() {
+    std::cout << "\nTesting Mixed-Precision Solves" << std::endl;
+    
+    uint32_t state = 77;
+    auto uniform = [&state]() {
+        state = state * 1664525u + 1013904223u;
+        return static_cast<double>(state >> 8) / 16777216.0 - 0.5;
+    };
+    
+    // the float gemm is Native's kernels without the widening: bf16 values
+    // held in floats give the same bits
+    {
+        size_t m = 37, n = 45, k = 300;
+        std::vector<BFloat16> A(m * k), B(k * n);
+        std::vector<float> Af(m * k), Bf(k * n), C0(m * n);
+        for (size_t i = 0; i < m * k; ++i) Af[i] = (A[i] = BFloat16(static_cast<float>(uniform()))).toFloat();
+        for (size_t i = 0; i < k * n; ++i) Bf[i] = (B[i] = BFloat16(static_cast<float>(uniform()))).toFloat();
+        for (float& c : C0) c = static_cast<float>(uniform());
+        std::vector<float> C = C0, D = C0;
+        gemm(m, n, k, -1.0f, A.data(), k, B.data(), n, 1.0f, C.data(), n);
+        gemm(m, n, k, -1.0f, Af.data(), k, Bf.data(), n, 1.0f, D.data(), n);
+        assert(std::memcmp(C.data(), D.data(), C.size() * sizeof(float)) == 0);
+    }
+    
+    // diagonally dominant, kappa about 3, and spd with kappa about 5;
+    // sizes that leave a partial block and a partial inner block
+    size_t n = 203;
+    std::vector<double> G(n * n), S(n * n, 0.0), b(n);
+    for (size_t i = 0; i < n; ++i) {
+        for (size_t j = 0; j < n; ++j) G[i * n + j] = uniform() + (i == j ? n / 2.0 : 0.0);
+        b[i] = uniform();
+    }
+    for (size_t i = 0; i < n; ++i) {
+        for (size_t j = 0; j < n; ++j) {
+            for (size_t p = 0; p < n; ++p) S[i * n + j] += G[i * n + p] * G[j * n + p];
+        }
+    }
+    
+    // the factors multiply back to A, pivoted, to float accuracy
+    FactorOptions fp32;
+    fp32.precision = FactorPrecision::FP32;
+    fp32.block = 64;
+    std::vector<float> F(n * n);
+    std::vector<size_t> pivots(n);
+    for (size_t i = 0; i < n * n; ++i) F[i] = static_cast<float>(G[i]);
+    assert(factorLU(n, F.data(), n, pivots.data(), fp32));
+    std::vector<double> PA(G);
+    for (size_t i = 0; i < n; ++i) {
+        std::swap_ranges(PA.begin() + i * n, PA.begin() + (i + 1) * n, PA.begin() + pivots[i] * n);
+    }
+    double worst = 0;
+    for (size_t i = 0; i < n; ++i) {
+        for (size_t j = 0; j < n; ++j) {
+            double s = 0;
+            for (size_t p = 0; p <= std::min(i, j); ++p) s += (p == i ? 1.0 : F[i * n + p]) * F[p * n + j];
+            worst = std::max(worst, std::fabs(s - PA[i * n + j]) / (n / 2.0));
+        }
+    }
+    assert(worst < 1e-5);
+    
+    for (size_t i = 0; i < n * n; ++i) F[i] = static_cast<float>(S[i]);
+    assert(factorCholesky(n, F.data(), n, fp32));
+    worst = 0;
+    for (size_t i = 0; i < n; ++i) {
+        for (size_t j = 0; j <= i; ++j) {
+            double s = 0;
+            for (size_t p = 0; p <= j; ++p) s += static_cast<double>(F[i * n + p]) * F[j * n + p];
+            worst = std::max(worst, std::fabs(s - S[i * n + j]) / S[i * n + i]);
+        }
+    }
+    assert(worst < 1e-5);
+    
+    // refined bf16 factors reach the fp64 / fp32 tolerance, taking more
+    // corrections than fp32 ones
+    std::vector<double> x(n);
+    size_t fp32_iterations = 0;
+    for (Factorization f : {Factorization::LU, Factorization::Cholesky}) {
+        const std::vector<double>& A = f == Factorization::LU ? G : S;
+        for (FactorPrecision precision : {FactorPrecision::FP32, FactorPrecision::BF16}) {
+            for (LinalgMode mode : {LinalgMode::Native, LinalgMode::HardwareDot}) {
+                for (ResidualPrecision residual : {ResidualPrecision::FP64, ResidualPrecision::FP32}) {
+                    RefinementOptions options;
+                    options.factorization = f;
+                    options.factor.precision = precision;
+                    options.factor.mode = mode;
+                    options.factor.block = 48;
+                    options.residual = residual;
+                    RefinementResult result = solveRefined(n, A.data(), n, b.data(), x.data(), options);
+                    assert(result.factored && result.converged);
+                    double u = residual == ResidualPrecision::FP64 ? 0x1p-53 : 0x1p-24;
+                    assert(result.backward_error <= std::sqrt(static_cast<double>(n)) * u);
+                    assert(result.history.size() == result.iterations + 1);
+                    assert(result.backward_error == result.history.back());
+                    
+                    // b - A x in double agrees
+                    double r = 0, ax = 0, xn = 0, bn = 0;
+                    for (size_t i = 0; i < n; ++i) {
+                        double s = b[i];
+                        for (size_t j = 0; j < n; ++j) s -= A[i * n + j] * x[j];
+                        r = std::max(r, std::fabs(s));
+                        xn = std::max(xn, std::fabs(x[i]));
+                        bn = std::max(bn, std::fabs(b[i]));
+                        double row = 0;
+                        for (size_t j = 0; j < n; ++j) row += std::fabs(A[i * n + j]);
+                        ax = std::max(ax, row);
+                    }
+                    assert(r / (ax * xn + bn) <= 4 * std::sqrt(static_cast<double>(n)) * u);
+                    
+                    if (precision == FactorPrecision::FP32 && residual == ResidualPrecision::FP64) {
+                        fp32_iterations = result.iterations;
+                    } else if (residual == ResidualPrecision::FP64) {
+                        assert(result.iterations > fp32_iterations);
+                    }
+                }
+            }
+        }
+    }
+    
+    // hilbert 6, kappa 1.5e7: fp32 factors still refine, bf16 ones
+    // (whose rounding alone moves A by more than A^-1 tolerates) do not
+    size_t h = 6;
+    std::vector<double> H(h * h), hb(h, 1.0), hx(h);
+    for (size_t i = 0; i < h; ++i) {
+        for (size_t j = 0; j < h; ++j) H[i * h + j] = 1.0 / static_cast<double>(i + j + 1);
+    }
+    RefinementOptions options;
+    options.factor.precision = FactorPrecision::FP32;
+    assert(solveRefined(h, H.data(), h, hb.data(), hx.data(), options).converged);
+    options.factor.precision = FactorPrecision::BF16;
+    RefinementResult hilbert = solveRefined(h, H.data(), h, hb.data(), hx.data(), options);
+    assert(hilbert.factored && !hilbert.converged);
+    // the correction that failed is undone, the error never grows
+    for (size_t i = 1; i <= hilbert.iterations; ++i) assert(hilbert.history[i] < hilbert.history[i - 1]);
+    assert(hilbert.backward_error == hilbert.history[hilbert.iterations]);
+    
+    // breakdowns and misuse
+    std::vector<float> singular = {1, 2, 2, 4};
+    std::vector<size_t> p2(2);
+    assert(!factorLU(2, singular.data(), 2, p2.data()));
+    std::vector<float> indefinite = {1, 2, 2, 1};
+    assert(!factorCholesky(2, indefinite.data(), 2));
+    std::vector<double> indefinite64 = {1, 2, 2, 1}, b2 = {1, 1}, x2(2);
+    options.factorization = Factorization::Cholesky;
+    assert(!solveRefined(2, indefinite64.data(), 2, b2.data(), x2.data(), options).factored);
+    bool threw = false;
+    try {
+        options.factor.block = 0;
+        solveRefined(2, indefinite64.data(), 2, b2.data(), x2.data(), options);
+    } catch (const std::invalid_argument&) {
+        threw = true;
+    }
+    assert(threw);
+    
+    std::cout << "LU and Cholesky factors within float accuracy, bf16 factors refined to the fp64 and fp32 "
+              << "tolerances, hilbert 6 only from fp32 factors" << std::endl;
+}
+
 int main() {
     std::cout << "   BFloat16 Educational Demo" << std::endl;
     
@@ -245,6 +2350,29 @@ int main() {
     testPrecisionLoss();
     testFP32Conversion();
     testDynamicRange();
+    testAddRounding();
+    testDivideRounding();
+    testConstexprAccessors();
+    testFMA();
+    testBulkConversion();
+    testTables();
+    testVector();
+    testLinalg();
+    testParallel();
+    testFP8();
+    testRoundingModes();
+    testReductions();
+    testTensorFiles();
+    testTensorPipeline();
+    testCharConversion();
+    testSqrt();
+    testElementary();
+    testOrder();
+    testMX();
+    testExpr();
+    testSubnormalMode();
+    testHardwareDot();
+    testSolve();
     
     std::cout << "   All tests completed!" << std::endl;    
     return 0;
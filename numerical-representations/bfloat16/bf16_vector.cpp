@@ -0,0 +1,3 @@
+#include "BF16Vector.h"
+
+template class AlignedVector<BFloat16>;
@@ -0,0 +1,463 @@
+#include "FP8.h"
+#include "ThreadPool.h"
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define FP8_X86 1
+#include <immintrin.h>
+#endif
+
+template <int E, int M, FloatEncoding ENC>
+FP8Tables<E, M, ENC>::FP8Tables() {
+    using Format = FloatFormat<E, M, SubnormalMode::Preserve, ENC>;
+
+    for (size_t a = 0; a < 256; ++a) {
+        for (size_t b = 0; b < 256; ++b) {
+            uint8_t x = static_cast<uint8_t>(a);
+            uint8_t y = static_cast<uint8_t>(b);
+            add_[index(x, y)] = Format::add(x, y);
+            subtract_[index(x, y)] = Format::subtract(x, y);
+            multiply_[index(x, y)] = Format::multiply(x, y);
+            divide_[index(x, y)] = Format::divide(x, y);
+        }
+        to_fp32_[a] = Format::toFP32Bits(static_cast<uint8_t>(a));
+    }
+}
+
+// batched lookups, large spans are split across the thread pool
+
+template <int E, int M, FloatEncoding ENC, typename Op>
+static void lookupBinary(Op op, const FP8<E, M, ENC>* a, const FP8<E, M, ENC>* b, FP8<E, M, ENC>* out, size_t n) {
+    parallelChunks(n, chunkElements(3 * sizeof(uint8_t)), [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            out[i] = FP8<E, M, ENC>::fromBits(op(a[i].bits(), b[i].bits()));
+        }
+    });
+}
+
+template <int E, int M, FloatEncoding ENC>
+void FP8<E, M, ENC>::add(const FP8* a, const FP8* b, FP8* out, size_t n) {
+    const Tables& tables = Tables::instance();
+    lookupBinary([&](uint8_t x, uint8_t y) { return tables.add(x, y); }, a, b, out, n);
+}
+
+template <int E, int M, FloatEncoding ENC>
+void FP8<E, M, ENC>::subtract(const FP8* a, const FP8* b, FP8* out, size_t n) {
+    const Tables& tables = Tables::instance();
+    lookupBinary([&](uint8_t x, uint8_t y) { return tables.subtract(x, y); }, a, b, out, n);
+}
+
+template <int E, int M, FloatEncoding ENC>
+void FP8<E, M, ENC>::multiply(const FP8* a, const FP8* b, FP8* out, size_t n) {
+    const Tables& tables = Tables::instance();
+    lookupBinary([&](uint8_t x, uint8_t y) { return tables.multiply(x, y); }, a, b, out, n);
+}
+
+template <int E, int M, FloatEncoding ENC>
+void FP8<E, M, ENC>::divide(const FP8* a, const FP8* b, FP8* out, size_t n) {
+    const Tables& tables = Tables::instance();
+    lookupBinary([&](uint8_t x, uint8_t y) { return tables.divide(x, y); }, a, b, out, n);
+}
+
+template class FP8Tables<4, 3, FloatEncoding::FiniteNaN>;
+template class FP8Tables<5, 2>;
+template class FP8<4, 3, FloatEncoding::FiniteNaN>;
+template class FP8<5, 2>;
+
+static_assert(sizeof(FP8E4M3) == 1 && sizeof(FP8E5M2) == 1, "FP8 must be a plain 8-bit value");
+
+// scalar kernels, the reference every simd path has to match
+
+template <int E, int M, FloatEncoding ENC>
+static void convertToFloatScalar(const FP8<E, M, ENC>* src, float* dst, size_t n) {
+    const uint32_t* table = FP8Tables<E, M, ENC>::instance().fp32Table();
+    for (size_t i = 0; i < n; ++i) {
+        std::memcpy(&dst[i], &table[src[i].bits()], sizeof(float));
+    }
+}
+
+template <int E, int M, FloatEncoding ENC>
+static void convertToBF16Scalar(const FP8<E, M, ENC>* src, BFloat16* dst, size_t n) {
+    const uint32_t* table = FP8Tables<E, M, ENC>::instance().fp32Table();
+    for (size_t i = 0; i < n; ++i) {
+        dst[i] = BFloat16::fromBits(static_cast<uint16_t>(table[src[i].bits()] >> 16));
+    }
+}
+
+template <int E, int M, FloatEncoding ENC>
+static void convertToFP8Scalar(const float* src, FP8<E, M, ENC>* dst, size_t n) {
+    for (size_t i = 0; i < n; ++i) {
+        uint32_t fp32_bits;
+        std::memcpy(&fp32_bits, &src[i], sizeof(float));
+        dst[i] = FP8<E, M, ENC>::fromFP32Bits(fp32_bits);
+    }
+}
+
+template <int E, int M, FloatEncoding ENC>
+static void convertToFP8Scalar(const BFloat16* src, FP8<E, M, ENC>* dst, size_t n) {
+    for (size_t i = 0; i < n; ++i) {
+        dst[i] = FP8<E, M, ENC>::fromFP32Bits(src[i].toFP32Bits());
+    }
+}
+
+#ifdef FP8_X86
+
+// narrowing works on FP32 bit patterns, per lane:
+//   normal:    rebias the exponent, then round the low 23 - M bits to
+//              nearest even; a carry runs into the exponent and anything
+//              past the largest finite value clamps to infinity, or to the
+//              nan pattern of a format without infinities (E4M3FN)
+//   subnormal: shift the full significand right by 151 - bias - M - e,
+//              rounding the same way (float subnormals all round to zero)
+//   nan:       sign | quiet nan, like FloatFormat::fromFP32Bits
+
+template <int E, int M, FloatEncoding ENC>
+struct FP8Narrow {
+    using Format = FloatFormat<E, M, SubnormalMode::Preserve, ENC>;
+    static constexpr int DROP = 23 - M;
+    static constexpr uint32_t REBIAS = static_cast<uint32_t>(127 - Format::EXPONENT_BIAS) << 23;
+    static constexpr uint32_t SUBNORMAL_BELOW = static_cast<uint32_t>(128 - Format::EXPONENT_BIAS) << 23;
+    static constexpr int SUBNORMAL_SHIFT = 151 - Format::EXPONENT_BIAS - M;
+    static constexpr uint32_t OVERFLOW_BITS = Format::infinity();
+    static constexpr uint32_t QUIET_NAN = Format::QUIET_NAN;
+};
+
+template <int E, int M, FloatEncoding ENC>
+__attribute__((target("avx2")))
+static __m256i narrowAVX2(__m256i w) {
+    using N = FP8Narrow<E, M, ENC>;
+    const __m256i one = _mm256_set1_epi32(1);
+    __m256i sign = _mm256_and_si256(_mm256_srli_epi32(w, 24), _mm256_set1_epi32(0x80));
+    __m256i mag = _mm256_and_si256(w, _mm256_set1_epi32(0x7FFFFFFF));
+
+    __m256i t = _mm256_sub_epi32(mag, _mm256_set1_epi32(N::REBIAS));
+    __m256i lsb = _mm256_and_si256(_mm256_srli_epi32(t, N::DROP), one);
+    __m256i normal = _mm256_add_epi32(t, _mm256_add_epi32(_mm256_set1_epi32((1 << (N::DROP - 1)) - 1), lsb));
+    normal = _mm256_min_epu32(_mm256_srli_epi32(normal, N::DROP), _mm256_set1_epi32(N::OVERFLOW_BITS));
+
+    __m256i sig = _mm256_or_si256(_mm256_and_si256(mag, _mm256_set1_epi32(0x007FFFFF)),
+                                  _mm256_set1_epi32(0x00800000));
+    __m256i shift = _mm256_sub_epi32(_mm256_set1_epi32(N::SUBNORMAL_SHIFT), _mm256_srli_epi32(mag, 23));
+    shift = _mm256_min_epi32(shift, _mm256_set1_epi32(31));
+    __m256i half = _mm256_sllv_epi32(one, _mm256_sub_epi32(shift, one));
+    __m256i sub_lsb = _mm256_and_si256(_mm256_srlv_epi32(sig, shift), one);
+    __m256i sub = _mm256_add_epi32(sig, _mm256_add_epi32(_mm256_sub_epi32(half, one), sub_lsb));
+    sub = _mm256_srlv_epi32(sub, shift);
+
+    // signed compares are fine, mag < 2^31
+    __m256i is_sub = _mm256_cmpgt_epi32(_mm256_set1_epi32(N::SUBNORMAL_BELOW), mag);
+    __m256i is_nan = _mm256_cmpgt_epi32(mag, _mm256_set1_epi32(0x7F800000));
+    __m256i result = _mm256_blendv_epi8(normal, sub, is_sub);
+    result = _mm256_blendv_epi8(result, _mm256_set1_epi32(N::QUIET_NAN), is_nan);
+    return _mm256_or_si256(result, sign);
+}
+
+// low byte of each 32-bit lane into the low 8 bytes
+__attribute__((target("avx2")))
+static void storeBytesAVX2(uint8_t* dst, __m256i v) {
+    const __m256i pick = _mm256_setr_epi8(0, 4, 8, 12, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+                                          0, 4, 8, 12, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+    __m256i bytes = _mm256_shuffle_epi8(v, pick);
+    bytes = _mm256_permutevar8x32_epi32(bytes, _mm256_setr_epi32(0, 4, 1, 1, 1, 1, 1, 1));
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(dst), _mm256_castsi256_si128(bytes));
+}
+
+template <int E, int M, FloatEncoding ENC>
+__attribute__((target("avx2")))
+static void convertToFP8AVX2(const float* src, FP8<E, M, ENC>* dst, size_t n) {
+    size_t i = 0;
+
+    for (; i + 8 <= n; i += 8) {
+        __m256i w = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+        storeBytesAVX2(reinterpret_cast<uint8_t*>(dst + i), narrowAVX2<E, M, ENC>(w));
+    }
+
+    convertToFP8Scalar(src + i, dst + i, n - i);
+}
+
+template <int E, int M, FloatEncoding ENC>
+__attribute__((target("avx2")))
+static void convertToFP8AVX2(const BFloat16* src, FP8<E, M, ENC>* dst, size_t n) {
+    size_t i = 0;
+
+    for (; i + 8 <= n; i += 8) {
+        __m128i h = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        __m256i w = _mm256_slli_epi32(_mm256_cvtepu16_epi32(h), 16);
+        storeBytesAVX2(reinterpret_cast<uint8_t*>(dst + i), narrowAVX2<E, M, ENC>(w));
+    }
+
+    convertToFP8Scalar(src + i, dst + i, n - i);
+}
+
+// widening: the bytes index the FP32 table directly
+
+template <int E, int M, FloatEncoding ENC>
+__attribute__((target("avx2")))
+static void convertToFloatAVX2(const FP8<E, M, ENC>* src, float* dst, size_t n) {
+    const int* table = reinterpret_cast<const int*>(FP8Tables<E, M, ENC>::instance().fp32Table());
+    size_t i = 0;
+
+    for (; i + 8 <= n; i += 8) {
+        __m128i b = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(src + i));
+        __m256i w = _mm256_i32gather_epi32(table, _mm256_cvtepu8_epi32(b), 4);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), w);
+    }
+
+    convertToFloatScalar(src + i, dst + i, n - i);
+}
+
+template <int E, int M, FloatEncoding ENC>
+__attribute__((target("avx2")))
+static void convertToBF16AVX2(const FP8<E, M, ENC>* src, BFloat16* dst, size_t n) {
+    const int* table = reinterpret_cast<const int*>(FP8Tables<E, M, ENC>::instance().fp32Table());
+    size_t i = 0;
+
+    for (; i + 16 <= n; i += 16) {
+        __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        __m256i lo = _mm256_i32gather_epi32(table, _mm256_cvtepu8_epi32(b), 4);
+        __m256i hi = _mm256_i32gather_epi32(table, _mm256_cvtepu8_epi32(_mm_srli_si128(b, 8)), 4);
+
+        // the low halves are zero, keep the top 16 bits in order
+        __m256i packed = _mm256_packus_epi32(_mm256_srli_epi32(lo, 16), _mm256_srli_epi32(hi, 16));
+        packed = _mm256_permute4x64_epi64(packed, 0xD8);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), packed);
+    }
+
+    convertToBF16Scalar(src + i, dst + i, n - i);
+}
+
+// gcc 12 flags the _mm512_undefined_* placeholders inside its own headers
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#pragma GCC diagnostic ignored "-Wuninitialized"
+#endif
+
+// avx512: 16 lanes, the same steps with mask registers and a narrowing
+// store, plus masked tails
+
+// inlined into both callers: a call returning a vector stops gcc from
+// clearing the upper halves on return, and the baseline sse code after a
+// short conversion would run with them dirty
+template <int E, int M, FloatEncoding ENC>
+__attribute__((target("avx512f,avx512bw,avx512vl"), always_inline))
+static inline __m128i narrowAVX512(__m512i w) {
+    using N = FP8Narrow<E, M, ENC>;
+    const __m512i one = _mm512_set1_epi32(1);
+    __m512i sign = _mm512_and_si512(_mm512_srli_epi32(w, 24), _mm512_set1_epi32(0x80));
+    __m512i mag = _mm512_and_si512(w, _mm512_set1_epi32(0x7FFFFFFF));
+
+    __m512i t = _mm512_sub_epi32(mag, _mm512_set1_epi32(N::REBIAS));
+    __m512i lsb = _mm512_and_si512(_mm512_srli_epi32(t, N::DROP), one);
+    __m512i normal = _mm512_add_epi32(t, _mm512_add_epi32(_mm512_set1_epi32((1 << (N::DROP - 1)) - 1), lsb));
+    normal = _mm512_min_epu32(_mm512_srli_epi32(normal, N::DROP), _mm512_set1_epi32(N::OVERFLOW_BITS));
+
+    __m512i sig = _mm512_or_si512(_mm512_and_si512(mag, _mm512_set1_epi32(0x007FFFFF)),
+                                  _mm512_set1_epi32(0x00800000));
+    __m512i shift = _mm512_sub_epi32(_mm512_set1_epi32(N::SUBNORMAL_SHIFT), _mm512_srli_epi32(mag, 23));
+    shift = _mm512_min_epi32(shift, _mm512_set1_epi32(31));
+    __m512i half = _mm512_sllv_epi32(one, _mm512_sub_epi32(shift, one));
+    __m512i sub_lsb = _mm512_and_si512(_mm512_srlv_epi32(sig, shift), one);
+    __m512i sub = _mm512_add_epi32(sig, _mm512_add_epi32(_mm512_sub_epi32(half, one), sub_lsb));
+    sub = _mm512_srlv_epi32(sub, shift);
+
+    __mmask16 is_sub = _mm512_cmplt_epu32_mask(mag, _mm512_set1_epi32(N::SUBNORMAL_BELOW));
+    __mmask16 is_nan = _mm512_cmpgt_epu32_mask(mag, _mm512_set1_epi32(0x7F800000));
+    __m512i result = _mm512_mask_blend_epi32(is_sub, normal, sub);
+    result = _mm512_mask_blend_epi32(is_nan, result, _mm512_set1_epi32(N::QUIET_NAN));
+    return _mm512_cvtepi32_epi8(_mm512_or_si512(result, sign));
+}
+
+template <int E, int M, FloatEncoding ENC>
+__attribute__((target("avx512f,avx512bw,avx512vl")))
+static void convertToFP8AVX512(const float* src, FP8<E, M, ENC>* dst, size_t n) {
+    size_t i = 0;
+
+    for (; i + 16 <= n; i += 16) {
+        __m512i w = _mm512_loadu_si512(src + i);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), narrowAVX512<E, M, ENC>(w));
+    }
+
+    if (i < n) {
+        __mmask16 k = static_cast<__mmask16>((1u << (n - i)) - 1);
+        __m512i w = _mm512_maskz_loadu_epi32(k, src + i);
+        _mm_mask_storeu_epi8(dst + i, k, narrowAVX512<E, M, ENC>(w));
+    }
+}
+
+template <int E, int M, FloatEncoding ENC>
+__attribute__((target("avx512f,avx512bw,avx512vl")))
+static void convertToFP8AVX512(const BFloat16* src, FP8<E, M, ENC>* dst, size_t n) {
+    size_t i = 0;
+
+    for (; i + 16 <= n; i += 16) {
+        __m256i h = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+        __m512i w = _mm512_slli_epi32(_mm512_cvtepu16_epi32(h), 16);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), narrowAVX512<E, M, ENC>(w));
+    }
+
+    if (i < n) {
+        __mmask16 k = static_cast<__mmask16>((1u << (n - i)) - 1);
+        __m256i h = _mm256_maskz_loadu_epi16(k, src + i);
+        __m512i w = _mm512_slli_epi32(_mm512_cvtepu16_epi32(h), 16);
+        _mm_mask_storeu_epi8(dst + i, k, narrowAVX512<E, M, ENC>(w));
+    }
+}
+
+template <int E, int M, FloatEncoding ENC>
+__attribute__((target("avx512f,avx512bw,avx512vl")))
+static void convertToFloatAVX512(const FP8<E, M, ENC>* src, float* dst, size_t n) {
+    const uint32_t* table = FP8Tables<E, M, ENC>::instance().fp32Table();
+    size_t i = 0;
+
+    for (; i + 16 <= n; i += 16) {
+        __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        __m512i w = _mm512_i32gather_epi32(_mm512_cvtepu8_epi32(b), table, 4);
+        _mm512_storeu_si512(dst + i, w);
+    }
+
+    if (i < n) {
+        __mmask16 k = static_cast<__mmask16>((1u << (n - i)) - 1);
+        __m128i b = _mm_maskz_loadu_epi8(k, src + i);
+        __m512i w = _mm512_mask_i32gather_epi32(_mm512_setzero_si512(), k, _mm512_cvtepu8_epi32(b), table, 4);
+        _mm512_mask_storeu_epi32(dst + i, k, w);
+    }
+}
+
+template <int E, int M, FloatEncoding ENC>
+__attribute__((target("avx512f,avx512bw,avx512vl")))
+static void convertToBF16AVX512(const FP8<E, M, ENC>* src, BFloat16* dst, size_t n) {
+    const uint32_t* table = FP8Tables<E, M, ENC>::instance().fp32Table();
+    size_t i = 0;
+
+    for (; i + 16 <= n; i += 16) {
+        __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        __m512i w = _mm512_i32gather_epi32(_mm512_cvtepu8_epi32(b), table, 4);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), _mm512_cvtepi32_epi16(_mm512_srli_epi32(w, 16)));
+    }
+
+    if (i < n) {
+        __mmask16 k = static_cast<__mmask16>((1u << (n - i)) - 1);
+        __m128i b = _mm_maskz_loadu_epi8(k, src + i);
+        __m512i w = _mm512_mask_i32gather_epi32(_mm512_setzero_si512(), k, _mm512_cvtepu8_epi32(b), table, 4);
+        _mm256_mask_storeu_epi16(dst + i, k, _mm512_cvtepi32_epi16(_mm512_srli_epi32(w, 16)));
+    }
+}
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+#endif // FP8_X86
+
+// runtime dispatch, neon has no gather and stays on the scalar loops
+
+template <int E, int M, FloatEncoding ENC>
+void convertToFloat(const FP8<E, M, ENC>* src, float* dst, size_t n, SimdLevel level) {
+    if (!simdLevelSupported(level)) level = SimdLevel::Scalar;
+
+    switch (level) {
+#ifdef FP8_X86
+    case SimdLevel::AVX2:       convertToFloatAVX2(src, dst, n); return;
+    case SimdLevel::AVX512:
+    case SimdLevel::AVX512BF16: convertToFloatAVX512(src, dst, n); return;
+#endif
+    default:                    convertToFloatScalar(src, dst, n); return;
+    }
+}
+
+template <int E, int M, FloatEncoding ENC>
+void convertToBF16(const FP8<E, M, ENC>* src, BFloat16* dst, size_t n, SimdLevel level) {
+    if (!simdLevelSupported(level)) level = SimdLevel::Scalar;
+
+    switch (level) {
+#ifdef FP8_X86
+    case SimdLevel::AVX2:       convertToBF16AVX2(src, dst, n); return;
+    case SimdLevel::AVX512:
+    case SimdLevel::AVX512BF16: convertToBF16AVX512(src, dst, n); return;
+#endif
+    default:                    convertToBF16Scalar(src, dst, n); return;
+    }
+}
+
+template <int E, int M, FloatEncoding ENC>
+void convertToFP8(const float* src, FP8<E, M, ENC>* dst, size_t n, SimdLevel level) {
+    if (!simdLevelSupported(level)) level = SimdLevel::Scalar;
+
+    switch (level) {
+#ifdef FP8_X86
+    case SimdLevel::AVX2:       convertToFP8AVX2(src, dst, n); return;
+    case SimdLevel::AVX512:
+    case SimdLevel::AVX512BF16: convertToFP8AVX512(src, dst, n); return;
+#endif
+    default:                    convertToFP8Scalar(src, dst, n); return;
+    }
+}
+
+template <int E, int M, FloatEncoding ENC>
+void convertToFP8(const BFloat16* src, FP8<E, M, ENC>* dst, size_t n, SimdLevel level) {
+    if (!simdLevelSupported(level)) level = SimdLevel::Scalar;
+
+    switch (level) {
+#ifdef FP8_X86
+    case SimdLevel::AVX2:       convertToFP8AVX2(src, dst, n); return;
+    case SimdLevel::AVX512:
+    case SimdLevel::AVX512BF16: convertToFP8AVX512(src, dst, n); return;
+#endif
+    default:                    convertToFP8Scalar(src, dst, n); return;
+    }
+}
+
+// large spans are split across the thread pool, each chunk runs the
+// pinned kernel on its own slice
+
+static const size_t WIDEN_GRAIN = chunkElements(sizeof(float) + 1);
+
+template <int E, int M, FloatEncoding ENC>
+void convertToFloat(const FP8<E, M, ENC>* src, float* dst, size_t n) {
+    SimdLevel level = detectSimdLevel();
+    parallelChunks(n, WIDEN_GRAIN, [=](size_t begin, size_t end) {
+        convertToFloat(src + begin, dst + begin, end - begin, level);
+    });
+}
+
+template <int E, int M, FloatEncoding ENC>
+void convertToBF16(const FP8<E, M, ENC>* src, BFloat16* dst, size_t n) {
+    SimdLevel level = detectSimdLevel();
+    parallelChunks(n, WIDEN_GRAIN, [=](size_t begin, size_t end) {
+        convertToBF16(src + begin, dst + begin, end - begin, level);
+    });
+}
+
+template <int E, int M, FloatEncoding ENC>
+void convertToFP8(const float* src, FP8<E, M, ENC>* dst, size_t n) {
+    SimdLevel level = detectSimdLevel();
+    parallelChunks(n, WIDEN_GRAIN, [=](size_t begin, size_t end) {
+        convertToFP8(src + begin, dst + begin, end - begin, level);
+    });
+}
+
+template <int E, int M, FloatEncoding ENC>
+void convertToFP8(const BFloat16* src, FP8<E, M, ENC>* dst, size_t n) {
+    SimdLevel level = detectSimdLevel();
+    parallelChunks(n, WIDEN_GRAIN, [=](size_t begin, size_t end) {
+        convertToFP8(src + begin, dst + begin, end - begin, level);
+    });
+}
+
+// one copy of every entry point per format
+
+#define FP8_INSTANTIATE(T)                                               \
+    template void convertToFloat(const T*, float*, size_t);              \
+    template void convertToBF16(const T*, BFloat16*, size_t);            \
+    template void convertToFP8(const float*, T*, size_t);                \
+    template void convertToFP8(const BFloat16*, T*, size_t);             \
+    template void convertToFloat(const T*, float*, size_t, SimdLevel);   \
+    template void convertToBF16(const T*, BFloat16*, size_t, SimdLevel); \
+    template void convertToFP8(const float*, T*, size_t, SimdLevel);     \
+    template void convertToFP8(const BFloat16*, T*, size_t, SimdLevel);
+
+FP8_INSTANTIATE(FP8E4M3)
+FP8_INSTANTIATE(FP8E5M2)
+
+#undef FP8_INSTANTIATE
@@ -0,0 +1,471 @@
+#include "MX.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define MX_X86 1
+#include <immintrin.h>
+#endif
+
+// the scalar and simd kernels run the same float operations in the same
+// order. the Makefile builds this file with -ffp-contract=off so gcc does
+// not fuse the simd scale multiply-adds; the element products are exact
+// either way
+
+static constexpr size_t MX_LANES = 16;
+static_assert(MX_BLOCK == 2 * MX_LANES, "a block is two passes over the lanes");
+
+// chunks are whole blocks
+static constexpr size_t QUANTIZE_GRAIN = chunkElements(sizeof(float) + 1);
+static constexpr size_t DEQUANTIZE_GRAIN = chunkElements(sizeof(float) + 1);
+static constexpr size_t DOT_GRAIN = chunkElements(sizeof(BFloat16) + 1);
+static_assert(QUANTIZE_GRAIN % MX_BLOCK == 0 && DOT_GRAIN % MX_BLOCK == 0, "chunks hold whole blocks");
+
+static size_t blockCount(size_t n) {
+    return (n + MX_BLOCK - 1) / MX_BLOCK;
+}
+
+template <typename Element>
+float BlockFloat<Element>::scaleValue(uint8_t scale) {
+    // 2^-127 is the one subnormal scale
+    uint32_t bits = scale == NAN_SCALE ? 0x7FC00000u
+                  : scale == 0        ? 0x00400000u
+                                      : static_cast<uint32_t>(scale) << 23;
+    float value;
+    std::memcpy(&value, &bits, sizeof(float));
+    return value;
+}
+
+template <typename Element>
+BlockFloat<Element>::BlockFloat(size_t n)
+    : size_(n), scales_(blockCount(n), SCALE_BIAS), elements_(blockCount(n) * MX_BLOCK) {}
+
+// quantization, one block at a time. the block is copied out as floats,
+// zero padded, so every loop below runs MX_BLOCK times and vectorizes
+
+static void loadBlock(const float* src, size_t count, float* block) {
+    std::memcpy(block, src, count * sizeof(float));
+}
+
+static void loadBlock(const FP32* src, size_t count, float* block) {
+    for (size_t i = 0; i < count; ++i) block[i] = src[i].toFloat();
+}
+
+static void loadBlock(const BFloat16* src, size_t count, float* block) {
+    for (size_t i = 0; i < count; ++i) block[i] = src[i].toFloat();
+}
+
+enum class BlockKind : uint8_t { Finite, Infinite, NaN };
+
+// the block's scale, and its values divided by it into scaled
+template <typename Element, typename Source>
+static BlockKind scaleBlock(const Source* src, size_t count, uint8_t& scale, float* scaled) {
+    using Block = BlockFloat<Element>;
+
+    float v[MX_BLOCK] = {};
+    loadBlock(src, count, v);
+
+    // the exponent of the largest finite magnitude; zeros and subnormals
+    // share the minimum one
+    const int bottom = 1 - 127;
+    int top = bottom;
+    bool nan = false;
+    bool infinite = false;
+    for (size_t i = 0; i < MX_BLOCK; ++i) {
+        FP32 x(v[i]);
+        nan |= x.isNaN();
+        infinite |= x.isInfinity();
+        top = std::max(top, x.isFinite() ? x.unbiasedExponent() : bottom);
+    }
+    if (nan) {
+        scale = Block::NAN_SCALE;
+        std::fill_n(scaled, MX_BLOCK, 0.0f);
+        return BlockKind::NaN;
+    }
+
+    int shared = std::min(std::max(top - Block::ELEMENT_EMAX, -127), 127);
+    scale = static_cast<uint8_t>(shared + Block::SCALE_BIAS);
+    // 2^-shared, exact. dividing by a power of two only rounds below the
+    // float normals, far under the smallest element, and never overflows
+    const float inverse = Block::scaleValue(static_cast<uint8_t>(Block::SCALE_BIAS - shared));
+    for (size_t i = 0; i < MX_BLOCK; ++i) scaled[i] = v[i] * inverse;
+    return infinite ? BlockKind::Infinite : BlockKind::Finite;
+}
+
+// after rounding, an overflow (infinity, or the nan pattern of E4M3,
+// which has no infinity) from a finite value saturates to the max
+template <typename Element>
+static void finishBlock(BlockKind kind, const float* scaled, Element* out) {
+    uint8_t* bytes = reinterpret_cast<uint8_t*>(out);
+    const uint8_t overflowed = Element::infinity().bits();
+    const uint8_t max = Element::max().bits();
+    switch (kind) {
+    case BlockKind::Finite:
+        for (size_t i = 0; i < MX_BLOCK; ++i) {
+            uint8_t magnitude = bytes[i] & 0x7F;
+            bytes[i] = magnitude == overflowed ? static_cast<uint8_t>((bytes[i] & 0x80) | max) : bytes[i];
+        }
+        return;
+    case BlockKind::Infinite:
+        for (size_t i = 0; i < MX_BLOCK; ++i) {
+            if ((bytes[i] & 0x7F) == overflowed && !std::isinf(scaled[i])) {
+                bytes[i] = static_cast<uint8_t>((bytes[i] & 0x80) | max);
+            }
+        }
+        return;
+    default:
+        std::fill_n(out, MX_BLOCK, Element::nan());
+        return;
+    }
+}
+
+// a group of blocks is scaled into a buffer and rounded in one bulk
+// conversion
+static constexpr size_t QUANTIZE_GROUP = 32 * MX_BLOCK;
+
+template <typename Element, typename Source>
+static BlockFloat<Element> quantizeSpan(const Source* src, size_t n) {
+    BlockFloat<Element> result(n);
+    uint8_t* scales = const_cast<uint8_t*>(result.scaleData());
+    Element* elements = const_cast<Element*>(result.elementData());
+    SimdLevel level = detectSimdLevel();
+    parallelChunks(n, QUANTIZE_GRAIN, [=](size_t begin, size_t end) {
+        float scaled[QUANTIZE_GROUP];
+        BlockKind kinds[QUANTIZE_GROUP / MX_BLOCK];
+        for (size_t group = begin; group < end; group += QUANTIZE_GROUP) {
+            size_t length = std::min(QUANTIZE_GROUP, end - group);
+            size_t blocks = blockCount(length);
+            for (size_t b = 0; b < blocks; ++b) {
+                size_t i = group + b * MX_BLOCK;
+                kinds[b] = scaleBlock<Element>(src + i, std::min(MX_BLOCK, end - i), scales[i / MX_BLOCK],
+                                               scaled + b * MX_BLOCK);
+            }
+            convertToFP8(scaled, elements + group, blocks * MX_BLOCK, level);
+            for (size_t b = 0; b < blocks; ++b) {
+                finishBlock(kinds[b], scaled + b * MX_BLOCK, elements + group + b * MX_BLOCK);
+            }
+        }
+    });
+    return result;
+}
+
+template <typename Element>
+BlockFloat<Element> BlockFloat<Element>::quantize(const float* src, size_t n) {
+    return quantizeSpan<Element>(src, n);
+}
+
+template <typename Element>
+BlockFloat<Element> BlockFloat<Element>::quantize(const BFloat16* src, size_t n) {
+    return quantizeSpan<Element>(src, n);
+}
+
+template <typename Element>
+BlockFloat<Element> BlockFloat<Element>::quantize(const FP32* src, size_t n) {
+    return quantizeSpan<Element>(src, n);
+}
+
+// dequantize kernels over elements [0, n) of whole blocks, the last one
+// may be partial. an element times a scale is exact in float
+
+template <typename Element>
+static void dequantizeScalar(const uint8_t* scales, const Element* w, float* dst, size_t n) {
+    const uint32_t* table = Element::Tables::instance().fp32Table();
+    for (size_t i = 0; i < n; ++i) {
+        float e;
+        std::memcpy(&e, &table[w[i].bits()], sizeof(float));
+        dst[i] = e * BlockFloat<Element>::scaleValue(scales[i / MX_BLOCK]);
+    }
+}
+
+// dot kernels over elements [0, n) of whole blocks
+
+// lane l of a block holds element l times x[l] plus element l + 16 times
+// x[l + 16]. a partial block reads x as zero past count, its padding
+// elements are zero too
+template <typename Element>
+static void blockLanesScalar(const uint32_t* table, const Element* w, const BFloat16* x, size_t count,
+                             float* lanes) {
+    for (size_t l = 0; l < MX_LANES; ++l) {
+        float p[2];
+        for (size_t half = 0; half < 2; ++half) {
+            size_t i = l + half * MX_LANES;
+            float e;
+            std::memcpy(&e, &table[w[i].bits()], sizeof(float));
+            p[half] = e * (i < count ? x[i].toFloat() : 0.0f);
+        }
+        lanes[l] = p[0] + p[1];
+    }
+}
+
+static float foldLanes(float* lanes) {
+    for (size_t width = MX_LANES / 2; width > 0; width /= 2) {
+        for (size_t l = 0; l < width; ++l) lanes[l] += lanes[l + width];
+    }
+    return lanes[0];
+}
+
+template <typename Element>
+static float dotScalar(const uint8_t* scales, const Element* w, const BFloat16* x, size_t n) {
+    const uint32_t* table = Element::Tables::instance().fp32Table();
+    float total[MX_LANES] = {};
+    for (size_t i = 0; i < n; i += MX_BLOCK) {
+        float lanes[MX_LANES];
+        blockLanesScalar(table, w + i, x + i, std::min(MX_BLOCK, n - i), lanes);
+        float scale = BlockFloat<Element>::scaleValue(scales[i / MX_BLOCK]);
+        for (size_t l = 0; l < MX_LANES; ++l) total[l] += lanes[l] * scale;
+    }
+    return foldLanes(total);
+}
+
+#ifdef MX_X86
+
+template <typename Element>
+__attribute__((target("avx2")))
+static void dequantizeAVX2(const uint8_t* scales, const Element* w, float* dst, size_t n) {
+    const int* table = reinterpret_cast<const int*>(Element::Tables::instance().fp32Table());
+    size_t i = 0;
+
+    for (; i + MX_BLOCK <= n; i += MX_BLOCK) {
+        __m256 s = _mm256_set1_ps(BlockFloat<Element>::scaleValue(scales[i / MX_BLOCK]));
+        for (size_t j = 0; j < MX_BLOCK; j += 8) {
+            __m128i b = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(w + i + j));
+            __m256 e = _mm256_castsi256_ps(_mm256_i32gather_epi32(table, _mm256_cvtepu8_epi32(b), 4));
+            _mm256_storeu_ps(dst + i + j, _mm256_mul_ps(e, s));
+        }
+    }
+
+    dequantizeScalar(scales + i / MX_BLOCK, w + i, dst + i, n - i);
+}
+
+// 8 elements and 8 bf16 values widened to float
+template <typename Element>
+__attribute__((target("avx2")))
+static __m256 productAVX2(const int* table, const Element* w, const BFloat16* x) {
+    __m128i b = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(w));
+    __m256 e = _mm256_castsi256_ps(_mm256_i32gather_epi32(table, _mm256_cvtepu8_epi32(b), 4));
+    __m128i h = _mm_loadu_si128(reinterpret_cast<const __m128i*>(x));
+    __m256 v = _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_cvtepu16_epi32(h), 16));
+    return _mm256_mul_ps(e, v);
+}
+
+template <typename Element>
+__attribute__((target("avx2")))
+static float dotAVX2(const uint8_t* scales, const Element* w, const BFloat16* x, size_t n) {
+    const int* table = reinterpret_cast<const int*>(Element::Tables::instance().fp32Table());
+    // lanes 0-7 and 8-15
+    __m256 total_lo = _mm256_setzero_ps();
+    __m256 total_hi = _mm256_setzero_ps();
+
+    BFloat16 padded[MX_BLOCK];
+    for (size_t i = 0; i < n; i += MX_BLOCK) {
+        const BFloat16* xs = x + i;
+        if (n - i < MX_BLOCK) {
+            std::fill_n(padded, MX_BLOCK, BFloat16::fromBits(0));
+            std::copy(x + i, x + n, padded);
+            xs = padded;
+        }
+        __m256 lo = _mm256_add_ps(productAVX2(table, w + i, xs), productAVX2(table, w + i + 16, xs + 16));
+        __m256 hi = _mm256_add_ps(productAVX2(table, w + i + 8, xs + 8), productAVX2(table, w + i + 24, xs + 24));
+        __m256 s = _mm256_set1_ps(BlockFloat<Element>::scaleValue(scales[i / MX_BLOCK]));
+        total_lo = _mm256_add_ps(total_lo, _mm256_mul_ps(lo, s));
+        total_hi = _mm256_add_ps(total_hi, _mm256_mul_ps(hi, s));
+    }
+
+    float lanes[MX_LANES];
+    _mm256_storeu_ps(lanes, total_lo);
+    _mm256_storeu_ps(lanes + 8, total_hi);
+    return foldLanes(lanes);
+}
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#pragma GCC diagnostic ignored "-Wuninitialized"
+#endif
+
+template <typename Element>
+__attribute__((target("avx512f,avx512bw,avx512vl")))
+static __m512 elementsAVX512(const uint32_t* table, const Element* w) {
+    __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(w));
+    return _mm512_castsi512_ps(_mm512_i32gather_epi32(_mm512_cvtepu8_epi32(b), table, 4));
+}
+
+template <typename Element>
+__attribute__((target("avx512f,avx512bw,avx512vl")))
+static void dequantizeAVX512(const uint8_t* scales, const Element* w, float* dst, size_t n) {
+    const uint32_t* table = Element::Tables::instance().fp32Table();
+    size_t i = 0;
+
+    for (; i + MX_BLOCK <= n; i += MX_BLOCK) {
+        __m512 s = _mm512_set1_ps(BlockFloat<Element>::scaleValue(scales[i / MX_BLOCK]));
+        _mm512_storeu_ps(dst + i, _mm512_mul_ps(elementsAVX512(table, w + i), s));
+        _mm512_storeu_ps(dst + i + 16, _mm512_mul_ps(elementsAVX512(table, w + i + 16), s));
+    }
+
+    if (i < n) {
+        // the padding elements are in storage, only the store is masked
+        __m512 s = _mm512_set1_ps(BlockFloat<Element>::scaleValue(scales[i / MX_BLOCK]));
+        size_t rest = n - i;
+        __mmask16 k0 = static_cast<__mmask16>(rest >= 16 ? 0xFFFFu : (1u << rest) - 1);
+        __mmask16 k1 = static_cast<__mmask16>(rest <= 16 ? 0u : (1u << (rest - 16)) - 1);
+        _mm512_mask_storeu_ps(dst + i, k0, _mm512_mul_ps(elementsAVX512(table, w + i), s));
+        _mm512_mask_storeu_ps(dst + i + 16, k1, _mm512_mul_ps(elementsAVX512(table, w + i + 16), s));
+    }
+}
+
+template <typename Element>
+__attribute__((target("avx512f,avx512bw,avx512vl")))
+static float dotAVX512(const uint8_t* scales, const Element* w, const BFloat16* x, size_t n) {
+    const uint32_t* table = Element::Tables::instance().fp32Table();
+    __m512 total = _mm512_setzero_ps();
+
+    for (size_t i = 0; i < n; i += MX_BLOCK) {
+        // masked loads read x as zero past the end
+        size_t rest = std::min(MX_BLOCK, n - i);
+        __mmask32 k = rest == MX_BLOCK ? ~__mmask32(0) : static_cast<__mmask32>((1u << rest) - 1);
+        __m512i h = _mm512_maskz_loadu_epi16(k, x + i);
+        __m512 x0 = _mm512_castsi512_ps(_mm512_slli_epi32(_mm512_cvtepu16_epi32(_mm512_castsi512_si256(h)), 16));
+        __m512 x1 = _mm512_castsi512_ps(_mm512_slli_epi32(_mm512_cvtepu16_epi32(_mm512_extracti64x4_epi64(h, 1)), 16));
+        __m512 lanes = _mm512_add_ps(_mm512_mul_ps(elementsAVX512(table, w + i), x0),
+                                     _mm512_mul_ps(elementsAVX512(table, w + i + 16), x1));
+        __m512 s = _mm512_set1_ps(BlockFloat<Element>::scaleValue(scales[i / MX_BLOCK]));
+        total = _mm512_add_ps(total, _mm512_mul_ps(lanes, s));
+    }
+
+    float lanes[MX_LANES];
+    _mm512_storeu_ps(lanes, total);
+    return foldLanes(lanes);
+}
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+#endif
+
+// pinned dispatch
+
+template <typename Element>
+using DotKernel = float (*)(const uint8_t*, const Element*, const BFloat16*, size_t);
+
+template <typename Element>
+static DotKernel<Element> dotKernel(SimdLevel level) {
+    if (!simdLevelSupported(level)) level = SimdLevel::Scalar;
+    switch (level) {
+#ifdef MX_X86
+    case SimdLevel::AVX2:       return dotAVX2<Element>;
+    case SimdLevel::AVX512:
+    case SimdLevel::AVX512BF16: return dotAVX512<Element>;
+#endif
+    default:                    return dotScalar<Element>;
+    }
+}
+
+template <typename Element>
+static void dequantizeSpan(const uint8_t* scales, const Element* w, float* dst, size_t n, SimdLevel level) {
+    if (!simdLevelSupported(level)) level = SimdLevel::Scalar;
+    switch (level) {
+#ifdef MX_X86
+    case SimdLevel::AVX2:       dequantizeAVX2(scales, w, dst, n); return;
+    case SimdLevel::AVX512:
+    case SimdLevel::AVX512BF16: dequantizeAVX512(scales, w, dst, n); return;
+#endif
+    default:                    dequantizeScalar(scales, w, dst, n); return;
+    }
+}
+
+// chunks of DOT_GRAIN elements combined in order, the same split
+// parallelReduce makes
+template <typename Element>
+static float dotSerial(DotKernel<Element> kernel, const uint8_t* scales, const Element* w, const BFloat16* x,
+                       size_t n) {
+    float result = 0.0f;
+    for (size_t begin = 0; begin < n; begin += DOT_GRAIN) {
+        size_t count = std::min(DOT_GRAIN, n - begin);
+        result = result + kernel(scales + begin / MX_BLOCK, w + begin, x + begin, count);
+    }
+    return result;
+}
+
+template <typename Element>
+float dot(const BlockFloat<Element>& w, const BFloat16* x, SimdLevel level) {
+    DotKernel<Element> kernel = dotKernel<Element>(level);
+    const uint8_t* scales = w.scaleData();
+    const Element* elements = w.elementData();
+    const size_t n = w.size();
+    if (n <= DOT_GRAIN) {
+        return dotSerial(kernel, scales, elements, x, n);
+    }
+    return parallelReduce(n, DOT_GRAIN, 0.0f,
+                          [=](size_t begin, size_t end) {
+                              return kernel(scales + begin / MX_BLOCK, elements + begin, x + begin, end - begin);
+                          },
+                          [](float a, float b) { return a + b; });
+}
+
+template <typename Element>
+float dot(const BlockFloat<Element>& w, const BFloat16* x) {
+    return dot(w, x, detectSimdLevel());
+}
+
+template <typename Element>
+void gemv(const BlockFloat<Element>& w, size_t rows, size_t cols, const BFloat16* x, float* y) {
+    if (w.size() != rows * cols || cols % MX_BLOCK != 0) {
+        throw std::invalid_argument("gemv: w must be rows x cols with cols a multiple of MX_BLOCK");
+    }
+    DotKernel<Element> kernel = dotKernel<Element>(detectSimdLevel());
+    const uint8_t* scales = w.scaleData();
+    const Element* elements = w.elementData();
+    size_t grain = std::max<size_t>(1, DOT_GRAIN / std::max<size_t>(cols, 1));
+    parallelChunks(rows, grain, [=](size_t begin, size_t end) {
+        for (size_t r = begin; r < end; ++r) {
+            size_t offset = r * cols;
+            y[r] = dotSerial(kernel, scales + offset / MX_BLOCK, elements + offset, x, cols);
+        }
+    });
+}
+
+template <typename Element>
+void dequantize(const BlockFloat<Element>& w, float* dst, SimdLevel level) {
+    const uint8_t* scales = w.scaleData();
+    const Element* elements = w.elementData();
+    parallelChunks(w.size(), DEQUANTIZE_GRAIN, [=](size_t begin, size_t end) {
+        dequantizeSpan(scales + begin / MX_BLOCK, elements + begin, dst + begin, end - begin, level);
+    });
+}
+
+template <typename Element>
+void BlockFloat<Element>::dequantize(float* dst) const {
+    ::dequantize(*this, dst, detectSimdLevel());
+}
+
+template <typename Element>
+void BlockFloat<Element>::dequantize(BFloat16* dst) const {
+    // through a float buffer a chunk at a time, then the bulk rounding
+    SimdLevel level = detectSimdLevel();
+    const uint8_t* scales = scales_.data();
+    const Element* elements = elements_.data();
+    parallelChunks(size_, DEQUANTIZE_GRAIN, [=](size_t begin, size_t end) {
+        float buffer[1024];
+        for (size_t i = begin; i < end; i += 1024) {
+            size_t count = std::min<size_t>(1024, end - i);
+            dequantizeSpan(scales + i / MX_BLOCK, elements + i, buffer, count, level);
+            convertToBF16(buffer, dst + i, count, level);
+        }
+    });
+}
+
+#define MX_INSTANTIATE(Element)                                                                  \
+    template class BlockFloat<Element>;                                                          \
+    template float dot(const BlockFloat<Element>&, const BFloat16*);                             \
+    template float dot(const BlockFloat<Element>&, const BFloat16*, SimdLevel);                  \
+    template void gemv(const BlockFloat<Element>&, size_t, size_t, const BFloat16*, float*);     \
+    template void dequantize(const BlockFloat<Element>&, float*, SimdLevel);
+
+MX_INSTANTIATE(FP8E4M3)
+MX_INSTANTIATE(FP8E5M2)
+
+#undef MX_INSTANTIATE
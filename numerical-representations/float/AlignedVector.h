@@ -0,0 +1,404 @@
+#ifndef ALIGNED_VECTOR_H
+#define ALIGNED_VECTOR_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <initializer_list>
+#include <new>
+#include <stdexcept>
+
+// the packed, 64-byte aligned array behind FP32Vector (FP32Vector.h) and
+// BF16Vector (../bfloat16/BF16Vector.h), with the arena they share
+
+// bump allocator for short-lived buffers
+//
+// allocations are 64-byte aligned and never freed one by one, reset()
+// releases everything at once. vectors that outgrow the arena fall back
+// to the heap.
+
+class VectorArena {
+public:
+    static constexpr size_t ALIGNMENT = 64;
+
+    explicit VectorArena(size_t capacity_bytes);
+    ~VectorArena();
+
+    VectorArena(const VectorArena&) = delete;
+    VectorArena& operator=(const VectorArena&) = delete;
+
+    // nullptr if the arena is full
+    void* allocate(size_t bytes);
+    void reset() { used_ = 0; }
+
+    size_t used() const { return used_; }
+    size_t capacity() const { return capacity_; }
+
+    // round a byte count up to the alignment
+    static size_t alignUp(size_t bytes) { return (bytes + ALIGNMENT - 1) & ~(ALIGNMENT - 1); }
+
+private:
+    unsigned char* buffer_;
+    size_t capacity_;
+    size_t used_;
+};
+
+// per element type, from the module headers:
+//   using Bits                   the raw bit pattern, for view()
+//   static void fromFloats(const float* src, T* dst, size_t n)
+//   static void toFloats(const T* src, float* dst, size_t n)
+//                                the bulk conversions
+// and T provides the batched add / subtract / multiply / scale
+template <typename T>
+struct VectorElement {};
+
+// packed array of T with 64-byte aligned storage
+//
+// owns its storage (heap or arena) or is a non-owning view over memory
+// the caller already has. views have a fixed size: assigning to a view
+// copies the elements into the caller's memory and throws
+// std::invalid_argument unless the sizes match, it never rebinds the view.
+// sizes too large to allocate throw std::length_error, as std::vector does
+
+template <typename T>
+class AlignedVector {
+public:
+    using Bits = typename VectorElement<T>::Bits;
+    static constexpr size_t ALIGNMENT = VectorArena::ALIGNMENT;
+
+    // constructors
+
+    AlignedVector();
+    explicit AlignedVector(size_t n, T value = T());
+    AlignedVector(size_t n, VectorArena& arena, T value = T());
+    AlignedVector(std::initializer_list<T> values);
+
+    AlignedVector(const AlignedVector& other);
+    AlignedVector(AlignedVector&& other) noexcept;
+    AlignedVector& operator=(const AlignedVector& other);
+    AlignedVector& operator=(AlignedVector&& other);
+    ~AlignedVector();
+
+    // named constructors
+
+    static AlignedVector view(Bits* bits, size_t n);   // zero-copy over raw bits
+    static AlignedVector view(T* data, size_t n);
+    static AlignedVector fromFloats(const float* src, size_t n);
+
+    // accessors
+
+    T* data() { return data_; }
+    const T* data() const { return data_; }
+    Bits* bits() { return reinterpret_cast<Bits*>(data_); }
+    const Bits* bits() const { return reinterpret_cast<const Bits*>(data_); }
+    size_t size() const { return size_; }
+    size_t capacity() const { return capacity_; }
+    bool empty() const { return size_ == 0; }
+    bool isView() const { return !owns_; }
+    VectorArena* arena() const { return arena_; }
+
+    T& operator[](size_t i) { return data_[i]; }
+    const T& operator[](size_t i) const { return data_[i]; }
+
+    T* begin() { return data_; }
+    T* end() { return data_ + size_; }
+    const T* begin() const { return data_; }
+    const T* end() const { return data_ + size_; }
+
+    // size management, views throw std::logic_error if asked to grow
+
+    void reserve(size_t n);
+    void resize(size_t n, T value = T());
+    void push_back(T value);
+    void clear() { size_ = 0; }
+
+    // conversion
+
+    void toFloats(float* dst) const { VectorElement<T>::toFloats(data_, dst, size_); }
+
+    // element-wise arithmetic, sizes must match (std::invalid_argument)
+    // results are allocated from the left operand's arena if it has one
+
+    AlignedVector operator+(const AlignedVector& other) const;
+    AlignedVector operator-(const AlignedVector& other) const;
+    AlignedVector operator*(const AlignedVector& other) const;
+    AlignedVector operator*(T scalar) const;
+
+    AlignedVector& operator+=(const AlignedVector& other);
+    AlignedVector& operator-=(const AlignedVector& other);
+    AlignedVector& operator*=(const AlignedVector& other);
+    AlignedVector& operator*=(T scalar);
+
+private:
+    T* data_;
+    size_t size_;
+    size_t capacity_;
+    VectorArena* arena_;
+    bool owns_;
+
+    static size_t storageBytes(size_t n);
+    T* allocate(size_t n);
+    void release();
+    void checkSameSize(const AlignedVector& other) const;
+    AlignedVector emptyLike() const;
+};
+
+template <typename T>
+AlignedVector<T> operator*(T scalar, const AlignedVector<T>& v) {
+    return v * scalar;
+}
+
+// constructors
+
+template <typename T>
+AlignedVector<T>::AlignedVector()
+    : data_(nullptr), size_(0), capacity_(0), arena_(nullptr), owns_(true) {
+}
+
+template <typename T>
+AlignedVector<T>::AlignedVector(size_t n, T value) : AlignedVector() {
+    resize(n, value);
+}
+
+template <typename T>
+AlignedVector<T>::AlignedVector(size_t n, VectorArena& arena, T value) : AlignedVector() {
+    arena_ = &arena;
+    resize(n, value);
+}
+
+template <typename T>
+AlignedVector<T>::AlignedVector(std::initializer_list<T> values) : AlignedVector() {
+    reserve(values.size());
+    std::copy(values.begin(), values.end(), data_);
+    size_ = values.size();
+}
+
+template <typename T>
+AlignedVector<T>::AlignedVector(const AlignedVector& other) : AlignedVector() {
+    arena_ = other.arena_;
+    reserve(other.size_);
+    std::copy(other.begin(), other.end(), data_);
+    size_ = other.size_;
+}
+
+template <typename T>
+AlignedVector<T>::AlignedVector(AlignedVector&& other) noexcept
+    : data_(other.data_), size_(other.size_), capacity_(other.capacity_),
+      arena_(other.arena_), owns_(other.owns_) {
+    other.data_ = nullptr;
+    other.size_ = 0;
+    other.capacity_ = 0;
+    other.owns_ = true;
+}
+
+template <typename T>
+AlignedVector<T>& AlignedVector<T>::operator=(const AlignedVector& other) {
+    if (this == &other) return *this;
+    if (!owns_) {
+        checkSameSize(other);
+        std::copy(other.begin(), other.end(), data_);
+        return *this;
+    }
+    AlignedVector copy(other);
+    *this = std::move(copy);
+    return *this;
+}
+
+template <typename T>
+AlignedVector<T>& AlignedVector<T>::operator=(AlignedVector&& other) {
+    if (this == &other) return *this;
+    if (!owns_) {
+        // a view keeps pointing at the caller's memory
+        checkSameSize(other);
+        std::copy(other.begin(), other.end(), data_);
+        return *this;
+    }
+    release();
+    data_ = other.data_;
+    size_ = other.size_;
+    capacity_ = other.capacity_;
+    arena_ = other.arena_;
+    owns_ = other.owns_;
+    other.data_ = nullptr;
+    other.size_ = 0;
+    other.capacity_ = 0;
+    other.owns_ = true;
+    return *this;
+}
+
+template <typename T>
+AlignedVector<T>::~AlignedVector() {
+    release();
+}
+
+// named constructors
+
+template <typename T>
+AlignedVector<T> AlignedVector<T>::view(Bits* bits, size_t n) {
+    return view(reinterpret_cast<T*>(bits), n);
+}
+
+template <typename T>
+AlignedVector<T> AlignedVector<T>::view(T* data, size_t n) {
+    AlignedVector v;
+    v.data_ = data;
+    v.size_ = n;
+    v.capacity_ = n;
+    v.owns_ = false;
+    return v;
+}
+
+template <typename T>
+AlignedVector<T> AlignedVector<T>::fromFloats(const float* src, size_t n) {
+    AlignedVector v;
+    v.reserve(n);
+    VectorElement<T>::fromFloats(src, v.data_, n);
+    v.size_ = n;
+    return v;
+}
+
+// storage
+
+template <typename T>
+size_t AlignedVector<T>::storageBytes(size_t n) {
+    // n * sizeof(T) and the round up to the alignment must not wrap
+    if (n > (SIZE_MAX - ALIGNMENT) / sizeof(T)) {
+        throw std::length_error("vector: size too large");
+    }
+    return VectorArena::alignUp(n * sizeof(T));
+}
+
+template <typename T>
+T* AlignedVector<T>::allocate(size_t n) {
+    size_t bytes = storageBytes(n);
+
+    if (arena_) {
+        void* p = arena_->allocate(bytes);
+        if (p) return static_cast<T*>(p);
+        // arena full, drop it and live on the heap from now on
+        arena_ = nullptr;
+    }
+
+    void* p = std::aligned_alloc(ALIGNMENT, bytes);
+    if (!p) throw std::bad_alloc();
+    return static_cast<T*>(p);
+}
+
+template <typename T>
+void AlignedVector<T>::release() {
+    // arena memory goes back on reset(), views never owned anything
+    if (owns_ && !arena_) {
+        std::free(data_);
+    }
+    data_ = nullptr;
+    size_ = 0;
+    capacity_ = 0;
+}
+
+template <typename T>
+void AlignedVector<T>::reserve(size_t n) {
+    if (n <= capacity_) return;
+    if (!owns_) throw std::logic_error("vector: cannot grow a view");
+
+    VectorArena* old_arena = arena_;
+    T* grown = allocate(n);
+    std::copy(data_, data_ + size_, grown);
+    if (!old_arena) std::free(data_);
+
+    data_ = grown;
+    capacity_ = storageBytes(n) / sizeof(T);
+}
+
+template <typename T>
+void AlignedVector<T>::resize(size_t n, T value) {
+    reserve(n);
+    if (n > size_) std::fill(data_ + size_, data_ + n, value);
+    size_ = n;
+}
+
+template <typename T>
+void AlignedVector<T>::push_back(T value) {
+    if (size_ == capacity_) {
+        reserve(std::max<size_t>(2 * capacity_, ALIGNMENT / sizeof(T)));
+    }
+    data_[size_++] = value;
+}
+
+// element-wise arithmetic
+
+template <typename T>
+void AlignedVector<T>::checkSameSize(const AlignedVector& other) const {
+    if (size_ != other.size_) {
+        throw std::invalid_argument("vector: size mismatch");
+    }
+}
+
+template <typename T>
+AlignedVector<T> AlignedVector<T>::emptyLike() const {
+    AlignedVector result;
+    result.arena_ = arena_;
+    result.reserve(size_);
+    result.size_ = size_;
+    return result;
+}
+
+template <typename T>
+AlignedVector<T> AlignedVector<T>::operator+(const AlignedVector& other) const {
+    checkSameSize(other);
+    AlignedVector result = emptyLike();
+    T::add(data_, other.data_, result.data_, size_);
+    return result;
+}
+
+template <typename T>
+AlignedVector<T> AlignedVector<T>::operator-(const AlignedVector& other) const {
+    checkSameSize(other);
+    AlignedVector result = emptyLike();
+    T::subtract(data_, other.data_, result.data_, size_);
+    return result;
+}
+
+template <typename T>
+AlignedVector<T> AlignedVector<T>::operator*(const AlignedVector& other) const {
+    checkSameSize(other);
+    AlignedVector result = emptyLike();
+    T::multiply(data_, other.data_, result.data_, size_);
+    return result;
+}
+
+template <typename T>
+AlignedVector<T> AlignedVector<T>::operator*(T scalar) const {
+    AlignedVector result = emptyLike();
+    T::scale(data_, scalar, result.data_, size_);
+    return result;
+}
+
+template <typename T>
+AlignedVector<T>& AlignedVector<T>::operator+=(const AlignedVector& other) {
+    checkSameSize(other);
+    T::add(data_, other.data_, data_, size_);
+    return *this;
+}
+
+template <typename T>
+AlignedVector<T>& AlignedVector<T>::operator-=(const AlignedVector& other) {
+    checkSameSize(other);
+    T::subtract(data_, other.data_, data_, size_);
+    return *this;
+}
+
+template <typename T>
+AlignedVector<T>& AlignedVector<T>::operator*=(const AlignedVector& other) {
+    checkSameSize(other);
+    T::multiply(data_, other.data_, data_, size_);
+    return *this;
+}
+
+template <typename T>
+AlignedVector<T>& AlignedVector<T>::operator*=(T scalar) {
+    T::scale(data_, scalar, data_, size_);
+    return *this;
+}
+
+#endif
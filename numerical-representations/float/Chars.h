@@ -0,0 +1,45 @@
+#ifndef CHARS_H
+#define CHARS_H
+
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+
+// text formats for toChars / fromChars on FP32 and BFloat16
+//
+// Shortest - the shortest decimal that parses back to the same value, fixed
+//            or scientific like std::to_chars ("0.1", "1e+07", "-inf", "nan")
+// Hex      - the bit pattern, "0x" then upper-case digits ("0x3F80")
+// Binary   - the bit pattern as sign, exponent and mantissa fields
+//            separated by spaces ("0 01111111 0000000")
+//
+// toChars writes no terminator and never allocates. a buffer shorter than
+// the result gets std::errc::value_too_large; MAX_CHARS of the type always
+// fits. fromChars parses the same formats and follows std::from_chars: no
+// leading '+' or whitespace, std::errc::invalid_argument when nothing
+// matches, std::errc::result_out_of_range (value untouched) when a decimal
+// overflows to infinity or underflows to zero
+enum class CharsFormat {
+    Shortest,
+    Hex,
+    Binary
+};
+
+// bit-pattern formatting shared by the types, bits holds the pattern in its
+// low exponent_bits + mantissa_bits + 1 bits
+
+std::to_chars_result bitsToChars(char* first, char* last, uint32_t bits,
+                                 int exponent_bits, int mantissa_bits, CharsFormat format);
+
+// Hex takes an optional "0x" and up to width / 4 digits, Binary every bit
+// with or without the two separating spaces
+std::from_chars_result bitsFromChars(const char* first, const char* last, uint32_t& bits,
+                                     int exponent_bits, int mantissa_bits, CharsFormat format);
+
+// copies the next number-like token of is (after whitespace) into buffer,
+// dropping a leading '+'. returns its length, 0 with failbit set when there
+// is none or it does not fit
+size_t readNumberToken(std::istream& is, char* buffer, size_t capacity);
+
+#endif
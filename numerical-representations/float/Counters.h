@@ -0,0 +1,151 @@
+#ifndef COUNTERS_H
+#define COUNTERS_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+
+// slow-path counters for the FloatFormat kernels, compiled in with
+// -DFLOAT_COUNTERS=1 (make counters). without it every hook below is an
+// empty inline function that compiles away: add, multiply and divide come
+// out instruction for instruction as without the hooks
+//
+// per operation the kernels count:
+//
+//   Calls      every call. Convert is FloatFormat::fromFP32Bits: SmallFloat,
+//              FP8 and the BFloat16 rounding-mode constructors, not the
+//              inline BFloat16(float)
+//   Special    the nan / infinity / zero early-outs, and for add and divide
+//              the out-of-line path any zero or subnormal operand takes
+//   Subnormal  a nonzero result with exponent field 0
+//   Tie        an exact halfway case under round to nearest even
+//   Overflow   a finite result rounded to infinity (or to the max finite
+//              value in a mode that rounds toward zero)
+//   Underflow  a result below the smallest normal, before rounding, that
+//              lost bits: it rounded to a subnormal, to zero, or up to the
+//              smallest normal
+//
+// the counters are per thread and only the owning thread writes them, a
+// relaxed load and store with no locked instruction. snapshot() adds up
+// every thread, exited ones included, so the thread pool's work shows up;
+// threadSnapshot() is the calling thread alone. a reset() that races with
+// running kernels may lose a few of their counts.
+//
+// only the scalar kernels are counted. the simd bulk conversions, the
+// lookup tables and the hardware float paths (expression templates, the
+// elementary functions) never reach them
+//
+// every translation unit of a program must agree on FLOAT_COUNTERS
+
+#ifndef FLOAT_COUNTERS
+#define FLOAT_COUNTERS 0
+#endif
+
+enum class CountedOp {
+    Add,        // and subtract
+    Multiply,
+    Divide,
+    Sqrt,
+    Rsqrt,
+    Fma,
+    Convert     // narrowing from FP32 bits
+};
+
+enum class CountedEvent {
+    Calls,
+    Special,
+    Subnormal,
+    Tie,
+    Overflow,
+    Underflow
+};
+
+constexpr size_t COUNTED_OPS = 7;
+constexpr size_t COUNTED_EVENTS = 6;
+
+const char* countedOpName(CountedOp op);
+const char* countedEventName(CountedEvent event);
+
+struct CounterSnapshot {
+    uint64_t counts[COUNTED_OPS][COUNTED_EVENTS] = {};
+
+    uint64_t operator()(CountedOp op, CountedEvent event) const {
+        return counts[static_cast<size_t>(op)][static_cast<size_t>(event)];
+    }
+
+    // the counts since an earlier snapshot
+    CounterSnapshot operator-(const CounterSnapshot& earlier) const;
+};
+
+// a table of the ops with any calls, one column per event
+std::ostream& operator<<(std::ostream& os, const CounterSnapshot& snapshot);
+
+class FloatCounters {
+public:
+    static constexpr bool ENABLED = FLOAT_COUNTERS != 0;
+
+    static CounterSnapshot snapshot();
+    static CounterSnapshot threadSnapshot();
+    static void reset();
+
+    // hooks for the kernels
+
+    // charged to the innermost Scope's op, dropped outside any Scope
+    static void count(CountedEvent event) {
+        if constexpr (ENABLED) {
+            Block& block = local();
+            if (block.op < COUNTED_OPS) bump(block.counts[block.op][static_cast<size_t>(event)]);
+        } else {
+            (void)event;
+        }
+    }
+
+    // the op the kernel hooks charge: set for the lifetime of a Scope, the
+    // outer op coming back when a nested one ends (fma calling multiply)
+    class Scope {
+    public:
+        explicit Scope(CountedOp op) {
+            if constexpr (ENABLED) {
+                Block& block = local();
+                previous_ = block.op;
+                block.op = static_cast<size_t>(op);
+                bump(block.counts[block.op][static_cast<size_t>(CountedEvent::Calls)]);
+            } else {
+                (void)op;
+            }
+        }
+        ~Scope() {
+            if constexpr (ENABLED) local().op = previous_;
+        }
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        size_t previous_ = COUNTED_OPS;
+    };
+
+private:
+    struct Block {
+        std::atomic<uint64_t> counts[COUNTED_OPS][COUNTED_EVENTS] = {};
+        size_t op = COUNTED_OPS;   // none
+    };
+
+    static void bump(std::atomic<uint64_t>& c) {
+        c.store(c.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+
+    static Block& local() {
+        Block* block = block_;
+        return block ? *block : attach();
+    }
+
+    // registers the calling thread's block, out of line
+    static Block& attach();
+
+    static inline thread_local Block* block_ = nullptr;
+
+    friend struct CounterRegistry;
+};
+
+#endif
@@ -0,0 +1,272 @@
+#ifndef EXPR_H
+#define EXPR_H
+
+#include "Rounding.h"
+#include "ThreadPool.h"
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <type_traits>
+
+// lazy element-wise expressions over FP32 / BFloat16 arrays, opt in by
+// including FP32Expr.h or ../bfloat16/BF16Expr.h
+//
+// lazy(v) wraps a vector. + - * and unary - on a wrapped operand build an
+// expression tree instead of computing anything, and evaluate() runs the
+// whole tree in one pass over memory, with no temporaries:
+//
+//   BF16Vector r = evaluate(lazy(a) * b + lazy(c) * d - e);
+//
+// the precision picks how the nodes round. both run in hardware float:
+//
+// Rounded  - every node rounds to the element type, nan to its quiet nan,
+//            exactly as the operators do. the result has the same bits as
+//            the operator chain: an op on two BFloat16 values is exact in
+//            float or rounds once with 16 bits to spare, so float then
+//            bf16 is the correct rounding (bf16_sweep checks every pair)
+// Widened  - intermediates stay in float and the result rounds to nearest
+//            even once at the end, for BFloat16 the closer answer. for FP32
+//            it differs from Rounded only in nan payloads
+//
+// evaluate() reads the calling thread's subnormal mode once (Rounding.h).
+// under Flush a subnormal operand reads as a zero of its sign and a node
+// whose result is subnormal (after rounding, for Rounded) gives one, so
+// Rounded still matches the operators
+//
+// the other operand of a node may be a vector or an element-type scalar.
+// operands must have the same size (std::invalid_argument). the result may
+// alias an operand. an expression keeps pointers to the vectors, not
+// copies, so it must not outlive them
+
+enum class ExprPrecision {
+    Rounded,
+    Widened
+};
+
+// scalars match any size
+constexpr size_t EXPR_ANY_SIZE = static_cast<size_t>(-1);
+
+template <typename Derived>
+struct Expr {
+    const Derived& self() const { return static_cast<const Derived&>(*this); }
+};
+
+template <typename T>
+struct IsExpr : std::is_base_of<Expr<T>, T> {};
+
+// how a non-expression operand enters a tree. FP32Expr.h / BF16Expr.h
+// map their vector and scalar types; an expression is its own operand
+template <typename T, typename = void>
+struct ExprOperand {};
+
+template <typename T>
+struct ExprOperand<T, std::enable_if_t<IsExpr<T>::value>> {
+    using Type = T;
+    static const T& get(const T& e) { return e; }
+};
+
+// the vector evaluate() returns for an element type
+template <typename T>
+struct ExprVector {};
+
+// per element type, from the module headers:
+//   static float round(float x)  x rounded to T as the operators round,
+//                                a nan to T's quiet nan
+//   static void narrow(const float* src, T* dst, size_t n)
+//                                exact, every src value is a T
+//   static void round(const float* src, T* dst, size_t n)
+//                                to nearest even
+template <typename T>
+struct ExprElement {};
+
+// Flush for either element type: FP32 and BFloat16 share float's exponent
+// range, so their subnormals are the floats with a zero exponent field
+template <SubnormalMode S>
+inline float exprFlush(float x) {
+    if (S == SubnormalMode::Preserve) return x;
+    uint32_t bits;
+    std::memcpy(&bits, &x, sizeof(bits));
+    if ((bits & 0x7F800000u) == 0) bits &= 0x80000000u;
+    std::memcpy(&x, &bits, sizeof(x));
+    return x;
+}
+
+// leaves
+
+template <typename T>
+struct ExprArray : Expr<ExprArray<T>> {
+    using Value = T;
+    static constexpr size_t ARRAYS = 1;
+
+    const T* data;
+    size_t n;
+
+    ExprArray(const T* data_, size_t n_) : data(data_), n(n_) {}
+
+    size_t size() const { return n; }
+    template <ExprPrecision P, SubnormalMode S>
+    float at(size_t i) const { return exprFlush<S>(data[i].toFloat()); }
+};
+
+template <typename T>
+struct ExprScalar : Expr<ExprScalar<T>> {
+    using Value = T;
+    static constexpr size_t ARRAYS = 0;
+
+    float value;
+
+    explicit ExprScalar(T value_) : value(value_.toFloat()) {}
+
+    size_t size() const { return EXPR_ANY_SIZE; }
+    template <ExprPrecision P, SubnormalMode S>
+    float at(size_t) const { return exprFlush<S>(value); }
+};
+
+// nodes
+
+struct ExprAdd {
+    static float apply(float a, float b) { return a + b; }
+};
+
+struct ExprSubtract {
+    static float apply(float a, float b) { return a - b; }
+};
+
+struct ExprMultiply {
+    static float apply(float a, float b) { return a * b; }
+};
+
+template <typename Op, typename L, typename R>
+struct ExprBinary : Expr<ExprBinary<Op, L, R>> {
+    using Value = typename L::Value;
+    static_assert(std::is_same<Value, typename R::Value>::value, "an expression has one element type");
+    static constexpr size_t ARRAYS = L::ARRAYS + R::ARRAYS;
+
+    L left;
+    R right;
+    size_t n;
+
+    ExprBinary(const L& left_, const R& right_) : left(left_), right(right_), n(left_.size()) {
+        if (n == EXPR_ANY_SIZE) {
+            n = right.size();
+        } else if (right.size() != EXPR_ANY_SIZE && right.size() != n) {
+            throw std::invalid_argument("expression: size mismatch");
+        }
+    }
+
+    size_t size() const { return n; }
+    template <ExprPrecision P, SubnormalMode S>
+    float at(size_t i) const {
+        float x = Op::apply(left.template at<P, S>(i), right.template at<P, S>(i));
+        return exprFlush<S>(P == ExprPrecision::Rounded ? ExprElement<Value>::round(x) : x);
+    }
+};
+
+template <typename E>
+struct ExprNegate : Expr<ExprNegate<E>> {
+    using Value = typename E::Value;
+    static constexpr size_t ARRAYS = E::ARRAYS;
+
+    E operand;
+
+    explicit ExprNegate(const E& operand_) : operand(operand_) {}
+
+    // exact, and flips the sign of a nan like the operators
+    size_t size() const { return operand.size(); }
+    template <ExprPrecision P, SubnormalMode S>
+    float at(size_t i) const { return -operand.template at<P, S>(i); }
+};
+
+// operators, taken only when one side already is an expression so that
+// vector op vector stays the eager member operator
+
+template <typename T>
+using ExprOperandType = typename ExprOperand<T>::Type;
+
+template <typename L, typename R>
+using ExprEnable = std::enable_if_t<(IsExpr<L>::value || IsExpr<R>::value), int>;
+
+template <typename L, typename R, ExprEnable<L, R> = 0>
+ExprBinary<ExprAdd, ExprOperandType<L>, ExprOperandType<R>> operator+(const L& left, const R& right) {
+    return {ExprOperand<L>::get(left), ExprOperand<R>::get(right)};
+}
+
+template <typename L, typename R, ExprEnable<L, R> = 0>
+ExprBinary<ExprSubtract, ExprOperandType<L>, ExprOperandType<R>> operator-(const L& left, const R& right) {
+    return {ExprOperand<L>::get(left), ExprOperand<R>::get(right)};
+}
+
+template <typename L, typename R, ExprEnable<L, R> = 0>
+ExprBinary<ExprMultiply, ExprOperandType<L>, ExprOperandType<R>> operator*(const L& left, const R& right) {
+    return {ExprOperand<L>::get(left), ExprOperand<R>::get(right)};
+}
+
+template <typename E>
+ExprNegate<E> operator-(const Expr<E>& e) {
+    return ExprNegate<E>(e.self());
+}
+
+// evaluation, a tile of floats at a time then narrowed (Rounded, already
+// representable) or rounded (Widened) into the output
+
+constexpr size_t EXPR_TILE = 256;
+constexpr size_t EXPR_LANES = 16;
+
+template <ExprPrecision P, SubnormalMode S, typename E>
+void evaluateTiles(const E& e, typename E::Value* out, size_t begin, size_t end) {
+    using Element = ExprElement<typename E::Value>;
+    float tile[EXPR_TILE];
+    for (size_t i = begin; i < end; i += EXPR_TILE) {
+        size_t count = end - i < EXPR_TILE ? end - i : EXPR_TILE;
+        // fixed-size runs so the loop vectorizes, then the ragged end
+        size_t j = 0;
+        for (; j + EXPR_LANES <= count; j += EXPR_LANES) {
+            for (size_t l = 0; l < EXPR_LANES; ++l) tile[j + l] = e.template at<P, S>(i + j + l);
+        }
+        for (; j < count; ++j) tile[j] = e.template at<P, S>(i + j);
+        if (P == ExprPrecision::Rounded) {
+            Element::narrow(tile, out + i, count);
+        } else {
+            Element::round(tile, out + i, count);
+        }
+    }
+}
+
+template <typename E>
+void evaluate(const Expr<E>& expr, typename E::Value* out, ExprPrecision precision = ExprPrecision::Rounded) {
+    using T = typename E::Value;
+    const E& e = expr.self();
+    constexpr size_t grain = chunkElements((E::ARRAYS + 1) * sizeof(T));
+    // read here, the pool threads have their own
+    SubnormalMode mode = subnormalMode();
+    parallelChunks(e.size(), grain, [&](size_t begin, size_t end) {
+        withSubnormalMode(mode, [&](auto sm) {
+            constexpr SubnormalMode S = decltype(sm)::value;
+            if (precision == ExprPrecision::Rounded) {
+                evaluateTiles<ExprPrecision::Rounded, S>(e, out, begin, end);
+            } else {
+                evaluateTiles<ExprPrecision::Widened, S>(e, out, begin, end);
+            }
+        });
+    });
+}
+
+template <typename E>
+typename ExprVector<typename E::Value>::Type evaluate(const Expr<E>& expr,
+                                                      ExprPrecision precision = ExprPrecision::Rounded) {
+    typename ExprVector<typename E::Value>::Type result(expr.self().size());
+    evaluate(expr, result.data(), precision);
+    return result;
+}
+
+// into an existing vector of the same size, which may be an operand
+template <typename V, typename E>
+void assign(V& dst, const Expr<E>& expr, ExprPrecision precision = ExprPrecision::Rounded) {
+    if (dst.size() != expr.self().size()) {
+        throw std::invalid_argument("assign: size mismatch");
+    }
+    evaluate(expr, dst.data(), precision);
+}
+
+#endif
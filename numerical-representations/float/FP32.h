@@ -1,46 +1,96 @@
 #ifndef FP32_H
 #define FP32_H
 
+#include "FloatFormat.h"
+#include "Chars.h"
+#include "Simd.h"
 #include <cstdint>
+#include <cstddef>
+#include <cstring>
 #include <string>
 #include <iosfwd>
 #include <iostream>
 
 class FP32{
     public:
-        FP32();
+        // masks, bias and the arithmetic kernels
+        using Format = FloatFormat<8, 23>;
+        // the kernels per subnormal mode. the arithmetic below runs the
+        // calling thread's subnormalMode(), see Rounding.h
+        template <SubnormalMode S>
+        using FormatFor = FloatFormat<8, 23, S>;
 
-        explicit FP32(uint32_t bits); // raw bits constructor
+        constexpr FP32() : bits_(0) {}
+
+        constexpr explicit FP32(uint32_t bits) : bits_(bits) {} // raw bits constructor
         FP32(float value); // float constructor
         FP32(double value); // double constructor
         FP32(int value); // int constructor
 
-        static FP32 fromBits(uint32_t bits);
-        static FP32 zero(bool negative = false);
-        static FP32 infinity(bool negative = false);
-        static FP32 nan();
-        static FP32 epsilon();
+        static constexpr FP32 fromBits(uint32_t bits){
+            return FP32(bits);
+        }
+        static constexpr FP32 zero(bool negative = false){
+            return FP32(negative ? SIGN_MASK : 0u);
+        }
+        static constexpr FP32 infinity(bool negative = false){
+            return FP32((negative ? SIGN_MASK : 0u) | EXPONENT_MASK);
+        }
+        static constexpr FP32 nan(){
+            return FP32(EXPONENT_MASK | 0x00400000u); // quiet NaN
+        }
+        static constexpr FP32 epsilon(){
+            return FP32(0x34000000u); // 2^-23
+        }
 
         // accessors 
 
-        uint32_t bits() const{
+        constexpr uint32_t bits() const{
             return bits_;
         }
-        bool sign() const;
-        uint8_t exponent() const;
-        uint32_t mantissa() const;
-        int biasedExponent() const;
-        int unbiasedExponent() const;
+        constexpr bool sign() const{
+            return (bits_ & SIGN_MASK) != 0;
+        }
+        constexpr uint8_t exponent() const{
+            return static_cast<uint8_t>((bits_ & EXPONENT_MASK) >> MANTISSA_BITS);
+        }
+        constexpr uint32_t mantissa() const{
+            return bits_ & MANTISSA_MASK;
+        }
+        constexpr int biasedExponent() const{
+            return exponent();
+        }
+        constexpr int unbiasedExponent() const{
+            // subnormal numbers and zero share the minimum exponent
+            return exponent() == 0 ? 1 - EXPONENT_BIAS : exponent() - EXPONENT_BIAS;
+        }
 
         // classification methods
 
-        bool isZero() const;
-        bool isSubnormal() const;
-        bool isNormal() const; 
-        bool isInfinity() const;
-        bool isNaN() const;
-        bool isFinite() const;
-        bool isNegative() const;
+        constexpr bool isZero() const{
+            // zero if exponent and mantissa are both zero
+            return (bits_ & ~SIGN_MASK) == 0;
+        }
+        constexpr bool isSubnormal() const{
+            return exponent() == 0 && mantissa() != 0;
+        }
+        constexpr bool isNormal() const{
+            return exponent() != 0 && exponent() != 0xFF;
+        }
+        constexpr bool isInfinity() const{
+            // infinity if exponent is all 1s and mantissa is zero
+            return (bits_ & ~SIGN_MASK) == EXPONENT_MASK;
+        }
+        constexpr bool isNaN() const{
+            // NaN if exponent is all 1s and mantissa is non-zero
+            return (bits_ & ~SIGN_MASK) > EXPONENT_MASK;
+        }
+        constexpr bool isFinite() const{
+            return (bits_ & EXPONENT_MASK) != EXPONENT_MASK;
+        }
+        constexpr bool isNegative() const{
+            return sign();
+        }
 
         // conversion methods 
 
@@ -49,6 +99,9 @@ class FP32{
         std::string toBinary() const;
         std::string toHex() const;
 
+        // longest toChars result, the Binary format
+        static constexpr size_t MAX_CHARS = 34;
+
         // arithmetic operators
 
         FP32 operator+(const FP32& other) const;
@@ -57,11 +110,22 @@ class FP32{
         FP32 operator/(const FP32& other) const;
         FP32 operator-() const; // unary negation
 
+        // fused multiply-add: a * b + c rounded once
+        static FP32 fma(const FP32& a, const FP32& b, const FP32& c);
+
         FP32& operator+=(const FP32& other);
         FP32& operator-=(const FP32& other);    
         FP32& operator*=(const FP32& other);
         FP32& operator/=(const FP32& other);
 
+        // batched arithmetic, same results as the scalar operators
+        // out may alias either input
+
+        static void add(const FP32* a, const FP32* b, FP32* out, size_t n);
+        static void subtract(const FP32* a, const FP32* b, FP32* out, size_t n);
+        static void multiply(const FP32* a, const FP32* b, FP32* out, size_t n);
+        static void scale(const FP32* a, FP32 s, FP32* out, size_t n);
+
         // comparison operators
 
         bool operator==(const FP32& other) const;
@@ -74,7 +138,13 @@ class FP32{
         // mathematical functions
 
         FP32 abs() const;
-        FP32 sqrt() const;
+        FP32 sqrt() const;    // correctly rounded, integer arithmetic only
+        FP32 rsqrt() const;   // 1 / sqrt(x) within 0.53 ulp, see FloatFormat::rsqrt
+
+        // batched sqrt / rsqrt, same results as the scalar functions, on
+        // the best simd level of the cpu
+        static void sqrt(const FP32* src, FP32* dst, size_t n);
+        static void rsqrt(const FP32* src, FP32* dst, size_t n);
 
         // debugging 
 
@@ -89,19 +159,54 @@ class FP32{
     private:
         uint32_t bits_; // 32 bit rep of the float 
 
-        static constexpr uint32_t SIGN_MASK = 0x80000000;
-        static constexpr uint32_t EXPONENT_MASK = 0x7F800000;
-        static constexpr uint32_t MANTISSA_MASK = 0x007FFFFF;
-        static constexpr uint32_t MANTISSA_BITS = 23;
-        static constexpr int EXPONENT_BIAS = 127;
-        static constexpr int EXPONENT_BITS = 8;
-
-        static uint32_t packBits(bool sign, uint8_t exp, uint32_t mant);
-        static FP32 addImpl(const FP32& a, const FP32& b);
-        static FP32 multiplyImpl(const FP32& a, const FP32& b);
-        static int compareImpl(const FP32& a, const FP32& b);
-        static FP32 normalize(bool sign, int exp, uint64_t significand);
-        static uint32_t roundToNearest(uint64_t value, int shift);
+        static constexpr uint32_t SIGN_MASK = Format::SIGN_MASK;
+        static constexpr uint32_t EXPONENT_MASK = Format::EXPONENT_MASK;
+        static constexpr uint32_t MANTISSA_MASK = Format::MANTISSA_MASK;
+        static constexpr uint32_t MANTISSA_BITS = Format::MANTISSA_BITS;
+        static constexpr int EXPONENT_BIAS = Format::EXPONENT_BIAS;
+        static constexpr int EXPONENT_BITS = Format::EXPONENT_BITS;
 };
 
+FP32 abs(const FP32& x);
+FP32 sqrt(const FP32& x);
+FP32 rsqrt(const FP32& x);
+FP32 fma(const FP32& a, const FP32& b, const FP32& c);
+
+// batched sqrt / rsqrt pinned to a level, on the calling thread. a level
+// the cpu does not support falls back to scalar
+void sqrt(const FP32* src, FP32* dst, size_t n, SimdLevel level);
+void rsqrt(const FP32* src, FP32* dst, size_t n, SimdLevel level);
+
+// allocation-free text conversion, see Chars.h. Shortest is the shortest
+// decimal that parses back to the same float
+std::to_chars_result toChars(char* first, char* last, FP32 value,
+                             CharsFormat format = CharsFormat::Shortest);
+std::from_chars_result fromChars(const char* first, const char* last, FP32& value,
+                                 CharsFormat format = CharsFormat::Shortest);
+
+// float conversions can't be constexpr before c++20 (no bit_cast),
+// but they are inline so hot loops don't pay for a call
+
+inline FP32::FP32(float value) {
+    std::memcpy(&bits_, &value, sizeof(float));
+}
+
+inline FP32::FP32(double value) : FP32(static_cast<float>(value)) {
+    // convert through float
+}
+
+inline FP32::FP32(int value) : FP32(static_cast<float>(value)) {
+    // convert through float
+}
+
+inline float FP32::toFloat() const {
+    float result;
+    std::memcpy(&result, &bits_, sizeof(float));
+    return result;
+}
+
+inline double FP32::toDouble() const {
+    return static_cast<double>(toFloat());
+}
+
 #endif
\ No newline at end of file
@@ -0,0 +1,58 @@
+#ifndef FP32_EXPR_H
+#define FP32_EXPR_H
+
+#include "Expr.h"
+#include "FP32.h"
+#include "FP32Vector.h"
+#include <cstring>
+
+// lazy expressions over FP32Vector, see Expr.h
+//
+//   FP32Vector r = evaluate(lazy(a) * b + lazy(c) * d - e);
+//   assign(a, lazy(a) * FP32(0.5f) + b, ExprPrecision::Widened);
+
+inline ExprArray<FP32> lazy(const FP32Vector& v) {
+    return ExprArray<FP32>(v.data(), v.size());
+}
+
+inline ExprArray<FP32> lazy(const FP32* data, size_t n) {
+    return ExprArray<FP32>(data, n);
+}
+
+template <>
+struct ExprOperand<FP32Vector> {
+    using Type = ExprArray<FP32>;
+    static Type get(const FP32Vector& v) { return lazy(v); }
+};
+
+template <>
+struct ExprOperand<FP32> {
+    using Type = ExprScalar<FP32>;
+    static Type get(FP32 value) { return Type(value); }
+};
+
+template <>
+struct ExprVector<FP32> {
+    using Type = FP32Vector;
+};
+
+// a float op already is the FP32 op, but for the nan: the operators
+// return the positive quiet nan
+template <>
+struct ExprElement<FP32> {
+    static float round(float x) {
+        uint32_t bits;
+        std::memcpy(&bits, &x, sizeof(bits));
+        bits = (bits & ~FP32::Format::SIGN_MASK) > FP32::Format::EXPONENT_MASK ? FP32::Format::QUIET_NAN : bits;
+        std::memcpy(&x, &bits, sizeof(x));
+        return x;
+    }
+
+    static void narrow(const float* src, FP32* dst, size_t n) {
+        std::memcpy(static_cast<void*>(dst), src, n * sizeof(float));
+    }
+
+    static void round(const float* src, FP32* dst, size_t n) { narrow(src, dst, n); }
+};
+
+#endif
@@ -0,0 +1,32 @@
+#ifndef FP32_ORDER_H
+#define FP32_ORDER_H
+
+#include "FP32.h"
+#include "Ordering.h"
+#include <cstddef>
+#include <utility>
+
+// bulk order ops over FP32 spans, see Ordering.h for the nan policies
+//
+// every op works on the total order key of the bits, so the loops are
+// integer min / max / compare over fixed blocks the compiler vectorizes,
+// not the branchy operator< that std::sort and std::min_element would
+// call. argmin / argmax / minmax / clamp split large spans across the
+// thread pool.
+//
+// argmin / argmax give the first index of the smallest / largest element,
+// n for an empty span. minmax of an empty span is (nan, nan). clamp throws
+// std::invalid_argument if lo or hi is nan or lo > hi. sort is ascending,
+// an lsd radix sort on the keys with 2n words of scratch
+
+size_t argmin(const FP32* x, size_t n, NaNPolicy policy = NaNPolicy::Propagate);
+size_t argmax(const FP32* x, size_t n, NaNPolicy policy = NaNPolicy::Propagate);
+std::pair<FP32, FP32> minmax(const FP32* x, size_t n, NaNPolicy policy = NaNPolicy::Propagate);
+
+// dst may alias src
+void clamp(const FP32* src, FP32* dst, size_t n, FP32 lo, FP32 hi,
+           NaNPolicy policy = NaNPolicy::Propagate);
+
+void sort(FP32* x, size_t n, NaNPolicy policy = NaNPolicy::Propagate);
+
+#endif
@@ -0,0 +1,32 @@
+#ifndef FP32_REDUCE_H
+#define FP32_REDUCE_H
+
+#include "FP32.h"
+#include "Summation.h"
+#include <cstddef>
+
+// reductions over FP32 spans, see Summation.h for the strategies
+//
+// Naive, Pairwise, Kahan and Neumaier round every add and product as the
+// operators do. under Preserve they run on hardware float, with AVX2 /
+// AVX-512 lanes where the cpu has them, which rounds exactly like the
+// operators; under Flush they run the operators. Widened sums the exact
+// products in double. the chunk results are combined in double and
+// rounded to FP32 once, so mean and norm2 round only at the end. the pool
+// threads use the calling thread's subnormal mode, and a nan result is
+// the canonical FP32::nan().
+//
+// mean of an empty span is NaN. norm2 does not rescale, it overflows when
+// the sum of squares does.
+
+FP32 sum(const FP32* x, size_t n, Summation method = Summation::Widened);
+FP32 mean(const FP32* x, size_t n, Summation method = Summation::Widened);
+FP32 norm2(const FP32* x, size_t n, Summation method = Summation::Widened);
+FP32 dot(const FP32* x, const FP32* y, size_t n, Summation method = Summation::Widened);
+
+// sum / dot pinned to a simd level, mostly for testing. every level gives
+// the same bits, a level the cpu does not support falls back to scalar
+FP32 sum(const FP32* x, size_t n, Summation method, SimdLevel level);
+FP32 dot(const FP32* x, const FP32* y, size_t n, Summation method, SimdLevel level);
+
+#endif
@@ -0,0 +1,31 @@
+#ifndef FP32_VECTOR_H
+#define FP32_VECTOR_H
+
+#include "AlignedVector.h"
+#include "FP32.h"
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+// packed array of FP32 values with 64-byte aligned storage, and the arena
+// for short-lived ones, see AlignedVector.h
+
+template <>
+struct VectorElement<FP32> {
+    using Bits = uint32_t;
+
+    // FP32 has float's bits, so both ways are one copy of the span
+    static void fromFloats(const float* src, FP32* dst, size_t n) {
+        std::memcpy(static_cast<void*>(dst), src, n * sizeof(float));
+    }
+    static void toFloats(const FP32* src, float* dst, size_t n) {
+        std::memcpy(dst, static_cast<const void*>(src), n * sizeof(float));
+    }
+};
+
+using FP32Arena = VectorArena;
+using FP32Vector = AlignedVector<FP32>;
+
+extern template class AlignedVector<FP32>;
+
+#endif
@@ -0,0 +1,860 @@
+#ifndef FLOAT_FORMAT_H
+#define FLOAT_FORMAT_H
+
+#include "Counters.h"
+#include "Rounding.h"
+#include <algorithm>
+#include <cstdint>
+#include <type_traits>
+
+// bit-level kernels for any IEEE-754 style binary format with E exponent
+// bits and M stored mantissa bits: a sign bit, a biased exponent, an
+// implicit leading 1 for normals, subnormals, infinities and NaNs, round to
+// nearest even. FP32 (8 / 23) and BFloat16 (8 / 7) are built on it, and
+// SmallFloat.h wraps it into value types for FP16, FP8 and TF32.
+//
+// the arithmetic kernels take the rounding mode (Rounding.h) as a template
+// parameter defaulting to NearestEven, so the default instantiation is the
+// same code as before the other modes existed.
+//
+// the third parameter picks subnormal handling (SubnormalMode in
+// Rounding.h). Flush reads subnormal operands as zero on the way in and
+// flushes subnormal results in normalize(); Preserve compiles to the same
+// code as before the parameter existed.
+//
+// the fourth picks what the all-ones exponent field encodes
+// (FloatEncoding below). the default is IEEE; FiniteNaN is the "FN" layout
+// of the OCP FP8 E4M3 format.
+//
+// with -DFLOAT_COUNTERS=1 the kernels count their slow paths, see
+// Counters.h.
+//
+// everything works on raw bit patterns (Bits) so the class types can use
+// the kernels on their storage directly. intermediate significands live in
+// Wide, 32 bits when 2M + 3 bits fit (products and dividends) and 64
+// otherwise, so the narrow formats never pay for 64-bit arithmetic.
+
+// reciprocals ceil(2^(3M + 4) / d) for every normalized divisor
+// significand d = 2^M .. 2^(M + 1) - 1. dividends stay below 2^(2M + 3), so
+// the product q = (n * r) >> (3M + 4) is off from n / d by less than
+// 2^-(M + 1) < 1 / d: it is the exact floor, and the remainder n - q * d
+// gives the sticky bit without a divide instruction. M = 10 is 4 KiB, FP32
+// sized tables would not fit in cache
+template <int M>
+struct FloatFormatReciprocals {
+    static constexpr int SHIFT = 3 * M + 4;
+    uint32_t r[1 << M];
+    constexpr FloatFormatReciprocals() : r() {
+        for (uint64_t i = 0; i < (uint64_t(1) << M); ++i) {
+            uint64_t d = (uint64_t(1) << M) + i;
+            r[i] = static_cast<uint32_t>(((uint64_t(1) << SHIFT) + d - 1) / d);
+        }
+    }
+};
+
+// reciprocal square root seeds for the integer sqrt / rsqrt kernels:
+// y[i] ~ 2^31 / sqrt(a) at the midpoint of a in [i / 64, (i + 1) / 64),
+// i = 64 .. 255 covering a in [1, 4). relative error at most 2^-8, one
+// newton-raphson step in 32.31 fixed point takes that to ~2^-15.4 and a
+// second to ~2^-29.5 (the fixed-point truncations)
+struct FloatFormatRsqrtSeeds {
+    static constexpr int FIRST = 64;
+    static constexpr int COUNT = 192;
+    uint32_t y[COUNT];
+
+    static constexpr uint64_t isqrt(uint64_t n) {
+        uint64_t lo = 0;
+        uint64_t hi = uint64_t(1) << 32;
+        while (hi - lo > 1) {
+            uint64_t mid = (lo + hi) / 2;
+            if (mid * mid <= n) lo = mid; else hi = mid;
+        }
+        return lo;
+    }
+
+    constexpr FloatFormatRsqrtSeeds() : y() {
+        // 2^31 / sqrt((2i + 1) / 128) = sqrt(2^61 / (2i + 1)) * 2^4
+        for (int i = 0; i < COUNT; ++i) {
+            y[i] = static_cast<uint32_t>(isqrt((uint64_t(1) << 61) / (2 * (i + FIRST) + 1)) << 4);
+        }
+    }
+};
+
+// what the all-ones exponent field holds
+//   Ieee       infinities and NaNs, as in IEEE 754
+//   FiniteNaN  finite values, except S.1..1.1..1, the only NaN (of either
+//              sign); there are no infinities. this is OCP E4M3FN, max 448
+//              where the Ieee E4M3 stops at 240. a result too large to
+//              represent is NaN, or the max finite when the rounding mode
+//              rounds it toward zero, and an infinite input converts to NaN
+enum class FloatEncoding { Ieee, FiniteNaN };
+
+template <int E, int M, SubnormalMode SM = SubnormalMode::Preserve, FloatEncoding ENC = FloatEncoding::Ieee>
+struct FloatFormat {
+    // exponents are kept in plain ints, and every format here converts to
+    // and from float exactly
+    static_assert(E >= 2 && E <= 8, "exponent must be 2..8 bits");
+    static_assert(M >= 1 && M <= 23, "mantissa must be 1..23 bits");
+    // the FP32-range shortcuts below assume the IEEE top field
+    static_assert(ENC == FloatEncoding::Ieee || E < 8, "finite-only formats need a narrower exponent than FP32");
+
+    static constexpr int EXPONENT_BITS = E;
+    static constexpr int MANTISSA_BITS = M;
+    static constexpr int TOTAL_BITS = 1 + E + M;
+    static constexpr int EXPONENT_BIAS = (1 << (E - 1)) - 1;
+    static constexpr bool HAS_INFINITY = ENC == FloatEncoding::Ieee;
+    static constexpr int MAX_FIELD = (1 << E) - 1;    // all-ones field: inf / nan, or the top binade
+    static constexpr int MAX_NORMAL_FIELD = HAS_INFINITY ? MAX_FIELD - 1 : MAX_FIELD;
+    static constexpr unsigned NORMAL_FIELDS = MAX_FIELD - 1; // fields 1 .. MAX_FIELD - 1, the fast paths
+
+    using Bits = typename std::conditional<TOTAL_BITS <= 8, uint8_t,
+                 typename std::conditional<TOTAL_BITS <= 16, uint16_t, uint32_t>::type>::type;
+    using Wide = typename std::conditional<2 * M + 3 <= 32, uint32_t, uint64_t>::type;
+    static constexpr int WIDE_BITS = 8 * static_cast<int>(sizeof(Wide));
+
+    static constexpr Bits SIGN_MASK = static_cast<Bits>(Bits(1) << (E + M));
+    static constexpr Bits EXPONENT_MASK = static_cast<Bits>(Bits(MAX_FIELD) << M);
+    static constexpr Bits MANTISSA_MASK = static_cast<Bits>((Bits(1) << M) - 1);
+    static constexpr Bits QUIET_NAN = static_cast<Bits>(EXPONENT_MASK | (HAS_INFINITY ? Bits(1) << (M - 1)
+                                                                                      : MANTISSA_MASK));
+
+    static constexpr bool FLUSH = SM == SubnormalMode::Flush;
+
+    // special values
+
+    static constexpr Bits zero(bool negative = false) { return negative ? SIGN_MASK : Bits(0); }
+    // without infinities this is the NaN of that sign, what an infinite
+    // result turns into
+    static constexpr Bits infinity(bool negative = false) {
+        return static_cast<Bits>(zero(negative) | (HAS_INFINITY ? EXPONENT_MASK : QUIET_NAN));
+    }
+    static constexpr Bits nan() { return QUIET_NAN; }
+    static constexpr Bits maxFinite() { return static_cast<Bits>((HAS_INFINITY ? EXPONENT_MASK : QUIET_NAN) - 1); }
+    static constexpr Bits minNormal() { return static_cast<Bits>(Bits(1) << M); }
+    static constexpr Bits minSubnormal() { return Bits(1); }
+    static constexpr Bits epsilon() {
+        // 2^-M, the gap between 1 and the next value
+        return static_cast<Bits>(Bits(EXPONENT_BIAS - M) << M);
+    }
+
+    // classification
+
+    static constexpr int field(Bits x) { return (x & EXPONENT_MASK) >> M; }
+    static constexpr bool isNaN(Bits x) {
+        return HAS_INFINITY ? (x & ~SIGN_MASK) > EXPONENT_MASK : (x & ~SIGN_MASK) == QUIET_NAN;
+    }
+    static constexpr bool isInfinity(Bits x) { return HAS_INFINITY && (x & ~SIGN_MASK) == EXPONENT_MASK; }
+    static constexpr bool isZero(Bits x) { return (x & ~SIGN_MASK) == 0; }
+    static constexpr bool isFinite(Bits x) {
+        return HAS_INFINITY ? (x & EXPONENT_MASK) != EXPONENT_MASK : !isNaN(x);
+    }
+    static constexpr bool isNormal(Bits x) { return field(x) != 0 && isFinite(x); }
+    static constexpr bool isSubnormal(Bits x) { return field(x) == 0 && (x & MANTISSA_MASK) != 0; }
+    static constexpr bool sign(Bits x) { return (x & SIGN_MASK) != 0; }
+
+    // an operand as the kernels read it: a subnormal is a zero of its sign
+    // when flushing. a select, no branch
+    static constexpr Bits daz(Bits x) {
+        return FLUSH && field(x) == 0 ? static_cast<Bits>(x & SIGN_MASK) : x;
+    }
+
+    // position of the highest set bit, v != 0
+    static int leadingBit(uint64_t v) { return 63 - __builtin_clzll(v); }
+
+    // right shift that ORs everything shifted out into the lsb (sticky bit)
+    static uint64_t shiftRightSticky(uint64_t v, int n) {
+        if (n <= 0) return v;
+        if (n >= 64) return v != 0;
+        return (v >> n) | ((v & ((1ULL << n) - 1)) != 0);
+    }
+
+    // rounding
+
+    static Wide roundToNearest(Wide value, int shift) {
+        // round to nearest, ties to even (bankers rounding)
+        if (shift <= 0) return value;
+
+        if (shift >= WIDE_BITS) {
+            // every bit is below the kept lsb, only more than half rounds up
+            if (FloatCounters::ENABLED && shift == WIDE_BITS && value == (Wide(1) << (WIDE_BITS - 1))) {
+                FloatCounters::count(CountedEvent::Tie);
+            }
+            return (shift == WIDE_BITS && value > (Wide(1) << (WIDE_BITS - 1))) ? 1 : 0;
+        }
+
+        Wide mask = (Wide(1) << shift) - 1;
+        Wide halfway = Wide(1) << (shift - 1);
+        Wide remainder = value & mask;
+        Wide result = value >> shift;
+        if (FloatCounters::ENABLED && remainder == halfway) FloatCounters::count(CountedEvent::Tie);
+
+        // round up above halfway, and on a tie only if that makes the lsb 0.
+        // computed without branches, rounding direction is data dependent
+        result += (remainder > halfway) | ((remainder == halfway) & result & 1);
+
+        return result;
+    }
+
+    // drop the low shift bits of value (a magnitude with the given sign)
+    // in any rounding mode
+    template <RoundingMode R>
+    static Wide round(bool sign, Wide value, int shift) {
+        if constexpr (R == RoundingMode::NearestEven) {
+            return roundToNearest(value, shift);
+        } else {
+            if (shift <= 0) return value;
+
+            Wide result = shift >= WIDE_BITS ? 0 : value >> shift;
+            Wide remainder = shift >= WIDE_BITS ? value : value & ((Wide(1) << shift) - 1);
+
+            if constexpr (R == RoundingMode::Stochastic) {
+                // up with probability remainder / 2^shift, the fraction
+                // taken to 32 bits
+                uint64_t dropped = remainder;
+                uint32_t fraction = shift <= 32 ? static_cast<uint32_t>(dropped << (32 - shift))
+                                  : shift - 32 >= 64 ? 0 : static_cast<uint32_t>(dropped >> (shift - 32));
+                return result + (StochasticRng::next() < fraction);
+            } else {
+                // directed: the magnitude goes up only if the mode points
+                // away from zero for this sign
+                bool away = R == RoundingMode::Upward ? !sign : R == RoundingMode::Downward ? sign : false;
+                return result + (away & (remainder != 0));
+            }
+        }
+    }
+
+    // a result too large to represent: infinity (NaN without infinities),
+    // unless the mode rounds this sign toward zero
+    template <RoundingMode R>
+    static constexpr Bits overflow(bool sign) {
+        bool toward_zero = R == RoundingMode::TowardZero || (R == RoundingMode::Upward && sign) ||
+                           (R == RoundingMode::Downward && !sign);
+        return toward_zero ? static_cast<Bits>(zero(sign) | maxFinite()) : infinity(sign);
+    }
+
+    // a nan / infinity / zero early-out
+    static Bits special(Bits result) {
+        FloatCounters::count(CountedEvent::Special);
+        return result;
+    }
+
+    // counts a rounded result that came out infinite, for the fast paths
+    // whose rounding carry runs into the exponent
+    static Bits counted(Bits result) {
+        if (FloatCounters::ENABLED && isInfinity(result)) FloatCounters::count(CountedEvent::Overflow);
+        return result;
+    }
+
+    // exact zero from operands of opposite sign: +0, or -0 rounding down
+    template <RoundingMode R>
+    static constexpr Bits cancelled() { return zero(R == RoundingMode::Downward); }
+
+    template <RoundingMode R = RoundingMode::NearestEven>
+    static Bits normalize(bool sign, int exp, Wide significand) {
+        // value = significand * 2^(exp - EXPONENT_BIAS - MANTISSA_BITS)
+        if (significand == 0) return zero(sign);
+
+        // want the leading 1 at bit M, where the implicit bit goes
+        int shift = leadingBit(significand) - M;
+        exp += shift;
+
+        if (exp <= 0) {
+            // subnormal or underflow, exponent field stays 0 and 1 - exp more
+            // bits go. rounding may carry into bit M, which is exactly the
+            // smallest normal, so the mantissa is not masked
+            int denorm_shift = shift + 1 - exp;
+            Wide mant = denorm_shift > 0 ? round<R>(sign, significand, denorm_shift)
+                                         : significand << -denorm_shift;
+            bool subnormal = mant != 0 && mant < (Wide(1) << M);
+            if constexpr (FloatCounters::ENABLED) {
+                bool inexact = denorm_shift >= WIDE_BITS ? true
+                             : denorm_shift > 0 && (significand & ((Wide(1) << denorm_shift) - 1)) != 0;
+                if (subnormal && !FLUSH) FloatCounters::count(CountedEvent::Subnormal);
+                if (inexact || (subnormal && FLUSH)) FloatCounters::count(CountedEvent::Underflow);
+            }
+            // flushing keeps only a carry up to the smallest normal
+            if (FLUSH && subnormal) return zero(sign);
+            return static_cast<Bits>(zero(sign) | mant);
+        }
+
+        // normal number, round and remove the implicit bit
+        Wide sig;
+        if (shift > 0) {
+            sig = round<R>(sign, significand, shift);
+
+            // rounding carried out of the top (1.11..1 -> 10.00..0)
+            if (sig >> (M + 1)) {
+                sig >>= 1;
+                exp++;
+            }
+        } else {
+            sig = significand << -shift;
+        }
+
+        // past the top binade, or onto the NaN pattern without infinities
+        if (exp > MAX_NORMAL_FIELD ||
+            (!HAS_INFINITY && exp == MAX_FIELD && (sig & MANTISSA_MASK) == MANTISSA_MASK)) {
+            FloatCounters::count(CountedEvent::Overflow);
+            return overflow<R>(sign);
+        }
+
+        return static_cast<Bits>(zero(sign) | (Bits(exp) << M) | (sig & MANTISSA_MASK));
+    }
+
+    // normalize() for the common case of a normal result that loses bits on
+    // the right, inline. adding the rounded significand, implicit bit
+    // included, onto exp - 1 lets a rounding carry bump the exponent (up to
+    // infinity) for free; in the directed modes a carry only happens when
+    // rounding away from zero, where infinity is right. without infinities
+    // the carry lands on 1.0 * 2^max, a finite value. anything else goes
+    // to normalize
+    template <RoundingMode R = RoundingMode::NearestEven>
+    static Bits roundAndPack(bool sign, int exp, Wide significand) {
+        int shift = leadingBit(significand) - M;
+        int biased = exp + shift;
+        if (__builtin_expect((shift > 0) & (biased > 0) & (biased < MAX_FIELD), 1)) {
+            return counted(static_cast<Bits>(zero(sign) + (Bits(biased - 1) << M) +
+                                             round<R>(sign, significand, shift)));
+        }
+        return normalize<R>(sign, exp, significand);
+    }
+
+    // addition
+
+    template <RoundingMode R = RoundingMode::NearestEven>
+    static Bits add(Bits a, Bits b) {
+        // fast path: both exponent fields in 1..MAX_FIELD - 1, i.e. both
+        // operands normal (the top binade of a FiniteNaN format goes the
+        // slow way). the two range checks are joined with & so this is a
+        // single branch
+        FloatCounters::Scope scope(CountedOp::Add);
+        unsigned field_a = static_cast<unsigned>(field(a));
+        unsigned field_b = static_cast<unsigned>(field(b));
+        if (__builtin_expect((field_a - 1 < NORMAL_FIELDS) & (field_b - 1 < NORMAL_FIELDS), 1)) {
+            return addFinite<R>(a, b);
+        }
+        return addSpecial<R>(a, b);
+    }
+
+    template <RoundingMode R = RoundingMode::NearestEven>
+    static Bits subtract(Bits a, Bits b) { return add<R>(a, static_cast<Bits>(b ^ SIGN_MASK)); }
+
+    // nan, infinity, zero or subnormal operands, kept out of line so the
+    // fast path stays small. flushing reads subnormals as zeros here, the
+    // fast path only sees normals
+    template <RoundingMode R>
+    __attribute__((noinline, cold))
+    static Bits addSpecial(Bits a, Bits b) {
+        FloatCounters::count(CountedEvent::Special);
+        a = daz(a);
+        b = daz(b);
+        if (isNaN(a) || isNaN(b)) return nan();
+
+        if (isInfinity(a)) {
+            if (isInfinity(b) && sign(a) != sign(b)) {
+                return nan(); // inf - inf
+            }
+            return a;
+        }
+
+        if (isInfinity(b)) return b;
+
+        if constexpr (FLUSH) {
+            // every finite operand is now normal or zero, and x + 0 is x
+            if (isZero(a)) return isZero(b) ? (sign(a) == sign(b) ? a : cancelled<R>()) : b;
+            if (isZero(b)) return a;
+        }
+
+        return addFinite<R>(a, b);
+    }
+
+    template <RoundingMode R>
+    static Bits addFinite(Bits a, Bits b) {
+        // order by magnitude, without a branch, so big sets the exponent and sign
+        Bits mag_a = a & ~SIGN_MASK;
+        Bits mag_b = b & ~SIGN_MASK;
+        Bits swap = static_cast<Bits>((Bits(0) - (mag_a < mag_b)) & (a ^ b));
+        Bits big = a ^ swap;
+        Bits small = b ^ swap;
+
+        bool result_sign = sign(big);
+        bool subtracting = sign(big ^ small);
+        int field_a = field(big);
+        int field_b = field(small);
+
+        // subnormals have no implicit bit and share the exponent of the
+        // smallest normal
+        Wide sig_a = (big & MANTISSA_MASK) | (Wide(field_a != 0) << M);
+        Wide sig_b = (small & MANTISSA_MASK) | (Wide(field_b != 0) << M);
+        int exp_a = field_a + (field_a == 0);
+        int exp_b = field_b + (field_b == 0);
+
+        // guard, round and sticky bits are enough for a correctly rounded
+        // sum. stochastic rounding needs the actual distance to the next
+        // value, so it keeps as many bits as Wide has room for. the gap
+        // saturates at the width of Wide, which already shifts everything
+        // into sticky
+        constexpr int GUARD = R == RoundingMode::Stochastic ? WIDE_BITS - M - 3 : 3;
+        sig_a <<= GUARD;
+        sig_b <<= GUARD;
+        int gap = std::min(exp_a - exp_b, WIDE_BITS - 1);
+        sig_b = static_cast<Wide>((sig_b >> gap) | ((sig_b & ((Wide(1) << gap) - 1)) != 0));
+
+        // add or subtract without a branch: negate sig_b in two's complement
+        Wide negate = Wide(0) - static_cast<Wide>(subtracting);
+        Wide result_sig = sig_a + ((sig_b ^ negate) - negate);
+
+        // exact cancellation gives +0 (-0 rounding down), and (-0) + (-0) is -0
+        if (result_sig == 0) return subtracting ? cancelled<R>() : zero(result_sign);
+
+        return roundAndPack<R>(result_sign, exp_a - GUARD, result_sig);
+    }
+
+    // multiplication
+
+    template <RoundingMode R = RoundingMode::NearestEven>
+    static Bits multiply(Bits a, Bits b) {
+        FloatCounters::Scope scope(CountedOp::Multiply);
+        a = daz(a);
+        b = daz(b);
+        bool result_sign = sign(a) != sign(b);
+
+        if (isNaN(a) || isNaN(b)) return special(nan());
+
+        if (isInfinity(a) || isInfinity(b)) {
+            if (isZero(a) || isZero(b)) {
+                return special(nan()); // 0 * inf
+            }
+            return special(infinity(result_sign));
+        }
+
+        if (isZero(a) || isZero(b)) return special(zero(result_sign));
+
+        // the exact 2M + 2 bit product, lsb at 2^(exp_a + exp_b - 2M)
+        int field_a = field(a);
+        int field_b = field(b);
+        Wide sig_a = (a & MANTISSA_MASK) | (Wide(field_a != 0) << M);
+        Wide sig_b = (b & MANTISSA_MASK) | (Wide(field_b != 0) << M);
+        int exp = (field_a + (field_a == 0)) + (field_b + (field_b == 0)) - EXPONENT_BIAS - M;
+
+        return roundAndPack<R>(result_sign, exp, sig_a * sig_b);
+    }
+
+    // division
+
+    // divisions up to M = 10 use a reciprocal table (FloatFormatReciprocals
+    // above), wider formats the hardware divide
+    static constexpr bool RECIPROCAL_DIVIDE = M <= 10;
+    static constexpr FloatFormatReciprocals<RECIPROCAL_DIVIDE ? M : 0> RECIPROCALS{};
+
+    template <RoundingMode R = RoundingMode::NearestEven>
+    static Bits divide(Bits a, Bits b) {
+        // same single-branch range test as add
+        FloatCounters::Scope scope(CountedOp::Divide);
+        unsigned field_a = static_cast<unsigned>(field(a));
+        unsigned field_b = static_cast<unsigned>(field(b));
+        if (__builtin_expect((field_a - 1 < NORMAL_FIELDS) & (field_b - 1 < NORMAL_FIELDS), 1)) {
+            Wide sig_a = (a & MANTISSA_MASK) | (Wide(1) << M);
+            Wide sig_b = (b & MANTISSA_MASK) | (Wide(1) << M);
+            return divideSignificands<R>(sign(a) != sign(b),
+                                         static_cast<int>(field_a) - static_cast<int>(field_b) + EXPONENT_BIAS,
+                                         sig_a, sig_b);
+        }
+        return divideSpecial<R>(a, b);
+    }
+
+    // nan, infinity, zero or subnormal operands
+    template <RoundingMode R>
+    __attribute__((noinline, cold))
+    static Bits divideSpecial(Bits a, Bits b) {
+        FloatCounters::count(CountedEvent::Special);
+        a = daz(a);
+        b = daz(b);
+        bool result_sign = sign(a) != sign(b);
+
+        if (isNaN(a) || isNaN(b)) return nan();
+
+        if (isInfinity(a)) {
+            if (isInfinity(b)) {
+                return nan(); // inf / inf
+            }
+            return infinity(result_sign);
+        }
+
+        if (isInfinity(b)) return zero(result_sign);
+
+        if (isZero(b)) {
+            if (isZero(a)) {
+                return nan(); // 0 / 0
+            }
+            return infinity(result_sign);
+        }
+
+        if (isZero(a)) return zero(result_sign);
+
+        // subnormals: shift the significand up to bit M and lower the
+        // exponent to match
+        int field_a = field(a);
+        int field_b = field(b);
+        Wide sig_a = (a & MANTISSA_MASK) | (Wide(field_a != 0) << M);
+        Wide sig_b = (b & MANTISSA_MASK) | (Wide(field_b != 0) << M);
+        int norm_a = M - leadingBit(sig_a);
+        int norm_b = M - leadingBit(sig_b);
+        int exp = (field_a + (field_a == 0) - norm_a) - (field_b + (field_b == 0) - norm_b) + EXPONENT_BIAS;
+
+        return divideSignificands<R>(result_sign, exp, sig_a << norm_a, sig_b << norm_b);
+    }
+
+    // sig_a / sig_b * 2^(exp - EXPONENT_BIAS), both significands normalized
+    // to [2^M, 2^(M + 1)). the quotient's leading bit lands in one of two
+    // known places, so unlike normalize() nothing here has to search for it
+    template <RoundingMode R>
+    static Bits divideSignificands(bool sign, int exp, Wide sig_a, Wide sig_b) {
+        if constexpr (R == RoundingMode::Stochastic) {
+            // guard and sticky only say which side of halfway the quotient
+            // is on, so divide with 64-bit headroom and narrow to Wide with a
+            // sticky bit, as fma does
+            uint64_t dividend = static_cast<uint64_t>(sig_a) << (62 - M);
+            uint64_t wide_sig = ((dividend / sig_b) << 1) | ((dividend % sig_b) != 0);
+            int wide_exp = exp - 63 + 2 * M;
+            int excess = leadingBit(wide_sig) - (WIDE_BITS - 2);
+            if (excess > 0) {
+                wide_sig = shiftRightSticky(wide_sig, excess);
+                wide_exp += excess;
+            }
+            return normalize<R>(sign, wide_exp, static_cast<Wide>(wide_sig));
+        }
+
+        // scale the dividend into [sig_b, 2 sig_b) * 2^(M + 1), an M + 2 bit
+        // quotient: implicit bit, M mantissa bits and the guard bit
+        bool below = sig_a < sig_b;
+        Wide dividend = below ? sig_a << (M + 2) : sig_a << (M + 1);
+        exp -= below;
+
+        Wide quotient, sticky;
+        if constexpr (RECIPROCAL_DIVIDE) {
+            quotient = static_cast<Wide>((static_cast<uint64_t>(dividend) * RECIPROCALS.r[sig_b - (Wide(1) << M)]) >>
+                                         RECIPROCALS.SHIFT);
+            sticky = dividend != quotient * sig_b;
+        } else {
+            // the hardware 64-bit divide beats a reciprocal seed plus two
+            // newton-raphson steps here. the remainder comes out of the same
+            // instruction and gives the sticky bit; recomputing it as
+            // dividend - quotient * sig_b would put a multiply after the divide
+            quotient = dividend / sig_b;
+            sticky = (dividend % sig_b) != 0;
+        }
+        Wide result_sig = (quotient << 1) | sticky;
+
+        // normal result: drop guard and sticky with a constant shift. a
+        // rounding carry lands in the exponent field, as in roundAndPack
+        if (__builtin_expect(static_cast<unsigned>(exp - 1) < NORMAL_FIELDS, 1)) {
+            return counted(static_cast<Bits>(zero(sign) + (Bits(exp - 1) << M) + round<R>(sign, result_sig, 2)));
+        }
+        return normalize<R>(sign, exp - 2, result_sig);
+    }
+
+    // square root and reciprocal square root, integers only
+    //
+    // both normalize x to a * 2^e with e even and a in [1, 4), then refine
+    // a table seed y ~ 1 / sqrt(a) in 32.31 fixed point (RSQRT_SEEDS). sqrt
+    // takes a * y to within one unit of the integer square root of the
+    // scaled significand, fixes it up exactly and rounds once with the
+    // remainder as sticky bit, so it is correctly rounded in every mode.
+    // rsqrt rounds y itself to nearest. with one step for M <= 8 and two
+    // above, y is off by less than 2^-15.4 and 2^-29.5 before that rounding:
+    // within 0.53 ulp for FP32, and for every 16-bit or smaller format the
+    // exhaustive tests find it below 0.5 ulp, i.e. correctly rounded
+
+    static constexpr FloatFormatRsqrtSeeds RSQRT_SEEDS{};
+    static constexpr int RSQRT_STEPS = M > 8 ? 2 : 1;
+
+    // y = y (3 - a y^2) / 2, A = a * 2^30 and y, y' in 32.31 fixed point
+    static uint32_t rsqrtStep(uint32_t A, uint32_t y) {
+        uint64_t y2 = (uint64_t(y) * y) >> 31;
+        uint64_t ay2 = (uint64_t(A) * y2) >> 30;
+        uint32_t t = static_cast<uint32_t>((uint64_t(3) << 30) - (ay2 >> 1));
+        return static_cast<uint32_t>((uint64_t(y) * t) >> 31);
+    }
+
+    template <int STEPS>
+    static uint32_t rsqrtFixed(uint32_t A) {
+        uint32_t y = RSQRT_SEEDS.y[(A >> 24) - FloatFormatRsqrtSeeds::FIRST];
+        for (int i = 0; i < STEPS; ++i) y = rsqrtStep(A, y);
+        return y;
+    }
+
+    // positive finite nonzero x as sig * 2^(e - M), sig in [2^M, 2^(M + 2))
+    // and e even
+    static Wide evenSignificand(Bits x, int& e) {
+        int f = field(x);
+        Wide sig = (x & MANTISSA_MASK) | (Wide(f != 0) << M);
+        int norm = M - leadingBit(sig);
+        sig <<= norm;
+        e = f + (f == 0) - norm - EXPONENT_BIAS;
+        int odd = e & 1;
+        e -= odd;
+        return sig << odd;
+    }
+
+    template <RoundingMode R = RoundingMode::NearestEven>
+    static Bits sqrt(Bits x) {
+        FloatCounters::Scope scope(CountedOp::Sqrt);
+        x = daz(x);
+        if (isNaN(x)) return special(nan());
+        if (isZero(x)) return special(x);   // sqrt(-0) is -0
+        if (sign(x)) return special(nan());
+        if (isInfinity(x)) return special(x);
+
+        int e;
+        Wide sig = evenSignificand(x, e);
+
+        // floor(sqrt(sig << S)) has M + 2 bits, the guard bit below the
+        // result lsb. stochastic rounding wants more; S keeps the root below
+        // 2^(WIDE_BITS - 2) so root and sticky fit Wide
+        constexpr int S = R == RoundingMode::Stochastic ? (WIDE_BITS == 32 ? 60 : 62) - M : M + 2;
+        constexpr int STEPS = R == RoundingMode::Stochastic ? 2 : RSQRT_STEPS;
+        uint64_t radicand = static_cast<uint64_t>(sig) << S;
+
+        // sqrt(sig * 2^S) = a * y * 2^((M + S) / 2), y from below
+        uint32_t A = static_cast<uint32_t>(sig << (30 - M));
+        uint64_t root = (uint64_t(A) * rsqrtFixed<STEPS>(A)) >> (61 - (M + S) / 2);
+        while (root * root > radicand) --root;
+        while (radicand - root * root > 2 * root) ++root;   // (root + 1)^2 <= radicand
+
+        Wide result_sig = static_cast<Wide>((root << 1) | (root * root != radicand));
+        return roundAndPack<R>(false, (e - M - S) / 2 - 1 + EXPONENT_BIAS + M, result_sig);
+    }
+
+    // 1 / sqrt(x) to within 0.53 ulp, rounded to nearest. rsqrt(+-0) is
+    // +-infinity, rsqrt(+inf) is +0
+    static Bits rsqrt(Bits x) {
+        FloatCounters::Scope scope(CountedOp::Rsqrt);
+        x = daz(x);
+        if (isNaN(x)) return special(nan());
+        if (isZero(x)) return special(infinity(sign(x)));
+        if (sign(x)) return special(nan());
+        if (isInfinity(x)) return special(zero());
+
+        int e;
+        Wide sig = evenSignificand(x, e);
+        uint32_t A = static_cast<uint32_t>(sig << (30 - M));
+
+        // 1 / sqrt(a * 2^e) = y * 2^(-31 - e / 2), always a normal number
+        return roundAndPack(false, EXPONENT_BIAS + M - 31 - e / 2,
+                            static_cast<Wide>(rsqrtFixed<RSQRT_STEPS>(A)));
+    }
+
+    // fused multiply-add: a * b + c rounded once
+
+    template <RoundingMode R = RoundingMode::NearestEven>
+    static Bits fma(Bits a, Bits b, Bits c) {
+        FloatCounters::Scope scope(CountedOp::Fma);
+        a = daz(a);
+        b = daz(b);
+        c = daz(c);
+        if (isNaN(a) || isNaN(b) || isNaN(c)) return special(nan());
+
+        bool product_sign = sign(a) != sign(b);
+
+        if (isInfinity(a) || isInfinity(b)) {
+            if (isZero(a) || isZero(b)) {
+                return special(nan()); // 0 * inf
+            }
+            if (isInfinity(c) && sign(c) != product_sign) {
+                return special(nan()); // inf - inf
+            }
+            return special(infinity(product_sign));
+        }
+
+        if (isInfinity(c)) return special(c);
+
+        if (isZero(a) || isZero(b)) {
+            // exact zero product, +0 + -0 = +0 (-0 rounding down)
+            if (isZero(c)) return special(product_sign == sign(c) ? zero(product_sign) : cancelled<R>());
+            return special(c);
+        }
+
+        if (isZero(c)) return special(multiply<R>(a, b));
+
+        // exact product as in multiply, lsb at 2^(exp_a + exp_b - 2M)
+        int field_a = field(a);
+        int field_b = field(b);
+        int field_c = field(c);
+        uint64_t sig_a = (a & MANTISSA_MASK) | (uint64_t(field_a != 0) << M);
+        uint64_t sig_b = (b & MANTISSA_MASK) | (uint64_t(field_b != 0) << M);
+        uint64_t sig_c = (c & MANTISSA_MASK) | (uint64_t(field_c != 0) << M);
+
+        uint64_t sig_p = sig_a * sig_b;
+        int lsb_p = (field_a + (field_a == 0)) + (field_b + (field_b == 0)) - 2 * EXPONENT_BIAS - 2 * M;
+        int lsb_c = (field_c + (field_c == 0)) - EXPONENT_BIAS - M;
+
+        // move both leading bits to bit 60, then align the smaller operand
+        // to the larger one, whatever falls off the bottom becomes sticky
+        int shift_p = 60 - leadingBit(sig_p);
+        int shift_c = 60 - leadingBit(sig_c);
+        sig_p <<= shift_p;
+        sig_c <<= shift_c;
+        lsb_p -= shift_p;
+        lsb_c -= shift_c;
+
+        int lsb = std::max(lsb_p, lsb_c);
+        sig_p = shiftRightSticky(sig_p, lsb - lsb_p);
+        sig_c = shiftRightSticky(sig_c, lsb - lsb_c);
+
+        uint64_t result_sig;
+        bool result_sign;
+
+        if (product_sign == sign(c)) {
+            result_sig = sig_p + sig_c;
+            result_sign = product_sign;
+        } else if (sig_p >= sig_c) {
+            result_sig = sig_p - sig_c;
+            result_sign = product_sign;
+        } else {
+            result_sig = sig_c - sig_p;
+            result_sign = sign(c);
+        }
+
+        // exact cancellation
+        if (result_sig == 0) return cancelled<R>();
+
+        // narrow to Wide, keeping a sticky bit. a no-op for 64-bit Wide
+        int excess = leadingBit(result_sig) - (WIDE_BITS - 2);
+        if (excess > 0) {
+            result_sig = shiftRightSticky(result_sig, excess);
+            lsb += excess;
+        }
+
+        return normalize<R>(result_sign, lsb + EXPONENT_BIAS + M, static_cast<Wide>(result_sig));
+    }
+
+    // comparison: -1, 0 or 1, and 2 when either side is NaN (unordered)
+
+    static int compare(Bits a, Bits b) {
+        if (isNaN(a) || isNaN(b)) return 2;
+
+        // +0 == -0
+        if (isZero(a) && isZero(b)) return 0;
+
+        bool sign_a = sign(a);
+        if (sign_a != sign(b)) return sign_a ? -1 : 1;
+
+        // same sign: larger bits are larger positive values and smaller
+        // negative ones
+        if (a == b) return 0;
+        return (a < b) != sign_a ? -1 : 1;
+    }
+
+    // total order key: an unsigned integer that sorts as IEEE 754
+    // totalOrder, -nan < -inf < ... < -0 < +0 < ... < +inf < +nan.
+    // positive patterns gain the top bit, negative ones are inverted so the
+    // larger magnitudes come first
+
+    static constexpr Bits ALL_BITS = static_cast<Bits>((SIGN_MASK << 1) - 1);
+
+    static constexpr Bits orderKey(Bits x) {
+        return static_cast<Bits>(sign(x) ? ~x & ALL_BITS : x | SIGN_MASK);
+    }
+    static constexpr Bits fromOrderKey(Bits key) {
+        return static_cast<Bits>(sign(key) ? key & ~SIGN_MASK : ~key & ALL_BITS);
+    }
+
+    // conversion to / from FP32 bit patterns. every format here is a
+    // subset of FP32, so widening is exact
+
+    static uint32_t toFP32Bits(Bits x) {
+        uint32_t sign_bit = static_cast<uint32_t>(sign(x)) << 31;
+        uint32_t mant = x & MANTISSA_MASK;
+        int f = field(x);
+
+        if constexpr (E == 8) {
+            // same exponent range, the mantissa just gains zeros
+            return sign_bit | (static_cast<uint32_t>(x & ~SIGN_MASK) << (23 - M));
+        }
+        if (f == MAX_FIELD && (HAS_INFINITY || isNaN(x))) return sign_bit | 0x7F800000u | (mant << (23 - M));
+        if (f == 0) {
+            if (mant == 0) return sign_bit;
+            // subnormal here, normal in FP32
+            int lead = leadingBit(mant);
+            uint32_t exp = static_cast<uint32_t>(1 - EXPONENT_BIAS - (M - lead) + 127);
+            return sign_bit | (exp << 23) | ((mant << (23 - lead)) & 0x007FFFFFu);
+        }
+        return sign_bit | (static_cast<uint32_t>(f - EXPONENT_BIAS + 127) << 23) | (mant << (23 - M));
+    }
+
+    template <RoundingMode R = RoundingMode::NearestEven>
+    static Bits fromFP32Bits(uint32_t f) {
+        FloatCounters::Scope scope(CountedOp::Convert);
+        // an FP32 subnormal is below every format's normal range, and with
+        // the FP32 exponent range stays subnormal
+        if (FLUSH && ((f >> 23) & 0xFF) == 0) return zero((f >> 31) != 0);
+        if constexpr (R == RoundingMode::Stochastic && E == 8 && M < 23) {
+            return fromFP32BitsStochastic(f, StochasticRng::next());
+        }
+
+        bool negative = (f >> 31) != 0;
+        uint32_t fp32_field = (f >> 23) & 0xFF;
+        uint32_t fp32_mant = f & 0x007FFFFFu;
+
+        if (fp32_field == 0xFF) return special(fp32_mant ? static_cast<Bits>(zero(negative) | QUIET_NAN)
+                                                         : infinity(negative));
+
+        if constexpr (E == 8 && M == 23) {
+            return static_cast<Bits>(f);
+        } else if constexpr (E == 8) {
+            // same exponent range: round the dropped bits to nearest even.
+            // a carry runs into the exponent, up to infinity
+            const int drop = 23 - M;
+            uint32_t magnitude = f & 0x7FFFFFFFu;
+            uint32_t halfway = 1u << (drop - 1);
+            uint32_t remainder = magnitude & ((1u << drop) - 1);
+            uint32_t rounded = magnitude >> drop;
+            if constexpr (FloatCounters::ENABLED) {
+                // the same exponent range, so tiny here is an FP32 subnormal
+                if (R == RoundingMode::NearestEven && remainder == halfway) {
+                    FloatCounters::count(CountedEvent::Tie);
+                }
+                if (fp32_field == 0 && remainder != 0) FloatCounters::count(CountedEvent::Underflow);
+            }
+            if constexpr (R == RoundingMode::NearestEven) {
+                rounded += (remainder > halfway) | ((remainder == halfway) & rounded & 1);
+            } else {
+                // a carry into the infinity pattern only happens rounding
+                // away from zero, where infinity is the right answer
+                rounded = round<R>(negative, magnitude, drop);
+            }
+            Bits result = counted(static_cast<Bits>(zero(negative) | rounded));
+            if (FloatCounters::ENABLED && isSubnormal(result)) FloatCounters::count(CountedEvent::Subnormal);
+            return result;
+        }
+
+        // smaller range: renormalize the FP32 significand into this format
+        if (fp32_field == 0 && fp32_mant == 0) return zero(negative);
+        uint32_t sig = fp32_mant | (static_cast<uint32_t>(fp32_field != 0) << 23);
+        int exp = static_cast<int>(fp32_field + (fp32_field == 0)) - 127 - 23 + EXPONENT_BIAS + M;
+        return normalize<R>(negative, exp, static_cast<Wide>(sig));
+    }
+
+    // stochastic narrowing for formats with the FP32 exponent range, with
+    // the random word supplied: rounds up when random < the dropped bits
+    // scaled to 32 bits. what fromFP32Bits<Stochastic> runs on the next word
+    // of the thread's stream, and what the bulk kernels match lane by lane
+    static Bits fromFP32BitsStochastic(uint32_t f, uint32_t random) {
+        static_assert(E == 8 && M < 23, "needs the FP32 exponent range");
+        bool negative = (f >> 31) != 0;
+        uint32_t fp32_field = (f >> 23) & 0xFF;
+        uint32_t fp32_mant = f & 0x007FFFFFu;
+        if (FLUSH && fp32_field == 0) return zero(negative);
+        if (fp32_field == 0xFF) return fp32_mant ? static_cast<Bits>(zero(negative) | QUIET_NAN)
+                                                 : infinity(negative);
+
+        const int drop = 23 - M;
+        uint32_t magnitude = f & 0x7FFFFFFFu;
+        uint32_t remainder = magnitude & ((1u << drop) - 1);
+        uint32_t rounded = (magnitude >> drop) + (random < (remainder << (32 - drop)));
+        return static_cast<Bits>(zero(negative) | rounded);
+    }
+};
+
+#endif
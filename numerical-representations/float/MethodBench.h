@@ -0,0 +1,189 @@
+#ifndef METHOD_BENCH_H
+#define METHOD_BENCH_H
+
+#include "MicroBench.h"
+#include "PerfEvents.h"
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+// whole-method benchmark harness, the C++ side of utils/timing.py
+// benchmark_methods: every method runs on a fresh setup(size) problem and
+// reports seconds per call. instead of a fixed n_runs it
+//
+//   warms up     the method runs for --warmup ms first, and a run repeats
+//                it enough times (calls) to last --sample ms, far above
+//                the clock's resolution
+//   stops        once the confidence interval of the mean run time is
+//                within --rel-ci of the mean (student t, at least
+//                --min-runs runs), giving up unconverged after --max-runs
+//                runs or --max-time seconds
+//   pins         the calling thread and the pool's workers to one cpu each,
+//                so the scheduler cannot migrate them mid-run
+//   counts       cycles, instructions, cache misses and context switches of
+//                the calling thread per call, see PerfEvents.h
+//
+// the csv has one row per (method, size). the json's "results" is
+// benchmark_methods' dict, method -> mean seconds per size, which
+// utils/plotting.py compare_methods charts as it is; "sizes" has the sizes
+// and "benchmarks" the full rows. --baseline=FILE.csv compares against an
+// earlier csv with welch's t-test: a change counts as real when it is
+// significant at --confidence and larger than --threshold, and finish()
+// returns 1 if any method got slower.
+//
+// flags: --csv=FILE  --json=FILE  --baseline=FILE  --filter=TEXT
+//        --sizes=A,B,..       replace the caller's sizes
+//        --confidence=0.95    --rel-ci=0.02      --threshold=0.03
+//        --min-runs=10        --max-runs=1000    --max-time=5 (s)
+//        --warmup=100 (ms)    --sample=2 (ms)
+//        --threads=N          pool size          --cpu=N  first cpu pinned
+//        --no-pin             --quiet            no table on stdout
+
+struct MethodResult {
+    std::string method;
+    size_t size = 0;
+    uint64_t runs = 0;
+    uint64_t calls = 0;          // calls per run
+    double mean = 0;             // seconds per call, over the runs
+    double stddev = 0;
+    double min = 0;
+    double median = 0;
+    double ci = 0;               // half width of the confidence interval
+    bool converged = false;
+    double counters[PERF_EVENTS] = {};   // per call
+    bool counted[PERF_EVENTS] = {};
+};
+
+// two-sided student t quantile: the t with P(|T| <= t) = confidence at df
+// degrees of freedom
+double studentQuantile(double confidence, double df);
+
+class MethodBench {
+public:
+    MethodBench(const std::string& suite, int argc, char** argv);
+
+    // the --sizes list if one was given, otherwise defaults
+    std::vector<size_t> sizes(const std::vector<size_t>& defaults) const;
+    bool enabled(const std::string& method) const;
+
+    // extra key / value pairs for the json "context" block
+    void setContext(const std::string& key, const std::string& value);
+
+    const std::vector<MethodResult>& results() const { return results_; }
+
+    // time method(), one call of the method per call
+    template <typename Method>
+    const MethodResult* run(const std::string& name, size_t size, Method&& method) {
+        if (!enabled(name)) return nullptr;
+
+        // warm up, growing the calls per run until a run is long enough
+        uint64_t calls = 1;
+        double warm = 0;
+        for (;;) {
+            double ns = sample(method, calls);
+            warm += ns;
+            if (ns < sample_ns_ && calls < (uint64_t(1) << 40)) {
+                uint64_t scale = ns > 0 ? static_cast<uint64_t>(sample_ns_ / ns * 1.2) + 1 : 10;
+                calls *= scale < 2 ? 2 : scale;
+            } else if (warm >= warmup_ns_) {
+                break;
+            }
+        }
+
+        std::vector<double> runs;
+        PerfReading counts;
+        for (size_t e = 0; e < PERF_EVENTS; ++e) counts.counted[e] = true;
+        double elapsed = 0;
+        bool converged = false;
+        for (;;) {
+            PerfReading before = events_.read();
+            double ns = sample(method, calls);
+            PerfReading delta = events_.read() - before;
+            for (size_t e = 0; e < PERF_EVENTS; ++e) {
+                counts.values[e] += delta.values[e];
+                counts.counted[e] = counts.counted[e] && delta.counted[e];
+            }
+            runs.push_back(ns * 1e-9 / static_cast<double>(calls));
+            elapsed += ns;
+            if (runs.size() >= min_runs_ && withinInterval(runs)) {
+                converged = true;
+                break;
+            }
+            if (runs.size() >= max_runs_ || elapsed >= max_time_ns_) break;
+        }
+        return &record(name, size, calls, runs, counts, converged);
+    }
+
+    // write the csv / json and compare with the baseline; the exit code
+    int finish();
+
+private:
+    std::string suite_;
+    std::vector<size_t> sizes_;
+    std::string filter_;
+    std::string csv_path_;
+    std::string json_path_;
+    std::string baseline_path_;
+    double confidence_;
+    double rel_ci_;
+    double threshold_;
+    size_t min_runs_;
+    size_t max_runs_;
+    double max_time_ns_;
+    double warmup_ns_;
+    double sample_ns_;
+    bool quiet_;
+    PerfEvents events_;
+    std::vector<std::pair<std::string, std::string>> context_;
+    std::vector<MethodResult> results_;
+
+    bool withinInterval(const std::vector<double>& runs) const;
+    const MethodResult& record(const std::string& name, size_t size, uint64_t calls,
+                               const std::vector<double>& runs, const PerfReading& counts, bool converged);
+    bool writeCsv() const;
+    bool writeJson() const;
+    int compareBaseline() const;
+
+    template <typename Method>
+    static double sample(Method& method, uint64_t calls) {
+        auto start = std::chrono::steady_clock::now();
+        for (uint64_t c = 0; c < calls; ++c) {
+            method();
+            clobberMemory();
+        }
+        auto stop = std::chrono::steady_clock::now();
+        return std::chrono::duration<double, std::nano>(stop - start).count();
+    }
+};
+
+// benchmark_methods: for each size, each method on its own setup(size)
+// problem. returns method -> mean seconds per size, in the order given,
+// 0 where a method was filtered out
+template <typename Problem>
+std::vector<std::pair<std::string, std::vector<double>>> benchmarkMethods(
+    MethodBench& bench,
+    const std::vector<std::pair<std::string, std::function<void(Problem&)>>>& methods,
+    const std::vector<size_t>& sizes, const std::function<Problem(size_t)>& setup) {
+    std::vector<std::pair<std::string, std::vector<double>>> means;
+    for (const auto& method : methods) means.emplace_back(method.first, std::vector<double>());
+
+    for (size_t size : sizes) {
+        for (size_t m = 0; m < methods.size(); ++m) {
+            if (!bench.enabled(methods[m].first)) {
+                means[m].second.push_back(0);
+                continue;
+            }
+            Problem problem = setup(size);
+            const std::function<void(Problem&)>& fn = methods[m].second;
+            const MethodResult* r = bench.run(methods[m].first, size, [&] { fn(problem); });
+            means[m].second.push_back(r->mean);
+        }
+    }
+    return means;
+}
+
+#endif
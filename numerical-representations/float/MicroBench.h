@@ -0,0 +1,116 @@
+#ifndef MICRO_BENCH_H
+#define MICRO_BENCH_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+// small google-benchmark-style harness behind the `make bench` targets
+//
+// a case is a kernel that processes one batch of `batch` elements. the
+// kernel is repeated until a sample lasts at least --min-time, the best of
+// several samples is kept, and every case is timed next to a native float
+// kernel doing the same work so the report can give the slowdown.
+//
+// flags: --json=FILE       also write the results as json
+//        --filter=TEXT     only run cases whose name contains TEXT
+//        --min-time=MS     minimum sample length (default 20 ms)
+//        --batches=A,B,..  batch sizes (default 16,1024,65536,1048576)
+
+// keep the compiler from discarding a result or hoisting it out of the loop
+template <typename T>
+inline void doNotOptimize(const T& value) {
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+inline void clobberMemory() {
+    asm volatile("" : : : "memory");
+}
+
+struct BenchResult {
+    std::string name;
+    size_t batch;
+    double ns_per_op;
+    double native_ns_per_op;
+    uint64_t iterations;    // batches run in the best sample
+};
+
+class MicroBench {
+public:
+    MicroBench(const std::string& suite, int argc, char** argv);
+
+    const std::vector<size_t>& batches() const { return batches_; }
+    bool enabled(const std::string& name) const;
+
+    // extra key / value pairs for the json "context" block
+    void setContext(const std::string& key, const std::string& value);
+
+    // time `emulated` and `native`, both of which process one batch per call
+    template <typename Emulated, typename Native>
+    void run(const std::string& name, size_t batch, Emulated&& emulated, Native&& native) {
+        if (!enabled(name)) return;
+
+        BenchResult result;
+        result.name = name;
+        result.batch = batch;
+        result.ns_per_op = measure(batch, emulated, result.iterations);
+        uint64_t native_iterations;
+        result.native_ns_per_op = measure(batch, native, native_iterations);
+        record(result);
+    }
+
+    // write the json file if one was asked for; returns the exit code
+    int finish();
+
+private:
+    std::string suite_;
+    std::vector<size_t> batches_;
+    std::string filter_;
+    std::string json_path_;
+    double min_time_ns_;
+    std::vector<std::pair<std::string, std::string>> context_;
+    std::vector<BenchResult> results_;
+
+    void record(const BenchResult& result);
+
+    // best-of-samples ns per element
+    template <typename Kernel>
+    double measure(size_t batch, Kernel& kernel, uint64_t& iterations) {
+        const int samples = 5;
+        kernel();   // warm caches and lazily built state
+
+        // grow the repeat count until one sample is long enough
+        uint64_t reps = 1;
+        for (;;) {
+            double ns = sample(kernel, reps);
+            if (ns >= min_time_ns_ || reps >= (uint64_t(1) << 40)) break;
+            uint64_t scale = ns > 0 ? static_cast<uint64_t>(min_time_ns_ / ns * 1.2) + 1 : 10;
+            reps *= scale < 2 ? 2 : scale;
+        }
+
+        double best = 1e300;
+        for (int s = 0; s < samples; ++s) {
+            double ns = sample(kernel, reps);
+            if (ns < best) best = ns;
+        }
+
+        iterations = reps;
+        return best / static_cast<double>(reps) / static_cast<double>(batch ? batch : 1);
+    }
+
+    template <typename Kernel>
+    static double sample(Kernel& kernel, uint64_t reps) {
+        auto start = std::chrono::steady_clock::now();
+        for (uint64_t r = 0; r < reps; ++r) {
+            kernel();
+            clobberMemory();
+        }
+        auto stop = std::chrono::steady_clock::now();
+        return std::chrono::duration<double, std::nano>(stop - start).count();
+    }
+};
+
+#endif
@@ -0,0 +1,27 @@
+#ifndef ORDERING_H
+#define ORDERING_H
+
+// nan handling for the bulk order ops in FP32Order.h and
+// ../bfloat16/BF16Order.h: argmin / argmax, minmax, clamp and sort
+//
+// they compare total order keys (FloatFormat::orderKey), plain unsigned
+// integers, so there is no branch on nan, zero or sign per element.
+// under every policy -0 is below +0, as in IEEE 754 minimum / maximum
+//
+// Propagate - a nan anywhere is the answer: argmin / argmax give the first
+//             nan, minmax gives the default nan twice, clamp passes nans
+//             through. sort moves the nans to the end, in input order
+// Ignore    - argmin / argmax / minmax skip the nans (n and nan when every
+//             element is one). clamp and sort treat them as Propagate
+//             does, there is nothing to skip
+// Total     - IEEE 754 totalOrder on the bits: negative nans below -inf,
+//             positive ones above +inf, ordered by payload. clamp moves a
+//             nan to lo or hi by its sign
+
+enum class NaNPolicy {
+    Propagate,
+    Ignore,
+    Total
+};
+
+#endif
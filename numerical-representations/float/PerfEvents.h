@@ -0,0 +1,56 @@
+#ifndef PERF_EVENTS_H
+#define PERF_EVENTS_H
+
+#include <cstddef>
+#include <cstdint>
+
+// hardware counters for the benchmark harnesses, through linux
+// perf_event_open. each event is opened on its own, for the calling thread
+// and user space only (what perf_event_paranoid <= 2 allows), so a missing
+// one (no pmu in a vm, a locked-down kernel, another os) just reads as not
+// counted. counts are scaled up when the kernel multiplexed the counter
+//
+// counts follow the thread that opened them; pool workers are not counted
+
+enum class PerfEvent {
+    Cycles,
+    Instructions,
+    CacheMisses,        // last-level cache misses
+    ContextSwitches     // software, counted even without a pmu
+};
+
+constexpr size_t PERF_EVENTS = 4;
+
+// csv / json column names: cycles, instructions, cache_misses, context_switches
+const char* perfEventName(PerfEvent event);
+
+struct PerfReading {
+    uint64_t values[PERF_EVENTS] = {};
+    bool counted[PERF_EVENTS] = {};
+
+    uint64_t operator()(PerfEvent event) const { return values[static_cast<size_t>(event)]; }
+    bool has(PerfEvent event) const { return counted[static_cast<size_t>(event)]; }
+
+    // the counts since an earlier reading
+    PerfReading operator-(const PerfReading& earlier) const;
+};
+
+class PerfEvents {
+public:
+    // opens whatever the kernel allows and starts counting, never throws
+    PerfEvents();
+    ~PerfEvents();
+
+    PerfEvents(const PerfEvents&) = delete;
+    PerfEvents& operator=(const PerfEvents&) = delete;
+
+    bool available(PerfEvent event) const { return fds_[static_cast<size_t>(event)] >= 0; }
+
+    // totals since construction
+    PerfReading read() const;
+
+private:
+    int fds_[PERF_EVENTS];
+};
+
+#endif
@@ -0,0 +1,160 @@
+#ifndef ROUNDING_H
+#define ROUNDING_H
+
+#include <atomic>
+#include <cstdint>
+#include <type_traits>
+
+// rounding modes for the FloatFormat kernels. NearestEven is the IEEE
+// default and what every operator uses; the others are opt in, through the
+// template parameter on the kernels or the RoundingMode overloads on the
+// value types
+
+enum class RoundingMode {
+    NearestEven,
+    TowardZero,
+    Upward,      // toward +inf
+    Downward,    // toward -inf
+    Stochastic   // up with probability equal to the fraction dropped
+};
+
+// calls f with std::integral_constant<RoundingMode, mode>, turning a
+// runtime mode into the template argument of the kernels
+template <typename F>
+auto withRoundingMode(RoundingMode mode, F&& f) {
+    using RM = RoundingMode;
+    switch (mode) {
+    case RM::TowardZero: return f(std::integral_constant<RM, RM::TowardZero>());
+    case RM::Upward:     return f(std::integral_constant<RM, RM::Upward>());
+    case RM::Downward:   return f(std::integral_constant<RM, RM::Downward>());
+    case RM::Stochastic: return f(std::integral_constant<RM, RM::Stochastic>());
+    default:             return f(std::integral_constant<RM, RM::NearestEven>());
+    }
+}
+
+// subnormal handling. Flush is the flush-to-zero / denormals-are-zero mode
+// of most accelerators: a subnormal operand reads as a zero of its sign,
+// and a result that rounds to a subnormal becomes a zero of its sign. a
+// result that rounds up to the smallest normal stays (tininess after
+// rounding, as x86 detects it). only the arithmetic kernels flush,
+// widening and comparison see the stored bits
+
+enum class SubnormalMode {
+    Preserve,   // IEEE gradual underflow
+    Flush
+};
+
+// the calling thread's mode, read by the FP32 / BFloat16 arithmetic. a
+// batched call reads it once on the calling thread and hands it to the
+// pool, like MXCSR would be for hardware float. initial-exec keeps the
+// read a single %fs load in the -fPIC libraries too, where the default
+// model calls __tls_get_addr on every scalar operator
+inline SubnormalMode& subnormalModeSlot() {
+    static thread_local SubnormalMode mode __attribute__((tls_model("initial-exec"))) = SubnormalMode::Preserve;
+    return mode;
+}
+
+inline SubnormalMode subnormalMode() { return subnormalModeSlot(); }
+inline void setSubnormalMode(SubnormalMode mode) { subnormalModeSlot() = mode; }
+
+// sets the calling thread's mode for a scope, the previous one comes back
+class SubnormalScope {
+public:
+    explicit SubnormalScope(SubnormalMode mode) : previous_(subnormalMode()) { setSubnormalMode(mode); }
+    ~SubnormalScope() { setSubnormalMode(previous_); }
+    SubnormalScope(const SubnormalScope&) = delete;
+    SubnormalScope& operator=(const SubnormalScope&) = delete;
+
+private:
+    SubnormalMode previous_;
+};
+
+// calls f with std::integral_constant<SubnormalMode, mode>, as
+// withRoundingMode does
+template <typename F>
+auto withSubnormalMode(SubnormalMode mode, F&& f) {
+    using SM = SubnormalMode;
+    if (__builtin_expect(mode == SM::Flush, 0)) return f(std::integral_constant<SM, SM::Flush>());
+    return f(std::integral_constant<SM, SM::Preserve>());
+}
+
+// counter-based random bits for stochastic rounding
+//
+// word n of stream k is a pure function of (k, n): two rounds of the
+// lowbias32 integer hash over the low 32 bits of n, keyed by a hash of k and
+// the high bits. nothing carries from one word to the next, so a bulk
+// conversion can reserve n counters, generate them in simd lanes or on
+// several threads, and still match n scalar draws in a row.
+//
+// every thread draws from its own stream. a thread that never calls seed()
+// gets the next unused key (0, 1, 2, ...) on its first draw, so a single
+// threaded program is reproducible without seeding
+
+class StochasticRng {
+public:
+    // lowbias32, a bijective 32-bit integer hash
+    static constexpr uint32_t mix(uint32_t x) {
+        x ^= x >> 16;
+        x *= 0x7FEB352Du;
+        x ^= x >> 15;
+        x *= 0x846CA68Bu;
+        x ^= x >> 16;
+        return x;
+    }
+
+    // shared by the 2^32 counters with the same high word
+    static constexpr uint32_t blockKey(uint64_t key, uint64_t counter) {
+        return mix(static_cast<uint32_t>(key) ^
+                   mix(static_cast<uint32_t>(key >> 32) + static_cast<uint32_t>(counter >> 32) * 0x9E3779B9u));
+    }
+
+    static constexpr uint32_t word(uint32_t block_key, uint32_t low) {
+        return mix(mix(low ^ block_key) + block_key);
+    }
+
+    static constexpr uint32_t bits(uint64_t key, uint64_t counter) {
+        return word(blockKey(key, counter), static_cast<uint32_t>(counter));
+    }
+
+    // next word of the calling thread's stream
+    static uint32_t next() {
+        Stream& s = stream();
+        return bits(s.key, s.counter++);
+    }
+
+    // restart the calling thread's stream at counter 0 of the given key
+    static void seed(uint64_t key) {
+        Stream& s = stream();
+        s.key = key;
+        s.counter = 0;
+    }
+
+    // take n consecutive counters from the calling thread's stream for bulk
+    // work: returns the key, first receives the first counter
+    static uint64_t reserve(uint64_t n, uint64_t& first) {
+        Stream& s = stream();
+        first = s.counter;
+        s.counter += n;
+        return s.key;
+    }
+
+private:
+    struct Stream {
+        uint64_t key;
+        uint64_t counter;
+        bool assigned;
+    };
+
+    static Stream& stream() {
+        // constant initialized, so no guard on the thread_local itself
+        static thread_local Stream s{0, 0, false};
+        if (__builtin_expect(!s.assigned, 0)) {
+            static std::atomic<uint64_t> next_key{0};
+            s.key = next_key.fetch_add(1, std::memory_order_relaxed);
+            s.assigned = true;
+        }
+        return s;
+    }
+};
+
+#endif
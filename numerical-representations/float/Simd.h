@@ -0,0 +1,22 @@
+#ifndef SIMD_H
+#define SIMD_H
+
+// instruction sets the bulk kernels can be dispatched to, shared by the
+// FP32 and BFloat16 modules
+
+enum class SimdLevel {
+    Scalar,
+    AVX2,        // avx2 + fma
+    AVX512,      // avx512f + avx512bw + avx512vl
+    AVX512BF16,  // avx512 + vcvtneps2bf16
+    NEON
+};
+
+// best level supported by the running cpu (detected once)
+SimdLevel detectSimdLevel();
+const char* simdLevelName(SimdLevel level);
+
+// true if the kernels for this level can run on this cpu
+bool simdLevelSupported(SimdLevel level);
+
+#endif
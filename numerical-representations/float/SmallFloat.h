@@ -0,0 +1,129 @@
+#ifndef SMALL_FLOAT_H
+#define SMALL_FLOAT_H
+
+#include "FloatFormat.h"
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <ostream>
+
+// value type over FloatFormat<E, M>, with the same interface as FP32 and
+// BFloat16: raw-bits and float constructors, classification, the four
+// operators with correct rounding, fma and comparisons. the aliases at the
+// bottom are the formats used for quantization experiments; the 8-bit ones
+// are table-backed and live next to BFloat16 (../bfloat16/FP8.h)
+
+template <int E, int M>
+class SmallFloat {
+public:
+    using Format = FloatFormat<E, M>;
+    using Bits = typename Format::Bits;
+
+    // constructors
+
+    constexpr SmallFloat() : bits_(0) {}
+    constexpr explicit SmallFloat(Bits bits) : bits_(bits) {}
+    SmallFloat(float value) : bits_(Format::fromFP32Bits(floatBits(value))) {}
+    SmallFloat(double value) : SmallFloat(static_cast<float>(value)) {}
+    SmallFloat(int value) : SmallFloat(static_cast<float>(value)) {}
+
+    // named constructors
+
+    static constexpr SmallFloat fromBits(Bits bits) { return SmallFloat(bits); }
+    static constexpr SmallFloat zero(bool negative = false) { return SmallFloat(Format::zero(negative)); }
+    static constexpr SmallFloat infinity(bool negative = false) { return SmallFloat(Format::infinity(negative)); }
+    static constexpr SmallFloat nan() { return SmallFloat(Format::nan()); }
+    static constexpr SmallFloat epsilon() { return SmallFloat(Format::epsilon()); }
+    static constexpr SmallFloat max() { return SmallFloat(Format::maxFinite()); }
+    static constexpr SmallFloat minNormal() { return SmallFloat(Format::minNormal()); }
+    static constexpr SmallFloat minSubnormal() { return SmallFloat(Format::minSubnormal()); }
+
+    // accessors
+
+    constexpr Bits bits() const { return bits_; }
+    constexpr bool sign() const { return Format::sign(bits_); }
+    constexpr int exponent() const { return Format::field(bits_); }
+    constexpr Bits mantissa() const { return static_cast<Bits>(bits_ & Format::MANTISSA_MASK); }
+    constexpr int unbiasedExponent() const {
+        // subnormal numbers and zero share the minimum exponent
+        return exponent() == 0 ? 1 - Format::EXPONENT_BIAS : exponent() - Format::EXPONENT_BIAS;
+    }
+
+    // classification
+
+    constexpr bool isZero() const { return Format::isZero(bits_); }
+    constexpr bool isInfinity() const { return Format::isInfinity(bits_); }
+    constexpr bool isNaN() const { return Format::isNaN(bits_); }
+    constexpr bool isNormal() const { return Format::isNormal(bits_); }
+    constexpr bool isSubnormal() const { return Format::isSubnormal(bits_); }
+    constexpr bool isFinite() const { return Format::isFinite(bits_); }
+    constexpr bool isNegative() const { return sign(); }
+
+    // conversion, widening to float is exact
+
+    uint32_t toFP32Bits() const { return Format::toFP32Bits(bits_); }
+    static SmallFloat fromFP32Bits(uint32_t fp32_bits) { return SmallFloat(Format::fromFP32Bits(fp32_bits)); }
+    float toFloat() const {
+        uint32_t fp32_bits = toFP32Bits();
+        float result;
+        std::memcpy(&result, &fp32_bits, sizeof(float));
+        return result;
+    }
+    double toDouble() const { return static_cast<double>(toFloat()); }
+
+    // arithmetic, each result rounded once to nearest even
+
+    SmallFloat operator+(const SmallFloat& other) const { return SmallFloat(Format::add(bits_, other.bits_)); }
+    SmallFloat operator-(const SmallFloat& other) const { return SmallFloat(Format::subtract(bits_, other.bits_)); }
+    SmallFloat operator*(const SmallFloat& other) const { return SmallFloat(Format::multiply(bits_, other.bits_)); }
+    SmallFloat operator/(const SmallFloat& other) const { return SmallFloat(Format::divide(bits_, other.bits_)); }
+    SmallFloat operator-() const { return SmallFloat(static_cast<Bits>(bits_ ^ Format::SIGN_MASK)); }
+
+    SmallFloat& operator+=(const SmallFloat& other) { return *this = *this + other; }
+    SmallFloat& operator-=(const SmallFloat& other) { return *this = *this - other; }
+    SmallFloat& operator*=(const SmallFloat& other) { return *this = *this * other; }
+    SmallFloat& operator/=(const SmallFloat& other) { return *this = *this / other; }
+
+    static SmallFloat fma(const SmallFloat& a, const SmallFloat& b, const SmallFloat& c) {
+        return SmallFloat(Format::fma(a.bits_, b.bits_, c.bits_));
+    }
+
+    // comparison, NaN is unordered and +0 == -0
+
+    bool operator==(const SmallFloat& other) const { return Format::compare(bits_, other.bits_) == 0; }
+    bool operator!=(const SmallFloat& other) const { return !(*this == other); }
+    bool operator<(const SmallFloat& other) const { return Format::compare(bits_, other.bits_) == -1; }
+    bool operator>(const SmallFloat& other) const { return Format::compare(bits_, other.bits_) == 1; }
+    bool operator<=(const SmallFloat& other) const {
+        int cmp = Format::compare(bits_, other.bits_);
+        return cmp == -1 || cmp == 0;
+    }
+    bool operator>=(const SmallFloat& other) const {
+        int cmp = Format::compare(bits_, other.bits_);
+        return cmp == 1 || cmp == 0;
+    }
+
+    // mathematical functions
+
+    SmallFloat abs() const { return SmallFloat(static_cast<Bits>(bits_ & ~Format::SIGN_MASK)); }
+    SmallFloat sqrt() const { return fromBits(Format::sqrt(bits_)); }     // correctly rounded
+    SmallFloat rsqrt() const { return fromBits(Format::rsqrt(bits_)); }   // below 0.5 ulp
+
+    friend std::ostream& operator<<(std::ostream& os, const SmallFloat& value) {
+        return os << value.toFloat();
+    }
+
+private:
+    Bits bits_;
+
+    static uint32_t floatBits(float value) {
+        uint32_t bits;
+        std::memcpy(&bits, &value, sizeof(float));
+        return bits;
+    }
+};
+
+using FP16 = SmallFloat<5, 10>;      // IEEE binary16
+using TF32 = SmallFloat<8, 10>;      // FP32 range, FP16 precision, stored in 32 bits
+
+#endif
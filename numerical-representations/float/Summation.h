@@ -0,0 +1,43 @@
+#ifndef SUMMATION_H
+#define SUMMATION_H
+
+#include <cstddef>
+
+// summation strategies for the sum / mean / norm2 / dot reductions in
+// FP32Reduce.h and ../bfloat16/BF16Reduce.h, cheapest first
+//
+// Naive    - one accumulator in input order, rounding every add like the
+//            operators. error grows as n u (u = half an ulp of the type)
+// Pairwise - blocks of SUMMATION_BLOCK terms summed in SUMMATION_LANES
+//            lanes, lanes and blocks combined as binary trees.
+//            error ~(16 + log2 n) u
+// Kahan    - each lane carries a compensation term for the low bits its
+//            last add dropped. error ~2u + n u^2 per lane
+// Neumaier - Kahan that also keeps the low bits of the running sum when a
+//            term is larger than it (Kahan gives 0 for 1 + big + 1 - big)
+// Widened  - accumulate in the next wider type (float for BFloat16, double
+//            for FP32) and round once at the end
+//
+// every strategy except Naive reduces fixed-size chunks, element i of a
+// chunk going to lane i % SUMMATION_LANES, and adds the chunk results in
+// the wider type in index order (see parallelReduce). the result does not
+// depend on the thread count or on the simd kernel that ran.
+//
+// the strategies that round like the operators run in the calling thread's
+// subnormalMode() (Rounding.h), on every pool thread of the reduction.
+// Widened sums the stored values whatever the mode. both modules run the
+// strategies on hardware float simd lanes, which round like the operators;
+// FP32 does so under Preserve only and keeps the operators for Flush.
+
+enum class Summation {
+    Naive,
+    Pairwise,
+    Kahan,
+    Neumaier,
+    Widened
+};
+
+constexpr size_t SUMMATION_LANES = 16;
+constexpr size_t SUMMATION_BLOCK = 16 * SUMMATION_LANES;
+
+#endif
@@ -0,0 +1,167 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// small work-stealing pool behind the bulk FP32 / BFloat16 entry points
+//
+// parallelFor splits [0, n) into chunks of `grain` elements. every thread
+// (the caller included) starts on its own contiguous run of chunks and
+// takes them from the front; once it runs dry it steals the back half of
+// another thread's run. one job runs at a time, and a parallelFor issued
+// from inside a chunk body runs serially on that thread.
+
+class ThreadPool {
+public:
+    using RangeFn = std::function<void(size_t begin, size_t end)>;
+
+    // threads == 0 picks std::thread::hardware_concurrency()
+    explicit ThreadPool(size_t threads = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // process-wide pool used by the library
+    static ThreadPool& instance();
+
+    // total threads including the caller, always >= 1
+    size_t threads() const { return workers_.size() + 1; }
+    void resize(size_t threads);
+
+    // pins the calling thread to cpus[0] and worker i to cpus[i % size],
+    // for benchmarks. linux only, false where the affinity cannot be set.
+    // lasts until the next resize
+    bool pin(const std::vector<int>& cpus);
+
+    // blocks until every chunk has run, rethrows the first exception a
+    // chunk threw
+    void parallelFor(size_t n, size_t grain, const RangeFn& body);
+
+private:
+    // remaining chunk indices [begin, end) owned by one thread
+    struct Run {
+        std::mutex lock;
+        size_t begin = 0;
+        size_t end = 0;
+    };
+
+    std::vector<std::thread> workers_;
+    std::unique_ptr<Run[]> runs_;
+
+    std::mutex submit_;                 // one job at a time
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::condition_variable done_;
+    bool stop_;
+    uint64_t generation_;
+    size_t busy_;                       // workers still inside the job
+
+    const RangeFn* body_;
+    size_t n_;
+    size_t grain_;
+    std::atomic<size_t> remaining_;     // chunks not yet finished
+    std::exception_ptr error_;
+
+    void start(size_t threads);
+    void stop();
+    void workerLoop(size_t self, uint64_t seen);
+    void drain(size_t self);
+    bool takeChunk(size_t self, size_t& chunk);
+    void runChunk(size_t chunk);
+};
+
+// library-wide settings
+
+// thread count of ThreadPool::instance()
+void setThreadCount(size_t threads);
+size_t threadCount();
+
+// bulk calls below this many elements stay on the calling thread
+// (default 65536), so small arrays never pay for a wake-up
+void setParallelThreshold(size_t elements);
+size_t parallelThreshold();
+
+// Deterministic - reductions always sum fixed-size chunks and combine the
+//                 partials in index order, serial or not, so the result does
+//                 not depend on the thread count or the schedule
+// Relaxed       - small inputs are one serial pass and parallel partials are
+//                 folded in as chunks finish; faster, but the rounding can
+//                 change from run to run
+enum class ReductionMode {
+    Deterministic,
+    Relaxed
+};
+
+void setReductionMode(ReductionMode mode);
+ReductionMode reductionMode();
+
+// chunk length that keeps a chunk's working set around 64 KiB, so a
+// chunk's operands stay in L2 while it runs
+constexpr size_t chunkElements(size_t bytes_per_element) {
+    size_t elements = (64 * 1024) / (bytes_per_element ? bytes_per_element : 1);
+    return elements < 64 ? 64 : elements & ~size_t(63);
+}
+
+// run body(begin, end) over [0, n), in parallel once n reaches the threshold
+template <typename Body>
+void parallelChunks(size_t n, size_t grain, Body&& body) {
+    ThreadPool& pool = ThreadPool::instance();
+    if (n < parallelThreshold() || pool.threads() == 1 || n <= grain) {
+        body(size_t(0), n);
+        return;
+    }
+    pool.parallelFor(n, grain, body);
+}
+
+// sum partial(begin, end) over [0, n) according to reductionMode()
+template <typename T, typename Partial, typename Combine>
+T parallelReduce(size_t n, size_t grain, T init, Partial&& partial, Combine&& combine) {
+    if (n == 0) return init;
+
+    if (reductionMode() == ReductionMode::Relaxed) {
+        if (n < parallelThreshold() || ThreadPool::instance().threads() == 1) {
+            return combine(init, partial(size_t(0), n));
+        }
+        std::mutex lock;
+        T result = init;
+        ThreadPool::instance().parallelFor(n, grain, [&](size_t begin, size_t end) {
+            T value = partial(begin, end);
+            std::lock_guard<std::mutex> guard(lock);
+            result = combine(result, value);
+        });
+        return result;
+    }
+
+    size_t chunks = (n + grain - 1) / grain;
+    std::vector<T> partials(chunks);
+    auto run = [&](size_t first, size_t last) {
+        for (size_t c = first; c < last; ++c) {
+            size_t begin = c * grain;
+            size_t end = begin + grain < n ? begin + grain : n;
+            partials[c] = partial(begin, end);
+        }
+    };
+    if (n < parallelThreshold() || ThreadPool::instance().threads() == 1) {
+        run(0, chunks);
+    } else {
+        ThreadPool::instance().parallelFor(chunks, 1, run);
+    }
+
+    T result = init;
+    for (const T& value : partials) {
+        result = combine(result, value);
+    }
+    return result;
+}
+
+#endif
@@ -0,0 +1,25 @@
+#include "AlignedVector.h"
+
+// arena, the vectors themselves are instantiated per element type in
+// fp32_vector.cpp and ../bfloat16/bf16_vector.cpp
+
+VectorArena::VectorArena(size_t capacity_bytes)
+    : buffer_(nullptr), capacity_(alignUp(capacity_bytes)), used_(0) {
+    if (capacity_ > 0) {
+        buffer_ = static_cast<unsigned char*>(std::aligned_alloc(ALIGNMENT, capacity_));
+        if (!buffer_) throw std::bad_alloc();
+    }
+}
+
+VectorArena::~VectorArena() {
+    std::free(buffer_);
+}
+
+void* VectorArena::allocate(size_t bytes) {
+    bytes = alignUp(bytes);
+    if (bytes > capacity_ - used_) return nullptr;
+
+    void* p = buffer_ + used_;
+    used_ += bytes;
+    return p;
+}
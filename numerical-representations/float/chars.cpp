@@ -0,0 +1,104 @@
+#include "Chars.h"
+#include <istream>
+#include <system_error>
+
+static const char HEX_DIGITS[] = "0123456789ABCDEF";
+
+static std::to_chars_result tooLarge(char* last) {
+    return {last, std::errc::value_too_large};
+}
+
+std::to_chars_result bitsToChars(char* first, char* last, uint32_t bits,
+                                 int exponent_bits, int mantissa_bits, CharsFormat format) {
+    int width = 1 + exponent_bits + mantissa_bits;
+
+    if (format == CharsFormat::Hex) {
+        int digits = (width + 3) / 4;
+        if (last - first < 2 + digits) return tooLarge(last);
+        *first++ = '0';
+        *first++ = 'x';
+        for (int i = digits - 1; i >= 0; --i) {
+            *first++ = HEX_DIGITS[(bits >> (4 * i)) & 0xF];
+        }
+        return {first, std::errc()};
+    }
+
+    // S EEEEEEEE MMMMMMM
+    if (last - first < width + 2) return tooLarge(last);
+    for (int i = width - 1; i >= 0; --i) {
+        *first++ = static_cast<char>('0' + ((bits >> i) & 1));
+        if (i == width - 1 || i == mantissa_bits) *first++ = ' ';
+    }
+    return {first, std::errc()};
+}
+
+static int hexValue(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+std::from_chars_result bitsFromChars(const char* first, const char* last, uint32_t& bits,
+                                     int exponent_bits, int mantissa_bits, CharsFormat format) {
+    int width = 1 + exponent_bits + mantissa_bits;
+    const char* p = first;
+    uint32_t value = 0;
+
+    if (format == CharsFormat::Hex) {
+        if (last - p > 2 && p[0] == '0' && (p[1] == 'x' || p[1] == 'X') && hexValue(p[2]) >= 0) p += 2;
+        int digits = 0;
+        for (; p != last && hexValue(*p) >= 0; ++p, ++digits) {
+            value = (value << 4) | static_cast<uint32_t>(hexValue(*p));
+        }
+        if (digits == 0) return {first, std::errc::invalid_argument};
+        if (digits > 8 || (width < 32 && (value >> width) != 0)) return {p, std::errc::result_out_of_range};
+        bits = value;
+        return {p, std::errc()};
+    }
+
+    for (int i = width - 1; i >= 0; --i) {
+        if (p == last || (*p != '0' && *p != '1')) return {first, std::errc::invalid_argument};
+        value = (value << 1) | static_cast<uint32_t>(*p++ - '0');
+        bool separator = i == width - 1 || i == mantissa_bits;
+        if (separator && p != last && *p == ' ') ++p;
+    }
+    bits = value;
+    return {p, std::errc()};
+}
+
+// characters std::from_chars may consume for a float, including inf, nan
+// and nan(payload)
+static bool numberChar(int c) {
+    return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+           c == '.' || c == '-' || c == '+' || c == '(' || c == ')' || c == '_';
+}
+
+size_t readNumberToken(std::istream& is, char* buffer, size_t capacity) {
+    std::istream::sentry sentry(is);
+    if (!sentry) return 0;
+
+    typedef std::istream::traits_type Traits;
+    std::streambuf* buf = is.rdbuf();
+    size_t length = 0;
+    bool overflow = false;
+    int c = buf->sgetc();
+    if (c == '+') c = buf->snextc();
+    while (!Traits::eq_int_type(c, Traits::eof()) && numberChar(c)) {
+        if (length == capacity) {
+            overflow = true;
+        } else {
+            buffer[length++] = static_cast<char>(c);
+        }
+        c = buf->snextc();
+    }
+
+    std::ios_base::iostate state = std::ios_base::goodbit;
+    if (Traits::eq_int_type(c, Traits::eof())) state |= std::ios_base::eofbit;
+    if (length == 0 || overflow) {
+        state |= std::ios_base::failbit;
+        length = 0;
+    }
+    is.setstate(state);
+    return length;
+}
@@ -0,0 +1,109 @@
+#include "Counters.h"
+#include <algorithm>
+#include <iomanip>
+#include <mutex>
+#include <ostream>
+#include <vector>
+
+static const char* const OP_NAMES[COUNTED_OPS] = {"add", "multiply", "divide", "sqrt", "rsqrt", "fma", "convert"};
+static const char* const EVENT_NAMES[COUNTED_EVENTS] = {"calls", "special", "subnormal", "tie", "overflow",
+                                                        "underflow"};
+
+const char* countedOpName(CountedOp op) { return OP_NAMES[static_cast<size_t>(op)]; }
+const char* countedEventName(CountedEvent event) { return EVENT_NAMES[static_cast<size_t>(event)]; }
+
+CounterSnapshot CounterSnapshot::operator-(const CounterSnapshot& earlier) const {
+    CounterSnapshot d;
+    for (size_t op = 0; op < COUNTED_OPS; ++op) {
+        for (size_t e = 0; e < COUNTED_EVENTS; ++e) d.counts[op][e] = counts[op][e] - earlier.counts[op][e];
+    }
+    return d;
+}
+
+std::ostream& operator<<(std::ostream& os, const CounterSnapshot& snapshot) {
+    std::ios::fmtflags flags = os.flags();
+    os << std::left << std::setw(10) << "op" << std::right;
+    for (const char* name : EVENT_NAMES) os << std::setw(12) << name;
+    os << '\n';
+    for (size_t op = 0; op < COUNTED_OPS; ++op) {
+        if (snapshot.counts[op][0] == 0) continue;
+        os << std::left << std::setw(10) << OP_NAMES[op] << std::right;
+        for (size_t e = 0; e < COUNTED_EVENTS; ++e) os << std::setw(12) << snapshot.counts[op][e];
+        os << '\n';
+    }
+    os.flags(flags);
+    return os;
+}
+
+// every live thread's block, and the totals of the threads that exited.
+// never destroyed: pool workers can exit during static destruction
+struct CounterRegistry {
+    std::mutex mutex;
+    std::vector<FloatCounters::Block*> live;
+    CounterSnapshot retired;
+
+    static CounterRegistry& instance() {
+        static CounterRegistry* registry = new CounterRegistry;
+        return *registry;
+    }
+
+    static void add(CounterSnapshot& total, const FloatCounters::Block& block) {
+        for (size_t op = 0; op < COUNTED_OPS; ++op) {
+            for (size_t e = 0; e < COUNTED_EVENTS; ++e) {
+                total.counts[op][e] += block.counts[op][e].load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    static void clear(FloatCounters::Block& block) {
+        for (auto& row : block.counts) {
+            for (auto& c : row) c.store(0, std::memory_order_relaxed);
+        }
+    }
+
+    // owns a thread's block, folds it into retired when the thread exits
+    struct Holder {
+        FloatCounters::Block block;
+
+        Holder() {
+            CounterRegistry& r = instance();
+            std::lock_guard<std::mutex> lock(r.mutex);
+            r.live.push_back(&block);
+        }
+
+        ~Holder() {
+            CounterRegistry& r = instance();
+            std::lock_guard<std::mutex> lock(r.mutex);
+            add(r.retired, block);
+            r.live.erase(std::find(r.live.begin(), r.live.end(), &block));
+            FloatCounters::block_ = nullptr;
+        }
+    };
+};
+
+FloatCounters::Block& FloatCounters::attach() {
+    static thread_local CounterRegistry::Holder holder;
+    block_ = &holder.block;
+    return holder.block;
+}
+
+CounterSnapshot FloatCounters::snapshot() {
+    CounterRegistry& r = CounterRegistry::instance();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    CounterSnapshot total = r.retired;
+    for (const Block* block : r.live) CounterRegistry::add(total, *block);
+    return total;
+}
+
+CounterSnapshot FloatCounters::threadSnapshot() {
+    CounterSnapshot total;
+    if (block_) CounterRegistry::add(total, *block_);
+    return total;
+}
+
+void FloatCounters::reset() {
+    CounterRegistry& r = CounterRegistry::instance();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    r.retired = CounterSnapshot();
+    for (Block* block : r.live) CounterRegistry::clear(*block);
+}
@@ -0,0 +1,129 @@
+#include "FP32.h"
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <vector>
+
+// ns per soft-float FP32 addition for operand mixes that hit different
+// parts of addImpl, with native float addition as the floor
+
+static volatile uint32_t sink;
+
+struct Operands {
+    std::vector<FP32> a, b;
+};
+
+static double timeAdd(const Operands& ops) {
+    const int reps = 7;
+    const size_t n = ops.a.size();
+    double best = 1e30;
+    std::vector<FP32> out(n);
+
+    for (int r = 0; r < reps; ++r) {
+        auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < n; ++i) {
+            out[i] = ops.a[i] + ops.b[i];
+        }
+        auto stop = std::chrono::steady_clock::now();
+        sink = out[r].bits();
+
+        double ns = std::chrono::duration<double, std::nano>(stop - start).count();
+        if (ns < best) best = ns;
+    }
+
+    return best / static_cast<double>(n);
+}
+
+static double timeNative(const Operands& ops) {
+    const int reps = 7;
+    const size_t n = ops.a.size();
+    double best = 1e30;
+    std::vector<float> a(n), b(n), out(n);
+    for (size_t i = 0; i < n; ++i) {
+        a[i] = ops.a[i].toFloat();
+        b[i] = ops.b[i].toFloat();
+    }
+
+    for (int r = 0; r < reps; ++r) {
+        auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < n; ++i) {
+            out[i] = a[i] + b[i];
+        }
+        auto stop = std::chrono::steady_clock::now();
+        sink = static_cast<uint32_t>(out[r]);
+
+        double ns = std::chrono::duration<double, std::nano>(stop - start).count();
+        if (ns < best) best = ns;
+    }
+
+    return best / static_cast<double>(n);
+}
+
+static FP32 randomNormal(std::mt19937& rng, int min_exp, int max_exp) {
+    std::uniform_int_distribution<int> exp(min_exp, max_exp);
+    std::uniform_int_distribution<uint32_t> mant(0, 0x7FFFFF);
+    std::uniform_int_distribution<int> sign(0, 1);
+    return FP32::fromBits((static_cast<uint32_t>(sign(rng)) << 31) |
+                          (static_cast<uint32_t>(exp(rng) + 127) << 23) | mant(rng));
+}
+
+int main() {
+    const size_t n = 1u << 20;
+    std::mt19937 rng(42);
+
+    // uniform: normals within a few binades of each other, random signs
+    Operands uniform;
+    // wide: normals across the whole exponent range, mostly one side dominates
+    Operands wide;
+    // cancellation: b is -a with the low mantissa bits changed, so the sum
+    // needs a long renormalizing shift
+    Operands cancel;
+    // adversarial: a random mix of normals, subnormals, zeros, infinities and
+    // nans, so the special-case branches are unpredictable
+    Operands adversarial;
+
+    std::uniform_int_distribution<uint32_t> any_bits(0, 0xFFFFFFFF);
+    std::uniform_int_distribution<int> kind(0, 4);
+    std::uniform_int_distribution<uint32_t> low(1, 0x7FFF);
+    for (size_t i = 0; i < n; ++i) {
+        uniform.a.push_back(randomNormal(rng, -8, 8));
+        uniform.b.push_back(randomNormal(rng, -8, 8));
+
+        wide.a.push_back(randomNormal(rng, -126, 127));
+        wide.b.push_back(randomNormal(rng, -126, 127));
+
+        FP32 x = randomNormal(rng, -60, 60);
+        cancel.a.push_back(x);
+        cancel.b.push_back(FP32::fromBits((x.bits() ^ 0x80000000u) ^ low(rng)));
+
+        FP32 pair[2];
+        for (FP32& v : pair) {
+            switch (kind(rng)) {
+            case 0:  v = FP32::fromBits(any_bits(rng) & 0x807FFFFFu); break;
+            case 1:  v = FP32::zero(any_bits(rng) & 1); break;
+            case 2:  v = FP32::infinity(any_bits(rng) & 1); break;
+            case 3:  v = FP32::nan(); break;
+            default: v = randomNormal(rng, -126, 127); break;
+            }
+        }
+        adversarial.a.push_back(pair[0]);
+        adversarial.b.push_back(pair[1]);
+    }
+
+    std::cout << "FP32 addition, ns/op (" << n << " pairs, best of 7)" << std::endl;
+    std::cout << std::fixed << std::setprecision(3);
+    std::cout << std::left << std::setw(14) << "operands" << std::right
+              << std::setw(12) << "fp32 ns" << std::setw(12) << "float ns" << std::endl;
+
+    const Operands* sets[] = {&uniform, &wide, &cancel, &adversarial};
+    const char* names[] = {"uniform", "wide", "cancellation", "adversarial"};
+    for (int s = 0; s < 4; ++s) {
+        std::cout << std::left << std::setw(14) << names[s] << std::right
+                  << std::setw(12) << timeAdd(*sets[s])
+                  << std::setw(12) << timeNative(*sets[s]) << std::endl;
+    }
+
+    return 0;
+}
@@ -1,263 +1,346 @@
 #include "FP32.h"
-#include <algorithm>
+#include "ThreadPool.h"
 
-uint32_t FP32::roundToNearest(uint64_t value, int shift) {
-    if (shift <= 0) return static_cast<uint32_t>(value); // round to nearest, bankers rounding
+#if defined(__x86_64__) || defined(__i386__)
+#define FP32_X86 1
+#include <immintrin.h>
+#endif
 
-    uint64_t mask = (1ULL << shift) - 1;
-    uint64_t halfway = 1ULL << (shift - 1);
-    uint64_t remainder = value & mask;
-    uint64_t result = value >> shift;
+// the rounding, normalization and special-value logic lives in
+// FloatFormat.h and is shared with BFloat16 and SmallFloat
 
-    if (remainder > halfway){
-        result++; // round up
-    }
-    else if (remainder == halfway){
-        // tie, round to even (lsb = 0)
-        if (result & 1){
-            result++; 
-        }
-    }
+// op(format) with the kernels of the calling thread's subnormal mode. the
+// Preserve kernels inline into each operator as they did before the mode
+// existed; Flush is a cold call, so the default path pays one load and a
+// predicted branch. with both inline gcc calls the Preserve kernel too
+template <typename Op>
+__attribute__((noinline, cold))
+static uint32_t flushKernel(Op op) {
+    return op(FP32::FormatFor<SubnormalMode::Flush>());
+}
 
-    return static_cast<uint32_t>(result);
+template <typename Op>
+static inline uint32_t kernel(Op op) {
+    if (__builtin_expect(subnormalMode() == SubnormalMode::Flush, 0)) return flushKernel(op);
+    return op(FP32::FormatFor<SubnormalMode::Preserve>());
 }
 
-// TODO: BUG - normalization logic is zeroing out results
-FP32 FP32::normalize(bool sign, int exp, uint64_t significand) {
-    if (significand == 0){
-        return FP32::zero(sign);
-    }
+FP32 FP32::operator+(const FP32& other) const {
+    return FP32(kernel([&](auto f) { return decltype(f)::add(bits_, other.bits_); }));
+}
 
-    // find leading 1 position
-    int leading_bit = 63;
-    while (leading_bit >= 0 && !((significand >> leading_bit) & 1)) {
-        leading_bit--;
-    }
+FP32 FP32::operator-(const FP32& other) const {
+    return FP32(kernel([&](auto f) { return decltype(f)::subtract(bits_, other.bits_); }));
+}
 
-    // adjust exponent based on leading bit pos
-    // for normalized numbers, we want leading bit at 23
-    int shift = leading_bit - MANTISSA_BITS;
-    exp += shift;
+FP32& FP32::operator+=(const FP32& other) {
+    *this = *this + other;
+    return *this;
+}
 
-    // check overflow/underflow
-    if (exp >= 255) {
-        return FP32::infinity(sign);
-    }
+FP32& FP32::operator-=(const FP32& other) {
+    *this = *this - other;
+    return *this;
+}
 
-    if (exp <= 0) {
-        // subnormal or underflow
-        int denorm_shift = 1 - exp;
-        if (denorm_shift > 63){
-            return FP32::zero(sign); 
-        }
+FP32 FP32::operator*(const FP32& other) const {
+    return FP32(kernel([&](auto f) { return decltype(f)::multiply(bits_, other.bits_); }));
+}
 
-        uint32_t mant = roundToNearest(significand, denorm_shift + shift);
-        return FP32(packBits(sign, 0, mant));
-    }
+FP32& FP32::operator*=(const FP32& other) {
+    *this = *this * other;
+    return *this;
+}
 
-    // normal case
+FP32 FP32::fma(const FP32& a, const FP32& b, const FP32& c) {
+    // a * b + c with a single rounding at the end
+    return FP32(kernel([&](auto f) { return decltype(f)::fma(a.bits_, b.bits_, c.bits_); }));
+}
 
-    // round to 23 mantissa bits
-    uint32_t mant = roundToNearest(significand, shift);
+// batched arithmetic
+// the FloatFormat kernels are inline, so each loop gets its own copy;
+// large spans are split across the thread pool. the subnormal mode is read
+// here, on the calling thread
 
-    // remove implicit leading 1
-    mant &= MANTISSA_MASK;
+static const size_t BATCH_GRAIN = chunkElements(3 * sizeof(FP32));
 
-    // pack and return
-    return FP32(packBits(sign, static_cast<uint8_t>(exp), mant));
+void FP32::add(const FP32* a, const FP32* b, FP32* out, size_t n) {
+    withSubnormalMode(subnormalMode(), [&](auto sm) {
+        using F = FormatFor<decltype(sm)::value>;
+        parallelChunks(n, BATCH_GRAIN, [=](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i) {
+                out[i] = FP32(F::add(a[i].bits_, b[i].bits_));
+            }
+        });
+    });
 }
 
-FP32 FP32::addImpl(const FP32& a, const FP32& b) {
-    // handle special cases first
-    if (a.isNaN() || b.isNaN()) return FP32::nan(); 
-    
-    if (a.isInfinity()) {
-        if (b.isInfinity() && a.sign() != b.sign()) {
-            return FP32::nan(); // inf - inf = NaN
-        }
-        return a;
+void FP32::subtract(const FP32* a, const FP32* b, FP32* out, size_t n) {
+    withSubnormalMode(subnormalMode(), [&](auto sm) {
+        using F = FormatFor<decltype(sm)::value>;
+        parallelChunks(n, BATCH_GRAIN, [=](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i) {
+                out[i] = FP32(F::subtract(a[i].bits_, b[i].bits_));
+            }
+        });
+    });
+}
+
+void FP32::multiply(const FP32* a, const FP32* b, FP32* out, size_t n) {
+    withSubnormalMode(subnormalMode(), [&](auto sm) {
+        using F = FormatFor<decltype(sm)::value>;
+        parallelChunks(n, BATCH_GRAIN, [=](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i) {
+                out[i] = FP32(F::multiply(a[i].bits_, b[i].bits_));
+            }
+        });
+    });
+}
+
+void FP32::scale(const FP32* a, FP32 s, FP32* out, size_t n) {
+    withSubnormalMode(subnormalMode(), [&](auto sm) {
+        using F = FormatFor<decltype(sm)::value>;
+        parallelChunks(n, BATCH_GRAIN, [=](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i) {
+                out[i] = FP32(F::multiply(a[i].bits_, s.bits_));
+            }
+        });
+    });
+}
+
+// batched sqrt / rsqrt
+//
+// positive normal x take the simd paths, zeros, subnormals, negatives,
+// infinities and nans the scalar kernel of the subnormal mode, so every
+// path gives the scalar bits in either mode. sqrt of a normal is hardware
+// sqrtps, correctly rounded like Format::sqrt and always normal. rsqrt runs
+// Format::rsqrt itself in 32-bit lanes: the seed gather, both newton steps
+// as 32 x 32 -> 64 bit products on the even and odd lanes, and the round to
+// nearest. the counted build stays on the scalar kernels so every element
+// is counted
+
+template <bool RSQRT, typename F>
+static void rootScalar(const FP32* src, FP32* dst, size_t n) {
+    for (size_t i = 0; i < n; ++i) {
+        dst[i] = FP32::fromBits(RSQRT ? F::rsqrt(src[i].bits()) : F::sqrt(src[i].bits()));
     }
-    
-    if (b.isInfinity()) return b;
-    
-    if (a.isZero()) return b;
-    if (b.isZero()) return a;
-    
-    // extract components
-    bool sign_a = a.sign();
-    bool sign_b = b.sign();
-    int exp_a = a.unbiasedExponent();
-    int exp_b = b.unbiasedExponent();
-    
-    // get significands with implicit bit
-    uint64_t sig_a = a.mantissa();
-    uint64_t sig_b = b.mantissa();
-    
-    if (a.isNormal()) sig_a |= (1ULL << MANTISSA_BITS);
-    if (b.isNormal()) sig_b |= (1ULL << MANTISSA_BITS);
-    
-    // align significands
-    sig_a <<= 3;
-    sig_b <<= 3;
-    
-    // make exponents equal by shifitng smaller one
-    if (exp_a > exp_b) {
-        int diff = exp_a - exp_b;
-        if (diff > 31) {
-            sig_b = 0;
-        } else {
-            sig_b >>= diff;
-        }
-        exp_b = exp_a;
-    } else if (exp_b > exp_a) {
-        int diff = exp_b - exp_a;
-        if (diff > 31) {
-            sig_a = 0;
-        } else {
-            sig_a >>= diff;
-        }
-        exp_a = exp_b;
+}
+
+#ifdef FP32_X86
+
+using Seeds = FloatFormatRsqrtSeeds;
+
+// the exponent field of 2^(-31 - e / 2) before roundAndPack's shift, less
+// the one the rounded significand's leading bit adds
+static constexpr int RSQRT_FIELD = FP32::Format::EXPONENT_BIAS + FP32::Format::MANTISSA_BITS - 31 - 1;
+static constexpr int BIAS = FP32::Format::EXPONENT_BIAS;
+
+// avx2: 8 lanes of 32 bits
+
+// one FP32::Format::rsqrtStep in the low halves of 4 64-bit lanes
+__attribute__((target("avx2,fma")))
+static __m256i rsqrtStepAVX2(__m256i A, __m256i y) {
+    __m256i y2 = _mm256_srli_epi64(_mm256_mul_epu32(y, y), 31);
+    __m256i ay2 = _mm256_srli_epi64(_mm256_mul_epu32(A, y2), 30);
+    __m256i t = _mm256_sub_epi64(_mm256_set1_epi64x(int64_t(3) << 30), _mm256_srli_epi64(ay2, 1));
+    return _mm256_srli_epi64(_mm256_mul_epu32(y, t), 31);
+}
+
+__attribute__((target("avx2,fma")))
+static __m256i rsqrtAVX2(__m256i bits) {
+    const __m256i one = _mm256_set1_epi32(1);
+    __m256i field = _mm256_srli_epi32(bits, 23);
+
+    // x = a * 2^e with a in [1, 4) and e even, A = a * 2^30
+    __m256i odd = _mm256_andnot_si256(field, one);
+    __m256i sig = _mm256_or_si256(_mm256_and_si256(bits, _mm256_set1_epi32(0x007FFFFF)),
+                                  _mm256_set1_epi32(0x00800000));
+    __m256i A = _mm256_sllv_epi32(sig, _mm256_add_epi32(odd, _mm256_set1_epi32(7)));
+    __m256i index = _mm256_sub_epi32(_mm256_srli_epi32(A, 24), _mm256_set1_epi32(Seeds::FIRST));
+    __m256i y = _mm256_i32gather_epi32(reinterpret_cast<const int*>(FP32::Format::RSQRT_SEEDS.y), index, 4);
+
+    __m256i A_odd = _mm256_srli_epi64(A, 32);
+    __m256i y_even = y;
+    __m256i y_odd = _mm256_srli_epi64(y, 32);
+    for (int i = 0; i < FP32::Format::RSQRT_STEPS; ++i) {
+        y_even = rsqrtStepAVX2(A, y_even);
+        y_odd = rsqrtStepAVX2(A_odd, y_odd);
     }
-    
-    // perform add or sub
-    uint64_t result_sig;
-    bool result_sign;
-    
-    if (sign_a == sign_b) {
-        // same sign = add
-        result_sig = sig_a + sig_b;
-        result_sign = sign_a;
-    } else {
-        // different sign = sub
-        if (sig_a >= sig_b) {
-            result_sig = sig_a - sig_b;
-            result_sign = sign_a;
-        } else {
-            result_sig = sig_b - sig_a;
-            result_sign = sign_b;
+    y = _mm256_blend_epi32(y_even, _mm256_slli_epi64(y_odd, 32), 0xAA);
+
+    // roundAndPack: y has its leading bit at 29 + (0, 1 or 2)
+    __m256i shift = _mm256_add_epi32(_mm256_min_epu32(_mm256_srli_epi32(y, 30), _mm256_set1_epi32(2)),
+                                     _mm256_set1_epi32(6));
+    __m256i half = _mm256_sllv_epi32(one, _mm256_sub_epi32(shift, one));
+    __m256i remainder = _mm256_and_si256(y, _mm256_sub_epi32(_mm256_add_epi32(half, half), one));
+    __m256i result = _mm256_srlv_epi32(y, shift);
+    __m256i up = _mm256_or_si256(_mm256_cmpgt_epi32(remainder, half),
+                                 _mm256_and_si256(_mm256_cmpeq_epi32(remainder, half), result));
+    result = _mm256_add_epi32(result, _mm256_and_si256(up, one));
+
+    // 1 / sqrt(a * 2^e) = y * 2^(-31 - e / 2), e / 2 = (field - 127) >> 1
+    __m256i half_e = _mm256_srai_epi32(_mm256_sub_epi32(field, _mm256_set1_epi32(BIAS)), 1);
+    __m256i biased = _mm256_sub_epi32(_mm256_add_epi32(shift, _mm256_set1_epi32(RSQRT_FIELD)), half_e);
+    return _mm256_add_epi32(_mm256_slli_epi32(biased, 23), result);
+}
+
+template <bool RSQRT, typename F>
+__attribute__((target("avx2,fma")))
+static void rootAVX2(const FP32* src, FP32* dst, size_t n) {
+    // a normal positive x is 0x00800000 .. 0x7F7FFFFF
+    const __m256i lowest = _mm256_set1_epi32(0x00800000);
+    const __m256i range = _mm256_set1_epi32(0x7F000000);
+    size_t i = 0;
+
+    for (; i + 8 <= n; i += 8) {
+        __m256i bits = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+        __m256i offset = _mm256_sub_epi32(bits, lowest);
+        __m256i fast = _mm256_andnot_si256(_mm256_cmpgt_epi32(_mm256_setzero_si256(), offset),
+                                           _mm256_cmpgt_epi32(range, offset));
+        if (_mm256_movemask_ps(_mm256_castsi256_ps(fast)) != 0xFF) {
+            rootScalar<RSQRT, F>(src + i, dst + i, 8);
+            continue;
         }
+        __m256i result = RSQRT ? rsqrtAVX2(bits)
+                               : _mm256_castps_si256(_mm256_sqrt_ps(_mm256_castsi256_ps(bits)));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), result);
     }
-    
-    // normalize result
-    return normalize(result_sign, exp_a + EXPONENT_BIAS - 3, result_sig);
-}
 
-FP32 FP32::operator+(const FP32& other) const {
-    return addImpl(*this, other);
+    rootScalar<RSQRT, F>(src + i, dst + i, n - i);
 }
 
-FP32 FP32::operator-(const FP32& other) const {
-    return addImpl(*this, -other);
-}
+// gcc 12 flags the _mm512_undefined_* placeholders inside its own headers
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#pragma GCC diagnostic ignored "-Wuninitialized"
+#endif
 
-FP32& FP32::operator+=(const FP32& other) {
-    *this = *this + other;
-    return *this;
+// avx512: 16 lanes, the tail is masked
+
+__attribute__((target("avx512f,avx512bw,avx512vl")))
+static __m512i rsqrtStepAVX512(__m512i A, __m512i y) {
+    __m512i y2 = _mm512_srli_epi64(_mm512_mul_epu32(y, y), 31);
+    __m512i ay2 = _mm512_srli_epi64(_mm512_mul_epu32(A, y2), 30);
+    __m512i t = _mm512_sub_epi64(_mm512_set1_epi64(int64_t(3) << 30), _mm512_srli_epi64(ay2, 1));
+    return _mm512_srli_epi64(_mm512_mul_epu32(y, t), 31);
 }
 
-FP32& FP32::operator-=(const FP32& other) {
-    *this = *this - other;
-    return *this;
+__attribute__((target("avx512f,avx512bw,avx512vl")))
+static __m512i rsqrtAVX512(__m512i bits) {
+    const __m512i one = _mm512_set1_epi32(1);
+    __m512i field = _mm512_srli_epi32(bits, 23);
+
+    __m512i odd = _mm512_andnot_si512(field, one);
+    __m512i sig = _mm512_or_si512(_mm512_and_si512(bits, _mm512_set1_epi32(0x007FFFFF)),
+                                  _mm512_set1_epi32(0x00800000));
+    __m512i A = _mm512_sllv_epi32(sig, _mm512_add_epi32(odd, _mm512_set1_epi32(7)));
+    __m512i index = _mm512_sub_epi32(_mm512_srli_epi32(A, 24), _mm512_set1_epi32(Seeds::FIRST));
+    __m512i y = _mm512_i32gather_epi32(index, FP32::Format::RSQRT_SEEDS.y, 4);
+
+    __m512i A_odd = _mm512_srli_epi64(A, 32);
+    __m512i y_even = y;
+    __m512i y_odd = _mm512_srli_epi64(y, 32);
+    for (int i = 0; i < FP32::Format::RSQRT_STEPS; ++i) {
+        y_even = rsqrtStepAVX512(A, y_even);
+        y_odd = rsqrtStepAVX512(A_odd, y_odd);
+    }
+    y = _mm512_mask_blend_epi32(0xAAAA, y_even, _mm512_slli_epi64(y_odd, 32));
+
+    __m512i shift = _mm512_add_epi32(_mm512_min_epu32(_mm512_srli_epi32(y, 30), _mm512_set1_epi32(2)),
+                                     _mm512_set1_epi32(6));
+    __m512i half = _mm512_sllv_epi32(one, _mm512_sub_epi32(shift, one));
+    __m512i remainder = _mm512_and_si512(y, _mm512_sub_epi32(_mm512_add_epi32(half, half), one));
+    __m512i result = _mm512_srlv_epi32(y, shift);
+    __mmask16 up = _mm512_cmpgt_epu32_mask(remainder, half) |
+                   (_mm512_cmpeq_epu32_mask(remainder, half) & _mm512_test_epi32_mask(result, one));
+    result = _mm512_mask_add_epi32(result, up, result, one);
+
+    __m512i half_e = _mm512_srai_epi32(_mm512_sub_epi32(field, _mm512_set1_epi32(BIAS)), 1);
+    __m512i biased = _mm512_sub_epi32(_mm512_add_epi32(shift, _mm512_set1_epi32(RSQRT_FIELD)), half_e);
+    return _mm512_add_epi32(_mm512_slli_epi32(biased, 23), result);
 }
 
-FP32 FP32::multiplyImpl(const FP32& a, const FP32& b) {
-    // handle special cases
-    if (a.isNaN() || b.isNaN()) return FP32::nan();
-    
-    if (a.isInfinity() || b.isInfinity()) {
-        if (a.isZero() || b.isZero()) {
-            return FP32::nan(); // 0 * inf = NaN
+template <bool RSQRT, typename F>
+__attribute__((target("avx512f,avx512bw,avx512vl")))
+static void rootAVX512(const FP32* src, FP32* dst, size_t n) {
+    const __m512i lowest = _mm512_set1_epi32(0x00800000);
+    const __m512i highest = _mm512_set1_epi32(0x7F7FFFFF);
+    size_t i = 0;
+
+    for (; i < n; i += 16) {
+        __mmask16 k = n - i >= 16 ? static_cast<__mmask16>(0xFFFF)
+                                  : static_cast<__mmask16>((1u << (n - i)) - 1);
+        __m512i bits = _mm512_maskz_loadu_epi32(k, src + i);
+        __mmask16 fast = _mm512_cmpge_epu32_mask(bits, lowest) & _mm512_cmple_epu32_mask(bits, highest);
+        if ((fast & k) != k) {
+            rootScalar<RSQRT, F>(src + i, dst + i, n - i >= 16 ? 16 : n - i);
+            continue;
         }
-        return FP32::infinity(a.sign() != b.sign());
+        __m512i result = RSQRT ? rsqrtAVX512(bits)
+                               : _mm512_castps_si512(_mm512_sqrt_ps(_mm512_castsi512_ps(bits)));
+        _mm512_mask_storeu_epi32(dst + i, k, result);
     }
-    
-    if (a.isZero() || b.isZero()) {
-        return FP32::zero(a.sign() != b.sign());
+}
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+#endif // FP32_X86
+
+// dispatch, neon stays on the scalar kernel
+
+template <bool RSQRT, typename F>
+static void root(const FP32* src, FP32* dst, size_t n, SimdLevel level) {
+    if (FloatCounters::ENABLED || !simdLevelSupported(level)) level = SimdLevel::Scalar;
+
+    switch (level) {
+#ifdef FP32_X86
+    case SimdLevel::AVX2:       rootAVX2<RSQRT, F>(src, dst, n); return;
+    case SimdLevel::AVX512:
+    case SimdLevel::AVX512BF16: rootAVX512<RSQRT, F>(src, dst, n); return;
+#endif
+    default:                    rootScalar<RSQRT, F>(src, dst, n); return;
     }
-    
-    // extract components
-    bool result_sign = a.sign() != b.sign();
-    int exp_a = a.unbiasedExponent();
-    int exp_b = b.unbiasedExponent();
-    
-    // get significands
-    uint64_t sig_a = a.mantissa();
-    uint64_t sig_b = b.mantissa();
-    
-    if (a.isNormal()) sig_a |= (1ULL << MANTISSA_BITS);
-    if (b.isNormal()) sig_b |= (1ULL << MANTISSA_BITS);
-    
-    // Multiply significands
-    // sig_a and sig_b are 24-bit fixed-point 
-    // product will be 48-bit fixed-point
-    uint64_t result_sig = sig_a * sig_b;
-    
-   
-    // input_exp = (exp_a + exp_b + BIAS) - expected_shift
-    int result_exp = exp_a + exp_b + EXPONENT_BIAS - MANTISSA_BITS;
-    
-    return normalize(result_sign, result_exp, result_sig);
 }
 
-FP32 FP32::operator*(const FP32& other) const {
-    return multiplyImpl(*this, other);
+void sqrt(const FP32* src, FP32* dst, size_t n, SimdLevel level) {
+    withSubnormalMode(subnormalMode(), [&](auto sm) {
+        root<false, FP32::FormatFor<decltype(sm)::value>>(src, dst, n, level);
+    });
 }
 
-FP32& FP32::operator*=(const FP32& other) {
-    *this = *this * other;
-    return *this;
+void rsqrt(const FP32* src, FP32* dst, size_t n, SimdLevel level) {
+    withSubnormalMode(subnormalMode(), [&](auto sm) {
+        root<true, FP32::FormatFor<decltype(sm)::value>>(src, dst, n, level);
+    });
+}
+
+static const size_t UNARY_GRAIN = chunkElements(2 * sizeof(FP32));
+
+void FP32::sqrt(const FP32* src, FP32* dst, size_t n) {
+    SimdLevel level = detectSimdLevel();
+    withSubnormalMode(subnormalMode(), [&](auto sm) {
+        using F = FormatFor<decltype(sm)::value>;
+        parallelChunks(n, UNARY_GRAIN, [=](size_t begin, size_t end) {
+            root<false, F>(src + begin, dst + begin, end - begin, level);
+        });
+    });
+}
+
+void FP32::rsqrt(const FP32* src, FP32* dst, size_t n) {
+    SimdLevel level = detectSimdLevel();
+    withSubnormalMode(subnormalMode(), [&](auto sm) {
+        using F = FormatFor<decltype(sm)::value>;
+        parallelChunks(n, UNARY_GRAIN, [=](size_t begin, size_t end) {
+            root<true, F>(src + begin, dst + begin, end - begin, level);
+        });
+    });
 }
 
 FP32 FP32::operator/(const FP32& other) const {
-    // handle special cases
-    if (isNaN() || other.isNaN()) return FP32::nan();
-    
-    if (isInfinity()) {
-        if (other.isInfinity()) {
-            return FP32::nan(); // inf / inf = NaN
-        }
-        return FP32::infinity(sign() != other.sign());
-    }
-    
-    if (other.isInfinity()) {
-        return FP32::zero(sign() != other.sign());
-    }
-    
-    if (other.isZero()) {
-        if (isZero()) {
-            return FP32::nan(); // 0 / 0 = NaN
-        }
-        return FP32::infinity(sign() != other.sign());
-    }
-    
-    if (isZero()) {
-        return FP32::zero(sign() != other.sign());
-    }
-    
-    // extract components
-    bool result_sign = sign() != other.sign();
-    int exp_a = unbiasedExponent();
-    int exp_b = other.unbiasedExponent();
-    
-    // get significands 
-    uint64_t sig_a = mantissa();
-    uint64_t sig_b = other.mantissa();
-    
-    if (isNormal()) sig_a |= (1ULL << MANTISSA_BITS);
-    if (other.isNormal()) sig_b |= (1ULL << MANTISSA_BITS);
-    
-    // shift dividend left for precision
-    sig_a <<= (MANTISSA_BITS + 3); // extra bits for rounding and normalization
-    
-    // divide significands
-    uint64_t result_sig = sig_a / sig_b;
-    
-   
-    // result_exp = exp_a - exp_b + BIAS
-    int result_exp = exp_a - exp_b + EXPONENT_BIAS - 3; // adjust for extra shift
-    
-    // normalize
-    return normalize(result_sign, result_exp, result_sig);
+    return FP32(kernel([&](auto f) { return decltype(f)::divide(bits_, other.bits_); }));
 }
 
 FP32& FP32::operator/=(const FP32& other) {
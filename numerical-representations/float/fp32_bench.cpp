@@ -0,0 +1,212 @@
+#include "FP32.h"
+#include "FP32Expr.h"
+#include "FP32Order.h"
+#include "MicroBench.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// every FP32 operator next to the same loop on native float, see
+// MicroBench.h for the flags. `make bench` writes bench_fp32.json
+
+int main(int argc, char** argv) {
+    MicroBench bench("fp32", argc, argv);
+
+    // per-core numbers, the batched calls would otherwise use the pool
+    setThreadCount(1);
+    bench.setContext("threads", "1");
+    bench.setContext("simd", simdLevelName(detectSimdLevel()));
+
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<float> mantissa(1.0f, 2.0f);
+    std::uniform_int_distribution<int> exponent(-20, 20);
+    std::uniform_int_distribution<int> sign(0, 1);
+
+    for (size_t batch : bench.batches()) {
+        // normal operands across a few dozen binades, positive for sqrt
+        std::vector<float> fa(batch), fb(batch), fc(batch), fout(batch);
+        for (size_t i = 0; i < batch; ++i) {
+            fa[i] = std::ldexp(mantissa(rng), exponent(rng));
+            fb[i] = std::ldexp(mantissa(rng), exponent(rng)) * (sign(rng) ? -1.0f : 1.0f);
+            fc[i] = std::ldexp(mantissa(rng), exponent(rng));
+        }
+
+        std::vector<FP32> a(batch), b(batch), c(batch), out(batch);
+        for (size_t i = 0; i < batch; ++i) {
+            a[i] = FP32(fa[i]);
+            b[i] = FP32(fb[i]);
+            c[i] = FP32(fc[i]);
+        }
+        std::vector<unsigned char> flags(batch);
+
+        bench.run("construct", batch,
+            [&] { for (size_t i = 0; i < batch; ++i) out[i] = FP32(fa[i]); },
+            [&] { for (size_t i = 0; i < batch; ++i) fout[i] = fa[i]; });
+
+        bench.run("add", batch,
+            [&] { for (size_t i = 0; i < batch; ++i) out[i] = a[i] + b[i]; },
+            [&] { for (size_t i = 0; i < batch; ++i) fout[i] = fa[i] + fb[i]; });
+
+        bench.run("sub", batch,
+            [&] { for (size_t i = 0; i < batch; ++i) out[i] = a[i] - b[i]; },
+            [&] { for (size_t i = 0; i < batch; ++i) fout[i] = fa[i] - fb[i]; });
+
+        bench.run("mul", batch,
+            [&] { for (size_t i = 0; i < batch; ++i) out[i] = a[i] * b[i]; },
+            [&] { for (size_t i = 0; i < batch; ++i) fout[i] = fa[i] * fb[i]; });
+
+        bench.run("div", batch,
+            [&] { for (size_t i = 0; i < batch; ++i) out[i] = a[i] / b[i]; },
+            [&] { for (size_t i = 0; i < batch; ++i) fout[i] = fa[i] / fb[i]; });
+
+        bench.run("sqrt", batch,
+            [&] { for (size_t i = 0; i < batch; ++i) out[i] = a[i].sqrt(); },
+            [&] { for (size_t i = 0; i < batch; ++i) fout[i] = std::sqrt(fa[i]); });
+
+        bench.run("rsqrt", batch,
+            [&] { for (size_t i = 0; i < batch; ++i) out[i] = a[i].rsqrt(); },
+            [&] { for (size_t i = 0; i < batch; ++i) fout[i] = 1.0f / std::sqrt(fa[i]); });
+
+        bench.run("sqrt_batch", batch,
+            [&] { FP32::sqrt(a.data(), out.data(), batch); },
+            [&] { for (size_t i = 0; i < batch; ++i) fout[i] = std::sqrt(fa[i]); });
+
+        bench.run("rsqrt_batch", batch,
+            [&] { FP32::rsqrt(a.data(), out.data(), batch); },
+            [&] { for (size_t i = 0; i < batch; ++i) fout[i] = 1.0f / std::sqrt(fa[i]); });
+
+        bench.run("rsqrt_batch_scalar", batch,
+            [&] { rsqrt(a.data(), out.data(), batch, SimdLevel::Scalar); },
+            [&] { for (size_t i = 0; i < batch; ++i) fout[i] = 1.0f / std::sqrt(fa[i]); });
+
+        bench.run("fma", batch,
+            [&] { for (size_t i = 0; i < batch; ++i) out[i] = fma(a[i], b[i], c[i]); },
+            [&] { for (size_t i = 0; i < batch; ++i) fout[i] = std::fma(fa[i], fb[i], fc[i]); });
+
+        bench.run("compare", batch,
+            [&] { for (size_t i = 0; i < batch; ++i) flags[i] = a[i] < b[i]; },
+            [&] { for (size_t i = 0; i < batch; ++i) flags[i] = fa[i] < fb[i]; });
+
+        bench.run("toFloat", batch,
+            [&] { for (size_t i = 0; i < batch; ++i) fout[i] = a[i].toFloat(); },
+            [&] { for (size_t i = 0; i < batch; ++i) fout[i] = fb[i]; });
+
+        bench.run("add_batch", batch,
+            [&] { FP32::add(a.data(), b.data(), out.data(), batch); },
+            [&] { for (size_t i = 0; i < batch; ++i) fout[i] = fa[i] + fb[i]; });
+
+        // a * b + c * a - b: eager batched calls with temporaries, then
+        // fused into one pass
+        std::vector<FP32> t1(batch), t2(batch);
+        auto ea = lazy(a.data(), batch);
+        auto eb = lazy(b.data(), batch);
+        auto ec = lazy(c.data(), batch);
+        auto expr_native = [&] {
+            for (size_t i = 0; i < batch; ++i) fout[i] = fa[i] * fb[i] + fc[i] * fa[i] - fb[i];
+        };
+        bench.run("expr_eager", batch, [&] {
+            FP32::multiply(a.data(), b.data(), t1.data(), batch);
+            FP32::multiply(c.data(), a.data(), t2.data(), batch);
+            FP32::add(t1.data(), t2.data(), t1.data(), batch);
+            FP32::subtract(t1.data(), b.data(), out.data(), batch);
+        }, expr_native);
+
+        bench.run("expr_fused", batch,
+            [&] { evaluate(ea * eb + ec * ea - eb, out.data()); }, expr_native);
+
+        // order ops on the keys against the float loop or algorithm
+        bench.run("argmin", batch,
+            [&] { doNotOptimize(argmin(b.data(), batch)); },
+            [&] { doNotOptimize(std::min_element(fb.begin(), fb.end()) - fb.begin()); });
+
+        bench.run("minmax", batch,
+            [&] { doNotOptimize(minmax(b.data(), batch).first.bits()); },
+            [&] { doNotOptimize(*std::minmax_element(fb.begin(), fb.end()).first); });
+
+        bench.run("clamp", batch,
+            [&] { clamp(b.data(), out.data(), batch, FP32(-1.0f), FP32(1.0f)); },
+            [&] { for (size_t i = 0; i < batch; ++i) fout[i] = std::clamp(fb[i], -1.0f, 1.0f); });
+
+        // the copy is in both loops, sorting sorted data would flatter both
+        bench.run("sort", batch,
+            [&] { out = b; sort(out.data(), batch); },
+            [&] { fout = fb; std::sort(fout.begin(), fout.end()); });
+
+        bench.run("sort_operator", batch,
+            [&] { out = b; std::sort(out.begin(), out.end()); },
+            [&] { fout = fb; std::sort(fout.begin(), fout.end()); });
+
+        // stream formatting costs ~100x an add, cap it so a run stays short
+        if (batch > 65536) continue;
+
+        std::ostringstream os;
+        bench.run("toString", batch,
+            [&] {
+                for (size_t i = 0; i < batch; ++i) {
+                    os.str("");
+                    os << a[i];
+                    doNotOptimize(os.tellp());
+                }
+            },
+            [&] {
+                for (size_t i = 0; i < batch; ++i) {
+                    os.str("");
+                    os << fa[i];
+                    doNotOptimize(os.tellp());
+                }
+            });
+
+        std::vector<std::string> text(batch);
+        for (size_t i = 0; i < batch; ++i) {
+            text[i] = std::to_string(fa[i]);
+        }
+        std::istringstream is;
+        bench.run("fromString", batch,
+            [&] {
+                for (size_t i = 0; i < batch; ++i) {
+                    is.clear();
+                    is.str(text[i]);
+                    is >> out[i];
+                }
+            },
+            [&] {
+                for (size_t i = 0; i < batch; ++i) {
+                    is.clear();
+                    is.str(text[i]);
+                    is >> fout[i];
+                }
+            });
+
+        // the same without streams: caller buffer, no locale, no allocation
+        char chars[64];
+        bench.run("toChars", batch,
+            [&] {
+                for (size_t i = 0; i < batch; ++i) {
+                    doNotOptimize(toChars(chars, chars + sizeof(chars), a[i]).ptr);
+                }
+            },
+            [&] {
+                for (size_t i = 0; i < batch; ++i) {
+                    doNotOptimize(std::to_chars(chars, chars + sizeof(chars), fa[i]).ptr);
+                }
+            });
+
+        bench.run("fromChars", batch,
+            [&] {
+                for (size_t i = 0; i < batch; ++i) {
+                    fromChars(text[i].data(), text[i].data() + text[i].size(), out[i]);
+                }
+            },
+            [&] {
+                for (size_t i = 0; i < batch; ++i) {
+                    std::from_chars(text[i].data(), text[i].data() + text[i].size(), fout[i]);
+                }
+            });
+    }
+
+    return bench.finish();
+}
@@ -1,25 +1,44 @@
 #include "FP32.h"
 #include <iostream>
-#include <iomanip>
+#include <string_view>
+
+std::to_chars_result toChars(char* first, char* last, FP32 value, CharsFormat format) {
+    if (format == CharsFormat::Shortest) {
+        return std::to_chars(first, last, value.toFloat());
+    }
+    return bitsToChars(first, last, value.bits(), FP32::Format::EXPONENT_BITS,
+                       FP32::Format::MANTISSA_BITS, format);
+}
+
+std::from_chars_result fromChars(const char* first, const char* last, FP32& value, CharsFormat format) {
+    if (format == CharsFormat::Shortest) {
+        float parsed;
+        std::from_chars_result result = std::from_chars(first, last, parsed);
+        if (result.ec == std::errc()) value = FP32(parsed);
+        return result;
+    }
+    uint32_t bits;
+    std::from_chars_result result = bitsFromChars(first, last, bits, FP32::Format::EXPONENT_BITS,
+                                                  FP32::Format::MANTISSA_BITS, format);
+    if (result.ec == std::errc()) value = FP32::fromBits(bits);
+    return result;
+}
 
 std::ostream& operator<<(std::ostream& os, const FP32& fp) {
-    // save stream state
-    std::ios_base::fmtflags flags = os.flags();
-    std::streamsize precision = os.precision();
-    
-    // print the decimal value (with approx precision)
-    os << std::setprecision(9) << fp.toDouble();
-    
-    // restore stream state
-    os.flags(flags);
-    os.precision(precision);
-    
-    return os;
+    // shortest round-trip decimal, only the stream's width and fill apply
+    char buffer[FP32::MAX_CHARS];
+    std::to_chars_result result = toChars(buffer, buffer + sizeof(buffer), fp);
+    return os << std::string_view(buffer, result.ptr - buffer);
 }
 
 std::istream& operator>>(std::istream& is, FP32& fp) {
-    float value;
-    is >> value;
-    fp = FP32(value);
+    char buffer[64];
+    size_t length = readNumberToken(is, buffer, sizeof(buffer));
+    if (length == 0) return is;
+
+    std::from_chars_result result = fromChars(buffer, buffer + length, fp);
+    if (result.ec != std::errc() || result.ptr != buffer + length) {
+        is.setstate(std::ios_base::failbit);
+    }
     return is;
-}
\ No newline at end of file
+}
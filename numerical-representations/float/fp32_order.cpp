@@ -0,0 +1,212 @@
+#include "FP32Order.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+using Format = FP32::Format;
+
+// the loops run ORDER_LANES elements at a time with a fixed trip count, so
+// -O2 turns them into vector min / max / compare with no scalar fallback
+static constexpr size_t ORDER_LANES = 16;
+static constexpr size_t RANGE_GRAIN = chunkElements(sizeof(FP32));
+static constexpr size_t CLAMP_GRAIN = chunkElements(2 * sizeof(FP32));
+
+// smallest and largest key of a span
+struct KeyRange {
+    uint32_t lo;
+    uint32_t hi;
+};
+
+// the key a nan takes in the reductions. under Propagate it sits below
+// every number for the minimum and above every number for the maximum,
+// under Ignore the other way round, so it wins only when nothing else is
+// left. both keys decode to nan patterns, no number has them
+struct NaNKeys {
+    bool remap;
+    uint32_t lo;
+    uint32_t hi;
+};
+
+static NaNKeys nanKeys(NaNPolicy policy) {
+    switch (policy) {
+    case NaNPolicy::Propagate: return {true, 0u, ~0u};
+    case NaNPolicy::Ignore:    return {true, ~0u, 0u};
+    default:                   return {false, 0u, 0u};
+    }
+}
+
+static KeyRange keyRange(const FP32* x, size_t n, NaNKeys nan) {
+    uint32_t lo[ORDER_LANES];
+    uint32_t hi[ORDER_LANES];
+    std::fill_n(lo, ORDER_LANES, ~0u);
+    std::fill_n(hi, ORDER_LANES, 0u);
+
+    size_t i = 0;
+    for (; i + ORDER_LANES <= n; i += ORDER_LANES) {
+        for (size_t l = 0; l < ORDER_LANES; ++l) {
+            uint32_t bits = x[i + l].bits();
+            uint32_t key = Format::orderKey(bits);
+            bool is_nan = nan.remap && Format::isNaN(bits);
+            lo[l] = std::min(lo[l], is_nan ? nan.lo : key);
+            hi[l] = std::max(hi[l], is_nan ? nan.hi : key);
+        }
+    }
+    for (; i < n; ++i) {
+        uint32_t bits = x[i].bits();
+        uint32_t key = Format::orderKey(bits);
+        bool is_nan = nan.remap && Format::isNaN(bits);
+        lo[0] = std::min(lo[0], is_nan ? nan.lo : key);
+        hi[0] = std::max(hi[0], is_nan ? nan.hi : key);
+    }
+
+    KeyRange range = {lo[0], hi[0]};
+    for (size_t l = 1; l < ORDER_LANES; ++l) {
+        range.lo = std::min(range.lo, lo[l]);
+        range.hi = std::max(range.hi, hi[l]);
+    }
+    return range;
+}
+
+static KeyRange keyRange(const FP32* x, size_t n, NaNPolicy policy) {
+    NaNKeys nan = nanKeys(policy);
+    return parallelReduce(n, RANGE_GRAIN, KeyRange{~0u, 0u},
+        [=](size_t begin, size_t end) { return keyRange(x + begin, end - begin, nan); },
+        [](KeyRange a, KeyRange b) { return KeyRange{std::min(a.lo, b.lo), std::max(a.hi, b.hi)}; });
+}
+
+// first index where match(bits) holds, n if none. whole blocks are tested
+// at once and only the one that hits is searched element by element
+template <typename Match>
+static size_t findFirst(const FP32* x, size_t n, Match match) {
+    size_t i = 0;
+    for (; i + ORDER_LANES <= n; i += ORDER_LANES) {
+        unsigned hits = 0;
+        for (size_t l = 0; l < ORDER_LANES; ++l) hits |= match(x[i + l].bits());
+        if (hits) break;
+    }
+    for (; i < n; ++i) {
+        if (match(x[i].bits())) return i;
+    }
+    return n;
+}
+
+template <bool MAX>
+static size_t argExtreme(const FP32* x, size_t n, NaNPolicy policy) {
+    if (n == 0) return n;
+
+    KeyRange range = keyRange(x, n, policy);
+    uint32_t target = Format::fromOrderKey(MAX ? range.hi : range.lo);
+    if (policy == NaNPolicy::Total || !Format::isNaN(target)) {
+        return findFirst(x, n, [=](uint32_t bits) { return bits == target; });
+    }
+
+    // a nan won: the first one under Propagate, and under Ignore it means
+    // every element is nan
+    if (policy == NaNPolicy::Ignore) return n;
+    return findFirst(x, n, [](uint32_t bits) { return Format::isNaN(bits); });
+}
+
+size_t argmin(const FP32* x, size_t n, NaNPolicy policy) {
+    return argExtreme<false>(x, n, policy);
+}
+
+size_t argmax(const FP32* x, size_t n, NaNPolicy policy) {
+    return argExtreme<true>(x, n, policy);
+}
+
+std::pair<FP32, FP32> minmax(const FP32* x, size_t n, NaNPolicy policy) {
+    if (n == 0) return {FP32::nan(), FP32::nan()};
+
+    KeyRange range = keyRange(x, n, policy);
+    FP32 lo = FP32::fromBits(Format::fromOrderKey(range.lo));
+    FP32 hi = FP32::fromBits(Format::fromOrderKey(range.hi));
+    if (policy != NaNPolicy::Total && (lo.isNaN() || hi.isNaN())) return {FP32::nan(), FP32::nan()};
+    return {lo, hi};
+}
+
+void clamp(const FP32* src, FP32* dst, size_t n, FP32 lo, FP32 hi, NaNPolicy policy) {
+    uint32_t key_lo = Format::orderKey(lo.bits());
+    uint32_t key_hi = Format::orderKey(hi.bits());
+    if (lo.isNaN() || hi.isNaN() || key_lo > key_hi) {
+        throw std::invalid_argument("clamp: lo and hi must be numbers with lo <= hi");
+    }
+
+    bool keep_nan = policy != NaNPolicy::Total;
+    auto one = [=](uint32_t bits) {
+        uint32_t key = std::min(std::max(Format::orderKey(bits), key_lo), key_hi);
+        return keep_nan && Format::isNaN(bits) ? bits : Format::fromOrderKey(key);
+    };
+    parallelChunks(n, CLAMP_GRAIN, [=](size_t begin, size_t end) {
+        size_t i = begin;
+        for (; i + ORDER_LANES <= end; i += ORDER_LANES) {
+            uint32_t out[ORDER_LANES];
+            for (size_t l = 0; l < ORDER_LANES; ++l) out[l] = one(src[i + l].bits());
+            std::memcpy(static_cast<void*>(dst + i), out, sizeof(out));
+        }
+        for (; i < end; ++i) dst[i] = FP32::fromBits(one(src[i].bits()));
+    });
+}
+
+// lsd radix sort on the keys, three 11-bit digits. one pass builds the
+// keys and all three histograms; a digit every key shares is skipped
+
+static constexpr int DIGIT_BITS = 11;
+static constexpr int DIGITS = 3;
+static constexpr size_t BUCKETS = size_t(1) << DIGIT_BITS;
+
+// below this many keys, clearing and scanning the buckets costs more than
+// comparison sorting the keys
+static constexpr size_t RADIX_MIN = 2048;
+
+void sort(FP32* x, size_t n, NaNPolicy policy) {
+    if (n < 2) return;
+
+    // under Propagate / Ignore the nans are packed at the front while the
+    // keys are built (never ahead of the read), then moved to the back
+    const bool radix = n >= RADIX_MIN;
+    std::vector<uint32_t> keys(n);
+    std::vector<size_t> count(radix ? DIGITS * BUCKETS : 0, 0);
+    bool keep_nan = policy != NaNPolicy::Total;
+    size_t nans = 0;
+    size_t m = 0;
+    for (size_t i = 0; i < n; ++i) {
+        uint32_t bits = x[i].bits();
+        if (keep_nan && Format::isNaN(bits)) {
+            x[nans++] = x[i];
+            continue;
+        }
+        uint32_t key = Format::orderKey(bits);
+        keys[m++] = key;
+        if (!radix) continue;
+        for (int d = 0; d < DIGITS; ++d) {
+            count[d * BUCKETS + ((key >> (d * DIGIT_BITS)) & (BUCKETS - 1))]++;
+        }
+    }
+    std::memmove(x + m, x, nans * sizeof(FP32));
+
+    // an odd number of radix passes leaves the keys in scratch
+    std::vector<uint32_t> scratch(radix ? m : 0);
+    uint32_t* from = keys.data();
+    uint32_t* to = scratch.data();
+    if (!radix) std::sort(from, from + m);
+    for (int d = 0; radix && d < DIGITS && m > 1; ++d) {
+        size_t* digit_count = &count[d * BUCKETS];
+        int shift = d * DIGIT_BITS;
+        if (digit_count[(from[0] >> shift) & (BUCKETS - 1)] == m) continue;
+
+        size_t offset = 0;
+        for (size_t b = 0; b < BUCKETS; ++b) {
+            size_t c = digit_count[b];
+            digit_count[b] = offset;
+            offset += c;
+        }
+        for (size_t i = 0; i < m; ++i) {
+            to[digit_count[(from[i] >> shift) & (BUCKETS - 1)]++] = from[i];
+        }
+        std::swap(from, to);
+    }
+
+    for (size_t i = 0; i < m; ++i) x[i] = FP32::fromBits(Format::fromOrderKey(from[i]));
+}
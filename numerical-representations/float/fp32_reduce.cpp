@@ -0,0 +1,560 @@
+#include "FP32Reduce.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <limits>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define FP32_X86 1
+#include <immintrin.h>
+#endif
+
+// under Preserve the strategies run on hardware float. IEEE single
+// precision rounds every add and product to nearest even with gradual
+// underflow, exactly as the FP32 operators do, so the same operations in
+// the same order give the operator bits. only nans differ, the hardware
+// keeps payloads and signs, so reduce() returns the canonical FP32 nan
+// for any nan result. Flush runs the operators themselves.
+//
+// every hardware kernel keeps SUMMATION_LANES lanes whatever the simd
+// width, element i of a chunk in lane i % 16. the simd kernels run the
+// whole rows and hand a short last row to the scalar steps, so every level
+// updates the same lanes in the same order and folds them as the same
+// tree. this file is built with -ffp-contract=off: a fused multiply-add
+// would round a product once less
+
+// chunk results are added in double, in index order
+static constexpr size_t REDUCE_GRAIN = chunkElements(2 * sizeof(FP32));
+static_assert(REDUCE_GRAIN % SUMMATION_BLOCK == 0, "chunks hold whole pairwise blocks");
+
+// hardware float only stands in for the operators when it evaluates in
+// float itself (not x87 extended precision)
+static constexpr bool HARDWARE_FLOAT = FLT_EVAL_METHOD == 0 && std::numeric_limits<float>::is_iec559;
+
+typedef double (*ReduceKernel)(const FP32*, const FP32*, size_t);
+typedef float (*BlockKernel)(const FP32*, const FP32*, size_t);
+
+// lane l absorbs lane l + width, halving the width each round
+template <typename T>
+static T foldLanes(T* lanes) {
+    for (size_t width = SUMMATION_LANES / 2; width > 0; width /= 2) {
+        for (size_t l = 0; l < width; ++l) {
+            lanes[l] = lanes[l] + lanes[l + width];
+        }
+    }
+    return lanes[0];
+}
+
+// operator kernels, for Flush
+
+// element i of the sum, or x[i] * y[i] rounded like operator*
+template <bool DOT>
+static FP32 term(const FP32* x, const FP32* y, size_t i) {
+    return DOT ? x[i] * y[i] : x[i];
+}
+
+template <bool DOT>
+static double naive(const FP32* x, const FP32* y, size_t n) {
+    FP32 acc;
+    for (size_t i = 0; i < n; ++i) {
+        acc += term<DOT>(x, y, i);
+    }
+    return acc.toDouble();
+}
+
+// n <= SUMMATION_BLOCK terms, one short naive sum per lane
+template <bool DOT>
+static FP32 pairwiseBlock(const FP32* x, const FP32* y, size_t n) {
+    FP32 lanes[SUMMATION_LANES];
+    for (size_t i = 0; i < n; ++i) {
+        lanes[i % SUMMATION_LANES] += term<DOT>(x, y, i);
+    }
+    return foldLanes(lanes);
+}
+
+template <bool DOT>
+static double pairwise(const FP32* x, const FP32* y, size_t n) {
+    // a binary counter over the block sums: block k merges once for every
+    // trailing zero bit of k, which builds the tree left to right
+    FP32 stack[64];
+    size_t top = 0;
+    size_t count = 1;
+    for (size_t i = 0; i < n; i += SUMMATION_BLOCK, ++count) {
+        stack[top++] = pairwiseBlock<DOT>(x + i, y + i, std::min(SUMMATION_BLOCK, n - i));
+        for (size_t m = count; (m & 1) == 0; m >>= 1) {
+            --top;
+            stack[top - 1] += stack[top];
+        }
+    }
+    while (top > 1) {
+        --top;
+        stack[top - 1] += stack[top];
+    }
+    return top ? stack[0].toDouble() : 0.0;
+}
+
+template <bool DOT>
+static double kahan(const FP32* x, const FP32* y, size_t n) {
+    FP32 sum[SUMMATION_LANES];
+    FP32 compensation[SUMMATION_LANES];
+    for (size_t i = 0; i < n; ++i) {
+        size_t l = i % SUMMATION_LANES;
+        FP32 corrected = term<DOT>(x, y, i) - compensation[l];
+        FP32 t = sum[l] + corrected;
+        compensation[l] = (t - sum[l]) - corrected;
+        sum[l] = t;
+    }
+
+    double lanes[SUMMATION_LANES];
+    for (size_t l = 0; l < SUMMATION_LANES; ++l) {
+        lanes[l] = sum[l].toDouble() - compensation[l].toDouble();
+    }
+    return foldLanes(lanes);
+}
+
+template <bool DOT>
+static double neumaier(const FP32* x, const FP32* y, size_t n) {
+    FP32 sum[SUMMATION_LANES];
+    FP32 compensation[SUMMATION_LANES];
+    for (size_t i = 0; i < n; ++i) {
+        size_t l = i % SUMMATION_LANES;
+        FP32 v = term<DOT>(x, y, i);
+        FP32 t = sum[l] + v;
+        // the smaller operand lost its low bits
+        if (sum[l].abs() >= v.abs()) {
+            compensation[l] += (sum[l] - t) + v;
+        } else {
+            compensation[l] += (v - t) + sum[l];
+        }
+        sum[l] = t;
+    }
+
+    double lanes[SUMMATION_LANES];
+    for (size_t l = 0; l < SUMMATION_LANES; ++l) {
+        lanes[l] = sum[l].toDouble() + compensation[l].toDouble();
+    }
+    return foldLanes(lanes);
+}
+
+// scalar hardware kernels, and the steps the simd kernels finish a short
+// row with
+
+template <bool DOT>
+static inline float termScalar(const FP32* x, const FP32* y, size_t i) {
+    return DOT ? x[i].toFloat() * y[i].toFloat() : x[i].toFloat();
+}
+
+static inline void kahanStep(float& sum, float& compensation, float v) {
+    float corrected = v - compensation;
+    float t = sum + corrected;
+    compensation = (t - sum) - corrected;
+    sum = t;
+}
+
+static inline void neumaierStep(float& sum, float& compensation, float v) {
+    float t = sum + v;
+    compensation += std::fabs(sum) >= std::fabs(v) ? (sum - t) + v : (v - t) + sum;
+    sum = t;
+}
+
+// one row of lanes at i, short if it is the last
+template <bool DOT>
+static void pairwiseRow(float* lanes, const FP32* x, const FP32* y, size_t i, size_t n) {
+    for (size_t l = 0; l < SUMMATION_LANES && i + l < n; ++l) lanes[l] += termScalar<DOT>(x, y, i + l);
+}
+
+template <bool DOT>
+static void kahanRow(float* sum, float* compensation, const FP32* x, const FP32* y, size_t i, size_t n) {
+    for (size_t l = 0; l < SUMMATION_LANES && i + l < n; ++l) kahanStep(sum[l], compensation[l], termScalar<DOT>(x, y, i + l));
+}
+
+template <bool DOT>
+static void neumaierRow(float* sum, float* compensation, const FP32* x, const FP32* y, size_t i, size_t n) {
+    for (size_t l = 0; l < SUMMATION_LANES && i + l < n; ++l) neumaierStep(sum[l], compensation[l], termScalar<DOT>(x, y, i + l));
+}
+
+template <bool DOT>
+static void widenedRow(double* lanes, const FP32* x, const FP32* y, size_t i, size_t n) {
+    // a product of two floats has at most 48 significant bits, exact in double
+    for (size_t l = 0; l < SUMMATION_LANES && i + l < n; ++l) {
+        lanes[l] += DOT ? x[i + l].toDouble() * y[i + l].toDouble() : x[i + l].toDouble();
+    }
+}
+
+static double kahanFold(const float* sum, const float* compensation) {
+    double lanes[SUMMATION_LANES];
+    for (size_t l = 0; l < SUMMATION_LANES; ++l) {
+        lanes[l] = static_cast<double>(sum[l]) - static_cast<double>(compensation[l]);
+    }
+    return foldLanes(lanes);
+}
+
+static double neumaierFold(const float* sum, const float* compensation) {
+    double lanes[SUMMATION_LANES];
+    for (size_t l = 0; l < SUMMATION_LANES; ++l) {
+        lanes[l] = static_cast<double>(sum[l]) + static_cast<double>(compensation[l]);
+    }
+    return foldLanes(lanes);
+}
+
+template <bool DOT>
+static double naiveScalar(const FP32* x, const FP32* y, size_t n) {
+    float acc = 0.0f;
+    for (size_t i = 0; i < n; ++i) {
+        acc += termScalar<DOT>(x, y, i);
+    }
+    return acc;
+}
+
+template <bool DOT>
+static float pairwiseBlockScalar(const FP32* x, const FP32* y, size_t n) {
+    float lanes[SUMMATION_LANES] = {};
+    for (size_t i = 0; i < n; i += SUMMATION_LANES) pairwiseRow<DOT>(lanes, x, y, i, n);
+    return foldLanes(lanes);
+}
+
+template <bool DOT>
+static double kahanScalar(const FP32* x, const FP32* y, size_t n) {
+    float sum[SUMMATION_LANES] = {};
+    float compensation[SUMMATION_LANES] = {};
+    for (size_t i = 0; i < n; i += SUMMATION_LANES) kahanRow<DOT>(sum, compensation, x, y, i, n);
+    return kahanFold(sum, compensation);
+}
+
+template <bool DOT>
+static double neumaierScalar(const FP32* x, const FP32* y, size_t n) {
+    float sum[SUMMATION_LANES] = {};
+    float compensation[SUMMATION_LANES] = {};
+    for (size_t i = 0; i < n; i += SUMMATION_LANES) neumaierRow<DOT>(sum, compensation, x, y, i, n);
+    return neumaierFold(sum, compensation);
+}
+
+template <bool DOT>
+static double widenedScalar(const FP32* x, const FP32* y, size_t n) {
+    double lanes[SUMMATION_LANES] = {};
+    for (size_t i = 0; i < n; i += SUMMATION_LANES) widenedRow<DOT>(lanes, x, y, i, n);
+    return foldLanes(lanes);
+}
+
+// the block sums of a chunk as in pairwise above, in hardware float
+template <BlockKernel BLOCK>
+static double pairwiseBlocks(const FP32* x, const FP32* y, size_t n) {
+    float stack[64];
+    size_t top = 0;
+    size_t count = 1;
+    for (size_t i = 0; i < n; i += SUMMATION_BLOCK, ++count) {
+        stack[top++] = BLOCK(x + i, y + i, std::min(SUMMATION_BLOCK, n - i));
+        for (size_t m = count; (m & 1) == 0; m >>= 1) {
+            --top;
+            stack[top - 1] += stack[top];
+        }
+    }
+    while (top > 1) {
+        --top;
+        stack[top - 1] += stack[top];
+    }
+    return top ? stack[0] : 0.0;
+}
+
+#ifdef FP32_X86
+
+// avx2: the 16 lanes are two float registers, lanes 0-7 and 8-15, or four
+// double registers for Widened
+
+template <bool DOT>
+__attribute__((target("avx2,fma")))
+static inline __m256 termAVX2(const FP32* x, const FP32* y, size_t i) {
+    __m256 v = _mm256_loadu_ps(reinterpret_cast<const float*>(x + i));
+    if (!DOT) return v;
+    return _mm256_mul_ps(v, _mm256_loadu_ps(reinterpret_cast<const float*>(y + i)));
+}
+
+template <bool DOT>
+__attribute__((target("avx2,fma")))
+static inline __m256d termAVX2d(const FP32* x, const FP32* y, size_t i) {
+    __m256d v = _mm256_cvtps_pd(_mm_loadu_ps(reinterpret_cast<const float*>(x + i)));
+    if (!DOT) return v;
+    return _mm256_mul_pd(v, _mm256_cvtps_pd(_mm_loadu_ps(reinterpret_cast<const float*>(y + i))));
+}
+
+template <bool DOT>
+__attribute__((target("avx2,fma")))
+static float pairwiseBlockAVX2(const FP32* x, const FP32* y, size_t n) {
+    __m256 acc[2] = {_mm256_setzero_ps(), _mm256_setzero_ps()};
+    size_t i = 0;
+    for (; i + SUMMATION_LANES <= n; i += SUMMATION_LANES) {
+        for (size_t h = 0; h < 2; ++h) acc[h] = _mm256_add_ps(acc[h], termAVX2<DOT>(x, y, i + 8 * h));
+    }
+    float lanes[SUMMATION_LANES];
+    _mm256_storeu_ps(lanes, acc[0]);
+    _mm256_storeu_ps(lanes + 8, acc[1]);
+    pairwiseRow<DOT>(lanes, x, y, i, n);
+    return foldLanes(lanes);
+}
+
+template <bool DOT>
+__attribute__((target("avx2,fma")))
+static double kahanAVX2(const FP32* x, const FP32* y, size_t n) {
+    __m256 sum[2] = {_mm256_setzero_ps(), _mm256_setzero_ps()};
+    __m256 compensation[2] = {_mm256_setzero_ps(), _mm256_setzero_ps()};
+    size_t i = 0;
+    for (; i + SUMMATION_LANES <= n; i += SUMMATION_LANES) {
+        for (size_t h = 0; h < 2; ++h) {
+            __m256 corrected = _mm256_sub_ps(termAVX2<DOT>(x, y, i + 8 * h), compensation[h]);
+            __m256 t = _mm256_add_ps(sum[h], corrected);
+            compensation[h] = _mm256_sub_ps(_mm256_sub_ps(t, sum[h]), corrected);
+            sum[h] = t;
+        }
+    }
+    float s[SUMMATION_LANES];
+    float c[SUMMATION_LANES];
+    for (size_t h = 0; h < 2; ++h) {
+        _mm256_storeu_ps(s + 8 * h, sum[h]);
+        _mm256_storeu_ps(c + 8 * h, compensation[h]);
+    }
+    kahanRow<DOT>(s, c, x, y, i, n);
+    return kahanFold(s, c);
+}
+
+template <bool DOT>
+__attribute__((target("avx2,fma")))
+static double neumaierAVX2(const FP32* x, const FP32* y, size_t n) {
+    const __m256 magnitude = _mm256_castsi256_ps(_mm256_set1_epi32(0x7FFFFFFF));
+    __m256 sum[2] = {_mm256_setzero_ps(), _mm256_setzero_ps()};
+    __m256 compensation[2] = {_mm256_setzero_ps(), _mm256_setzero_ps()};
+    size_t i = 0;
+    for (; i + SUMMATION_LANES <= n; i += SUMMATION_LANES) {
+        for (size_t h = 0; h < 2; ++h) {
+            __m256 v = termAVX2<DOT>(x, y, i + 8 * h);
+            __m256 t = _mm256_add_ps(sum[h], v);
+            __m256 sum_larger = _mm256_cmp_ps(_mm256_and_ps(sum[h], magnitude), _mm256_and_ps(v, magnitude), _CMP_GE_OQ);
+            __m256 from_sum = _mm256_add_ps(_mm256_sub_ps(sum[h], t), v);
+            __m256 from_term = _mm256_add_ps(_mm256_sub_ps(v, t), sum[h]);
+            compensation[h] = _mm256_add_ps(compensation[h], _mm256_blendv_ps(from_term, from_sum, sum_larger));
+            sum[h] = t;
+        }
+    }
+    float s[SUMMATION_LANES];
+    float c[SUMMATION_LANES];
+    for (size_t h = 0; h < 2; ++h) {
+        _mm256_storeu_ps(s + 8 * h, sum[h]);
+        _mm256_storeu_ps(c + 8 * h, compensation[h]);
+    }
+    neumaierRow<DOT>(s, c, x, y, i, n);
+    return neumaierFold(s, c);
+}
+
+template <bool DOT>
+__attribute__((target("avx2,fma")))
+static double widenedAVX2(const FP32* x, const FP32* y, size_t n) {
+    __m256d acc[4] = {_mm256_setzero_pd(), _mm256_setzero_pd(), _mm256_setzero_pd(), _mm256_setzero_pd()};
+    size_t i = 0;
+    for (; i + SUMMATION_LANES <= n; i += SUMMATION_LANES) {
+        for (size_t q = 0; q < 4; ++q) acc[q] = _mm256_add_pd(acc[q], termAVX2d<DOT>(x, y, i + 4 * q));
+    }
+    double lanes[SUMMATION_LANES];
+    for (size_t q = 0; q < 4; ++q) _mm256_storeu_pd(lanes + 4 * q, acc[q]);
+    widenedRow<DOT>(lanes, x, y, i, n);
+    return foldLanes(lanes);
+}
+
+// gcc 12 flags the _mm512_undefined_* placeholders inside its own headers
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#pragma GCC diagnostic ignored "-Wuninitialized"
+#endif
+
+// avx512: one float register holds all 16 lanes, two double registers
+
+template <bool DOT>
+__attribute__((target("avx512f,avx512bw,avx512vl")))
+static inline __m512 termAVX512(const FP32* x, const FP32* y, size_t i) {
+    __m512 v = _mm512_loadu_ps(x + i);
+    if (!DOT) return v;
+    return _mm512_mul_ps(v, _mm512_loadu_ps(y + i));
+}
+
+template <bool DOT>
+__attribute__((target("avx512f,avx512bw,avx512vl")))
+static inline __m512d termAVX512d(const FP32* x, const FP32* y, size_t i) {
+    __m512d v = _mm512_cvtps_pd(_mm256_loadu_ps(reinterpret_cast<const float*>(x + i)));
+    if (!DOT) return v;
+    return _mm512_mul_pd(v, _mm512_cvtps_pd(_mm256_loadu_ps(reinterpret_cast<const float*>(y + i))));
+}
+
+template <bool DOT>
+__attribute__((target("avx512f,avx512bw,avx512vl")))
+static float pairwiseBlockAVX512(const FP32* x, const FP32* y, size_t n) {
+    __m512 acc = _mm512_setzero_ps();
+    size_t i = 0;
+    for (; i + SUMMATION_LANES <= n; i += SUMMATION_LANES) acc = _mm512_add_ps(acc, termAVX512<DOT>(x, y, i));
+    float lanes[SUMMATION_LANES];
+    _mm512_storeu_ps(lanes, acc);
+    pairwiseRow<DOT>(lanes, x, y, i, n);
+    return foldLanes(lanes);
+}
+
+template <bool DOT>
+__attribute__((target("avx512f,avx512bw,avx512vl")))
+static double kahanAVX512(const FP32* x, const FP32* y, size_t n) {
+    __m512 sum = _mm512_setzero_ps();
+    __m512 compensation = _mm512_setzero_ps();
+    size_t i = 0;
+    for (; i + SUMMATION_LANES <= n; i += SUMMATION_LANES) {
+        __m512 corrected = _mm512_sub_ps(termAVX512<DOT>(x, y, i), compensation);
+        __m512 t = _mm512_add_ps(sum, corrected);
+        compensation = _mm512_sub_ps(_mm512_sub_ps(t, sum), corrected);
+        sum = t;
+    }
+    float s[SUMMATION_LANES];
+    float c[SUMMATION_LANES];
+    _mm512_storeu_ps(s, sum);
+    _mm512_storeu_ps(c, compensation);
+    kahanRow<DOT>(s, c, x, y, i, n);
+    return kahanFold(s, c);
+}
+
+template <bool DOT>
+__attribute__((target("avx512f,avx512bw,avx512vl")))
+static double neumaierAVX512(const FP32* x, const FP32* y, size_t n) {
+    __m512 sum = _mm512_setzero_ps();
+    __m512 compensation = _mm512_setzero_ps();
+    size_t i = 0;
+    for (; i + SUMMATION_LANES <= n; i += SUMMATION_LANES) {
+        __m512 v = termAVX512<DOT>(x, y, i);
+        __m512 t = _mm512_add_ps(sum, v);
+        __mmask16 sum_larger = _mm512_cmp_ps_mask(_mm512_abs_ps(sum), _mm512_abs_ps(v), _CMP_GE_OQ);
+        __m512 from_sum = _mm512_add_ps(_mm512_sub_ps(sum, t), v);
+        __m512 from_term = _mm512_add_ps(_mm512_sub_ps(v, t), sum);
+        compensation = _mm512_add_ps(compensation, _mm512_mask_blend_ps(sum_larger, from_term, from_sum));
+        sum = t;
+    }
+    float s[SUMMATION_LANES];
+    float c[SUMMATION_LANES];
+    _mm512_storeu_ps(s, sum);
+    _mm512_storeu_ps(c, compensation);
+    neumaierRow<DOT>(s, c, x, y, i, n);
+    return neumaierFold(s, c);
+}
+
+template <bool DOT>
+__attribute__((target("avx512f,avx512bw,avx512vl")))
+static double widenedAVX512(const FP32* x, const FP32* y, size_t n) {
+    __m512d acc[2] = {_mm512_setzero_pd(), _mm512_setzero_pd()};
+    size_t i = 0;
+    for (; i + SUMMATION_LANES <= n; i += SUMMATION_LANES) {
+        for (size_t h = 0; h < 2; ++h) acc[h] = _mm512_add_pd(acc[h], termAVX512d<DOT>(x, y, i + 8 * h));
+    }
+    double lanes[SUMMATION_LANES];
+    _mm512_storeu_pd(lanes, acc[0]);
+    _mm512_storeu_pd(lanes + 8, acc[1]);
+    widenedRow<DOT>(lanes, x, y, i, n);
+    return foldLanes(lanes);
+}
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+#endif // FP32_X86
+
+// dispatch. Flush and the counted build take the operator kernels, except
+// Widened, which sums the stored values either way; neon stays on the
+// scalar kernels
+
+template <bool DOT>
+static ReduceKernel reduceKernel(Summation method, SubnormalMode mode, SimdLevel level) {
+    if (mode == SubnormalMode::Flush || FloatCounters::ENABLED || !HARDWARE_FLOAT) {
+        switch (method) {
+        case Summation::Naive:    return naive<DOT>;
+        case Summation::Pairwise: return pairwise<DOT>;
+        case Summation::Kahan:    return kahan<DOT>;
+        case Summation::Neumaier: return neumaier<DOT>;
+        default:                  break;
+        }
+    }
+    if (!simdLevelSupported(level)) level = SimdLevel::Scalar;
+
+    switch (level) {
+#ifdef FP32_X86
+    case SimdLevel::AVX2:
+        switch (method) {
+        case Summation::Naive:    return naiveScalar<DOT>;
+        case Summation::Pairwise: return pairwiseBlocks<pairwiseBlockAVX2<DOT>>;
+        case Summation::Kahan:    return kahanAVX2<DOT>;
+        case Summation::Neumaier: return neumaierAVX2<DOT>;
+        default:                  return widenedAVX2<DOT>;
+        }
+    case SimdLevel::AVX512:
+    case SimdLevel::AVX512BF16:
+        switch (method) {
+        case Summation::Naive:    return naiveScalar<DOT>;
+        case Summation::Pairwise: return pairwiseBlocks<pairwiseBlockAVX512<DOT>>;
+        case Summation::Kahan:    return kahanAVX512<DOT>;
+        case Summation::Neumaier: return neumaierAVX512<DOT>;
+        default:                  return widenedAVX512<DOT>;
+        }
+#endif
+    default:
+        switch (method) {
+        case Summation::Naive:    return naiveScalar<DOT>;
+        case Summation::Pairwise: return pairwiseBlocks<pairwiseBlockScalar<DOT>>;
+        case Summation::Kahan:    return kahanScalar<DOT>;
+        case Summation::Neumaier: return neumaierScalar<DOT>;
+        default:                  return widenedScalar<DOT>;
+        }
+    }
+}
+
+template <bool DOT>
+static double reduce(Summation method, SimdLevel level, const FP32* x, const FP32* y, size_t n) {
+    // read here, the pool threads have their own
+    SubnormalMode mode = subnormalMode();
+    ReduceKernel kernel = reduceKernel<DOT>(method, mode, level);
+
+    double result;
+    if (method == Summation::Naive) {
+        // one pass on the calling thread, the same bits as an operator+= loop
+        result = kernel(x, y, n);
+    } else if (n <= REDUCE_GRAIN) {
+        // a single chunk skips the partials vector, same bits
+        result = 0.0 + kernel(x, y, n);
+    } else {
+        result = parallelReduce(n, REDUCE_GRAIN, 0.0,
+                                [=](size_t begin, size_t end) {
+                                    SubnormalScope scope(mode);
+                                    return kernel(x + begin, y + begin, end - begin);
+                                },
+                                [](double a, double b) { return a + b; });
+    }
+    return std::isnan(result) ? FP32::nan().toDouble() : result;
+}
+
+FP32 sum(const FP32* x, size_t n, Summation method, SimdLevel level) {
+    return FP32(reduce<false>(method, level, x, x, n));
+}
+
+FP32 dot(const FP32* x, const FP32* y, size_t n, Summation method, SimdLevel level) {
+    return FP32(reduce<true>(method, level, x, y, n));
+}
+
+FP32 sum(const FP32* x, size_t n, Summation method) {
+    return sum(x, n, method, detectSimdLevel());
+}
+
+FP32 mean(const FP32* x, size_t n, Summation method) {
+    if (n == 0) return FP32::nan();
+    return FP32(reduce<false>(method, detectSimdLevel(), x, x, n) / static_cast<double>(n));
+}
+
+FP32 norm2(const FP32* x, size_t n, Summation method) {
+    // double has more than 2 * 24 + 2 bits, so rounding its sqrt to float
+    // is the correctly rounded sqrt of the sum
+    return FP32(std::sqrt(reduce<true>(method, detectSimdLevel(), x, x, n)));
+}
+
+FP32 dot(const FP32* x, const FP32* y, size_t n, Summation method) {
+    return dot(x, y, n, method, detectSimdLevel());
+}
@@ -1,7 +1,35 @@
+#include "Counters.h"
 #include "FP32.h"
+#include "FP32Expr.h"
+#include "FP32Order.h"
+#include "FP32Reduce.h"
+#include "FP32Vector.h"
+#include "MethodBench.h"
+#include "SmallFloat.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <atomic>
 #include <iostream>
 #include <iomanip>
 #include <cassert>
+#include <cmath>
+#include <random>
+#include <sstream>
+#include <string>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <stdexcept>
+#include <vector>
+#ifdef __SSE2__
+#include <xmmintrin.h>
+
+#ifdef __linux__
+#include <sched.h>
+#endif
+#endif
 
 void testConstruction() {
     std::cout << "\nConstruction" << std::endl;
@@ -196,6 +224,1108 @@ void testPrecisionLoss() {
     std::cout << a << " - " << b << " = " << result << std::endl;
 }
 
+void testFMA() {
+    std::cout << "\nFused Multiply-Add" << std::endl;
+    
+    // (1 + 2^-23)^2 = 1 + 2^-22 + 2^-46, the 2^-46 term is lost by a separate multiply
+    FP32 a = FP32::fromBits(0x3F800001u);
+    FP32 c = FP32::fromBits(0xBF800002u); // -(1 + 2^-22)
+    FP32 fused = fma(a, a, c);
+    FP32 separate = a * a + c;
+    
+    std::cout << std::scientific << std::setprecision(6);
+    std::cout << "fma(a, a, c) = " << fused << " (expected: 2^-46 = 1.421085e-14)" << std::endl;
+    std::cout << "a * a + c    = " << separate << " (double rounding)" << std::endl;
+    assert(fused.bits() == FP32(std::ldexp(1.0f, -46)).bits());
+    assert(separate.isZero());
+    
+    // agrees with the hardware fma on random operands
+    std::mt19937 rng(7);
+    int checked = 0;
+    for (int i = 0; i < 200000; ++i) {
+        FP32 x = FP32::fromBits(rng());
+        FP32 y = FP32::fromBits(rng());
+        FP32 z = FP32::fromBits(rng());
+        float expected = std::fma(x.toFloat(), y.toFloat(), z.toFloat());
+        FP32 result = fma(x, y, z);
+        assert(result.bits() == FP32(expected).bits() || (result.isNaN() && std::isnan(expected)));
+        checked++;
+    }
+    std::cout << checked << " random fma results match std::fma" << std::endl;
+    
+    // special values
+    FP32 inf = FP32::infinity(false);
+    FP32 zero = FP32::zero();
+    FP32 one(1.0f);
+    assert(fma(inf, zero, one).isNaN());
+    assert(fma(inf, one, -inf).isNaN());
+    assert(fma(zero, one, -zero).bits() == zero.bits());
+    assert(fma(-zero, one, -zero).bits() == (-zero).bits());
+}
+
+void testAddRounding() {
+    std::cout << "\nAddition Rounding" << std::endl;
+    
+    // random pairs against hardware addition, with half the pairs close
+    // to cancelling and a third sharing an exponent
+    std::mt19937 rng(7);
+    size_t mismatches = 0;
+    const size_t trials = 1000000;
+    for (size_t i = 0; i < trials; ++i) {
+        uint32_t x = rng();
+        uint32_t y = (i & 1) ? (x ^ 0x80000000u) + (rng() % 65536) - 32768 : rng();
+        if (i % 3 == 0) y = (y & 0x807FFFFFu) | (x & 0x7F800000u);
+        
+        FP32 a = FP32::fromBits(x);
+        FP32 b = FP32::fromBits(y);
+        float expected = a.toFloat() + b.toFloat();
+        FP32 got = a + b;
+        if (std::isnan(expected) ? !got.isNaN() : got.bits() != FP32(expected).bits()) {
+            mismatches++;
+        }
+    }
+    assert(mismatches == 0);
+    
+    // operands far apart still round on the bits that were shifted out
+    FP32 one(1.0f);
+    FP32 tiny = FP32::fromBits(0x33800001u); // just over half an ulp of 1
+    assert((one + tiny).bits() == 0x3F800001u);
+    
+    // signed zeros and the subnormal / normal boundary
+    assert((FP32(0.0f) + FP32(-0.0f)).bits() == 0x00000000u);
+    assert((FP32(-0.0f) + FP32(-0.0f)).bits() == 0x80000000u);
+    assert((FP32(1.5f) - FP32(1.5f)).bits() == 0x00000000u);
+    assert((FP32::fromBits(0x007FFFFFu) + FP32::fromBits(0x00000001u)).bits() == 0x00800000u);
+    assert((FP32::fromBits(0x00800000u) - FP32::fromBits(0x00000001u)).bits() == 0x007FFFFFu);
+    
+    std::cout << std::dec << trials << " random sums match hardware addition" << std::endl;
+}
+
+void testDivideRounding() {
+    std::cout << "\nDivision Rounding" << std::endl;
+    
+    // random bit patterns against hardware division, specials and
+    // subnormals included, plus quotients that land in the subnormal range
+    std::mt19937 rng(11);
+    size_t mismatches = 0;
+    const size_t trials = 1000000;
+    for (size_t i = 0; i < trials; ++i) {
+        uint32_t x = rng();
+        uint32_t y = rng();
+        if (i % 4 == 0) x &= 0x807FFFFFu;                            // subnormal dividend
+        if (i % 4 == 1) x = (x & 0x80FFFFFFu) | 0x01000000u;      // quotient near the bottom
+        
+        FP32 a = FP32::fromBits(x);
+        FP32 b = FP32::fromBits(y);
+        float expected = a.toFloat() / b.toFloat();
+        FP32 got = a / b;
+        if (std::isnan(expected) ? !got.isNaN() : got.bits() != FP32(expected).bits()) {
+            mismatches++;
+        }
+    }
+    assert(mismatches == 0);
+    
+    // the remainder decides ties: 1 / (1 + 2^-23) is just above a halfway point
+    assert((FP32(1.0f) / FP32::fromBits(0x3F800001u)).bits() == 0x3F7FFFFEu);
+    assert((FP32(1.0f) / FP32(3.0f)).bits() == 0x3EAAAAABu);
+    
+    // overflow, underflow to the smallest subnormal, and exact powers of two
+    assert((FP32::fromBits(0x7F7FFFFFu) / FP32(0.5f)).isInfinity());
+    assert((FP32::fromBits(0x00800000u) / FP32::fromBits(0x4B000000u)).bits() == 0x00000001u);
+    assert((FP32::fromBits(0x00000001u) / FP32(2.0f)).bits() == 0x00000000u);
+    assert((FP32::fromBits(0x00000003u) / FP32(2.0f)).bits() == 0x00000002u);
+    assert((FP32::fromBits(0x00000001u) / FP32::fromBits(0x00000001u)).bits() == 0x3F800000u);
+    
+    std::cout << std::dec << trials << " random quotients match hardware division" << std::endl;
+}
+
+void testConstexprAccessors() {
+    std::cout << "\nConstexpr Accessors" << std::endl;
+    
+    // evaluated at compile time, these fail the build if they stop being constexpr
+    static_assert(FP32::fromBits(0x3F800000u).exponent() == 127, "1.0 exponent");
+    static_assert(FP32::epsilon().unbiasedExponent() == -23, "epsilon is 2^-23");
+    static_assert(FP32::nan().isNaN() && !FP32::nan().isFinite(), "nan");
+    static_assert(FP32::infinity(true).isInfinity() && FP32::infinity(true).sign(), "-inf");
+    static_assert(FP32::zero(true).isZero() && FP32::zero(true).isNegative(), "-0");
+    static_assert(FP32::fromBits(0x00000001u).isSubnormal(), "min subnormal");
+    static_assert(FP32::fromBits(0x7F800001u).isNaN(), "signalling nan");
+    
+    // each pattern falls in exactly one class
+    const uint32_t samples[] = {0x00000000u, 0x80000000u, 0x00000001u, 0x807FFFFFu,
+                                0x00800000u, 0x3F800000u, 0xFF7FFFFFu, 0x7F800000u,
+                                0xFF800000u, 0x7FC00000u, 0xFFFFFFFFu};
+    for (uint32_t bits : samples) {
+        FP32 v = FP32::fromBits(bits);
+        int classes = v.isZero() + v.isSubnormal() + v.isNormal() + v.isInfinity() + v.isNaN();
+        assert(classes == 1);
+        assert(v.isFinite() == !(v.isInfinity() || v.isNaN()));
+    }
+    std::cout << "classification consistent on " << sizeof(samples) / sizeof(samples[0])
+              << " boundary patterns" << std::endl;
+}
+
+void testVector() {
+    std::cout << "\nVector Container" << std::endl;
+    
+    FP32Vector a(1000, FP32(1.5f));
+    FP32Vector b(1000, FP32(0.25f));
+    assert(reinterpret_cast<uintptr_t>(a.data()) % FP32Vector::ALIGNMENT == 0);
+    
+    // element-wise ops agree with the scalar operators
+    FP32Vector sum = a + b;
+    FP32Vector prod = a * b;
+    FP32Vector scaled = a * FP32(3.0f);
+    for (size_t i = 0; i < a.size(); ++i) {
+        assert(sum[i].bits() == (a[i] + b[i]).bits());
+        assert(prod[i].bits() == (a[i] * b[i]).bits());
+        assert(scaled[i].bits() == (a[i] * FP32(3.0f)).bits());
+    }
+    std::cout << "1.5 + 0.25 = " << sum[0] << ", 1.5 * 0.25 = " << prod[0]
+              << ", 1.5 * 3 = " << scaled[0] << std::endl;
+    
+    // temporaries from an arena never touch the heap
+    FP32Arena arena(64 * 1024);
+    FP32Vector x(256, arena, FP32(2.0f));
+    FP32Vector y = x * x;
+    assert(y.arena() == &arena && arena.used() == 2 * 256 * sizeof(FP32));
+    assert(reinterpret_cast<uintptr_t>(y.data()) % FP32Vector::ALIGNMENT == 0);
+    assert(y[255] == FP32(4.0f));
+    
+    // the float conversions keep every bit, nan payloads included
+    float floats[3] = {0.1f, -0.0f, FP32::fromBits(0x7FA00001u).toFloat()};
+    FP32Vector converted = FP32Vector::fromFloats(floats, 3);
+    float back[3];
+    converted.toFloats(back);
+    for (int i = 0; i < 3; ++i) {
+        assert(converted[i].bits() == FP32(floats[i]).bits());
+        assert(std::memcmp(&back[i], &floats[i], sizeof(float)) == 0);
+    }
+    
+    // zero-copy view over raw bits
+    uint32_t raw[4] = {FP32(1.0f).bits(), FP32(2.0f).bits(), FP32(3.0f).bits(), FP32(4.0f).bits()};
+    FP32Vector view = FP32Vector::view(raw, 4);
+    assert(view.isView() && view.bits() == raw);
+    view *= FP32(2.0f);
+    assert(raw[3] == FP32(8.0f).bits());
+    
+    bool threw = false;
+    try {
+        view.push_back(FP32(1.0f));
+    } catch (const std::logic_error&) {
+        threw = true;
+    }
+    assert(threw);
+    
+    threw = false;
+    try {
+        a += view;
+    } catch (const std::invalid_argument&) {
+        threw = true;
+    }
+    assert(threw);
+    std::cout << "view scaled in place: raw[3] = " << FP32::fromBits(raw[3]) << std::endl;
+    
+    // assigning to a view writes through to the caller's memory
+    FP32Vector ones(4, FP32(1.0f));
+    view = ones;
+    assert(view.isView() && view.data() == reinterpret_cast<FP32*>(raw));
+    assert(raw[0] == FP32(1.0f).bits() && raw[3] == FP32(1.0f).bits());
+    view = ones * FP32(5.0f);
+    assert(view.isView() && raw[2] == FP32(5.0f).bits());
+    
+    threw = false;
+    try {
+        view = a;
+    } catch (const std::invalid_argument&) {
+        threw = true;
+    }
+    assert(threw && view.isView() && raw[1] == FP32(5.0f).bits());
+    
+    // a size whose byte count wraps is refused before anything is allocated
+    threw = false;
+    try {
+        FP32Vector huge(SIZE_MAX / sizeof(FP32));
+    } catch (const std::length_error&) {
+        threw = true;
+    }
+    assert(threw);
+    threw = false;
+    try {
+        FP32Vector grown;
+        grown.reserve(SIZE_MAX / sizeof(FP32) - 1);
+    } catch (const std::length_error&) {
+        threw = true;
+    }
+    assert(threw);
+    std::cout << "view assignment writes raw[2] = " << FP32::fromBits(raw[2])
+              << ", oversized vectors throw length_error" << std::endl;
+}
+
+void testThreadPool() {
+    std::cout << "\nThread Pool" << std::endl;
+    
+    // more threads than this machine may have, so stealing still happens
+    ThreadPool pool(4);
+    assert(pool.threads() == 4);
+    
+    // every index runs exactly once, including the short last chunk
+    std::vector<std::atomic<int>> hits(100003);
+    pool.parallelFor(hits.size(), 997, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) hits[i]++;
+    });
+    for (const std::atomic<int>& h : hits) assert(h == 1);
+    
+    // uneven chunk cost forces idle threads to steal
+    std::atomic<uint64_t> total(0);
+    pool.parallelFor(256, 1, [&](size_t begin, size_t) {
+        uint64_t spin = begin < 32 ? 200000 : 1000;
+        uint64_t x = begin;
+        for (uint64_t i = 0; i < spin; ++i) x = x * 6364136223846793005ull + 1;
+        total += x & 1;
+    });
+    
+    // the first exception comes back to the caller, nested calls run inline
+    bool threw = false;
+    try {
+        pool.parallelFor(64, 1, [&](size_t begin, size_t) {
+            pool.parallelFor(8, 1, [](size_t, size_t) {});
+            if (begin == 17) throw std::runtime_error("chunk 17");
+        });
+    } catch (const std::runtime_error&) {
+        threw = true;
+    }
+    assert(threw);
+    
+    // batched ops split across threads give the serial result
+    const size_t n = 200000;
+    std::vector<FP32> a(n), b(n), serial(n), parallel(n);
+    for (size_t i = 0; i < n; ++i) {
+        a[i] = FP32(static_cast<float>(i) * 0.37f);
+        b[i] = FP32(1.0f / static_cast<float>(i + 1));
+    }
+    FP32::add(a.data(), b.data(), serial.data(), n);
+    size_t old_threshold = parallelThreshold();
+    setThreadCount(4);
+    setParallelThreshold(0);
+    FP32::add(a.data(), b.data(), parallel.data(), n);
+    for (size_t i = 0; i < n; ++i) assert(parallel[i].bits() == serial[i].bits());
+    
+    // deterministic reductions give the same bits for any thread count
+    auto partial = [&](size_t begin, size_t end) {
+        float sum = 0.0f;
+        for (size_t i = begin; i < end; ++i) sum += b[i].toFloat();
+        return sum;
+    };
+    auto plus = [](float x, float y) { return x + y; };
+    setThreadCount(1);
+    float reference = parallelReduce(n, 4096, 0.0f, partial, plus);
+    for (size_t threads : {2, 3, 4, 7}) {
+        setThreadCount(threads);
+        for (int run = 0; run < 5; ++run) {
+            assert(parallelReduce(n, 4096, 0.0f, partial, plus) == reference);
+        }
+    }
+    
+    setReductionMode(ReductionMode::Relaxed);
+    float relaxed = parallelReduce(n, 4096, 0.0f, partial, plus);
+    assert(std::fabs(relaxed - reference) < 1e-4f * std::fabs(reference));
+    setReductionMode(ReductionMode::Deterministic);
+    
+    setThreadCount(0);
+    setParallelThreshold(old_threshold);
+    std::cout << std::setprecision(9) << "harmonic sum H(" << std::dec << n << ") = " << reference
+              << " on 1-7 threads" << std::endl;
+}
+
+void testReductions() {
+    std::cout << "\nReductions" << std::endl;
+    
+    // uniform [0, 1) terms against a double reference, whose error is far
+    // below an FP32 ulp at this length
+    const size_t n = 200003;
+    std::vector<FP32> x(n), y(n);
+    uint32_t state = 99;
+    double exact_sum = 0.0;
+    double exact_dot = 0.0;
+    for (size_t i = 0; i < n; ++i) {
+        state = state * 1664525u + 1013904223u;
+        x[i] = FP32(static_cast<float>(state >> 8) * 0x1p-24f);
+        y[i] = FP32(1.0f - x[i].toFloat() * 0.5f);
+        exact_sum += x[i].toDouble();
+        exact_dot += x[i].toDouble() * y[i].toDouble();
+    }
+    auto error = [](FP32 got, double exact) { return std::fabs(got.toDouble() - exact) / std::fabs(exact); };
+    
+    FP32 loop;
+    for (size_t i = 0; i < n; ++i) loop += x[i];
+    assert(sum(x.data(), n, Summation::Naive).bits() == loop.bits());
+    
+    double naive_error = error(loop, exact_sum);
+    double pairwise_error = error(sum(x.data(), n, Summation::Pairwise), exact_sum);
+    double kahan_error = error(sum(x.data(), n, Summation::Kahan), exact_sum);
+    double neumaier_error = error(sum(x.data(), n, Summation::Neumaier), exact_sum);
+    double widened_error = error(sum(x.data(), n, Summation::Widened), exact_sum);
+    const double ulp = std::ldexp(1.0, -23);
+    assert(naive_error > pairwise_error && naive_error > 8 * ulp);
+    assert(pairwise_error < 8 * ulp);
+    assert(kahan_error <= ulp && neumaier_error <= ulp && widened_error <= ulp);
+    assert(error(dot(x.data(), y.data(), n, Summation::Kahan), exact_dot) <= ulp);
+    assert(error(dot(x.data(), y.data(), n), exact_dot) <= ulp);
+    
+    // Kahan loses the 1s next to a large term in the same lane, Neumaier
+    // keeps them
+    std::vector<FP32> spiky(64);
+    spiky[0] = FP32(1.0f);
+    spiky[16] = FP32(std::ldexp(1.0f, 40));
+    spiky[32] = FP32(1.0f);
+    spiky[48] = FP32(-std::ldexp(1.0f, 40));
+    assert(sum(spiky.data(), 64, Summation::Naive).toFloat() == 0.0f);
+    assert(sum(spiky.data(), 64, Summation::Kahan).toFloat() == 0.0f);
+    assert(sum(spiky.data(), 64, Summation::Neumaier).toFloat() == 2.0f);
+    assert(sum(spiky.data(), 64, Summation::Widened).toFloat() == 2.0f);
+    
+    const Summation methods[] = {Summation::Naive, Summation::Pairwise, Summation::Kahan,
+                                 Summation::Neumaier, Summation::Widened};
+    FP32 small[] = {FP32(3.0f), FP32(4.0f), FP32(1.0f), FP32(2.0f)};
+    for (Summation method : methods) {
+        assert(mean(small, 4, method).toFloat() == 2.5f);
+        assert(norm2(small, 2, method).toFloat() == 5.0f);
+        assert(dot(small, small + 2, 2, method).toFloat() == 11.0f);
+        assert(sum(small, 0, method).isZero() && mean(small, 0, method).isNaN());
+    }
+    
+    // under Preserve every simd level runs hardware float, under Flush the
+    // operators; no term or partial here is subnormal, so all agree. the
+    // odd lengths leave a short last row of lanes
+    const size_t lengths[] = {1, 15, 17, 1000, 4099, n};
+    for (Summation method : methods) {
+        for (size_t len : lengths) {
+            uint32_t sum_bits;
+            uint32_t dot_bits;
+            {
+                SubnormalScope flush(SubnormalMode::Flush);
+                sum_bits = sum(x.data(), len, method).bits();
+                dot_bits = dot(x.data(), y.data(), len, method).bits();
+            }
+            for (SimdLevel level : {SimdLevel::Scalar, SimdLevel::AVX2, SimdLevel::AVX512}) {
+                assert(sum(x.data(), len, method, level).bits() == sum_bits);
+                assert(dot(x.data(), y.data(), len, method, level).bits() == dot_bits);
+            }
+        }
+    }
+
+    // overflow and nans: the hardware keeps nan signs, the result is the
+    // canonical nan at every level
+    std::vector<FP32> wild(53);
+    for (size_t i = 0; i < wild.size(); ++i) wild[i] = FP32(std::ldexp(i % 2 ? -1.5f : 1.75f, 127));
+    FP32 wild_sum = sum(wild.data(), wild.size(), Summation::Naive);
+    assert(wild_sum.isInfinity());
+    for (SimdLevel level : {SimdLevel::Scalar, SimdLevel::AVX2, SimdLevel::AVX512}) {
+        for (Summation method : methods) {
+            FP32 got = sum(wild.data(), wild.size(), method, level);
+            assert(method == Summation::Widened ? got.toFloat() > 0.0f
+                                                : got.isNaN() || got.bits() == wild_sum.bits());
+            if (got.isNaN()) assert(got.bits() == FP32::nan().bits());
+        }
+        wild[20] = FP32(-std::nanf(""));
+        assert(dot(wild.data(), wild.data(), wild.size(), Summation::Kahan, level).bits() == FP32::nan().bits());
+        wild[20] = wild[22];
+    }
+
+    // chunked strategies give the same bits on any thread count
+    size_t old_threshold = parallelThreshold();
+    setParallelThreshold(0);
+    setThreadCount(1);
+    std::vector<uint32_t> serial;
+    for (Summation method : methods) serial.push_back(dot(x.data(), y.data(), n, method).bits());
+    setThreadCount(4);
+    for (size_t m = 0; m < 5; ++m) assert(dot(x.data(), y.data(), n, methods[m]).bits() == serial[m]);
+    setThreadCount(0);
+    setParallelThreshold(old_threshold);
+    
+    std::cout << std::scientific << std::setprecision(2) << "relative error of a " << std::dec << n
+              << " term sum: naive " << naive_error << ", pairwise " << pairwise_error
+              << ", kahan " << kahan_error << ", neumaier " << neumaier_error
+              << ", widened " << widened_error << std::endl;
+}
+
+// one operation against the double result rounded through float; float has
+// more than 2(M + 1) + 2 bits for every format here so the double rounding
+// is harmless
+template <typename T>
+static bool smallFloatMatches(T a, T b, char op) {
+    double x = a.toDouble();
+    double y = b.toDouble();
+    double exact = op == '+' ? x + y : op == '-' ? x - y : op == '*' ? x * y : x / y;
+    T got = op == '+' ? a + b : op == '-' ? a - b : op == '*' ? a * b : a / b;
+    T expected(static_cast<float>(exact));
+    return expected.isNaN() ? got.isNaN() : got.bits() == expected.bits();
+}
+
+void testSmallFloat() {
+    std::cout << "\nSmall Formats" << std::endl;
+    using E4M3 = SmallFloat<4, 3>;
+    using E5M2 = SmallFloat<5, 2>;
+    
+    static_assert(FP16::Format::EXPONENT_BIAS == 15 && FP16::Format::TOTAL_BITS == 16, "binary16");
+    static_assert(E4M3::max().bits() == 0x77 && E5M2::max().bits() == 0x7B, "fp8 max");
+    static_assert(TF32::Format::EXPONENT_BIAS == 127 && TF32::Format::TOTAL_BITS == 19, "tf32");
+    static_assert(sizeof(E4M3) == 1 && sizeof(FP16) == 2, "storage");
+    
+    // known encodings, overflow and the subnormal boundary
+    assert(FP16(1.0f).bits() == 0x3C00u);
+    assert(FP16(65504.0f).bits() == 0x7BFFu);
+    assert(FP16(65520.0f).isInfinity());               // halfway to 2^16 rounds up
+    assert(FP16(std::ldexp(1.0f, -24)).bits() == 0x0001u);
+    assert(FP16(std::ldexp(1.0f, -25)).bits() == 0x0000u);   // tie to even
+    assert(FP16(1.0f / 3.0f).bits() == 0x3555u);
+    assert(E4M3(240.0f).bits() == 0x77u && E4M3(248.0f).isInfinity());
+    assert(E5M2(57344.0f).bits() == 0x7Bu);
+    assert(TF32(1.0f + std::ldexp(1.0f, -11)).bits() == TF32(1.0f).bits());
+    assert(FP16(std::nanf("")).isNaN() && E4M3(-INFINITY).bits() == 0xF8u);
+    
+    // every finite or infinite half value survives a trip through float
+    for (uint32_t bits = 0; bits <= 0xFFFFu; ++bits) {
+        FP16 v = FP16::fromBits(static_cast<uint16_t>(bits));
+        if (!v.isNaN()) assert(FP16(v.toFloat()).bits() == v.bits());
+    }
+    
+    // every pair of fp8 values, for both layouts and all four operators
+    const char ops[] = {'+', '-', '*', '/'};
+    size_t mismatches = 0;
+    size_t checked = 0;
+    for (uint32_t x = 0; x < 256; ++x) {
+        for (uint32_t y = 0; y < 256; ++y) {
+            for (char op : ops) {
+                mismatches += !smallFloatMatches(E4M3::fromBits(static_cast<uint8_t>(x)),
+                                                 E4M3::fromBits(static_cast<uint8_t>(y)), op);
+                mismatches += !smallFloatMatches(E5M2::fromBits(static_cast<uint8_t>(x)),
+                                                 E5M2::fromBits(static_cast<uint8_t>(y)), op);
+                checked += 2;
+            }
+        }
+    }
+    assert(mismatches == 0);
+    
+    // random half and tf32 pairs
+    std::mt19937 rng(13);
+    const size_t trials = 500000;
+    for (size_t i = 0; i < trials; ++i) {
+        uint32_t x = rng();
+        uint32_t y = rng();
+        char op = ops[i % 4];
+        mismatches += !smallFloatMatches(FP16::fromBits(static_cast<uint16_t>(x)),
+                                         FP16::fromBits(static_cast<uint16_t>(y)), op);
+        mismatches += !smallFloatMatches(TF32::fromBits(x & 0x7FFFFu), TF32::fromBits(y & 0x7FFFFu), op);
+        checked += 2;
+    }
+    assert(mismatches == 0);
+    
+    // fma rounds once: (1 + 2^-9)^2 - 1 keeps the 2^-18 term
+    FP16 a = FP16::fromBits(0x3C02u);
+    assert(FP16::fma(a, a, FP16(-1.0f)).toFloat() == std::ldexp(1.0f, -8) + std::ldexp(1.0f, -18));
+    assert((a * a - FP16(1.0f)).toFloat() == std::ldexp(1.0f, -8));
+    assert(FP16(2.0f).sqrt().bits() == 0x3DA8u);
+    
+    std::cout << checked << " small format results match the rounded reference" << std::endl;
+}
+
+void testCharConversion() {
+    std::cout << "\nText Conversion" << std::endl;
+    
+    char buffer[FP32::MAX_CHARS];
+    char* end = buffer + sizeof(buffer);
+    auto text = [&](FP32 x, CharsFormat format) {
+        std::to_chars_result r = toChars(buffer, end, x, format);
+        assert(r.ec == std::errc());
+        return std::string(buffer, r.ptr);
+    };
+    
+    assert(text(FP32(0.1f), CharsFormat::Shortest) == "0.1");
+    assert(text(FP32(-1e7f), CharsFormat::Shortest) == "-1e+07");
+    assert(text(FP32::infinity(true), CharsFormat::Shortest) == "-inf");
+    assert(text(FP32(1.0f), CharsFormat::Hex) == "0x3F800000");
+    assert(text(FP32(-2.0f), CharsFormat::Binary) == "1 10000000 00000000000000000000000");
+    assert(FP32(1.0f).toHex() == "0x3F800000" && FP32(1.0f).toBinary() == text(FP32(1.0f), CharsFormat::Binary));
+    
+    // a short buffer is an error, never an overrun
+    assert(toChars(buffer, buffer + 9, FP32(1.0f), CharsFormat::Hex).ec == std::errc::value_too_large);
+    assert(toChars(buffer, buffer + 3, FP32(0.125f)).ec == std::errc::value_too_large);
+    
+    // every format parses back to the same bits, over a spread of patterns
+    const CharsFormat formats[] = {CharsFormat::Shortest, CharsFormat::Hex, CharsFormat::Binary};
+    size_t checked = 0;
+    for (uint64_t i = 0; i < (uint64_t(1) << 32); i += 4099) {
+        FP32 x = FP32::fromBits(static_cast<uint32_t>(i));
+        for (CharsFormat format : formats) {
+            std::to_chars_result r = toChars(buffer, end, x, format);
+            assert(r.ec == std::errc());
+            FP32 y;
+            std::from_chars_result p = fromChars(buffer, r.ptr, y, format);
+            assert(p.ec == std::errc() && p.ptr == r.ptr);
+            assert(y.bits() == x.bits() || (format == CharsFormat::Shortest && x.isNaN() && y.isNaN()));
+        }
+        ++checked;
+    }
+    
+    // parse errors leave the value alone
+    FP32 y(7.0f);
+    const char* bad[] = {"", "+1", "x", "1e39", "1e-50"};
+    for (const char* s : bad) {
+        std::from_chars_result p = fromChars(s, s + std::strlen(s), y);
+        assert(p.ec != std::errc() && y.toFloat() == 7.0f);
+    }
+    const char* wide = "0x1FFFFFFFF";
+    assert(fromChars(wide, wide + 11, y, CharsFormat::Hex).ec == std::errc::result_out_of_range);
+    const char* packed = "00111111100000000000000000000000";
+    assert(fromChars(packed, packed + 32, y, CharsFormat::Binary).ec == std::errc() && y.toFloat() == 1.0f);
+    
+    // the stream operators sit on top, honouring width and fill only
+    std::ostringstream os;
+    os << std::setprecision(2) << std::hex << FP32(0.1f) << ' ' << std::setw(6) << std::setfill('_') << FP32(1.5f);
+    assert(os.str() == "0.1 ___1.5");
+    
+    std::istringstream is("+2.5 1e-3\t-inf 1e39");
+    FP32 a, b, c, d(3.0f);
+    is >> a >> b >> c;
+    assert(is && a.toFloat() == 2.5f && b.toFloat() == 1e-3f && c.isInfinity() && c.sign());
+    is >> d;
+    assert(is.fail() && d.toFloat() == 3.0f);
+    
+    std::cout << checked << " patterns round trip in every format" << std::endl;
+}
+
+// largest |rsqrt(x) - 1 / sqrt(x)| over x, in ulp, and whether sqrt
+// matched the float square root rounded to T everywhere (T(std::sqrt) is
+// correctly rounded for T no wider than float)
+template <typename T>
+bool rootsMatch(T x, double& max_ulp) {
+    float root = std::sqrt(x.toFloat());
+    bool match = std::isnan(root) ? x.sqrt().isNaN() : x.sqrt().bits() == T(root).bits();
+    if (x.isNaN() || x.isZero() || x.isInfinity() || x.toFloat() < 0.0f) return match;
+    double exact = 1.0 / std::sqrt(static_cast<double>(x.toFloat()));
+    double ulp = std::ldexp(1.0, std::ilogb(exact) - T::Format::MANTISSA_BITS);
+    max_ulp = std::max(max_ulp, std::fabs(static_cast<double>(x.rsqrt().toFloat()) - exact) / ulp);
+    return match;
+}
+
+void testSqrt() {
+    std::cout << "\nSquare Root" << std::endl;
+    
+    assert(FP32(2.0f).sqrt().toFloat() == std::sqrt(2.0f) && FP32(0.25f).rsqrt().toFloat() == 2.0f);
+    assert(FP32::zero(true).sqrt().bits() == 0x80000000u && FP32(-1.0f).sqrt().isNaN());
+    assert(FP32::infinity().sqrt().isInfinity() && FP32::infinity().rsqrt().isZero());
+    assert(FP32::zero(true).rsqrt().bits() == FP32::infinity(true).bits());
+    assert(FP32::nan().rsqrt().isNaN() && FP32(-4.0f).rsqrt().isNaN());
+    
+    // both binades of [1, 4) cover every significand and exponent parity,
+    // then a spread over all patterns, subnormals included
+    size_t mismatches = 0;
+    size_t checked = 0;
+    double max_ulp = 0.0;
+    for (uint32_t bits = 0x3F800000u; bits < 0x40800000u; ++bits, ++checked) {
+        mismatches += !rootsMatch(FP32::fromBits(bits), max_ulp);
+    }
+    for (uint64_t bits = 0; bits < (uint64_t(1) << 32); bits += 65521, ++checked) {
+        mismatches += !rootsMatch(FP32::fromBits(static_cast<uint32_t>(bits)), max_ulp);
+    }
+    for (uint32_t bits = 1; bits < 0x00800000u; bits += 997, ++checked) {
+        mismatches += !rootsMatch(FP32::fromBits(bits), max_ulp);
+    }
+    assert(mismatches == 0);
+    assert(max_ulp <= 0.53);
+    
+    // the small formats, every pattern
+    double small_ulp = 0.0;
+    for (uint32_t bits = 0; bits <= 0xFFFFu; ++bits) {
+        mismatches += !rootsMatch(FP16::fromBits(static_cast<uint16_t>(bits)), small_ulp);
+        mismatches += !rootsMatch(SmallFloat<4, 3>::fromBits(static_cast<uint8_t>(bits)), small_ulp);
+        mismatches += !rootsMatch(SmallFloat<5, 2>::fromBits(static_cast<uint8_t>(bits)), small_ulp);
+    }
+    assert(mismatches == 0);
+    assert(small_ulp < 0.5);
+    
+    // the batched versions, in place too
+    std::vector<FP32> values;
+    for (uint64_t bits = 0; bits < (uint64_t(1) << 32); bits += 1000003) {
+        values.push_back(FP32::fromBits(static_cast<uint32_t>(bits)));
+    }
+    std::vector<FP32> roots(values.size());
+    FP32::sqrt(values.data(), roots.data(), values.size());
+    for (size_t i = 0; i < values.size(); ++i) assert(roots[i].bits() == values[i].sqrt().bits());
+    roots = values;
+    FP32::rsqrt(roots.data(), roots.data(), roots.size());
+    for (size_t i = 0; i < values.size(); ++i) assert(roots[i].bits() == values[i].rsqrt().bits());
+    
+    // every simd level against the scalar bits: the binades [1, 4) hold
+    // every significand and exponent parity the lanes see, then the spread
+    // and a tail that is not a whole register, in both subnormal modes
+    std::vector<FP32> binades;
+    for (uint32_t bits = 0x3F800000u; bits < 0x40800000u; ++bits) binades.push_back(FP32::fromBits(bits));
+    values.resize(values.size() - 5);
+    for (const std::vector<FP32>* xs : {&binades, &values}) {
+        std::vector<FP32> sq_ref(xs->size()), rs_ref(xs->size()), sq(xs->size()), rs(xs->size());
+        sqrt(xs->data(), sq_ref.data(), xs->size(), SimdLevel::Scalar);
+        rsqrt(xs->data(), rs_ref.data(), xs->size(), SimdLevel::Scalar);
+        for (size_t i = 0; i < xs->size(); i += 4099) {
+            assert(sq_ref[i].bits() == (*xs)[i].sqrt().bits() && rs_ref[i].bits() == (*xs)[i].rsqrt().bits());
+        }
+        for (SimdLevel level : {SimdLevel::AVX2, SimdLevel::AVX512}) {
+            sqrt(xs->data(), sq.data(), xs->size(), level);
+            rsqrt(xs->data(), rs.data(), xs->size(), level);
+            for (size_t i = 0; i < xs->size(); ++i) {
+                assert(sq[i].bits() == sq_ref[i].bits() && rs[i].bits() == rs_ref[i].bits());
+            }
+        }
+    }
+    for (SimdLevel level : {SimdLevel::Scalar, SimdLevel::AVX2, SimdLevel::AVX512}) {
+        SubnormalScope flush(SubnormalMode::Flush);
+        rsqrt(values.data(), roots.data(), values.size(), level);
+        for (size_t i = 0; i < values.size(); ++i) assert(roots[i].bits() == values[i].rsqrt().bits());
+    }
+    
+    // the documented bound over every positive pattern, through the batched
+    // rsqrt on the pool. zeros, infinities and nans give the scalar bits;
+    // a negative is nan by the sign test alone, the spread above has them
+    const size_t SWEEP_CHUNK = size_t(1) << 16;
+    auto sweep = [&](size_t begin, size_t end) {
+        std::vector<FP32> x(SWEEP_CHUNK), r(SWEEP_CHUNK);
+        std::pair<double, size_t> worst(0.0, 0);
+        for (size_t chunk = begin; chunk < end; ++chunk) {
+            uint32_t first = static_cast<uint32_t>(chunk * SWEEP_CHUNK);
+            for (size_t i = 0; i < SWEEP_CHUNK; ++i) x[i] = FP32::fromBits(first + static_cast<uint32_t>(i));
+            FP32::rsqrt(x.data(), r.data(), SWEEP_CHUNK);
+            for (size_t i = 0; i < SWEEP_CHUNK; ++i) {
+                if (x[i].isZero() || !x[i].isFinite()) {
+                    worst.second += r[i].bits() != x[i].rsqrt().bits();
+                    continue;
+                }
+                // the ulp of exact, 2^(ilogb(exact) - 23), from its exponent field
+                double exact = 1.0 / std::sqrt(static_cast<double>(x[i].toFloat()));
+                uint64_t exact_bits;
+                std::memcpy(&exact_bits, &exact, sizeof(exact));
+                uint64_t ulp_bits = ((exact_bits >> 52) - 23) << 52;
+                double ulp;
+                std::memcpy(&ulp, &ulp_bits, sizeof(ulp));
+                worst.first = std::max(worst.first, std::fabs(static_cast<double>(r[i].toFloat()) - exact) / ulp);
+            }
+        }
+        return worst;
+    };
+    auto worse = [](std::pair<double, size_t> a, std::pair<double, size_t> b) {
+        return std::make_pair(std::max(a.first, b.first), a.second + b.second);
+    };
+    std::pair<double, size_t> swept = parallelReduce((size_t(1) << 31) / SWEEP_CHUNK, 1,
+                                                     std::make_pair(0.0, size_t(0)), sweep, worse);
+    assert(swept.second == 0);
+    assert(swept.first <= 0.53 && swept.first >= max_ulp);
+    
+    std::cout << checked << " FP32 square roots correctly rounded, rsqrt within "
+              << std::defaultfloat << std::setprecision(4) << max_ulp << " ulp (" << small_ulp << " for the small formats), "
+              << swept.first << " ulp over every positive float, simd on " << simdLevelName(detectSimdLevel()) << std::endl;
+}
+
+void testOrder() {
+    std::cout << "\nOrder Ops" << std::endl;
+    
+    using Format = FP32::Format;
+    assert(Format::orderKey(FP32(-0.0f).bits()) < Format::orderKey(FP32(0.0f).bits()));
+    assert(Format::orderKey(FP32::infinity(true).bits()) < Format::orderKey(FP32(-1e30f).bits()));
+    assert(Format::orderKey(0xFFC00000u) < Format::orderKey(FP32::infinity(true).bits()));   // -nan
+    
+    // random patterns with plenty of zeros, infinities, subnormals and
+    // nans of both signs, across the thread pool's parallel threshold
+    std::mt19937 rng(7);
+    const uint32_t specials[] = {0x00000000u, 0x80000000u, 0x7F800000u, 0xFF800000u, 0x7FC00000u,
+                                 0xFFC00001u, 0x00000001u, 0x80000001u, 0x7F7FFFFFu, 0xFF7FFFFFu};
+    const size_t n = 200003;
+    std::vector<FP32> x(n);
+    for (size_t i = 0; i < n; ++i) {
+        uint32_t r = rng();
+        x[i] = FP32::fromBits(r % 16 == 0 ? specials[(r >> 4) % 10] : r);
+    }
+    std::vector<FP32> numbers;
+    for (const FP32& v : x) {
+        if (!v.isNaN()) numbers.push_back(v);
+    }
+    
+    auto key = [](const FP32& v) { return Format::orderKey(v.bits()); };
+    auto byKey = [&](const FP32& a, const FP32& b) { return key(a) < key(b); };
+    auto firstBits = [](const std::vector<FP32>& v, uint32_t bits) {
+        return static_cast<size_t>(std::find_if(v.begin(), v.end(), [=](const FP32& e) { return e.bits() == bits; }) - v.begin());
+    };
+    size_t first_nan = static_cast<size_t>(std::find_if(x.begin(), x.end(), [](const FP32& e) { return e.isNaN(); }) - x.begin());
+    FP32 lo = *std::min_element(numbers.begin(), numbers.end(), byKey);
+    FP32 hi = *std::max_element(numbers.begin(), numbers.end(), byKey);
+    FP32 total_lo = *std::min_element(x.begin(), x.end(), byKey);
+    FP32 total_hi = *std::max_element(x.begin(), x.end(), byKey);
+    assert(lo.bits() == FP32::infinity(true).bits() && total_lo.isNaN());
+    
+    assert(argmin(x.data(), n) == first_nan && argmax(x.data(), n) == first_nan);
+    assert(argmin(x.data(), n, NaNPolicy::Ignore) == firstBits(x, lo.bits()));
+    assert(argmax(x.data(), n, NaNPolicy::Ignore) == firstBits(x, hi.bits()));
+    assert(argmin(x.data(), n, NaNPolicy::Total) == firstBits(x, total_lo.bits()));
+    assert(argmax(x.data(), n, NaNPolicy::Total) == firstBits(x, total_hi.bits()));
+    assert(minmax(x.data(), n).first.isNaN() && minmax(x.data(), n).second.isNaN());
+    assert(minmax(x.data(), n, NaNPolicy::Ignore).first.bits() == lo.bits());
+    assert(minmax(x.data(), n, NaNPolicy::Ignore).second.bits() == hi.bits());
+    assert(minmax(x.data(), n, NaNPolicy::Total).second.bits() == total_hi.bits());
+    
+    // -0 is below +0, the first of equal values wins, and an all-nan span
+    // has nothing left under Ignore
+    std::vector<FP32> small = {FP32(1.0f), FP32(0.0f), FP32(-0.0f), FP32(-0.0f), FP32(1.0f)};
+    assert(argmin(small.data(), small.size()) == 2 && argmax(small.data(), small.size()) == 0);
+    std::vector<FP32> nans(5, FP32::nan());
+    assert(argmin(nans.data(), nans.size(), NaNPolicy::Ignore) == 5 && argmin(nans.data(), 0) == 0);
+    assert(minmax(nans.data(), nans.size(), NaNPolicy::Ignore).first.isNaN());
+    
+    // clamp: nans pass through unless the order is total
+    std::vector<FP32> clamped(n);
+    clamp(x.data(), clamped.data(), n, FP32(-1.0f), FP32(2.0f));
+    for (size_t i = 0; i < n; ++i) {
+        if (x[i].isNaN()) {
+            assert(clamped[i].bits() == x[i].bits());
+        } else {
+            FP32 expected = key(x[i]) < key(FP32(-1.0f)) ? FP32(-1.0f) : key(x[i]) > key(FP32(2.0f)) ? FP32(2.0f) : x[i];
+            assert(clamped[i].bits() == expected.bits());
+        }
+    }
+    clamp(x.data(), clamped.data(), n, FP32(-1.0f), FP32(2.0f), NaNPolicy::Total);
+    for (size_t i = 0; i < n; ++i) {
+        if (x[i].isNaN()) assert(clamped[i].bits() == (x[i].sign() ? FP32(-1.0f) : FP32(2.0f)).bits());
+    }
+    bool threw = false;
+    try { clamp(x.data(), clamped.data(), n, FP32(2.0f), FP32(1.0f)); } catch (const std::invalid_argument&) { threw = true; }
+    assert(threw);
+    
+    // sort against std::stable_sort on the keys: numbers ascending then the
+    // nans in input order, or everything by key under Total
+    std::vector<FP32> expected = numbers;
+    std::stable_sort(expected.begin(), expected.end(), byKey);
+    for (const FP32& v : x) {
+        if (v.isNaN()) expected.push_back(v);
+    }
+    std::vector<FP32> sorted = x;
+    sort(sorted.data(), n);
+    for (size_t i = 0; i < n; ++i) assert(sorted[i].bits() == expected[i].bits());
+    
+    expected = x;
+    std::sort(expected.begin(), expected.end(), byKey);
+    sorted = x;
+    sort(sorted.data(), n, NaNPolicy::Total);
+    for (size_t i = 0; i < n; ++i) assert(sorted[i].bits() == expected[i].bits());
+    
+    // short spans comparison sort the keys instead
+    std::vector<FP32> head(x.begin(), x.begin() + 1000);
+    expected = head;
+    std::sort(expected.begin(), expected.end(), byKey);
+    sort(head.data(), head.size(), NaNPolicy::Total);
+    for (size_t i = 0; i < head.size(); ++i) assert(head[i].bits() == expected[i].bits());
+    sort(nans.data(), nans.size());
+    assert(nans[4].isNaN());
+    
+    std::cout << n << " patterns: argmin / argmax / minmax / clamp / sort match the key-order reference" << std::endl;
+}
+
+void testExpr() {
+    std::cout << "\nExpression Templates" << std::endl;
+    
+    // past the parallel threshold, with a ragged tile at the end, and
+    // subnormal / huge operands mixed in
+    const size_t n = 100003;
+    FP32Vector a(n), b(n), c(n), d(n), e(n);
+    std::mt19937 rng(11);
+    std::uniform_int_distribution<uint32_t> any;
+    std::uniform_real_distribution<float> unit(-2.0f, 2.0f);
+    for (size_t i = 0; i < n; ++i) {
+        a[i] = FP32(unit(rng));
+        b[i] = i % 97 == 0 ? FP32::fromBits(any(rng) & 0x807FFFFFu) : FP32(unit(rng));
+        c[i] = FP32(std::ldexp(unit(rng), static_cast<int>(i % 200) - 100));
+        d[i] = FP32(unit(rng));
+        e[i] = FP32(unit(rng));
+    }
+    
+    // Rounded gives the operator chain's bits; Widened is hardware float,
+    // the same values
+    FP32Vector eager = a * b + c * d - e;
+    FP32Vector fused = evaluate(lazy(a) * b + lazy(c) * d - e);
+    FP32Vector widened = evaluate(lazy(a) * b + lazy(c) * d - e, ExprPrecision::Widened);
+    for (size_t i = 0; i < n; ++i) {
+        assert(fused[i].bits() == eager[i].bits() && widened[i].bits() == eager[i].bits());
+    }
+    
+    // specials: the operators' nan is the positive quiet one
+    const uint32_t specials[] = {0x7F800000u, 0xFF800000u, 0x7FC00000u, 0xFFC00001u, 0x7F800001u,
+                                 0x7F7FFFFFu, 0xFF7FFFFFu, 0x00000001u, 0x80000000u, 0x00000000u};
+    FP32Vector sa(100), sb(100);
+    for (size_t i = 0; i < 100; ++i) {
+        sa[i] = FP32::fromBits(specials[i / 10]);
+        sb[i] = FP32::fromBits(specials[i % 10]);
+    }
+    FP32Vector special_eager = sa * sb + sa - sb;
+    FP32Vector special_fused = evaluate(lazy(sa) * sb + sa - sb);
+    for (size_t i = 0; i < 100; ++i) assert(special_fused[i].bits() == special_eager[i].bits());
+    
+    eager = b - a * FP32(0.25f);
+    fused = evaluate(-(FP32(0.25f) * lazy(a)) + b);
+    for (size_t i = 0; i < n; ++i) assert(fused[i].bits() == eager[i].bits());
+    
+    // in place into an operand, and the size check
+    FP32Vector expected = a * b + c;
+    assign(a, lazy(a) * b + c, ExprPrecision::Widened);
+    for (size_t i = 0; i < n; ++i) assert(a[i].bits() == expected[i].bits());
+    FP32Vector shorter(n - 1);
+    bool threw = false;
+    try { evaluate(lazy(shorter) * a); } catch (const std::invalid_argument&) { threw = true; }
+    assert(threw);
+    
+    std::cout << "one pass, Rounded and Widened both match the operator chain" << std::endl;
+}
+
+void testCounters() {
+    std::cout << "\nSlow-Path Counters" << std::endl;
+    
+    // each case on its own, so the deltas are exact
+    struct Case {
+        const char* name;
+        CountedOp op;
+        std::function<void()> run;
+        uint64_t special, subnormal, tie, overflow, underflow;
+    };
+    volatile uint32_t sink = 0;
+    auto keep = [&](FP32 x) { sink = x.bits(); };
+    const Case cases[] = {
+        {"1 + 2^-24, a tie", CountedOp::Add,
+         [&] { keep(FP32(1.0f) + FP32::fromBits(0x33800000u)); }, 0, 0, 1, 0, 0},
+        {"max + half ulp, tie to infinity", CountedOp::Add,
+         [&] { keep(FP32::fromBits(0x7F7FFFFFu) + FP32::fromBits(0x73000000u)); }, 0, 0, 1, 1, 0},
+        {"inf + 1", CountedOp::Add,
+         [&] { keep(FP32::infinity() + FP32(1.0f)); }, 1, 0, 0, 0, 0},
+        {"subnormal + 1", CountedOp::Add,
+         [&] { keep(FP32::fromBits(1) + FP32(1.0f)); }, 1, 0, 0, 0, 0},
+        {"max * 2", CountedOp::Multiply,
+         [&] { keep(FP32::fromBits(0x7F7FFFFFu) * FP32(2.0f)); }, 0, 0, 0, 1, 0},
+        {"min normal * 0.75, exact subnormal", CountedOp::Multiply,
+         [&] { keep(FP32::fromBits(0x00800000u) * FP32(0.75f)); }, 0, 1, 0, 0, 0},
+        {"(min normal + ulp) / 2, rounded subnormal", CountedOp::Multiply,
+         [&] { keep(FP32::fromBits(0x00800001u) * FP32(0.5f)); }, 0, 1, 1, 0, 1},
+        {"min subnormal * 0.25, to zero", CountedOp::Multiply,
+         [&] { keep(FP32::fromBits(1) * FP32(0.25f)); }, 0, 0, 0, 0, 1},
+        {"0 * 3", CountedOp::Multiply,
+         [&] { keep(FP32(0.0f) * FP32(3.0f)); }, 1, 0, 0, 0, 0},
+        {"1 / 0", CountedOp::Divide,
+         [&] { keep(FP32(1.0f) / FP32(0.0f)); }, 1, 0, 0, 0, 0},
+        {"sqrt(-1)", CountedOp::Sqrt,
+         [&] { keep(FP32(-1.0f).sqrt()); }, 1, 0, 0, 0, 0},
+        {"1 * 3, nothing", CountedOp::Multiply,
+         [&] { keep(FP32(1.0f) * FP32(3.0f)); }, 0, 0, 0, 0, 0},
+    };
+    
+    for (const Case& c : cases) {
+        CounterSnapshot before = FloatCounters::threadSnapshot();
+        c.run();
+        CounterSnapshot d = FloatCounters::threadSnapshot() - before;
+        if (!FloatCounters::ENABLED) {
+            for (size_t op = 0; op < COUNTED_OPS; ++op) {
+                for (size_t e = 0; e < COUNTED_EVENTS; ++e) assert(d.counts[op][e] == 0);
+            }
+            continue;
+        }
+        assert(d(c.op, CountedEvent::Calls) == 1);
+        assert(d(c.op, CountedEvent::Special) == c.special);
+        assert(d(c.op, CountedEvent::Subnormal) == c.subnormal);
+        assert(d(c.op, CountedEvent::Tie) == c.tie);
+        assert(d(c.op, CountedEvent::Overflow) == c.overflow);
+        assert(d(c.op, CountedEvent::Underflow) == c.underflow);
+    }
+    
+    // a batched call on the pool shows up in the all-threads snapshot
+    const size_t n = 200003;
+    std::vector<FP32> a(n, FP32::fromBits(0x00800000u)), b(n, FP32(0.75f)), out(n);
+    FloatCounters::reset();
+    FP32::multiply(a.data(), b.data(), out.data(), n);
+    CounterSnapshot total = FloatCounters::snapshot();
+    uint64_t expected = FloatCounters::ENABLED ? n : 0;
+    assert(total(CountedOp::Multiply, CountedEvent::Calls) == expected);
+    assert(total(CountedOp::Multiply, CountedEvent::Subnormal) == expected);
+    FloatCounters::reset();
+    assert(FloatCounters::snapshot()(CountedOp::Multiply, CountedEvent::Calls) == 0);
+    
+    if (FloatCounters::ENABLED) {
+        std::cout << sizeof(cases) / sizeof(cases[0]) << " cases counted exactly, " << n << " pooled multiplies" << std::endl;
+    } else {
+        std::cout << "compiled out (make counters), every count stays 0" << std::endl;
+    }
+}
+
+void testSubnormalMode() {
+    std::cout << "\nFlush-to-Zero Mode" << std::endl;
+    
+    using Flush = FP32::FormatFor<SubnormalMode::Flush>;
+    const FP32 min_normal = FP32::fromBits(0x00800000u);
+    const FP32 half(0.5f);
+    
+    // results that round to a subnormal flush to a zero of their sign, one
+    // that rounds up to the smallest normal stays
+    assert((min_normal * half).bits() == 0x00400000u);
+    {
+        SubnormalScope flush(SubnormalMode::Flush);
+        assert(subnormalMode() == SubnormalMode::Flush);
+        assert((min_normal * half).bits() == 0x00000000u);
+        assert((-min_normal * half).bits() == 0x80000000u);
+        assert((FP32::fromBits(0x3F7FFFFFu) * min_normal).bits() == 0x00800000u);
+        assert((FP32::fromBits(0x00C00000u) - FP32::fromBits(0x00A00000u)).bits() == 0x00000000u);
+        // subnormal operands read as zero
+        assert((FP32::fromBits(1) + FP32::fromBits(1)).bits() == 0x00000000u);
+        assert((FP32(1.0f) / FP32::fromBits(0x80000001u)).bits() == 0xFF800000u);
+        assert(FP32::fromBits(0x00400000u).sqrt().bits() == 0x00000000u);
+        assert(fma(FP32::fromBits(1), FP32(1e30f), FP32(1.0f)).bits() == FP32(1.0f).bits());
+        
+        // a batched call runs the caller's mode on every pool thread
+        const size_t n = 200003;
+        std::vector<FP32> a(n, min_normal), b(n, half), out(n);
+        FP32::multiply(a.data(), b.data(), out.data(), n);
+        for (size_t i = 0; i < n; ++i) assert(out[i].bits() == 0);
+        
+        // and lazy expressions and the rounded reductions
+        FP32Vector x(n, min_normal), y(n, half);
+        FP32Vector lazy_result = evaluate(lazy(x) * y + lazy(x) * y);
+        for (size_t i = 0; i < n; ++i) assert(lazy_result[i].bits() == 0);
+        for (Summation method : {Summation::Naive, Summation::Pairwise, Summation::Kahan, Summation::Neumaier}) {
+            assert(dot(a.data(), b.data(), n, method).bits() == 0);
+        }
+        assert(dot(a.data(), b.data(), n, Summation::Widened).bits() != 0);
+    }
+    assert(subnormalMode() == SubnormalMode::Preserve);
+    assert((min_normal * half).bits() == 0x00400000u);
+    
+    // against the hardware's own flush-to-zero and denormals-are-zero
+    // (MXCSR FZ and DAZ), operands biased toward the bottom binades
+    size_t compared = 0;
+#ifdef __SSE2__
+    std::mt19937 rng(24);
+    std::uniform_int_distribution<uint32_t> any;
+    const unsigned csr = _mm_getcsr();
+    for (int i = 0; i < 400000; ++i) {
+        uint32_t a = any(rng), b = any(rng);
+        if (i & 1) a = (a & 0x807FFFFFu) | ((any(rng) % 30) << 23);
+        if (i & 2) b = (b & 0x807FFFFFu) | ((any(rng) % 140) << 23);
+        volatile float fa = FP32::fromBits(a).toFloat();
+        volatile float fb = FP32::fromBits(b).toFloat();
+        _mm_setcsr(csr | 0x8040);
+        float hw[5] = {fa + fb, fa - fb, fa * fb, fa / fb, std::sqrt(static_cast<float>(fa))};
+        _mm_setcsr(csr);
+        uint32_t ours[5] = {Flush::add(a, b), Flush::subtract(a, b), Flush::multiply(a, b), Flush::divide(a, b),
+                            Flush::sqrt(a)};
+        for (int k = 0; k < 5; ++k) {
+            FP32 h(hw[k]);
+            assert(h.isNaN() ? Flush::isNaN(ours[k]) : h.bits() == ours[k]);
+        }
+        compared += 5;
+    }
+#endif
+    
+    std::cout << compared << " results match MXCSR FZ + DAZ, batches, lazy expressions and reductions flush" << std::endl;
+}
+
+void testMethodBench() {
+    std::cout << "\nMethod Benchmark Harness" << std::endl;
+    
+    // against scipy.stats.t.ppf((1 + c) / 2, df), welch gives fractional df
+    assert(std::fabs(studentQuantile(0.95, 1) - 12.706205) < 1e-5);
+    assert(std::fabs(studentQuantile(0.95, 2) - 4.302653) < 1e-5);
+    assert(std::fabs(studentQuantile(0.95, 10) - 2.228139) < 1e-5);
+    assert(std::fabs(studentQuantile(0.99, 5) - 4.032143) < 1e-5);
+    assert(std::fabs(studentQuantile(0.99, 3.5) - 5.085702) < 1e-5);
+    assert(std::fabs(studentQuantile(0.95, 1e6) - 1.959966) < 1e-5);
+    
+    PerfEvents events;
+    bool switches = events.available(PerfEvent::ContextSwitches);
+    
+    const std::string csv_path = "method_bench_test.csv";
+    const std::string json_path = "method_bench_test.json";
+    const std::string baseline_path = "method_bench_baseline.csv";
+    std::vector<std::string> args = {"fp32_test", "--quiet", "--min-runs=5", "--max-runs=40", "--max-time=0.1",
+                                     "--warmup=2", "--sample=0.2", "--sizes=64,512"};
+    auto argv = [](std::vector<std::string>& list) {
+        std::vector<char*> out;
+        for (std::string& arg : list) out.push_back(&arg[0]);
+        return out;
+    };
+    
+    using Problem = std::vector<FP32>;
+    std::vector<std::pair<std::string, std::function<void(Problem&)>>> methods = {
+        {"sum", [](Problem& v) {
+             FP32 sum(0.0f);
+             for (const FP32& x : v) sum += x;
+             doNotOptimize(sum);
+         }},
+        {"scale", [](Problem& v) {
+             for (FP32& x : v) x = x * FP32(0.5f);
+         }},
+    };
+    auto setup = [](size_t n) { return Problem(n, FP32(1.5f)); };
+    {
+        std::vector<std::string> list = args;
+        list.push_back("--csv=" + csv_path);
+        list.push_back("--json=" + json_path);
+        std::vector<char*> v = argv(list);
+        MethodBench bench("fp32 methods", static_cast<int>(v.size()), v.data());
+        auto means = benchmarkMethods<Problem>(bench, methods, bench.sizes({1, 2, 3}), setup);
+        assert(means.size() == 2 && means[0].first == "sum" && means[1].first == "scale");
+        assert(means[0].second.size() == 2 && means[1].second.size() == 2);
+        assert(bench.results().size() == 4);
+        for (const MethodResult& r : bench.results()) {
+            assert(r.runs >= 5 && r.runs <= 40 && r.calls >= 1);
+            assert(r.min > 0 && r.min <= r.median && r.min <= r.mean && r.ci >= 0);
+            assert(r.counted[static_cast<size_t>(PerfEvent::ContextSwitches)] == switches);
+        }
+        // 512 elements take longer than 64
+        assert(means[0].second[1] > means[0].second[0]);
+        assert(bench.finish() == 0);
+    }
+    
+    std::ifstream csv(csv_path);
+    std::string line;
+    size_t rows = 0;
+    std::getline(csv, line);
+    assert(line.compare(0, 31, "suite,method,size,runs,calls,me") == 0);
+    assert(line.find(",cycles,instructions,cache_misses,context_switches") != std::string::npos);
+    while (std::getline(csv, line)) ++rows;
+    assert(rows == 4);
+    std::ifstream json(json_path);
+    std::string text((std::istreambuf_iterator<char>(json)), std::istreambuf_iterator<char>());
+    assert(text.find("\"sizes\": {\n    \"sum\": [64, 512]") != std::string::npos);
+    assert(text.find("\"results\": {\n    \"sum\": [") != std::string::npos);
+    
+    // against a baseline far slower and one far faster than any machine
+    for (double mean : {1.0, 1e-15}) {
+        std::ofstream baseline(baseline_path);
+        baseline << "method,size,runs,mean_s,stddev_s\nsum,64,10," << mean << "," << mean / 100 << "\n";
+        baseline.close();
+        std::vector<std::string> list = args;
+        list.push_back("--filter=sum");
+        list.push_back("--baseline=" + baseline_path);
+        std::vector<char*> v = argv(list);
+        MethodBench bench("fp32 methods", static_cast<int>(v.size()), v.data());
+        Problem problem = setup(64);
+        bench.run("sum", 64, [&] { methods[0].second(problem); });
+        assert(bench.finish() == (mean > 1e-3 ? 0 : 1));
+    }
+    
+#ifdef __linux__
+    // the whole pool onto the cpu the caller is on
+    assert(ThreadPool::instance().pin({sched_getcpu()}));
+#endif
+    
+    std::remove(csv_path.c_str());
+    std::remove(json_path.c_str());
+    std::remove(baseline_path.c_str());
+    std::cout << "t quantiles match, csv / json in benchmark_methods' shape, a slower run fails the baseline"
+              << std::endl;
+}
+
 int main() {
     
     testConstruction();
@@ -206,6 +1336,21 @@ int main() {
     testEdgeCases();
     testBitRepresentation();
     testPrecisionLoss();
+    testAddRounding();
+    testDivideRounding();
+    testConstexprAccessors();
+    testFMA();
+    testVector();
+    testThreadPool();
+    testSmallFloat();
+    testReductions();
+    testCharConversion();
+    testSqrt();
+    testOrder();
+    testExpr();
+    testCounters();
+    testSubnormalMode();
+    testMethodBench();
     
     std::cout << " All tests completed!" << std::endl;
     
@@ -0,0 +1,3 @@
+#include "FP32Vector.h"
+
+template class AlignedVector<FP32>;
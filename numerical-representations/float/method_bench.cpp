@@ -0,0 +1,511 @@
+#include "MethodBench.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <ctime>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <thread>
+
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+// quantiles
+
+// standard normal quantile, newton on erfc from 0. for p >= 1/2 the cdf is
+// concave on the way to the root, so the steps never overshoot
+static double normalQuantile(double p) {
+    if (p < 0.5) return -normalQuantile(1 - p);
+    double z = 0;
+    for (int i = 0; i < 60; ++i) {
+        double cdf = 0.5 * std::erfc(-z / std::sqrt(2.0));
+        double step = (cdf - p) / (std::exp(-0.5 * z * z) / std::sqrt(2 * M_PI));
+        z -= step;
+        if (std::fabs(step) < 1e-14 * (1 + std::fabs(z))) break;
+    }
+    return z;
+}
+
+// regularized incomplete beta I_x(a, b), the continued fraction evaluated
+// with lentz's method (numerical recipes 6.4)
+static double incompleteBeta(double a, double b, double x) {
+    if (x <= 0) return 0;
+    if (x >= 1) return 1;
+    // the fraction converges fast below the mean, use the symmetry above it
+    if (x > (a + 1) / (a + b + 2)) return 1 - incompleteBeta(b, a, 1 - x);
+
+    const double tiny = 1e-300;
+    double front = std::exp(std::lgamma(a + b) - std::lgamma(a) - std::lgamma(b) + a * std::log(x) +
+                            b * std::log1p(-x)) / a;
+    double c = 1, d = 1 - (a + b) * x / (a + 1);
+    d = 1 / (std::fabs(d) < tiny ? tiny : d);
+    double f = d;
+    for (int m = 1; m < 300; ++m) {
+        for (int odd = 0; odd < 2; ++odd) {
+            double num = odd ? -(a + m) * (a + b + m) * x / ((a + 2 * m) * (a + 2 * m + 1))
+                             : m * (b - m) * x / ((a + 2 * m - 1) * (a + 2 * m));
+            d = 1 + num * d;
+            d = 1 / (std::fabs(d) < tiny ? tiny : d);
+            c = 1 + num / c;
+            if (std::fabs(c) < tiny) c = tiny;
+            f *= c * d;
+            if (odd && std::fabs(c * d - 1) < 1e-15) return front * f;
+        }
+    }
+    return front * f;
+}
+
+// P(T <= t) for t >= 0
+static double studentCdf(double t, double df) {
+    return 1 - 0.5 * incompleteBeta(0.5 * df, 0.5, df / (df + t * t));
+}
+
+static double studentPdf(double t, double df) {
+    return std::exp(std::lgamma(0.5 * (df + 1)) - std::lgamma(0.5 * df) - 0.5 * std::log(df * M_PI) -
+                    0.5 * (df + 1) * std::log1p(t * t / df));
+}
+
+double studentQuantile(double confidence, double df) {
+    double p = 0.5 + 0.5 * confidence;   // one-sided
+    // closed forms for the two heaviest tails
+    if (df <= 1) return std::tan(M_PI * (p - 0.5));
+    if (df == 2) return (2 * p - 1) * std::sqrt(2 / (4 * p * (1 - p)));
+
+    // cornish-fisher expansion around the normal quantile (abramowitz and
+    // stegun 26.7.5) to start, then newton on the exact cdf; the expansion
+    // alone is 1% low at 3 degrees of freedom and 99%
+    double z = normalQuantile(p);
+    double z2 = z * z;
+    double g1 = z * (z2 + 1) / 4;
+    double g2 = z * ((5 * z2 + 16) * z2 + 3) / 96;
+    double g3 = z * (((3 * z2 + 19) * z2 + 17) * z2 - 15) / 384;
+    double g4 = z * ((((79 * z2 + 776) * z2 + 1482) * z2 - 1920) * z2 - 945) / 92160;
+    double t = z + (g1 + (g2 + (g3 + g4 / df) / df) / df) / df;
+    for (int i = 0; i < 20; ++i) {
+        double step = (studentCdf(t, df) - p) / studentPdf(t, df);
+        t -= step;
+        if (std::fabs(step) < 1e-12 * t) break;
+    }
+    return t;
+}
+
+// sample statistics
+
+struct Moments {
+    double mean = 0;
+    double stddev = 0;
+};
+
+static Moments moments(const std::vector<double>& xs) {
+    Moments m;
+    if (xs.empty()) return m;
+    for (double x : xs) m.mean += x;
+    m.mean /= static_cast<double>(xs.size());
+    if (xs.size() < 2) return m;
+    double ssq = 0;
+    for (double x : xs) ssq += (x - m.mean) * (x - m.mean);
+    m.stddev = std::sqrt(ssq / static_cast<double>(xs.size() - 1));
+    return m;
+}
+
+static double halfWidth(double confidence, double stddev, size_t n) {
+    if (n < 2) return INFINITY;
+    return studentQuantile(confidence, static_cast<double>(n - 1)) * stddev / std::sqrt(static_cast<double>(n));
+}
+
+// flags
+
+static std::vector<size_t> parseList(const std::string& text) {
+    std::vector<size_t> values;
+    std::stringstream ss(text);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        if (!item.empty()) values.push_back(std::strtoull(item.c_str(), nullptr, 10));
+    }
+    return values;
+}
+
+static bool startsWith(const std::string& s, const std::string& prefix) {
+    return s.compare(0, prefix.size(), prefix) == 0;
+}
+
+// the cpu the caller runs on now, where the pinning starts by default
+static int currentCpu() {
+#ifdef __linux__
+    int cpu = sched_getcpu();
+    return cpu < 0 ? 0 : cpu;
+#else
+    return 0;
+#endif
+}
+
+MethodBench::MethodBench(const std::string& suite, int argc, char** argv)
+    : suite_(suite), confidence_(0.95), rel_ci_(0.02), threshold_(0.03), min_runs_(10), max_runs_(1000),
+      max_time_ns_(5e9), warmup_ns_(100e6), sample_ns_(2e6), quiet_(false) {
+    bool pin = true;
+    int first_cpu = -1;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (startsWith(arg, "--csv=")) {
+            csv_path_ = arg.substr(6);
+        } else if (startsWith(arg, "--json=")) {
+            json_path_ = arg.substr(7);
+        } else if (startsWith(arg, "--baseline=")) {
+            baseline_path_ = arg.substr(11);
+        } else if (startsWith(arg, "--filter=")) {
+            filter_ = arg.substr(9);
+        } else if (startsWith(arg, "--sizes=")) {
+            sizes_ = parseList(arg.substr(8));
+        } else if (startsWith(arg, "--confidence=")) {
+            confidence_ = std::strtod(arg.c_str() + 13, nullptr);
+        } else if (startsWith(arg, "--rel-ci=")) {
+            rel_ci_ = std::strtod(arg.c_str() + 9, nullptr);
+        } else if (startsWith(arg, "--threshold=")) {
+            threshold_ = std::strtod(arg.c_str() + 12, nullptr);
+        } else if (startsWith(arg, "--min-runs=")) {
+            min_runs_ = std::max<size_t>(2, std::strtoull(arg.c_str() + 11, nullptr, 10));
+        } else if (startsWith(arg, "--max-runs=")) {
+            max_runs_ = std::max<size_t>(2, std::strtoull(arg.c_str() + 11, nullptr, 10));
+        } else if (startsWith(arg, "--max-time=")) {
+            max_time_ns_ = std::strtod(arg.c_str() + 11, nullptr) * 1e9;
+        } else if (startsWith(arg, "--warmup=")) {
+            warmup_ns_ = std::strtod(arg.c_str() + 9, nullptr) * 1e6;
+        } else if (startsWith(arg, "--sample=")) {
+            sample_ns_ = std::strtod(arg.c_str() + 9, nullptr) * 1e6;
+        } else if (startsWith(arg, "--threads=")) {
+            setThreadCount(std::strtoull(arg.c_str() + 10, nullptr, 10));
+        } else if (startsWith(arg, "--cpu=")) {
+            first_cpu = std::atoi(arg.c_str() + 6);
+        } else if (arg == "--no-pin") {
+            pin = false;
+        } else if (arg == "--quiet") {
+            quiet_ = true;
+        } else {
+            std::cerr << "unknown flag " << arg << " (see MethodBench.h)" << std::endl;
+            std::exit(2);
+        }
+    }
+    if (!(confidence_ > 0 && confidence_ < 1)) {
+        std::cerr << "--confidence must be in (0, 1)" << std::endl;
+        std::exit(2);
+    }
+    max_runs_ = std::max(max_runs_, min_runs_);
+
+    // consecutive cpus from the first, the caller on the first one
+    std::string pinned = "no";
+    if (pin) {
+        ThreadPool& pool = ThreadPool::instance();
+        int cpus = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+        if (first_cpu < 0) first_cpu = currentCpu();
+        std::vector<int> order;
+        std::ostringstream list;
+        for (size_t t = 0; t < pool.threads(); ++t) {
+            order.push_back((first_cpu + static_cast<int>(t)) % cpus);
+            list << (t ? "," : "") << order.back();
+        }
+        if (pool.pin(order)) {
+            pinned = list.str();
+        } else if (!quiet_) {
+            std::cerr << "could not pin the threads, running unpinned" << std::endl;
+        }
+    }
+
+    setContext("compiler", __VERSION__);
+    setContext("num_cpus", std::to_string(std::thread::hardware_concurrency()));
+    setContext("threads", std::to_string(threadCount()));
+    setContext("pinned_cpus", pinned);
+    std::ostringstream stopping;
+    stopping << "ci " << rel_ci_ << " of the mean at " << confidence_ << ", " << min_runs_ << " to "
+             << max_runs_ << " runs";
+    setContext("stopping", stopping.str());
+}
+
+std::vector<size_t> MethodBench::sizes(const std::vector<size_t>& defaults) const {
+    return sizes_.empty() ? defaults : sizes_;
+}
+
+bool MethodBench::enabled(const std::string& method) const {
+    return filter_.empty() || method.find(filter_) != std::string::npos;
+}
+
+void MethodBench::setContext(const std::string& key, const std::string& value) {
+    context_.emplace_back(key, value);
+}
+
+bool MethodBench::withinInterval(const std::vector<double>& runs) const {
+    Moments m = moments(runs);
+    return halfWidth(confidence_, m.stddev, runs.size()) <= rel_ci_ * m.mean;
+}
+
+const MethodResult& MethodBench::record(const std::string& name, size_t size, uint64_t calls,
+                                        const std::vector<double>& runs, const PerfReading& counts,
+                                        bool converged) {
+    MethodResult r;
+    r.method = name;
+    r.size = size;
+    r.runs = runs.size();
+    r.calls = calls;
+    Moments m = moments(runs);
+    r.mean = m.mean;
+    r.stddev = m.stddev;
+    r.ci = halfWidth(confidence_, m.stddev, runs.size());
+    std::vector<double> sorted = runs;
+    std::sort(sorted.begin(), sorted.end());
+    r.min = sorted.front();
+    size_t mid = sorted.size() / 2;
+    r.median = sorted.size() % 2 ? sorted[mid] : 0.5 * (sorted[mid - 1] + sorted[mid]);
+    r.converged = converged;
+    double total_calls = static_cast<double>(calls) * static_cast<double>(runs.size());
+    for (size_t e = 0; e < PERF_EVENTS; ++e) {
+        r.counted[e] = counts.counted[e];
+        r.counters[e] = counts.counted[e] ? static_cast<double>(counts.values[e]) / total_calls : 0;
+    }
+    results_.push_back(r);
+
+    if (!quiet_) {
+        if (results_.size() == 1) {
+            std::cout << suite_ << ", mean to within " << rel_ci_ * 100 << "% at " << confidence_ * 100
+                      << "% confidence" << std::endl;
+            std::cout << std::left << std::setw(28) << "method" << std::right << std::setw(14) << "mean us"
+                      << std::setw(10) << "+-%" << std::setw(8) << "runs" << std::setw(14) << "cycles"
+                      << std::setw(10) << "ipc" << std::endl;
+        }
+        std::ostringstream label;
+        label << name << "/" << size;
+        std::cout << std::left << std::setw(28) << label.str() << std::right << std::fixed << std::setprecision(3)
+                  << std::setw(14) << r.mean * 1e6 << std::setw(10) << std::setprecision(2)
+                  << 100 * r.ci / r.mean << std::setw(8) << r.runs << (r.converged ? " " : "*");
+        size_t cycles = static_cast<size_t>(PerfEvent::Cycles);
+        size_t instructions = static_cast<size_t>(PerfEvent::Instructions);
+        if (r.counted[cycles]) {
+            std::cout << std::setw(13) << std::setprecision(0) << r.counters[cycles];
+        } else {
+            std::cout << std::setw(13) << "-";
+        }
+        if (r.counted[cycles] && r.counted[instructions] && r.counters[cycles] > 0) {
+            std::cout << std::setw(10) << std::setprecision(2) << r.counters[instructions] / r.counters[cycles];
+        } else {
+            std::cout << std::setw(10) << "-";
+        }
+        std::cout << std::defaultfloat << std::endl;
+    }
+    return results_.back();
+}
+
+// output
+
+static std::string jsonString(const std::string& s) {
+    std::string out = "\"";
+    for (char c : s) {
+        if (c == '"' || c == '\\') out += '\\';
+        out += c;
+    }
+    return out + "\"";
+}
+
+static const char* const CSV_COLUMNS[] = {"suite", "method", "size", "runs", "calls", "mean_s", "stddev_s",
+                                          "min_s", "median_s", "ci_s", "converged"};
+
+bool MethodBench::writeCsv() const {
+    std::ofstream out(csv_path_);
+    if (!out) {
+        std::cerr << "cannot write " << csv_path_ << std::endl;
+        return false;
+    }
+    for (size_t c = 0; c < sizeof(CSV_COLUMNS) / sizeof(CSV_COLUMNS[0]); ++c) out << (c ? "," : "") << CSV_COLUMNS[c];
+    for (size_t e = 0; e < PERF_EVENTS; ++e) out << "," << perfEventName(static_cast<PerfEvent>(e));
+    out << "\n" << std::setprecision(9);
+
+    // an uncounted event is an empty field, pandas reads it as nan
+    for (const MethodResult& r : results_) {
+        out << suite_ << "," << r.method << "," << r.size << "," << r.runs << "," << r.calls << "," << r.mean
+            << "," << r.stddev << "," << r.min << "," << r.median << "," << r.ci << "," << (r.converged ? 1 : 0);
+        for (size_t e = 0; e < PERF_EVENTS; ++e) {
+            out << ",";
+            if (r.counted[e]) out << r.counters[e];
+        }
+        out << "\n";
+    }
+    if (!quiet_) std::cout << "wrote " << csv_path_ << std::endl;
+    return true;
+}
+
+bool MethodBench::writeJson() const {
+    std::ofstream out(json_path_);
+    if (!out) {
+        std::cerr << "cannot write " << json_path_ << std::endl;
+        return false;
+    }
+
+    char date[32];
+    std::time_t now = std::time(nullptr);
+    std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%SZ", std::gmtime(&now));
+
+    // methods in the order they first ran
+    std::vector<std::string> methods;
+    for (const MethodResult& r : results_) {
+        if (std::find(methods.begin(), methods.end(), r.method) == methods.end()) methods.push_back(r.method);
+    }
+
+    out << "{\n  \"context\": {\n";
+    out << "    \"suite\": " << jsonString(suite_) << ",\n";
+    out << "    \"date\": " << jsonString(date);
+    for (const auto& kv : context_) {
+        out << ",\n    " << jsonString(kv.first) << ": " << jsonString(kv.second);
+    }
+    out << "\n  },\n" << std::setprecision(9);
+
+    // benchmark_methods' shape: method -> sizes, method -> mean seconds
+    for (int pass = 0; pass < 2; ++pass) {
+        out << (pass == 0 ? "  \"sizes\": {" : "  \"results\": {");
+        for (size_t m = 0; m < methods.size(); ++m) {
+            out << (m ? ",\n    " : "\n    ") << jsonString(methods[m]) << ": [";
+            bool first = true;
+            for (const MethodResult& r : results_) {
+                if (r.method != methods[m]) continue;
+                out << (first ? "" : ", ");
+                if (pass == 0) {
+                    out << r.size;
+                } else {
+                    out << r.mean;
+                }
+                first = false;
+            }
+            out << "]";
+        }
+        out << "\n  },\n";
+    }
+
+    out << "  \"benchmarks\": [";
+    for (size_t i = 0; i < results_.size(); ++i) {
+        const MethodResult& r = results_[i];
+        out << (i ? ",\n" : "\n") << "    {\"name\": " << jsonString(r.method + "/" + std::to_string(r.size))
+            << ", \"method\": " << jsonString(r.method) << ", \"size\": " << r.size << ", \"runs\": " << r.runs
+            << ", \"calls\": " << r.calls << ", \"mean_s\": " << r.mean << ", \"stddev_s\": " << r.stddev
+            << ", \"min_s\": " << r.min << ", \"median_s\": " << r.median << ", \"ci_s\": " << r.ci
+            << ", \"converged\": " << (r.converged ? "true" : "false");
+        for (size_t e = 0; e < PERF_EVENTS; ++e) {
+            out << ", \"" << perfEventName(static_cast<PerfEvent>(e)) << "\": ";
+            if (r.counted[e]) {
+                out << r.counters[e];
+            } else {
+                out << "null";
+            }
+        }
+        out << "}";
+    }
+    out << "\n  ]\n}\n";
+
+    if (!quiet_) std::cout << "wrote " << json_path_ << std::endl;
+    return true;
+}
+
+// baseline
+
+struct BaselineRow {
+    double mean = 0;
+    double stddev = 0;
+    double runs = 0;
+};
+
+static std::vector<std::string> splitCsv(const std::string& line) {
+    std::vector<std::string> fields;
+    std::stringstream ss(line);
+    std::string field;
+    while (std::getline(ss, field, ',')) fields.push_back(field);
+    if (!line.empty() && line.back() == ',') fields.emplace_back();
+    return fields;
+}
+
+int MethodBench::compareBaseline() const {
+    std::ifstream in(baseline_path_);
+    std::string line;
+    if (!in || !std::getline(in, line)) {
+        std::cerr << "cannot read baseline " << baseline_path_ << std::endl;
+        return 1;
+    }
+
+    // columns by name, so an older csv with fewer counters still reads
+    std::vector<std::string> header = splitCsv(line);
+    auto column = [&](const char* name) {
+        auto it = std::find(header.begin(), header.end(), name);
+        return it == header.end() ? -1 : static_cast<int>(it - header.begin());
+    };
+    int method_col = column("method"), size_col = column("size"), runs_col = column("runs");
+    int mean_col = column("mean_s"), stddev_col = column("stddev_s");
+    if (method_col < 0 || size_col < 0 || runs_col < 0 || mean_col < 0 || stddev_col < 0) {
+        std::cerr << baseline_path_ << " is not a MethodBench csv" << std::endl;
+        return 1;
+    }
+    int last = std::max({method_col, size_col, runs_col, mean_col, stddev_col});
+
+    std::map<std::pair<std::string, size_t>, BaselineRow> baseline;
+    while (std::getline(in, line)) {
+        std::vector<std::string> fields = splitCsv(line);
+        if (static_cast<int>(fields.size()) <= last) continue;
+        BaselineRow row;
+        row.mean = std::strtod(fields[mean_col].c_str(), nullptr);
+        row.stddev = std::strtod(fields[stddev_col].c_str(), nullptr);
+        row.runs = std::strtod(fields[runs_col].c_str(), nullptr);
+        baseline[{fields[method_col], std::strtoull(fields[size_col].c_str(), nullptr, 10)}] = row;
+    }
+
+    if (!quiet_) {
+        std::cout << "against " << baseline_path_ << ", welch t-test at " << confidence_ * 100
+                  << "% and a " << threshold_ * 100 << "% threshold" << std::endl;
+        std::cout << std::left << std::setw(28) << "method" << std::right << std::setw(14) << "baseline us"
+                  << std::setw(14) << "now us" << std::setw(10) << "change" << "  verdict" << std::endl;
+    }
+    size_t slower = 0;
+    for (const MethodResult& r : results_) {
+        auto it = baseline.find({r.method, r.size});
+        if (it == baseline.end()) continue;
+        const BaselineRow& b = it->second;
+
+        // welch: unequal variances, satterthwaite degrees of freedom
+        double va = b.runs > 0 ? b.stddev * b.stddev / b.runs : 0;
+        double vb = r.runs > 0 ? r.stddev * r.stddev / static_cast<double>(r.runs) : 0;
+        double se = std::sqrt(va + vb);
+        double change = b.mean > 0 ? r.mean / b.mean - 1 : 0;
+        bool significant;
+        if (se > 0) {
+            double df = (va + vb) * (va + vb) /
+                        ((b.runs > 1 ? va * va / (b.runs - 1) : 0) +
+                         (r.runs > 1 ? vb * vb / static_cast<double>(r.runs - 1) : 0));
+            double t = (r.mean - b.mean) / se;
+            significant = std::fabs(t) > studentQuantile(confidence_, std::max(df, 1.0));
+        } else {
+            significant = r.mean != b.mean;
+        }
+
+        const char* verdict = "same";
+        if (significant && change > threshold_) {
+            verdict = "SLOWER";
+            ++slower;
+        } else if (significant && change < -threshold_) {
+            verdict = "faster";
+        }
+        if (!quiet_) {
+            std::ostringstream label;
+            label << r.method << "/" << r.size;
+            std::cout << std::left << std::setw(28) << label.str() << std::right << std::fixed
+                      << std::setprecision(3) << std::setw(14) << b.mean * 1e6 << std::setw(14) << r.mean * 1e6
+                      << std::setw(9) << std::setprecision(1) << std::showpos << change * 100 << std::noshowpos
+                      << "%  " << verdict << std::defaultfloat << std::endl;
+        }
+    }
+    return slower == 0 ? 0 : 1;
+}
+
+int MethodBench::finish() {
+    int status = 0;
+    if (!csv_path_.empty() && !writeCsv()) status = 1;
+    if (!json_path_.empty() && !writeJson()) status = 1;
+    if (!baseline_path_.empty() && compareBaseline() != 0) status = 1;
+    return status;
+}
@@ -0,0 +1,124 @@
+#include "MicroBench.h"
+#include <cstdlib>
+#include <ctime>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <thread>
+
+static std::vector<size_t> parseList(const std::string& text) {
+    std::vector<size_t> values;
+    std::stringstream ss(text);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        if (!item.empty()) values.push_back(std::strtoull(item.c_str(), nullptr, 10));
+    }
+    return values;
+}
+
+static bool startsWith(const std::string& s, const std::string& prefix) {
+    return s.compare(0, prefix.size(), prefix) == 0;
+}
+
+MicroBench::MicroBench(const std::string& suite, int argc, char** argv)
+    : suite_(suite), batches_{16, 1024, 65536, 1048576}, min_time_ns_(20e6) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (startsWith(arg, "--json=")) {
+            json_path_ = arg.substr(7);
+        } else if (startsWith(arg, "--filter=")) {
+            filter_ = arg.substr(9);
+        } else if (startsWith(arg, "--min-time=")) {
+            min_time_ns_ = std::strtod(arg.c_str() + 11, nullptr) * 1e6;
+        } else if (startsWith(arg, "--batches=")) {
+            batches_ = parseList(arg.substr(10));
+        } else {
+            std::cerr << "unknown flag " << arg << " (see MicroBench.h)" << std::endl;
+            std::exit(2);
+        }
+    }
+
+    setContext("compiler", __VERSION__);
+    setContext("num_cpus", std::to_string(std::thread::hardware_concurrency()));
+}
+
+bool MicroBench::enabled(const std::string& name) const {
+    return filter_.empty() || name.find(filter_) != std::string::npos;
+}
+
+void MicroBench::setContext(const std::string& key, const std::string& value) {
+    context_.emplace_back(key, value);
+}
+
+void MicroBench::record(const BenchResult& result) {
+    results_.push_back(result);
+
+    if (results_.size() == 1) {
+        std::cout << suite_ << " vs native float, best of 5 samples" << std::endl;
+        std::cout << std::left << std::setw(24) << "case" << std::right
+                  << std::setw(12) << "ns/op" << std::setw(14) << "ops/s"
+                  << std::setw(12) << "native ns" << std::setw(12) << "slowdown" << std::endl;
+    }
+
+    // one line per case as it finishes, the run takes a while
+    const BenchResult& r = result;
+    std::ostringstream name;
+    name << r.name << "/" << r.batch;
+    std::cout << std::left << std::setw(24) << name.str() << std::right << std::fixed
+              << std::setprecision(3)
+              << std::setw(12) << r.ns_per_op
+              << std::setw(14) << std::setprecision(0) << 1e9 / r.ns_per_op
+              << std::setw(12) << std::setprecision(3) << r.native_ns_per_op
+              << std::setw(11) << std::setprecision(1) << r.ns_per_op / r.native_ns_per_op << "x"
+              << std::endl;
+}
+
+static std::string jsonString(const std::string& s) {
+    std::string out = "\"";
+    for (char c : s) {
+        if (c == '"' || c == '\\') out += '\\';
+        out += c;
+    }
+    return out + "\"";
+}
+
+int MicroBench::finish() {
+    if (json_path_.empty()) return 0;
+
+    std::ofstream out(json_path_);
+    if (!out) {
+        std::cerr << "cannot write " << json_path_ << std::endl;
+        return 1;
+    }
+
+    char date[32];
+    std::time_t now = std::time(nullptr);
+    std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%SZ", std::gmtime(&now));
+
+    out << "{\n  \"context\": {\n";
+    out << "    \"suite\": " << jsonString(suite_) << ",\n";
+    out << "    \"date\": " << jsonString(date);
+    for (const auto& kv : context_) {
+        out << ",\n    " << jsonString(kv.first) << ": " << jsonString(kv.second);
+    }
+    out << "\n  },\n  \"benchmarks\": [";
+
+    out << std::setprecision(6);
+    for (size_t i = 0; i < results_.size(); ++i) {
+        const BenchResult& r = results_[i];
+        out << (i ? ",\n" : "\n")
+            << "    {\"name\": " << jsonString(r.name + "/" + std::to_string(r.batch))
+            << ", \"op\": " << jsonString(r.name)
+            << ", \"batch\": " << r.batch
+            << ", \"iterations\": " << r.iterations
+            << ", \"ns_per_op\": " << r.ns_per_op
+            << ", \"ops_per_sec\": " << 1e9 / r.ns_per_op
+            << ", \"native_ns_per_op\": " << r.native_ns_per_op
+            << ", \"slowdown\": " << r.ns_per_op / r.native_ns_per_op << "}";
+    }
+    out << "\n  ]\n}\n";
+
+    std::cout << "wrote " << json_path_ << std::endl;
+    return 0;
+}
@@ -0,0 +1,75 @@
+#include "PerfEvents.h"
+
+#ifdef __linux__
+#include <cstring>
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+static const char* const EVENT_NAMES[PERF_EVENTS] = {"cycles", "instructions", "cache_misses",
+                                                     "context_switches"};
+
+const char* perfEventName(PerfEvent event) { return EVENT_NAMES[static_cast<size_t>(event)]; }
+
+PerfReading PerfReading::operator-(const PerfReading& earlier) const {
+    PerfReading d;
+    for (size_t e = 0; e < PERF_EVENTS; ++e) {
+        d.counted[e] = counted[e] && earlier.counted[e];
+        d.values[e] = d.counted[e] ? values[e] - earlier.values[e] : 0;
+    }
+    return d;
+}
+
+#ifdef __linux__
+
+static int openEvent(uint32_t type, uint64_t config) {
+    perf_event_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+}
+
+PerfEvents::PerfEvents() {
+    fds_[0] = openEvent(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+    fds_[1] = openEvent(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+    fds_[2] = openEvent(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES);
+    fds_[3] = openEvent(PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CONTEXT_SWITCHES);
+}
+
+PerfEvents::~PerfEvents() {
+    for (int fd : fds_) {
+        if (fd >= 0) close(fd);
+    }
+}
+
+PerfReading PerfEvents::read() const {
+    PerfReading r;
+    for (size_t e = 0; e < PERF_EVENTS; ++e) {
+        // value, time enabled, time running
+        uint64_t data[3];
+        if (fds_[e] < 0 || ::read(fds_[e], data, sizeof(data)) != static_cast<ssize_t>(sizeof(data))) continue;
+        if (data[2] == 0) continue;   // never scheduled on the pmu
+        double scale = data[1] > data[2] ? static_cast<double>(data[1]) / static_cast<double>(data[2]) : 1.0;
+        r.values[e] = static_cast<uint64_t>(static_cast<double>(data[0]) * scale);
+        r.counted[e] = true;
+    }
+    return r;
+}
+
+#else
+
+PerfEvents::PerfEvents() {
+    for (int& fd : fds_) fd = -1;
+}
+
+PerfEvents::~PerfEvents() {}
+
+PerfReading PerfEvents::read() const { return PerfReading(); }
+
+#endif
@@ -0,0 +1,55 @@
+#include "Simd.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define SIMD_X86 1
+#endif
+
+#if defined(__aarch64__) && defined(__ARM_NEON)
+#define SIMD_NEON 1
+#endif
+
+bool simdLevelSupported(SimdLevel level) {
+    switch (level) {
+    case SimdLevel::Scalar:
+        return true;
+#ifdef SIMD_X86
+    case SimdLevel::AVX2:
+        return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+    case SimdLevel::AVX512:
+        return __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw") &&
+               __builtin_cpu_supports("avx512vl");
+    case SimdLevel::AVX512BF16:
+        return __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw") &&
+               __builtin_cpu_supports("avx512vl") && __builtin_cpu_supports("avx512bf16");
+#endif
+#ifdef SIMD_NEON
+    case SimdLevel::NEON:
+        return true; // baseline on aarch64
+#endif
+    default:
+        return false;
+    }
+}
+
+SimdLevel detectSimdLevel() {
+    static const SimdLevel level = [] {
+        const SimdLevel order[] = {SimdLevel::AVX512BF16, SimdLevel::AVX512,
+                                   SimdLevel::AVX2, SimdLevel::NEON};
+        for (SimdLevel candidate : order) {
+            if (simdLevelSupported(candidate)) return candidate;
+        }
+        return SimdLevel::Scalar;
+    }();
+    return level;
+}
+
+const char* simdLevelName(SimdLevel level) {
+    switch (level) {
+    case SimdLevel::Scalar:     return "scalar";
+    case SimdLevel::AVX2:       return "avx2";
+    case SimdLevel::AVX512:     return "avx512";
+    case SimdLevel::AVX512BF16: return "avx512_bf16";
+    case SimdLevel::NEON:       return "neon";
+    }
+    return "unknown";
+}
@@ -0,0 +1,241 @@
+#include "ThreadPool.h"
+#include <algorithm>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+// set while a thread is running chunks, nested jobs then run inline
+static thread_local bool in_pool_job = false;
+
+ThreadPool::ThreadPool(size_t threads)
+    : stop_(false), generation_(0), busy_(0),
+      body_(nullptr), n_(0), grain_(1), remaining_(0) {
+    start(threads);
+}
+
+ThreadPool::~ThreadPool() {
+    stop();
+}
+
+ThreadPool& ThreadPool::instance() {
+    static ThreadPool pool;
+    return pool;
+}
+
+// lifetime
+
+void ThreadPool::start(size_t threads) {
+    if (threads == 0) threads = std::thread::hardware_concurrency();
+    if (threads == 0) threads = 1;
+
+    runs_.reset(new Run[threads]);
+    stop_ = false;
+    for (size_t i = 1; i < threads; ++i) {
+        // hand over the current generation, a worker that read it itself
+        // could start after the first job and sleep through it
+        workers_.emplace_back(&ThreadPool::workerLoop, this, i, generation_);
+    }
+}
+
+void ThreadPool::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    wake_.notify_all();
+    for (std::thread& worker : workers_) {
+        worker.join();
+    }
+    workers_.clear();
+}
+
+void ThreadPool::resize(size_t threads) {
+    std::lock_guard<std::mutex> lock(submit_);
+    stop();
+    start(threads);
+}
+
+#ifdef __linux__
+
+static bool pinThread(pthread_t thread, int cpu) {
+    if (cpu < 0 || cpu >= CPU_SETSIZE) return false;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return pthread_setaffinity_np(thread, sizeof(set), &set) == 0;
+}
+
+bool ThreadPool::pin(const std::vector<int>& cpus) {
+    if (cpus.empty()) return false;
+    std::lock_guard<std::mutex> lock(submit_);
+    bool pinned = pinThread(pthread_self(), cpus[0]);
+    for (size_t i = 0; i < workers_.size(); ++i) {
+        pinned = pinThread(workers_[i].native_handle(), cpus[(i + 1) % cpus.size()]) && pinned;
+    }
+    return pinned;
+}
+
+#else
+
+bool ThreadPool::pin(const std::vector<int>&) {
+    return false;
+}
+
+#endif
+
+// jobs
+
+void ThreadPool::parallelFor(size_t n, size_t grain, const RangeFn& body) {
+    if (n == 0) return;
+    grain = std::max<size_t>(grain, 1);
+    size_t chunks = (n + grain - 1) / grain;
+
+    if (in_pool_job || workers_.empty() || chunks == 1) {
+        body(0, n);
+        return;
+    }
+
+    std::lock_guard<std::mutex> submit(submit_);
+
+    // every thread starts on its own contiguous run of chunks
+    size_t count = threads();
+    for (size_t i = 0; i < count; ++i) {
+        std::lock_guard<std::mutex> lock(runs_[i].lock);
+        runs_[i].begin = chunks * i / count;
+        runs_[i].end = chunks * (i + 1) / count;
+    }
+
+    body_ = &body;
+    n_ = n;
+    grain_ = grain;
+    remaining_ = chunks;
+    error_ = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        busy_ = workers_.size();
+        ++generation_;
+    }
+    wake_.notify_all();
+
+    in_pool_job = true;
+    drain(0);
+    in_pool_job = false;
+
+    // workers must have left the job before its state is reused
+    std::exception_ptr error;
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        done_.wait(lock, [this] { return remaining_ == 0 && busy_ == 0; });
+        body_ = nullptr;
+        std::swap(error, error_);
+    }
+    if (error) std::rethrow_exception(error);
+}
+
+void ThreadPool::workerLoop(size_t self, uint64_t seen) {
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            wake_.wait(lock, [&] { return stop_ || generation_ != seen; });
+            if (stop_) return;
+            seen = generation_;
+        }
+
+        in_pool_job = true;
+        drain(self);
+        in_pool_job = false;
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (--busy_ == 0) done_.notify_all();
+    }
+}
+
+void ThreadPool::drain(size_t self) {
+    size_t chunk;
+    while (takeChunk(self, chunk)) {
+        runChunk(chunk);
+    }
+}
+
+bool ThreadPool::takeChunk(size_t self, size_t& chunk) {
+    Run& own = runs_[self];
+    {
+        std::lock_guard<std::mutex> lock(own.lock);
+        if (own.begin < own.end) {
+            chunk = own.begin++;
+            return true;
+        }
+    }
+
+    // own run is empty, steal the back half of someone else's
+    size_t count = threads();
+    for (size_t k = 1; k < count; ++k) {
+        Run& victim = runs_[(self + k) % count];
+        size_t first, last;
+        {
+            std::lock_guard<std::mutex> lock(victim.lock);
+            size_t left = victim.end - victim.begin;
+            if (left == 0) continue;
+            first = victim.end - (left + 1) / 2;
+            last = victim.end;
+            victim.end = first;
+        }
+
+        chunk = first;
+        if (last - first > 1) {
+            std::lock_guard<std::mutex> lock(own.lock);
+            own.begin = first + 1;
+            own.end = last;
+        }
+        return true;
+    }
+    return false;
+}
+
+void ThreadPool::runChunk(size_t chunk) {
+    size_t begin = chunk * grain_;
+    size_t end = std::min(n_, begin + grain_);
+
+    try {
+        (*body_)(begin, end);
+    } catch (...) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!error_) error_ = std::current_exception();
+    }
+
+    if (remaining_.fetch_sub(1) == 1) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        done_.notify_all();
+    }
+}
+
+// settings
+
+static std::atomic<size_t> parallel_threshold(size_t(1) << 16);
+static std::atomic<ReductionMode> reduction_mode(ReductionMode::Deterministic);
+
+void setThreadCount(size_t threads) {
+    ThreadPool::instance().resize(threads);
+}
+
+size_t threadCount() {
+    return ThreadPool::instance().threads();
+}
+
+void setParallelThreshold(size_t elements) {
+    parallel_threshold = elements;
+}
+
+size_t parallelThreshold() {
+    return parallel_threshold;
+}
+
+void setReductionMode(ReductionMode mode) {
+    reduction_mode = mode;
+}
+
+ReductionMode reductionMode() {
+    return reduction_mode;
+}